@@ -14,10 +14,12 @@
 #include <imgui.h>
 
 #include "manager/SessionManager.hpp"
+#include "manager/PlayerManager.hpp"
 #include "manager/AsyncTaskManager.hpp"
 
 #include "task/AsyncTaskPushSession.hpp"
 #include "task/AsyncTaskExportSession.hpp"
+#include "task/AsyncTaskExportAnimation.hpp"
 
 #include "Macro.hpp"
 
@@ -214,4 +216,30 @@ void OpenSessionSourceFolder() {
     std::thread([command] { std::system(command.c_str()); }).detach();
 }
 
+void ExportAnimationPromptPath() {
+    auto& sessionManager = SessionManager::getInstance();
+    auto& asyncTaskManager = AsyncTaskManager::getInstance();
+
+    if (!sessionManager.anySessionOpened() || asyncTaskManager.hasTaskOfType<AsyncTaskExportAnimation>())
+        return;
+
+    const char* filterPatterns[] = { "*.png" };
+    char* savePath = tinyfd_saveFileDialog(
+        "Select a file to save to",
+        nullptr,
+        ARRAY_LENGTH(filterPatterns), filterPatterns,
+        "Animated PNG files"
+    );
+
+    if (savePath) {
+        auto& playerManager = PlayerManager::getInstance();
+
+        asyncTaskManager.startTask<AsyncTaskExportAnimation>(
+            sessionManager.getCurrentSession(),
+            playerManager.getAnimationIndex(), playerManager.getFrameRate(),
+            std::string(savePath)
+        );
+    }
+}
+
 } // namespace Actions
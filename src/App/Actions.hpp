@@ -9,6 +9,8 @@ void ExportSession();
 void ExportSessionAsOther();
 void OpenSessionSourceFolder();
 
+void ExportAnimationPromptPath();
+
 } // namespace Actions
 
 #endif // ACTIONS_HPP
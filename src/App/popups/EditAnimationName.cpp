@@ -6,6 +6,8 @@
 
 #include <string>
 
+#include <utility>
+
 #include "manager/SessionManager.hpp"
 #include "command/CommandModifyAnimationName.hpp"
 
@@ -31,8 +33,8 @@ void Popups::EditAnimationName::update() {
 
     if (!lateOpen && open) {
         const auto& animation =
-            sessionManager.getCurrentSession()->getCurrentCellAnim().object
-                ->getAnimation(mAnimationIndex);
+            std::as_const(*sessionManager.getCurrentSession()->getCurrentCellAnim().object)
+                .getAnimation(mAnimationIndex);
 
         strncpy(newName, animation.name.c_str(), sizeof(newName) - 1);
         newName[sizeof(newName) - 1] = '\0';
@@ -2,6 +2,8 @@
 
 #include <imgui.h>
 
+#include <utility>
+
 #include "manager/SessionManager.hpp"
 
 #include "command/CommandModifyArrangementPart.hpp"
@@ -30,9 +32,9 @@ void Popups::EditPartName::update() {
 
     if (!lateOpen && open) {
         const CellAnim::ArrangementPart& part =
-            sessionManager.getCurrentSession()
-                ->getCurrentCellAnim().object
-                ->getArrangement(mArrangementIndex).parts.at(mPartIndex);
+            std::as_const(*sessionManager.getCurrentSession()
+                ->getCurrentCellAnim().object)
+                .getArrangement(mArrangementIndex).parts.at(mPartIndex);
 
         if (!part.editorName.empty())
             newName = part.editorName;
@@ -51,9 +53,9 @@ void Popups::EditPartName::update() {
 
         if (ImGui::Button("OK", { 120.f, 0.f })) {
             CellAnim::ArrangementPart newPart =
-                sessionManager.getCurrentSession()
-                ->getCurrentCellAnim().object
-                ->getArrangement(mArrangementIndex).parts.at(mPartIndex);
+                std::as_const(*sessionManager.getCurrentSession()
+                ->getCurrentCellAnim().object)
+                .getArrangement(mArrangementIndex).parts.at(mPartIndex);
 
             newPart.editorName = newName;
 
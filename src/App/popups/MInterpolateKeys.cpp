@@ -6,6 +6,8 @@
 
 #include <array>
 
+#include "Toast.hpp"
+
 #include "util/BezierUtil.hpp"
 
 #include "cellanim/CellAnim.hpp"
@@ -27,7 +29,7 @@
 static void _ApplyInterpolation(
     const std::array<float, 4>& curve,
     int interval, // Spacing between frames.
-    CellAnim::AnimationKey& backKey, const CellAnim::AnimationKey& frontKey,
+    const CellAnim::AnimationKey& backKey, const CellAnim::AnimationKey& frontKey,
     const CellAnim::Animation& animation, unsigned animationIndex
 ) {
     auto currentSession = SessionManager::getInstance().getCurrentSession();
@@ -82,13 +84,13 @@ void Popups::MInterpolateKeys::update() {
 
     static CellAnim::Animation animationBackup { CellAnim::Animation {} };
 
-    CellAnim::Animation* currentAnimation { nullptr };
+    const CellAnim::Animation* currentAnimation { nullptr };
     unsigned animationIndex;
 
-    CellAnim::AnimationKey* currentKey { nullptr };
+    const CellAnim::AnimationKey* currentKey { nullptr };
     int currentKeyIndex = -1;
 
-    CellAnim::AnimationKey* nextKey { nullptr };
+    const CellAnim::AnimationKey* nextKey { nullptr };
 
     if (condition) {
         currentAnimation = &playerManager.getAnimation();
@@ -106,7 +108,7 @@ void Popups::MInterpolateKeys::update() {
     }
 
     if (!active && lateOpen && condition) {
-        *currentAnimation = animationBackup;
+        playerManager.editAnimation() = animationBackup;
         playerManager.validateState();
 
         lateOpen = false;
@@ -225,6 +227,9 @@ void Popups::MInterpolateKeys::update() {
 
             float t = fmodf((float)ImGui::GetTime(), 1.f);
 
+            // The preview animates continuously.
+            Toast::getInstance()->requestUpdates();
+
             ImGui::ProgressBar(BezierUtil::ApproxY(t, v.data()));
         }
 
@@ -58,8 +58,8 @@ void Popups::MOptimizeGlobal::update() {
         ImGui::Dummy({ 0.f, 12.f });
 
         ImGui::TextUnformatted(
-            "This action is irreversible; You won't be able to undo this\n"
-            "action or any action before it."
+            "Edits made while the cellanim is being optimized will cancel\n"
+            "the optimization. This action can be undone."
         );
 
         ImGui::Dummy({ 0.f, 3.f });
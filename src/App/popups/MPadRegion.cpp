@@ -31,7 +31,7 @@ void Popups::MPadRegion::update() {
     if (!active && lateOpen && openConditions) {
         SelectionState& selectionState = sessionManager.getCurrentSession()->getPartSelectState();
 
-        auto& part = playerManager.getArrangement().parts.at(selectionState.mSelected[0].index);
+        auto& part = playerManager.editArrangement().parts.at(selectionState.mSelected[0].index);
 
         part.cellOrigin = origCellOrigin;
         part.cellSize = origCellSize;
@@ -44,7 +44,8 @@ void Popups::MPadRegion::update() {
     if (active && openConditions) {
         SelectionState& selectionState = sessionManager.getCurrentSession()->getPartSelectState();
 
-        auto& part = playerManager.getArrangement().parts.at(selectionState.mSelected[0].index);
+        const unsigned partIndex = selectionState.mSelected[0].index;
+        const auto& part = playerManager.getArrangement().parts.at(partIndex);
 
         if (!lateOpen) {
             origCellOrigin = part.cellOrigin;
@@ -67,12 +68,15 @@ void Popups::MPadRegion::update() {
         ImGui::Separator();
 
         if (ImGui::Button("Apply")) {
-            part.cellSize = origCellSize;
-            part.cellOrigin = origCellOrigin;
+            // Back to the original part so that the command undoes to it.
+            auto& editedPart = playerManager.editArrangement().parts.at(partIndex);
 
-            part.transform.position = origPosition;
+            editedPart.cellSize = origCellSize;
+            editedPart.cellOrigin = origCellOrigin;
 
-            auto newPart = part; // Copy
+            editedPart.transform.position = origPosition;
+
+            auto newPart = editedPart; // Copy
 
             newPart.cellSize.x = origCellSize.x + padBy.x;
             newPart.cellSize.y = origCellSize.y + padBy.y;
@@ -111,20 +115,27 @@ void Popups::MPadRegion::update() {
             lateOpen = false;
         }
 
-        part.cellSize.x = origCellSize.x + padBy.x;
-        part.cellSize.y = origCellSize.y + padBy.y;
+        const auto& currentPart = playerManager.getArrangement().parts.at(partIndex);
+        auto previewPart = currentPart;
+
+        previewPart.cellSize.x = origCellSize.x + padBy.x;
+        previewPart.cellSize.y = origCellSize.y + padBy.y;
 
-        part.cellOrigin.x = origCellOrigin.x - (padBy.x / 2);
-        part.cellOrigin.y = origCellOrigin.y - (padBy.y / 2);
+        previewPart.cellOrigin.x = origCellOrigin.x - (padBy.x / 2);
+        previewPart.cellOrigin.y = origCellOrigin.y - (padBy.y / 2);
 
         if (centerPart) {
-            part.transform.position.x = origPosition.x - ((padBy.x / 2) * part.transform.scale.x);
-            part.transform.position.y = origPosition.y - ((padBy.y / 2) * part.transform.scale.y);
+            previewPart.transform.position.x = origPosition.x - ((padBy.x / 2) * previewPart.transform.scale.x);
+            previewPart.transform.position.y = origPosition.y - ((padBy.y / 2) * previewPart.transform.scale.y);
         }
         else {
-            part.transform.position.x = origPosition.x;
-            part.transform.position.y = origPosition.y;
+            previewPart.transform.position.x = origPosition.x;
+            previewPart.transform.position.y = origPosition.y;
         }
+
+        // Only written when the preview changes.
+        if (previewPart != currentPart)
+            playerManager.editArrangement().parts.at(partIndex) = previewPart;
     }
 
     if (active)
@@ -10,6 +10,20 @@
 
 #include "Macro.hpp"
 
+// Sets the preview transform of the current arrangement, only taking it for
+// writing if it changes.
+static void setTempTransform(const CellAnim::IntVec2& offset, const CellAnim::FltVec2& scale) {
+    PlayerManager& playerManager = PlayerManager::getInstance();
+
+    const CellAnim::Arrangement& arrangement = playerManager.getArrangement();
+    if (arrangement.tempOffset == offset && arrangement.tempScale == scale)
+        return;
+
+    CellAnim::Arrangement& editedArrangement = playerManager.editArrangement();
+    editedArrangement.tempOffset = offset;
+    editedArrangement.tempScale = scale;
+}
+
 void Popups::MTransformArrangement::update() {
     ImGui::PushStyleVar(ImGuiStyleVar_WindowPadding, { 15.f, 15.f });
 
@@ -19,15 +33,10 @@ void Popups::MTransformArrangement::update() {
     SessionManager& sessionManager = SessionManager::getInstance();
     PlayerManager& playerManager = PlayerManager::getInstance();
 
-    CellAnim::Arrangement* arrangement { nullptr };
+    const bool sessionAvaliable = sessionManager.getCurrentSessionIndex() >= 0;
 
-    if (sessionManager.getCurrentSessionIndex() >= 0) {
-        arrangement = &playerManager.getArrangement();
-    }
-
-    if (!active && lateOpen && arrangement) {
-        arrangement->tempOffset = { 0, 0 };
-        arrangement->tempScale = { 1.f, 1.f };
+    if (!active && lateOpen && sessionAvaliable) {
+        setTempTransform({ 0, 0 }, { 1.f, 1.f });
 
         lateOpen = false;
     }
@@ -65,12 +74,11 @@ void Popups::MTransformArrangement::update() {
         ImGui::Separator();
 
         if (ImGui::Button("Apply")) {
-            arrangement->tempOffset = { 0, 0 };
-            arrangement->tempScale = { 1.f, 1.f };
+            setTempTransform({ 0, 0 }, { 1.f, 1.f });
 
             SelectionState &selectionState = sessionManager.getCurrentSession()->getPartSelectState();
 
-            auto newArrangement = *arrangement;
+            auto newArrangement = playerManager.getArrangement();
             for (size_t i = 0; i < newArrangement.parts.size(); i++) {
                 if (onlySelected && !selectionState.checkSelected(i)) {
                     continue;
@@ -116,14 +124,10 @@ void Popups::MTransformArrangement::update() {
             lateOpen = false;
         }
 
-        if (!onlySelected) {
-            arrangement->tempOffset = offset;
-            arrangement->tempScale = scale;
-        }
-        else {
-            arrangement->tempOffset = { 0, 0 };
-            arrangement->tempScale = { 1.f, 1.f };
-        }
+        if (!onlySelected)
+            setTempTransform(offset, scale);
+        else
+            setTempTransform({ 0, 0 }, { 1.f, 1.f });
 
         ImGui::EndPopup();
     }
@@ -44,7 +44,7 @@ void Popups::ModifiedTextureSize::update() {
 
             Session* currentSession = sessionManager.getCurrentSession();
 
-            std::vector<CellAnim::Arrangement> newArrangements =
+            CellAnim::PersistentVector<CellAnim::Arrangement> newArrangements =
                 currentSession->getCurrentCellAnim().object->getArrangements();
 
             float scaleX =
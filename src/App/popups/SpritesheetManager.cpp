@@ -86,7 +86,7 @@ void Popups::SpritesheetManager::update() {
             );
 
             ImGui::GetWindowDrawList()->AddImage(
-                cellanimSheet->getImTextureId(),
+                cellanimSheet->syncAndGetImTextureId(),
                 imageTL, imageBR
             );
 
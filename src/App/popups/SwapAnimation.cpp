@@ -10,6 +10,10 @@
 
 #include <limits>
 
+#include <utility>
+
+#include "Toast.hpp"
+
 #include "manager/SessionManager.hpp"
 #include "command/CommandSwapAnimations.hpp"
 
@@ -98,8 +102,8 @@ void Popups::SwapAnimation::update() {
 
             float beginCursorY = ImGui::GetCursorPosY();
 
-            const auto& animations = sessionManager.getCurrentSession()
-                ->getCurrentCellAnim().object->getAnimations();
+            const auto& animations = std::as_const(*sessionManager.getCurrentSession()
+                ->getCurrentCellAnim().object).getAnimations();
 
             for (int n = 0; n < static_cast<int>(animations.size()); n++) {
                 std::ostringstream fmtStream;
@@ -130,6 +134,8 @@ void Popups::SwapAnimation::update() {
                     swapAnim = n;
 
                     animationBegin = ImGui::GetTime();
+
+                    Toast::getInstance()->requestUpdates(animationTime);
                 }
             }
 
@@ -146,10 +146,10 @@ struct TedNamedPartEntryOld {
 } __attribute__((packed));
 
 static CellAnim::ArrangementPart* getPart(
-    const Session& session,
+    const CellAnim::ArchiveContents& contents,
     unsigned cellIndex, unsigned arrngIndex, unsigned partIndex
 ) {
-    if (cellIndex >= session.cellanims.size()) {
+    if (cellIndex >= contents.cellanims.size()) {
         Logging::error(
             "[TedApply] Invalid editor data binary: oob cellanim index!:\n"
             "   - Cellanim Index: {}",
@@ -158,7 +158,7 @@ static CellAnim::ArrangementPart* getPart(
         return nullptr;
     }
 
-    auto& arrangements = session.cellanims.at(cellIndex).object->getArrangements();
+    auto& arrangements = contents.cellanims.at(cellIndex)->getArrangements();
     if (arrngIndex >= arrangements.size()) {
         Logging::error(
             "[TedApply] Invalid editor data binary: oob arrangement index!:\n"
@@ -185,10 +185,10 @@ static CellAnim::ArrangementPart* getPart(
 }
 
 static CellAnim::Animation* getAnimation(
-    const Session& session,
+    const CellAnim::ArchiveContents& contents,
     unsigned cellIndex, unsigned animIndex
 ) {
-    if (cellIndex >= session.cellanims.size()) {
+    if (cellIndex >= contents.cellanims.size()) {
         Logging::error(
             "[TedApply] Invalid editor data binary: oob cellanim index!:\n"
             "   - Cellanim Index: {}",
@@ -197,7 +197,7 @@ static CellAnim::Animation* getAnimation(
         return nullptr;
     }
 
-    auto& animations = session.cellanims.at(cellIndex).object->getAnimations();
+    auto& animations = contents.cellanims.at(cellIndex)->getAnimations();
     if (animIndex >= animations.size()) {
         Logging::error(
             "[TedApply] Invalid editor data binary: oob animation index!:\n"
@@ -212,7 +212,7 @@ static CellAnim::Animation* getAnimation(
 }
 
 
-static bool ApplyImpl(Session& session, const unsigned char *data, const size_t dataSize) {
+static bool ApplyImpl(CellAnim::ArchiveContents& contents, const unsigned char *data, const size_t dataSize) {
     const TedFileHeader* fileHeader = reinterpret_cast<const TedFileHeader*>(data);
 
     const unsigned char* compressedStart = fileHeader->getDataStart();
@@ -254,7 +254,7 @@ static bool ApplyImpl(Session& session, const unsigned char *data, const size_t
         } break;
 
         case TED_ENTRY_TYPE_PART_NAME: {
-            auto* part = getPart(session,
+            auto* part = getPart(contents,
                 currentCellAnimIdx,
                 currentEntry->partName.arrangementIndex,
                 currentEntry->partName.partIndex
@@ -266,7 +266,7 @@ static bool ApplyImpl(Session& session, const unsigned char *data, const size_t
         } break;
 
         case TED_ENTRY_TYPE_PART_LOCK: {
-            auto* part = getPart(session,
+            auto* part = getPart(contents,
                 currentCellAnimIdx,
                 currentEntry->partLock.arrangementIndex,
                 currentEntry->partLock.partIndex
@@ -278,7 +278,7 @@ static bool ApplyImpl(Session& session, const unsigned char *data, const size_t
         } break;
 
         case TED_ENTRY_TYPE_PART_HIDE: {
-            auto* part = getPart(session,
+            auto* part = getPart(contents,
                 currentCellAnimIdx,
                 currentEntry->partHide.arrangementIndex,
                 currentEntry->partHide.partIndex
@@ -292,7 +292,7 @@ static bool ApplyImpl(Session& session, const unsigned char *data, const size_t
 
         case TED_ENTRY_TYPE_ANIM_COMMENT: {
             auto* anim = getAnimation(
-                session, currentCellAnimIdx,
+                contents, currentCellAnimIdx,
                 currentEntry->animComment.animationIndex
             );
             if (!anim)
@@ -315,7 +315,7 @@ static bool ApplyImpl(Session& session, const unsigned char *data, const size_t
 }
 
 // TODO: remove on public release
-static bool ApplyImpl_Old(Session& session, const unsigned char *data, const size_t dataSize) {
+static bool ApplyImpl_Old(CellAnim::ArchiveContents& contents, const unsigned char *data, const size_t dataSize) {
     Logging::warn("[EditorDataProc::Apply] ---   <<-- USING MALFORM TED HACK -->>   ---");
     Logging::warn("[EditorDataProc::Apply] TED size is {}kb long", dataSize / 1024);
 
@@ -354,7 +354,7 @@ static bool ApplyImpl_Old(Session& session, const unsigned char *data, const siz
 
             for (uint32_t j = 0; j < currentHeader->entryCount; j++) {
                 auto* part = getPart(
-                    session,
+                    contents,
                     currentEntry->cellanimIndex,
                     currentEntry->arrangementIndex,
                     currentEntry->partIndex
@@ -385,7 +385,7 @@ static bool ApplyImpl_Old(Session& session, const unsigned char *data, const siz
 
             for (uint32_t j = 0; j < entryCount; j++) {
                 auto* part = getPart(
-                    session,
+                    contents,
                     currentEntry->cellanimIndex,
                     currentEntry->arrangementIndex,
                     currentEntry->partIndex
@@ -419,7 +419,7 @@ static bool ApplyImpl_Old(Session& session, const unsigned char *data, const siz
 
             for (uint32_t j = 0; j < entryCount; j++) {
                 auto* part = getPart(
-                    session,
+                    contents,
                     currentEntry->cellanimIndex,
                     currentEntry->arrangementIndex,
                     currentEntry->partIndex
@@ -458,7 +458,7 @@ static bool ApplyImpl_Old(Session& session, const unsigned char *data, const siz
     return true;
 }
 
-bool EditorDataProc::Apply(Session& session, const unsigned char *data, const size_t dataSize) {
+bool EditorDataProc::Apply(CellAnim::ArchiveContents& contents, const unsigned char *data, const size_t dataSize) {
     const TedFileHeader* fileHeader = reinterpret_cast<const TedFileHeader*>(data);
 
     bool isOldFormat = false;
@@ -474,7 +474,7 @@ bool EditorDataProc::Apply(Session& session, const unsigned char *data, const si
     }
 
     if (isOldFormat) {
-        return ApplyImpl_Old(session, data, dataSize);
+        return ApplyImpl_Old(contents, data, dataSize);
     }
 
     if (fileHeader->majorVersion != TED_VERSION_MAJOR) {
@@ -486,10 +486,10 @@ bool EditorDataProc::Apply(Session& session, const unsigned char *data, const si
         return false;
     }
 
-    return ApplyImpl(session, data, dataSize);
+    return ApplyImpl(contents, data, dataSize);
 }
 
-std::optional<std::vector<unsigned char>> EditorDataProc::Create(const Session &session) {
+std::optional<std::vector<unsigned char>> EditorDataProc::Create(const CellAnim::ArchiveContents& contents) {
     // string - offset into pool
     std::unordered_map<std::string, unsigned> stringPoolMap;
     uint32_t nextStringPoolOffs = 0;
@@ -511,10 +511,10 @@ std::optional<std::vector<unsigned char>> EditorDataProc::Create(const Session &
 
     auto createStartTime = std::chrono::high_resolution_clock::now();
 
-    for (size_t cellAnimIdx = 0; cellAnimIdx < session.cellanims.size(); cellAnimIdx++) {
+    for (size_t cellAnimIdx = 0; cellAnimIdx < contents.cellanims.size(); cellAnimIdx++) {
         bool alreadySetFollowCellAnim = (cellAnimIdx == 0);
 
-        const auto& arrangements = session.cellanims[cellAnimIdx].object->getArrangements();
+        const auto& arrangements = contents.cellanims[cellAnimIdx]->getArrangements();
         for (size_t arrangementIdx = 0; arrangementIdx < arrangements.size(); arrangementIdx++) {
             const auto& parts = arrangements[arrangementIdx].parts;
             for (size_t partIdx = 0; partIdx < parts.size(); partIdx++) {
@@ -568,13 +568,13 @@ std::optional<std::vector<unsigned char>> EditorDataProc::Create(const Session &
             }
         }
 
-        const auto& animations = session.cellanims[cellAnimIdx].object->getAnimations();
+        const auto& animations = contents.cellanims[cellAnimIdx]->getAnimations();
         for (size_t animationIdx = 0; animationIdx < animations.size(); animationIdx++) {
             const auto& animation = animations[animationIdx];
 
             // RVL already stores comments in a header file, so it's redundant to store
             // them here as well.
-            if (!animation.comment.empty() && (session.type != CellAnim::CELLANIM_TYPE_RVL)) {
+            if (!animation.comment.empty() && (contents.type != CellAnim::CELLANIM_TYPE_RVL)) {
                 trySetFollowCellAnim(alreadySetFollowCellAnim, cellAnimIdx);
 
                 TedEntry entry;
@@ -1,7 +1,7 @@
 #ifndef EDITOR_DATA_PACKAGE_HPP
 #define EDITOR_DATA_PACKAGE_HPP
 
-#include "manager/SessionManager.hpp"
+#include "cellanim/CellAnimArchive.hpp"
 
 #include <cstddef>
 
@@ -13,9 +13,13 @@ namespace EditorDataProc {
 
 inline constexpr std::string_view ARCHIVE_FILENAME = "TOAST.TED";
 
-bool Apply(Session& session, const unsigned char* data, size_t dataSize);
+// Apply editor data (names, comments, ..) to the cellanims of an archive.
+bool Apply(CellAnim::ArchiveContents& contents, const unsigned char* data, size_t dataSize);
 
-std::optional<std::vector<unsigned char>> Create(const Session& session);
+// Create editor data for the cellanims of an archive.
+//
+// Returns: the editor data file, or nothing if there is no data to store.
+std::optional<std::vector<unsigned char>> Create(const CellAnim::ArchiveContents& contents);
 
 } // namespace EditorDataProc
 
@@ -1,28 +1,49 @@
 #include "Session.hpp"
 
 #include "manager/PlayerManager.hpp"
+#include "manager/ConfigManager.hpp"
 
 #include "Logging.hpp"
 
+size_t Session::getCommandMemoryUsage(const BaseCommand& command) {
+    return command.getMemoryUsage() + COMMAND_OVERHEAD;
+}
+
+void Session::pushUndo(HistoryEntry entry) {
+    this->undoMemoryUsage += entry.memoryUsage;
+    this->undoQueue.push_back(std::move(entry));
+
+    const size_t budget =
+        size_t(ConfigManager::getInstance().getConfig().undoHistoryBudget) * 1024 * 1024;
+
+    // Forget the oldest commands; the newest one is always kept.
+    while (this->undoMemoryUsage > budget && this->undoQueue.size() > 1) {
+        this->undoMemoryUsage -= this->undoQueue.front().memoryUsage;
+        this->undoQueue.pop_front();
+    }
+}
+
 void Session::addCommand(std::shared_ptr<BaseCommand> command) {
     command->execute();
-    if (this->undoQueue.size() >= COMMANDS_MAX)
-        this->undoQueue.pop_front();
 
-    this->undoQueue.push_back(command);
+    for (const auto& redoEntry : this->redoQueue)
+        this->undoMemoryUsage -= redoEntry.memoryUsage;
     this->redoQueue.clear();
+
+    const size_t memoryUsage = getCommandMemoryUsage(*command);
+    pushUndo(HistoryEntry { std::move(command), memoryUsage });
 }
 
 void Session::undo() {
     if (this->undoQueue.empty())
         return;
 
-    auto command = undoQueue.back();
+    HistoryEntry entry = std::move(this->undoQueue.back());
     this->undoQueue.pop_back();
 
-    command->rollback();
+    entry.command->rollback();
 
-    this->redoQueue.push_back(command);
+    this->redoQueue.push_back(std::move(entry));
 
     this->modified = true;
 }
@@ -31,15 +52,15 @@ void Session::redo() {
     if (this->redoQueue.empty())
         return;
 
-    auto command = redoQueue.back();
+    HistoryEntry entry = std::move(this->redoQueue.back());
     this->redoQueue.pop_back();
 
-    command->execute();
+    entry.command->execute();
 
-    if (this->undoQueue.size() == COMMANDS_MAX)
-        this->undoQueue.pop_front();
+    // Counted already; re-added when pushed.
+    this->undoMemoryUsage -= entry.memoryUsage;
 
-    this->undoQueue.push_back(command);
+    pushUndo(std::move(entry));
 
     this->modified = true;
 }
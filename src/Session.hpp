@@ -63,8 +63,13 @@ public:
     void clearUndoRedo() {
         undoQueue.clear();
         redoQueue.clear();
+
+        undoMemoryUsage = 0;
     }
 
+    // Approximate memory used by the undo & redo history.
+    size_t getUndoMemoryUsage() const { return undoMemoryUsage; }
+
     unsigned getCurrentCellAnimIndex() const { return currentCellAnim; }
     void setCurrentCellAnimIndex(unsigned index);
 
@@ -110,11 +115,24 @@ private:
         type = rhs.type;
         undoQueue = std::move(rhs.undoQueue);
         redoQueue = std::move(rhs.redoQueue);
+        undoMemoryUsage = rhs.undoMemoryUsage;
         currentCellAnim = rhs.currentCellAnim;
     }
 
+    // A command in the undo or redo history. Its size is taken once, when it
+    // is added; what it references (e.g. a live sheet) can change size later.
+    struct HistoryEntry {
+        std::shared_ptr<BaseCommand> command;
+        size_t memoryUsage;
+    };
+
+    void pushUndo(HistoryEntry entry);
+
+    static size_t getCommandMemoryUsage(const BaseCommand& command);
+
 public:
-    static constexpr unsigned int COMMANDS_MAX = 512;
+    // Rough size of a command itself & its place in the history.
+    static constexpr size_t COMMAND_OVERHEAD = 64;
 
     std::vector<CellAnimGroup> cellanims;
     std::shared_ptr<TextureGroup<TextureEx>> sheets;
@@ -129,8 +147,10 @@ public:
 private:
     unsigned currentCellAnim;
 
-    std::deque<std::shared_ptr<BaseCommand>> undoQueue;
-    std::deque<std::shared_ptr<BaseCommand>> redoQueue;
+    std::deque<HistoryEntry> undoQueue;
+    std::deque<HistoryEntry> redoQueue;
+
+    size_t undoMemoryUsage { 0 };
 };
 
 #endif // SESSION_HPP
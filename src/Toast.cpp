@@ -11,7 +11,10 @@
 
 #include <array>
 
+#include <algorithm>
+
 #include <imgui.h>
+#include <imgui_internal.h>
 
 #include <tinyfiledialogs.h>
 
@@ -27,6 +30,8 @@
 #include "manager/MainThreadTaskManager.hpp"
 #include "manager/PromptPopupManager.hpp"
 
+#include "texture/ETC1BlockCache.hpp"
+
 #include "font/FontAwesome.h"
 
 #include "command/CommandSwitchCellanim.hpp"
@@ -87,6 +92,12 @@ static inline void syncToUpdateRate() {
     b = std::chrono::system_clock::now();
 }
 
+// How long to wait for events when idle before updating anyways.
+constexpr double IDLE_WAIT_TIMEOUT = .25; // seconds
+// How long to keep updating after input or another event, so that hover
+// effects, tooltips & the like can settle.
+constexpr double EVENT_SETTLE_TIME = 1.; // seconds
+
 Toast::Toast(int argc, const char **argv) {
     if (gInstance != nullptr) {
         throw std::runtime_error("Toast::Toast: Instance of Toast already exists!");
@@ -286,6 +297,9 @@ Toast::~Toast() {
     glfwDestroyWindow(mGlfwWindowHndl);
     glfwTerminate();
 
+    // Blocks packed since the last export (e.g. for format previews).
+    ETC1BlockCache::flush();
+
     Logging::info("[Toast::Toast] Finished deinitializing.");
 
     Logging::close();
@@ -331,6 +345,50 @@ void Toast::requestExit(bool force) {
     mRunning = false;
 }
 
+void Toast::requestUpdates(double seconds) {
+    mAwakeUntil = std::max(mAwakeUntil, glfwGetTime() + seconds);
+    mUpdatesRequested = true;
+}
+
+bool Toast::shouldIdle() const {
+    if (!ConfigManager::getInstance().getConfig().idleWhenInactive)
+        return false;
+
+    if (mUpdatesRequested || glfwGetTime() < mAwakeUntil)
+        return false;
+
+    if (
+        PlayerManager::getInstance().getPlaying() ||
+        AsyncTaskManager::getInstance().hasTasks()
+    )
+        return false;
+
+    // Text fields blink their cursor.
+    if (ImGui::GetIO().WantTextInput)
+        return false;
+
+    return true;
+}
+
+void Toast::waitForEvents() {
+    const bool idle = shouldIdle();
+    mUpdatesRequested = false;
+
+    if (!idle) {
+        glfwPollEvents();
+        return;
+    }
+
+    const double waitStart = glfwGetTime();
+
+    glfwWaitEventsTimeout(IDLE_WAIT_TIMEOUT);
+
+    // Woken up by an event (input, resize, a task from another thread ..)
+    // rather than the timeout; allow for the timer being a bit early.
+    if (glfwGetTime() - waitStart < IDLE_WAIT_TIMEOUT * .9)
+        requestUpdates(EVENT_SETTLE_TIME);
+}
+
 void Toast::update() {
     mDrawnThisFrame = false;
 
@@ -338,12 +396,17 @@ void Toast::update() {
 
     glfwMakeContextCurrent(mGlfwWindowHndl);
 
-    glfwPollEvents();
-
     ImGui::SetCurrentContext(mGuiContext);
 
+    waitForEvents();
+
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
+
+    // Input that came in while polling; queued until ImGui::NewFrame.
+    if (ImGui::GetCurrentContext()->InputEventsQueue.Size > 0)
+        requestUpdates(EVENT_SETTLE_TIME);
+
     ImGui::NewFrame();
 
     const ImGuiViewport *viewport = ImGui::GetMainViewport();
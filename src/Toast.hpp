@@ -41,6 +41,10 @@ public:
 
     void requestExit(bool force = false);
 
+    // Keep updating at the update rate for this long, even if idle. Call it
+    // every frame to animate continuously.
+    void requestUpdates(double seconds = 0.);
+
     bool getRunning() const { return mRunning; }
     std::thread::id getMainThreadId() const { return mMainThreadId; }
 
@@ -52,6 +56,10 @@ public:
         return mGlfwWindowHndl;
     }
 
+private:
+    bool shouldIdle() const;
+    void waitForEvents();
+
 private:
     bool mRunning { true };
 
@@ -62,6 +70,11 @@ private:
 
     bool mDrawnThisFrame { false };
 
+    // GLFW time until which the app is kept from going idle.
+    double mAwakeUntil { 0. };
+    // Updates were requested during the last frame.
+    bool mUpdatesRequested { false };
+
     WindowRoot *mRootWindow { nullptr };
 
     std::thread::id mMainThreadId;
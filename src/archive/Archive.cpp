@@ -4,6 +4,8 @@
 
 #include <cstddef>
 
+#include <algorithm>
+
 void Archive::Directory::sortAlphabetic() {
     this->files.sort([](const File &a, const File &b) {
         return a.name < b.name;
@@ -28,10 +30,262 @@ const Archive::File *Archive::findFile(std::string_view path, const Archive::Dir
     // Slash found: it's a subdirectory, recursive search
     else {
         for (const Directory &subDir : directory.subdirectories) {
-            if (strncmp(subDir.name.data(), path.data(), slashOffset) == 0)
+            if (subDir.name == path.substr(0, slashOffset))
                 return findFile(path.substr(slashOffset + 1), subDir);
         }
 
         return nullptr;
     }
 }
+
+namespace Archive {
+
+constexpr unsigned PATH_INDEX_MIN_SLOT_BITS = 6;
+
+void PathIndex::clear() {
+    mSlots.clear();
+    mSlotBits = 0;
+
+    mCount = 0;
+
+    mPathPool.clear();
+}
+
+void PathIndex::grow() {
+    const unsigned newSlotBits = std::max(mSlotBits + 1, PATH_INDEX_MIN_SLOT_BITS);
+
+    std::vector<Entry> oldSlots(size_t(1) << newSlotBits, Entry {});
+    oldSlots.swap(mSlots);
+    mSlotBits = newSlotBits;
+
+    const size_t slotMask = mSlots.size() - 1;
+
+    for (const Entry& entry : oldSlots) {
+        if (!entry.file && !entry.directory)
+            continue;
+
+        size_t slot = getSlot(entry.hash);
+        while (mSlots[slot].file || mSlots[slot].directory)
+            slot = (slot + 1) & slotMask;
+
+        mSlots[slot] = entry;
+    }
+}
+
+const PathIndex::Entry* PathIndex::find(std::string_view path, uint32_t hash) const {
+    if (mSlots.empty())
+        return nullptr;
+
+    const size_t slotMask = mSlots.size() - 1;
+
+    size_t slot = getSlot(hash);
+    while (mSlots[slot].file || mSlots[slot].directory) {
+        const Entry& entry = mSlots[slot];
+        if (entry.hash == hash && getPath(entry) == path)
+            return &entry;
+
+        slot = (slot + 1) & slotMask;
+    }
+
+    return nullptr;
+}
+
+void PathIndex::insert(std::string_view path, uint32_t hash, const File* file, const Directory* directory) {
+    if (const Entry* existing = find(path, hash)) {
+        Entry* entry = const_cast<Entry*>(existing);
+        if (file)
+            entry->file = file;
+        if (directory)
+            entry->directory = directory;
+
+        return;
+    }
+
+    // Keep the load factor at or below one half.
+    if ((mCount + 1) * 2 > mSlots.size())
+        grow();
+
+    const size_t slotMask = mSlots.size() - 1;
+
+    size_t slot = getSlot(hash);
+    while (mSlots[slot].file || mSlots[slot].directory)
+        slot = (slot + 1) & slotMask;
+
+    mSlots[slot] = Entry {
+        .hash = hash,
+
+        .pathOffset = static_cast<uint32_t>(mPathPool.size()),
+        .pathLength = static_cast<uint32_t>(path.size()),
+
+        .file = file,
+        .directory = directory
+    };
+    mPathPool.append(path);
+
+    mCount++;
+}
+
+static void indexDirectory(PathIndex& index, const Directory& directory, std::string& path) {
+    const size_t baseLength = path.size();
+
+    for (const File& file : directory.files) {
+        path.resize(baseLength);
+        path += file.name;
+
+        index.insert(path, computePathHash(path), &file, nullptr);
+    }
+
+    for (const Directory& subdirectory : directory.subdirectories) {
+        path.resize(baseLength);
+        path += subdirectory.name;
+
+        index.insert(path, computePathHash(path), nullptr, &subdirectory);
+
+        path += '/';
+        indexDirectory(index, subdirectory, path);
+    }
+
+    path.resize(baseLength);
+}
+
+const PathIndex& ArchiveObjectBase::getIndex() const {
+    if (!mIndexValid) {
+        mIndex.clear();
+
+        std::string path;
+        indexDirectory(mIndex, mStructure, path);
+
+        mIndexValid = true;
+    }
+
+    return mIndex;
+}
+
+const File* ArchiveObjectBase::findFile(std::string_view path) const {
+    const PathIndex::Entry* entry = getIndex().find(path);
+    return entry ? entry->file : nullptr;
+}
+
+const Directory* ArchiveObjectBase::findDirectory(std::string_view path) const {
+    const PathIndex::Entry* entry = getIndex().find(path);
+    return entry ? entry->directory : nullptr;
+}
+
+Directory& ArchiveObjectBase::getOrCreateDirectory(std::string_view path) {
+    const PathIndex::Entry* entry = mIndex.find(path);
+    if (entry && entry->directory)
+        return *const_cast<Directory*>(entry->directory);
+
+    const size_t slashOffset = path.rfind('/');
+
+    Directory* parent = (slashOffset == std::string_view::npos) ?
+        &mStructure : &getOrCreateDirectory(path.substr(0, slashOffset));
+
+    Directory& directory = parent->addDirectory(Directory(
+        std::string(path.substr(slashOffset + 1)), parent
+    ));
+
+    mIndex.insert(path, computePathHash(path), nullptr, &directory);
+
+    return directory;
+}
+
+File& ArchiveObjectBase::addFileAtPath(std::string_view path, File&& file) {
+    const size_t slashOffset = path.rfind('/');
+
+    Directory& directory = (slashOffset == std::string_view::npos) ?
+        mStructure : getOrCreateDirectory(path.substr(0, slashOffset));
+
+    file.name = path.substr(slashOffset + 1);
+
+    File& addedFile = directory.addFile(std::move(file));
+
+    mIndex.insert(path, computePathHash(path), &addedFile, nullptr);
+
+    return addedFile;
+}
+
+// Padding is written from here.
+static const unsigned char ZERO_PADDING[0x80] {};
+
+void ScatterList::append(const unsigned char* data, size_t dataSize) {
+    if (dataSize == 0)
+        return;
+
+    mRanges.push_back({ .data = data, .size = dataSize, .offset = mSize });
+    mSize += dataSize;
+}
+
+void ScatterList::append(std::vector<unsigned char>&& table) {
+    mTables.push_back(std::move(table));
+    append(mTables.back().data(), mTables.back().size());
+}
+
+void ScatterList::appendPadding(size_t size) {
+    if (size == 0)
+        return;
+
+    mRanges.push_back({ .data = nullptr, .size = size, .offset = mSize });
+    mSize += size;
+}
+
+bool ScatterList::write(const Sink& sink) const {
+    for (const Range& range : mRanges) {
+        if (range.data) {
+            if (!sink(range.data, range.size))
+                return false;
+            continue;
+        }
+
+        for (size_t written = 0; written < range.size; written += sizeof(ZERO_PADDING)) {
+            if (!sink(ZERO_PADDING, std::min(range.size - written, sizeof(ZERO_PADDING))))
+                return false;
+        }
+    }
+
+    return true;
+}
+
+const unsigned char* ScatterList::gather(size_t offset, size_t size, unsigned char* scratch) const {
+    // Last range starting at or before offset.
+    auto it = std::upper_bound(
+        mRanges.begin(), mRanges.end(), offset,
+        [](size_t offset, const Range& range) { return offset < range.offset; }
+    );
+    if (it == mRanges.begin())
+        return scratch;
+    --it;
+
+    if (it->data && (offset + size) <= (it->offset + it->size))
+        return it->data + (offset - it->offset);
+
+    unsigned char* destination = scratch;
+    for (; size > 0 && it != mRanges.end(); ++it) {
+        const size_t rangeOffset = offset - it->offset;
+        const size_t copySize = std::min(size, it->size - rangeOffset);
+
+        if (it->data)
+            std::memcpy(destination, it->data + rangeOffset, copySize);
+        else
+            std::memset(destination, 0x00, copySize);
+
+        destination += copySize;
+        offset += copySize;
+        size -= copySize;
+    }
+
+    return scratch;
+}
+
+std::vector<unsigned char> ScatterList::flatten() const {
+    std::vector<unsigned char> result(mSize);
+
+    for (const Range& range : mRanges) {
+        if (range.data)
+            std::memcpy(result.data() + range.offset, range.data, range.size);
+    }
+
+    return result;
+}
+
+} // namespace Archive
@@ -1,6 +1,8 @@
 #ifndef ARCHIVE_HPP
 #define ARCHIVE_HPP
 
+#include <cstdint>
+
 #include <string>
 #include <string_view>
 
@@ -8,8 +10,64 @@
 
 #include <list>
 
+#include <memory>
+
+#include <functional>
+
 namespace Archive {
 
+// A buffer that the data of several files can point into, e.g. a decompressed
+// archive.
+using SharedBuffer = std::shared_ptr<const std::vector<unsigned char>>;
+
+// The contents of a file. They either own their bytes or reference a range of a
+// SharedBuffer; in the latter case the bytes are copied only once they are
+// modified (see edit).
+class FileData {
+public:
+    FileData() = default;
+    FileData(std::vector<unsigned char> data) :
+        mOwned(std::move(data))
+    {}
+    FileData(SharedBuffer buffer, size_t offset, size_t size) :
+        mShared(std::move(buffer)),
+        mSharedData(mShared->data() + offset), mSharedSize(size)
+    {}
+
+    FileData& operator=(std::vector<unsigned char> data) {
+        mOwned = std::move(data);
+        mShared.reset();
+
+        return *this;
+    }
+
+    const unsigned char* data() const { return isShared() ? mSharedData : mOwned.data(); }
+    size_t size() const { return isShared() ? mSharedSize : mOwned.size(); }
+    bool empty() const { return size() == 0; }
+
+    const unsigned char* begin() const { return data(); }
+    const unsigned char* end() const { return data() + size(); }
+
+    // Get the bytes for modification. Shared bytes are copied first.
+    std::vector<unsigned char>& edit() {
+        if (isShared()) {
+            mOwned.assign(mSharedData, mSharedData + mSharedSize);
+            mShared.reset();
+        }
+
+        return mOwned;
+    }
+
+    bool isShared() const { return mShared != nullptr; }
+
+private:
+    std::vector<unsigned char> mOwned;
+
+    SharedBuffer mShared;
+    const unsigned char* mSharedData { nullptr };
+    size_t mSharedSize { 0 };
+};
+
 class Directory; // Forward-declaration
 
 class File {
@@ -20,7 +78,7 @@ public:
 
 public:
     std::string name;
-    std::vector<unsigned char> data;
+    FileData data;
 
     Directory *parent { nullptr };
 };
@@ -78,21 +136,191 @@ public:
     Directory* parent { nullptr };
 };
 
+// The hash used for paths; this is the SARC name hash.
+constexpr uint32_t PATH_HASH_KEY = 0x65;
+
+inline uint32_t computePathHash(std::string_view path, uint32_t key = PATH_HASH_KEY) {
+    uint32_t result = 0;
+    for (char character : path)
+        result = character + result * key;
+
+    return result;
+}
+
+// Flat open-addressing hash table from full paths ("dir1/dir2/file.ext") to the
+// files and directories of an archive.
+class PathIndex {
+public:
+    struct Entry {
+        uint32_t hash;
+
+        // Location of the path in the path pool.
+        uint32_t pathOffset;
+        uint32_t pathLength;
+
+        // Either or both can be set (a file and a directory may share a path).
+        const File* file;
+        const Directory* directory;
+    };
+
+public:
+    void clear();
+
+    // Insert or update the entry for path; hash must be computePathHash(path).
+    void insert(std::string_view path, uint32_t hash, const File* file, const Directory* directory);
+
+    const Entry* find(std::string_view path, uint32_t hash) const;
+    const Entry* find(std::string_view path) const {
+        return find(path, computePathHash(path));
+    }
+
+    size_t size() const { return mCount; }
+
+private:
+    size_t getSlot(uint32_t hash) const {
+        // The path hash is weak in the low bits; spread it first.
+        return static_cast<uint32_t>(hash * 0x9E3779B1u) >> (32 - mSlotBits);
+    }
+
+    std::string_view getPath(const Entry& entry) const {
+        return std::string_view(mPathPool).substr(entry.pathOffset, entry.pathLength);
+    }
+
+    void grow();
+
+private:
+    // Empty slots have neither a file nor a directory.
+    std::vector<Entry> mSlots;
+    unsigned mSlotBits { 0 };
+
+    size_t mCount { 0 };
+
+    // Every path in the index, back to back.
+    std::string mPathPool;
+};
+
+// A serialized archive as a list of byte ranges that make up the archive when
+// written back to back, like the iovecs of writev. The ranges reference the data
+// of the archive's files and tables owned by the list, so the archive image is
+// never assembled unless flatten is called.
+class ScatterList {
+public:
+    // Returns: false to stop writing.
+    using Sink = std::function<bool(const unsigned char* data, size_t dataSize)>;
+
+public:
+    ScatterList() = default;
+
+    // The ranges may point into the list's own tables.
+    ScatterList(const ScatterList&) = delete;
+    ScatterList& operator=(const ScatterList&) = delete;
+
+    ScatterList(ScatterList&&) = default;
+    ScatterList& operator=(ScatterList&&) = default;
+
+    // Reference dataSize bytes at data; they must outlive the list.
+    void append(const unsigned char* data, size_t dataSize);
+    // Take ownership of a table and append its bytes.
+    void append(std::vector<unsigned char>&& table);
+    // Append zero bytes.
+    void appendPadding(size_t size);
+
+    size_t getSize() const { return mSize; }
+
+    // Hand every range to sink in order.
+    //
+    // Returns: false if the sink stopped the write, true otherwise.
+    bool write(const Sink& sink) const;
+
+    // Get size bytes starting at offset. If they are contiguous in one range a
+    // pointer to them is returned directly; otherwise they are copied to
+    // scratch (which must have room for size bytes).
+    const unsigned char* gather(size_t offset, size_t size, unsigned char* scratch) const;
+
+    // Assemble the whole archive image.
+    std::vector<unsigned char> flatten() const;
+
+private:
+    struct Range {
+        // Null for padding.
+        const unsigned char* data;
+        size_t size;
+
+        // Offset of the range in the archive.
+        size_t offset;
+    };
+
+    std::vector<Range> mRanges;
+    std::vector<std::vector<unsigned char>> mTables;
+
+    size_t mSize { 0 };
+};
+
 class ArchiveObjectBase {
 public:
     ArchiveObjectBase() = default;
 
+    // The index refers to the entries of the structure it was built from, so a
+    // copy starts without one.
+    ArchiveObjectBase(const ArchiveObjectBase& other) :
+        mInitialized(other.mInitialized), mStructure(other.mStructure)
+    {}
+    ArchiveObjectBase& operator=(const ArchiveObjectBase& other) {
+        mInitialized = other.mInitialized;
+        mStructure = other.mStructure;
+
+        mIndex.clear();
+        mIndexValid = false;
+
+        return *this;
+    }
+
+    ArchiveObjectBase(ArchiveObjectBase&&) = default;
+    ArchiveObjectBase& operator=(ArchiveObjectBase&&) = default;
+
     bool isInitialized() const { return mInitialized; }
 
-    Directory& getStructure() { return mStructure; }
+    // The mutable structure may be modified, so the path index is rebuilt on
+    // the next lookup.
+    Directory& getStructure() {
+        mIndexValid = false;
+        return mStructure;
+    }
     const Directory& getStructure() const { return mStructure; }
 
+    // Find a file or directory by its full path, e.g. "arc/file.ext".
+    const File* findFile(std::string_view path) const;
+    File* findFile(std::string_view path) {
+        return const_cast<File*>(static_cast<const ArchiveObjectBase*>(this)->findFile(path));
+    }
+
+    const Directory* findDirectory(std::string_view path) const;
+    Directory* findDirectory(std::string_view path) {
+        return const_cast<Directory*>(static_cast<const ArchiveObjectBase*>(this)->findDirectory(path));
+    }
+
+protected:
+    // Add a file at path, creating the directories leading up to it as needed.
+    // The file is named after the last path segment. The index is kept up to
+    // date.
+    File& addFileAtPath(std::string_view path, File&& file);
+
+    // Find or create the directory at path.
+    Directory& getOrCreateDirectory(std::string_view path);
+
+    const PathIndex& getIndex() const;
+
 protected:
     bool mInitialized { false };
 
     Directory mStructure;
+
+    mutable PathIndex mIndex;
+    mutable bool mIndexValid { false };
 };
 
+// Find a file by its path relative to directory. This walks the tree; lookups of
+// full paths in an archive should go through ArchiveObjectBase::findFile.
 const File *findFile(std::string_view path, const Directory &directory);
 inline File *findFile(std::string_view path, Directory &directory) {
     return const_cast<File *>(findFile(path, static_cast<const Directory &>(directory)));
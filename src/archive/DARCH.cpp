@@ -76,7 +76,14 @@ public:
 
 namespace Archive {
 
-DARCHObject::DARCHObject(const unsigned char *data, const size_t dataSize) {
+DARCHObject::DARCHObject(const unsigned char *data, const size_t dataSize) :
+    DARCHObject(std::make_shared<const std::vector<unsigned char>>(data, data + dataSize))
+{}
+
+DARCHObject::DARCHObject(SharedBuffer buffer) {
+    const unsigned char *data = buffer->data();
+    const size_t dataSize = buffer->size();
+
     if (dataSize < sizeof(DARCHHeader)) {
         Logging::error("[DARCHObject::DARCHObject] Invalid DARCH binary: data size smaller than header size!");
         return;
@@ -121,7 +128,7 @@ DARCHObject::DARCHObject(const unsigned char *data, const size_t dataSize) {
             const unsigned char* fileDataStart = data + BYTESWAP_32(node->file.dataOffset);
             const unsigned char* fileDataEnd   = fileDataStart + BYTESWAP_32(node->file.dataSize);
 
-            file.data = std::vector<unsigned char>(fileDataStart, fileDataEnd);
+            file.data = FileData(buffer, fileDataStart - data, fileDataEnd - fileDataStart);
 
             currentDirectory->addFile(std::move(file));
         }
@@ -137,18 +144,15 @@ DARCHObject::DARCHObject(const unsigned char *data, const size_t dataSize) {
     mInitialized = true;
 }
 
-std::vector<unsigned char> DARCHObject::serialize() {
-    std::vector<unsigned char> result(sizeof(DARCHHeader));
-
-    DARCHHeader *header = reinterpret_cast<DARCHHeader*>(result.data());
-    *header = DARCHHeader {
+ScatterList DARCHObject::serializeScatter() const {
+    DARCHHeader header {
         .nodeSectionStart = BYTESWAP_32(sizeof(DARCHHeader))
     };
 
     struct FlatEntry {
         union {
-            Archive::Directory *dir;
-            Archive::File *file;
+            const Archive::Directory *dir;
+            const Archive::File *file;
         };
         bool isDir;
 
@@ -168,8 +172,8 @@ std::vector<unsigned char> DARCHObject::serialize() {
         }
     };
 
-    std::stack<std::pair<Archive::Directory *, std::list<Archive::File>::iterator>> fileItStack;
-    std::stack<std::pair<Archive::Directory *, std::list<Archive::Directory>::iterator>> directoryItStack;
+    std::stack<std::pair<const Archive::Directory *, std::list<Archive::File>::const_iterator>> fileItStack;
+    std::stack<std::pair<const Archive::Directory *, std::list<Archive::Directory>::const_iterator>> directoryItStack;
 
     // Push the root directory.
     fileItStack.push({ &mStructure, mStructure.files.begin() });
@@ -197,7 +201,7 @@ std::vector<unsigned char> DARCHObject::serialize() {
         }
         // Process subdirectories.
         else if (dirIt != currentDir->subdirectories.end()) {
-            Archive::Directory* subDir = &(*dirIt);
+            const Archive::Directory* subDir = &(*dirIt);
             flattenedArchive.push_back({
                 .dir = subDir,
                 .isDir = true,
@@ -240,7 +244,7 @@ std::vector<unsigned char> DARCHObject::serialize() {
         ) + 1;
     }
 
-    header->nodeSectionSize = BYTESWAP_32(static_cast<uint32_t>(
+    header.nodeSectionSize = BYTESWAP_32(static_cast<uint32_t>(
         (sizeof(DARCHNode) * flattenedArchive.size()) + nextStringPoolOffset
     ));
 
@@ -253,7 +257,7 @@ std::vector<unsigned char> DARCHObject::serialize() {
     );
     unsigned nextDataOffset = baseDataOffset;
 
-    header->dataSectionStart = BYTESWAP_32(baseDataOffset);
+    header.dataSectionStart = BYTESWAP_32(baseDataOffset);
 
     // Calculate data offsets.
     for (size_t i = 1; i < flattenedArchive.size(); ++i) {
@@ -268,14 +272,16 @@ std::vector<unsigned char> DARCHObject::serialize() {
         }
     }
 
-    result.resize(nextDataOffset);
-    header = reinterpret_cast<DARCHHeader *>(result.data());
+    // Everything up to the data section; the file data is referenced as-is.
+    std::vector<unsigned char> table(baseDataOffset);
+
+    *reinterpret_cast<DARCHHeader *>(table.data()) = header;
 
     // Write nodes.
     for (size_t i = 0; i < flattenedArchive.size(); ++i) {
         const FlatEntry &entry = flattenedArchive[i];
         DARCHNode *node = reinterpret_cast<DARCHNode*>(
-            result.data() + sizeof(DARCHHeader) +
+            table.data() + sizeof(DARCHHeader) +
             (sizeof(DARCHNode) * i)
         );
 
@@ -283,7 +289,7 @@ std::vector<unsigned char> DARCHObject::serialize() {
         node->setNameOffset(stringOffsets[i]);
 
         char *nameDest = reinterpret_cast<char *>(
-            result.data() + sizeof(DARCHHeader) +
+            table.data() + sizeof(DARCHHeader) +
             (sizeof(DARCHNode) * flattenedArchive.size()) +
             stringOffsets[i]
         );
@@ -296,20 +302,34 @@ std::vector<unsigned char> DARCHObject::serialize() {
             std::strcpy(nameDest, entry.dir->name.c_str());
         }
         else {
-            const unsigned char *fileData = entry.file->data.data();
-            unsigned fileDataSize = entry.file->data.size();
-
             node->file.dataOffset = BYTESWAP_32(dataOffsets[i]);
-            node->file.dataSize = BYTESWAP_32(fileDataSize);
+            node->file.dataSize = BYTESWAP_32(static_cast<uint32_t>(entry.file->data.size()));
 
             // Copy name.
             std::strcpy(nameDest, entry.file->name.c_str());
-            // Copy data.
-            std::memcpy(result.data() + dataOffsets[i], fileData, fileDataSize);
         }
     }
 
+    ScatterList result;
+    result.append(std::move(table));
+
+    for (size_t i = 1; i < flattenedArchive.size(); ++i) {
+        const FlatEntry &entry = flattenedArchive[i];
+        if (entry.isDir)
+            continue;
+
+        result.appendPadding(dataOffsets[i] - result.getSize());
+        result.append(entry.file->data.data(), entry.file->data.size());
+    }
+
+    // The last file is padded too if an (empty) directory follows it.
+    result.appendPadding(nextDataOffset - result.getSize());
+
     return result;
 }
 
+std::vector<unsigned char> DARCHObject::serialize() {
+    return serializeScatter().flatten();
+}
+
 } // namespace Archive
@@ -11,10 +11,17 @@ namespace Archive {
 
 class DARCHObject : public Archive::ArchiveObjectBase {
 public:
+    // The data of the files references the buffer; it is kept alive for as
+    // long as any of them do.
+    DARCHObject(SharedBuffer buffer);
+    // The data is copied once into a new buffer.
     DARCHObject(const unsigned char* data, const size_t dataSize);
     DARCHObject() = default;
 
     [[nodiscard]] std::vector<unsigned char> serialize();
+
+    // Serialize without assembling the archive image; see ScatterList.
+    [[nodiscard]] ScatterList serializeScatter() const;
 };
 
 } // namespace Archive
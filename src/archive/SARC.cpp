@@ -1,17 +1,14 @@
 #include "SARC.hpp"
 
 #include <cstdint>
+#include <cstring>
 
 #include "Logging.hpp"
 
 #include <fstream>
 
-#include <sstream>
-
 #include <algorithm>
 
-#include <stack>
-
 #include "compression/NZlib.hpp"
 
 #include "Macro.hpp"
@@ -42,7 +39,7 @@ struct SarcFileHeader {
 } __attribute__((packed));
 
 struct SfatNode {
-    uint32_t nameHash; // See sarcComputeHash for algorithm.
+    uint32_t nameHash; // See Archive::computePathHash for algorithm.
 
     // | nameOffset (3byte) | collisionCount (1byte) |
     uint32_t nameOffsetAndCollisionCount;
@@ -95,17 +92,16 @@ struct SfntSection {
     char data[0];
 } __attribute__((packed));
 
-static uint32_t sarcComputeHash(std::string_view string, uint32_t key) {
-    uint32_t result = 0;
-	for (char character : string)
-		result = character + result * key;
+namespace Archive {
 
-	return result;
-}
+SARCObject::SARCObject(const unsigned char* data, const size_t dataSize) :
+    SARCObject(std::make_shared<const std::vector<unsigned char>>(data, data + dataSize))
+{}
 
-namespace Archive {
+SARCObject::SARCObject(SharedBuffer buffer) {
+    const unsigned char* data = buffer->data();
+    const size_t dataSize = buffer->size();
 
-SARCObject::SARCObject(const unsigned char* data, const size_t dataSize) {
     if (dataSize < sizeof(SarcFileHeader)) {
         Logging::error("[SARCObject::SARCObject] Invalid SARC binary: data size smaller than header size!");
         return;
@@ -157,86 +153,69 @@ SARCObject::SARCObject(const unsigned char* data, const size_t dataSize) {
         const unsigned char* nodeDataStart = data + header->dataStart + node->dataOffsetStart;
         const unsigned char* nodeDataEnd = data + header->dataStart + node->dataOffsetEnd;
 
-        // Create file at path.
-
-        std::stringstream stream(name);
-        std::string currentSegment;
-
-        Archive::Directory* currentDir = &mStructure;
-
-        // Traverse.
-        while (std::getline(stream, currentSegment, '/')) {
-            // Last segment is the file name; add it!
-            if (stream.peek() == EOF) {
-                Archive::File newFile(currentSegment);
-
-                newFile.parent = currentDir;
-                newFile.data = std::vector<unsigned char>(nodeDataStart, nodeDataEnd);
+        const std::string_view path(name);
 
-                currentDir->addFile(std::move(newFile));
+        Archive::File newFile("");
+        newFile.data = FileData(buffer, nodeDataStart - data, nodeDataEnd - nodeDataStart);
 
-                break;
-            }
-
-            // Find or create the subdirectory.
-            auto it = std::find_if(
-                currentDir->subdirectories.begin(), currentDir->subdirectories.end(),
-                [&currentSegment](const Archive::Directory& dir) {
-                    return dir.name == currentSegment;
-                }
-            );
-
-            // Directory doesn't exist; create and add it.
-            if (it == currentDir->subdirectories.end()) {
-                Archive::Directory newDir(currentSegment, currentDir);
-                currentDir->addDirectory(std::move(newDir));
-
-                currentDir = &currentDir->subdirectories.back();
-            }
-            // Move into the existing directory.
-            else
-                currentDir = &(*it);
-        }
+        // Create file at path.
+        addFileAtPath(path, std::move(newFile));
     }
 
+    mIndexValid = true;
+
     mInitialized = true;
 }
 
-std::vector<unsigned char> SARCObject::serialize() {
+ScatterList SARCObject::serializeScatter() const {
     struct FileEntry {
         const Archive::File* file;
-        std::string path;
+
+        // Location of the path in the path pool.
+        uint32_t pathOffset;
+        uint32_t pathLength;
+
         uint32_t collisionCount;
         uint32_t pathHash;
     };
     std::vector<FileEntry> entries;
 
-    std::stack<const Archive::Directory*> dirStack;
-    dirStack.push(&mStructure);
+    // Every path, back to back.
+    std::string pathPool;
 
-    while (!dirStack.empty()) {
-        const Archive::Directory* currentDir = dirStack.top();
-        dirStack.pop();
+    // Path of the directory currently being gathered, including the trailing
+    // slash. Names are appended to it and cut off again, so no path is built
+    // more than once.
+    std::string path;
 
-        for (const auto& file : currentDir->files) {
-            // Build file path.
-            std::string path = file.name;
+    auto gatherFiles = [&entries, &pathPool, &path](auto& self, const Archive::Directory& directory) -> void {
+        const size_t baseLength = path.size();
 
-            const Archive::Directory* dir = file.parent;
-            while (dir && dir->parent) {
-                path = dir->name + "/" + path;
-                dir = dir->parent;
-            }
+        for (const auto& file : directory.files) {
+            path.resize(baseLength);
+            path += file.name;
 
             entries.push_back({
                 .file = &file,
-                .path = path,
-                .pathHash = sarcComputeHash(path, SARC_DEFAULT_HASH_KEY)
+
+                .pathOffset = static_cast<uint32_t>(pathPool.size()),
+                .pathLength = static_cast<uint32_t>(path.size()),
+
+                .pathHash = computePathHash(path, SARC_DEFAULT_HASH_KEY)
             });
+            pathPool += path;
         }
-        for (const auto& subdir : currentDir->subdirectories)
-            dirStack.push(&subdir);
-    }
+        for (const auto& subdir : directory.subdirectories) {
+            path.resize(baseLength);
+            path += subdir.name;
+            path += '/';
+
+            self(self, subdir);
+        }
+
+        path.resize(baseLength);
+    };
+    gatherFiles(gatherFiles, mStructure);
 
     // SARC nodes are always sorted by their hashes.
     std::sort(
@@ -246,7 +225,7 @@ std::vector<unsigned char> SARCObject::serialize() {
         }
     );
 
-    uint32_t lastHash = entries[0].pathHash;
+    uint32_t lastHash = entries.empty() ? 0 : entries[0].pathHash;
     uint32_t lastCollisionCount = 0;
     for (auto& entry : entries) {
         if (entry.pathHash == lastHash) {
@@ -259,20 +238,26 @@ std::vector<unsigned char> SARCObject::serialize() {
         }
     }
 
-    size_t fullSize = sizeof(SarcFileHeader) + sizeof(SfatSection) +
+    // Everything up to the file data.
+    size_t tableSize = sizeof(SarcFileHeader) + sizeof(SfatSection) +
         sizeof(SfntSection) + (sizeof(SfatNode) * entries.size());
-    for (size_t i = 0; i < entries.size(); i++)
-        fullSize += ALIGN_UP_4(entries[i].path.size() + 1);
-    for (size_t i = 0; i < entries.size(); i++)
-        fullSize = ALIGN_UP_128(fullSize) + ALIGN_UP_128(entries[i].file->data.size());
-    std::vector<unsigned char> result(fullSize);
+    for (const auto& entry : entries)
+        tableSize += ALIGN_UP_4(entry.pathLength + 1);
+    tableSize = ALIGN_UP_128(tableSize);
+
+    size_t fullSize = tableSize;
+    for (const auto& entry : entries)
+        fullSize += ALIGN_UP_128(entry.file->data.size());
+
+    std::vector<unsigned char> table(tableSize);
 
-    SarcFileHeader* header = reinterpret_cast<SarcFileHeader*>(result.data());
+    SarcFileHeader* header = reinterpret_cast<SarcFileHeader*>(table.data());
     *header = SarcFileHeader {
-        .fileSize = static_cast<uint32_t>(fullSize)
+        .fileSize = static_cast<uint32_t>(fullSize),
+        .dataStart = static_cast<uint32_t>(tableSize)
     };
 
-    SfatSection* sfatSection = reinterpret_cast<SfatSection*>(result.data() + header->headerSize);
+    SfatSection* sfatSection = reinterpret_cast<SfatSection*>(table.data() + header->headerSize);
     *sfatSection = SfatSection {
         .nodeCount = static_cast<uint16_t>(entries.size()),
 
@@ -287,6 +272,8 @@ std::vector<unsigned char> SARCObject::serialize() {
     // Write the strings & nodes at the same time.
 
     char* currentName = sfntSection->data;
+    uint32_t currentDataOffset = 0;
+
     for (size_t i = 0; i < entries.size(); i++) {
         const FileEntry& entry = entries[i];
 
@@ -297,32 +284,32 @@ std::vector<unsigned char> SARCObject::serialize() {
         node->setCollisionCount(entry.collisionCount);
         node->setNameOffset(currentName - sfntSection->data);
 
-        std::strcpy(currentName, entry.path.c_str());
-        currentName += ALIGN_UP_4(entry.path.size() + 1);
-    }
-
-    // Write the data.
-
-    unsigned char* dataStart = result.data() + ALIGN_UP_128(
-        reinterpret_cast<unsigned char*>(currentName) - result.data()
-    );
+        node->dataOffsetStart = currentDataOffset;
+        node->dataOffsetEnd = currentDataOffset + entry.file->data.size();
 
-    header->dataStart = static_cast<uint32_t>(dataStart - result.data());
+        // The table is zeroed, so the name is already terminated.
+        std::memcpy(currentName, pathPool.data() + entry.pathOffset, entry.pathLength);
+        currentName += ALIGN_UP_4(entry.pathLength + 1);
 
-    unsigned char* currentData = dataStart;
-    for (size_t i = 0; i < entries.size(); i++) {
-        const FileEntry& entry = entries[i];
+        currentDataOffset += ALIGN_UP_128(entry.file->data.size());
+    }
 
-        SfatNode* node = sfatSection->nodes + i;
+    ScatterList result;
+    result.append(std::move(table));
 
-        node->dataOffsetStart = static_cast<uint32_t>(currentData - dataStart);
-        node->dataOffsetEnd = node->dataOffsetStart + entry.file->data.size();
+    // The file data is referenced as-is.
+    for (const auto& entry : entries) {
+        const size_t dataSize = entry.file->data.size();
 
-        memcpy(currentData, entry.file->data.data(), entry.file->data.size());
-        currentData += ALIGN_UP_128(entry.file->data.size());
+        result.append(entry.file->data.data(), dataSize);
+        result.appendPadding(ALIGN_UP_128(dataSize) - dataSize);
     }
 
     return result;
 }
 
+std::vector<unsigned char> SARCObject::serialize() {
+    return serializeScatter().flatten();
+}
+
 } // namespace Archive
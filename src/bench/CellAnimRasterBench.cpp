@@ -0,0 +1,422 @@
+// toast-bench-cellanim-raster [archive]...
+// Throughput (frames/s) of the software rasterizer on dense generated
+// arrangements & on every key of the given cellanim archives (.szs), checked
+// against a reference that rasterizes the quads as two triangles like GL.
+
+#include <cstdint>
+
+#include <cmath>
+
+#include <iostream>
+#include <iomanip>
+
+#include <string>
+
+#include <vector>
+
+#include <chrono>
+#include <random>
+
+#include <algorithm>
+
+#include "cellanim/CellAnim.hpp"
+#include "cellanim/CellAnimArchive.hpp"
+#include "cellanim/CellAnimDrawData.hpp"
+#include "cellanim/CellAnimRasterizer.hpp"
+
+// Channels may differ by this much (out of 255) from the reference ...
+static constexpr int CHANNEL_TOLERANCE = 2;
+// ... and this fraction of the pixels may differ by more (pixel centers on the
+// edges of parts, which GL & the rasterizer assign differently).
+static constexpr double EDGE_TOLERANCE = .005;
+
+// The part counts of the generated arrangements.
+static constexpr unsigned PART_COUNTS[] = { 64, 512, 4096 };
+
+static constexpr unsigned CANVAS_SIZE = 1024;
+
+// Minimum time each measurement runs for.
+static constexpr double MEASURE_SECONDS = 1.0;
+
+// The reference blends & stores premultiplied doubles.
+struct ReferenceImage {
+    unsigned width, height;
+    std::vector<double> pixels;
+};
+
+static void ReferenceSample(
+    const CellAnimRasterizer::Sheet& sheet, double u, double v, double texel[4]
+) {
+    const double x = u * sheet.width - .5;
+    const double y = v * sheet.height - .5;
+
+    const double floorX = std::floor(x), floorY = std::floor(y);
+    const double weightX = x - floorX, weightY = y - floorY;
+
+    const int maxX = static_cast<int>(sheet.width) - 1;
+    const int maxY = static_cast<int>(sheet.height) - 1;
+
+    const int x0 = std::clamp(static_cast<int>(floorX), 0, maxX);
+    const int x1 = std::clamp(static_cast<int>(floorX) + 1, 0, maxX);
+    const int y0 = std::clamp(static_cast<int>(floorY), 0, maxY);
+    const int y1 = std::clamp(static_cast<int>(floorY) + 1, 0, maxY);
+
+    auto at = [&sheet](int px, int py, int c) {
+        return sheet.pixels[(static_cast<size_t>(py) * sheet.width + px) * 4 + c] / 255.0;
+    };
+
+    for (int c = 0; c < 4; c++) {
+        const double top = at(x0, y0, c) + (at(x1, y0, c) - at(x0, y0, c)) * weightX;
+        const double bottom = at(x0, y1, c) + (at(x1, y1, c) - at(x0, y1, c)) * weightX;
+        texel[c] = top + (bottom - top) * weightY;
+    }
+}
+
+static void ReferenceDrawTriangle(
+    ReferenceImage& image, const CellAnim::PartDrawCommand& command,
+    const CellAnimRasterizer::Sheet& sheet, const unsigned (&indices)[3]
+) {
+    const ImVec2 p[3] = { command.quad[indices[0]], command.quad[indices[1]], command.quad[indices[2]] };
+    const ImVec2 uv[3] = { command.uvs[indices[0]], command.uvs[indices[1]], command.uvs[indices[2]] };
+
+    const double area =
+        double(p[1].x - p[0].x) * (p[2].y - p[0].y) - double(p[1].y - p[0].y) * (p[2].x - p[0].x);
+    if (std::fabs(area) < 1e-9)
+        return;
+
+    const int minX = std::max(0, static_cast<int>(std::floor(std::min({ p[0].x, p[1].x, p[2].x }))));
+    const int minY = std::max(0, static_cast<int>(std::floor(std::min({ p[0].y, p[1].y, p[2].y }))));
+    const int maxX = std::min<int>(image.width, static_cast<int>(std::ceil(std::max({ p[0].x, p[1].x, p[2].x }))));
+    const int maxY = std::min<int>(image.height, static_cast<int>(std::ceil(std::max({ p[0].y, p[1].y, p[2].y }))));
+
+    auto edge = [](const ImVec2& a, const ImVec2& b, double x, double y) {
+        return (double(b.x) - a.x) * (y - a.y) - (double(b.y) - a.y) * (x - a.x);
+    };
+
+    const CellAnim::PartColors& colors = command.colors;
+
+    const double vertexColor[4] = {
+        ((command.vertexColor >> 0) & 0xFF) / 255.0,
+        ((command.vertexColor >> 8) & 0xFF) / 255.0,
+        ((command.vertexColor >> 16) & 0xFF) / 255.0,
+        ((command.vertexColor >> 24) & 0xFF) / 255.0
+    };
+
+    for (int y = minY; y < maxY; y++) {
+        for (int x = minX; x < maxX; x++) {
+            const double cx = x + .5, cy = y + .5;
+
+            // Barycentric weights; inside if all have the sign of the area.
+            const double w0 = edge(p[1], p[2], cx, cy) / area;
+            const double w1 = edge(p[2], p[0], cx, cy) / area;
+            const double w2 = edge(p[0], p[1], cx, cy) / area;
+
+            if (w0 < 0.0 || w1 < 0.0 || w2 < 0.0)
+                continue;
+
+            const double u = w0 * uv[0].x + w1 * uv[1].x + w2 * uv[2].x;
+            const double v = w0 * uv[0].y + w1 * uv[1].y + w2 * uv[2].y;
+
+            double color[4];
+            ReferenceSample(sheet, u, v, color);
+
+            const float* foreA = colors.foreColorA.asArray();
+            const float* backA = colors.backColorA.asArray();
+            const float* foreB = colors.foreColorB.asArray();
+            const float* backB = colors.backColorB.asArray();
+
+            for (int c = 0; c < 3; c++) {
+                const double passA = color[c] * foreA[c] + backA[c] - color[c] * foreA[c] * backA[c];
+                const double passB = passA * foreB[c] + backB[c] - passA * foreB[c] * backB[c];
+                color[c] = std::clamp(passB, 0.0, 1.0);
+            }
+
+            for (int c = 0; c < 4; c++)
+                color[c] *= vertexColor[c];
+
+            double* dst = image.pixels.data() + (static_cast<size_t>(y) * image.width + x) * 4;
+
+            const double alpha = color[3];
+            for (int c = 0; c < 3; c++)
+                dst[c] = color[c] * alpha + dst[c] * (1.0 - alpha);
+            dst[3] = alpha + dst[3] * (1.0 - alpha);
+        }
+    }
+}
+
+static std::vector<unsigned char> ReferenceRasterize(
+    unsigned width, unsigned height,
+    const std::vector<CellAnim::PartDrawCommand>& commands,
+    const std::vector<CellAnimRasterizer::Sheet>& sheets
+) {
+    ReferenceImage image { width, height, std::vector<double>(size_t(width) * height * 4, 0.0) };
+
+    // The triangles the GL renderer draws each quad as.
+    static constexpr unsigned TRIANGLES[2][3] = { { 0, 1, 3 }, { 1, 2, 3 } };
+
+    for (const auto& command : commands) {
+        const auto& sheet = sheets[command.textureVarying % sheets.size()];
+
+        ReferenceDrawTriangle(image, command, sheet, TRIANGLES[0]);
+        ReferenceDrawTriangle(image, command, sheet, TRIANGLES[1]);
+    }
+
+    std::vector<unsigned char> result(size_t(width) * height * 4);
+
+    for (size_t i = 0; i < size_t(width) * height; i++) {
+        const double* src = image.pixels.data() + i * 4;
+        const double alpha = src[3];
+
+        for (int c = 0; c < 4; c++) {
+            const double value = c == 3 ? alpha : (alpha > 0.0 ? src[c] / alpha : 0.0);
+            result[i * 4 + c] = static_cast<unsigned char>(std::clamp(value, 0.0, 1.0) * 255.0 + .5);
+        }
+    }
+
+    return result;
+}
+
+struct Comparison {
+    int maxDifference { 0 };
+    size_t pixelsOverTolerance { 0 };
+    size_t pixelCount { 0 };
+
+    void add(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b) {
+        for (size_t i = 0; i < a.size(); i += 4) {
+            // Colors of (nearly) transparent pixels don't matter.
+            const bool visible = a[i + 3] > 2 || b[i + 3] > 2;
+
+            int difference = std::abs(a[i + 3] - b[i + 3]);
+            if (visible) {
+                for (int c = 0; c < 3; c++)
+                    difference = std::max(difference, std::abs(a[i + c] - b[i + c]));
+            }
+
+            maxDifference = std::max(maxDifference, difference);
+            if (difference > CHANNEL_TOLERANCE)
+                pixelsOverTolerance++;
+        }
+
+        pixelCount += a.size() / 4;
+    }
+
+    bool withinTolerance() const {
+        return pixelsOverTolerance <= pixelCount * EDGE_TOLERANCE;
+    }
+};
+
+static void PrintComparison(const Comparison& comparison) {
+    std::cout <<
+        "  vs reference: max difference " << comparison.maxDifference << ", " <<
+        std::fixed << std::setprecision(3) <<
+        (100.0 * comparison.pixelsOverTolerance / std::max<size_t>(comparison.pixelCount, 1)) <<
+        "% of pixels over " << CHANNEL_TOLERANCE <<
+        (comparison.withinTolerance() ? "" : " (over tolerance)") << "\n";
+}
+
+// Run func until MEASURE_SECONDS have passed; returns the runs per second.
+template <typename Func>
+static double MeasureRate(Func&& func) {
+    unsigned runs = 0;
+
+    const auto start = std::chrono::steady_clock::now();
+    double seconds = 0.0;
+
+    do {
+        func();
+        runs++;
+
+        seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    } while (seconds < MEASURE_SECONDS);
+
+    return runs / seconds;
+}
+
+// A random sheet with random transparency, & an arrangement of parts cut from
+// it, scattered over the canvas with every transform, flip & color.
+static bool BenchGenerated(std::mt19937& rng) {
+    constexpr unsigned SHEET_SIZE = 512;
+
+    std::vector<unsigned char> sheetPixels(SHEET_SIZE * SHEET_SIZE * 4);
+    for (auto& value : sheetPixels)
+        value = static_cast<unsigned char>(rng());
+
+    const std::vector<CellAnimRasterizer::Sheet> sheets {
+        { sheetPixels.data(), SHEET_SIZE, SHEET_SIZE }
+    };
+
+    bool allWithinTolerance = true;
+
+    for (unsigned partCount : PART_COUNTS) {
+        CellAnim::CellAnimObject cellanim;
+        cellanim.setSheetWidth(SHEET_SIZE);
+        cellanim.setSheetHeight(SHEET_SIZE);
+
+        CellAnim::Arrangement arrangement;
+
+        std::uniform_int_distribution<unsigned> cellOrigin(0, SHEET_SIZE - 64);
+        std::uniform_int_distribution<unsigned> cellSize(8, 64);
+        std::uniform_int_distribution<int> position(-400, 400);
+        std::uniform_real_distribution<float> scale(.5f, 2.f);
+        std::uniform_real_distribution<float> angle(-180.f, 180.f);
+        std::uniform_real_distribution<float> color(0.f, 1.f);
+        std::uniform_int_distribution<unsigned> coin(0, 1);
+
+        for (unsigned i = 0; i < partCount; i++) {
+            CellAnim::ArrangementPart part;
+
+            part.cellOrigin = CellAnim::UintVec2(cellOrigin(rng), cellOrigin(rng));
+            part.cellSize = CellAnim::UintVec2(cellSize(rng), cellSize(rng));
+
+            part.transform.position = CellAnim::IntVec2(position(rng), position(rng));
+            part.transform.scale = CellAnim::FltVec2(scale(rng), scale(rng));
+            part.transform.angle = angle(rng);
+
+            part.flipX = coin(rng);
+            part.flipY = coin(rng);
+
+            part.opacity = static_cast<uint8_t>(128 + rng() % 128);
+
+            part.foreColor = { color(rng), color(rng), color(rng) };
+            part.backColor = { color(rng) * .5f, color(rng) * .5f, color(rng) * .5f };
+
+            arrangement.parts.push_back(std::move(part));
+        }
+
+        cellanim.getArrangements().push_back(std::move(arrangement));
+
+        CellAnim::AnimationKey key;
+        key.transform.angle = 15.f;
+        key.transform.scale = CellAnim::FltVec2(1.25f, .9f);
+        key.foreColor = { .9f, 1.f, .8f };
+        key.backColor = { .1f, 0.f, .05f };
+
+        std::vector<CellAnim::PartDrawCommand> commands;
+        CellAnim::makeDrawCommands(
+            commands, cellanim, key, -1, 0xFFFFFFFF, true,
+            ImVec2(CANVAS_SIZE / 2.f, CANVAS_SIZE / 2.f), ImVec2(1.f, 1.f)
+        );
+
+        std::vector<unsigned char> image(CANVAS_SIZE * CANVAS_SIZE * 4);
+
+        const double framesPerSecond = MeasureRate([&]() {
+            std::fill(image.begin(), image.end(), 0);
+            CellAnimRasterizer::rasterize(image.data(), CANVAS_SIZE, CANVAS_SIZE, commands, sheets);
+        });
+
+        std::cout <<
+            partCount << " parts on a " << CANVAS_SIZE << "x" << CANVAS_SIZE << " canvas: " <<
+            std::fixed << std::setprecision(1) << framesPerSecond << " frames/s\n";
+
+        Comparison comparison;
+        comparison.add(image, ReferenceRasterize(CANVAS_SIZE, CANVAS_SIZE, commands, sheets));
+
+        PrintComparison(comparison);
+        allWithinTolerance &= comparison.withinTolerance();
+    }
+
+    return allWithinTolerance;
+}
+
+// Every key of every animation, cropped to its bounds.
+static bool BenchArchive(const char* path) {
+    CellAnim::ArchiveContents contents;
+    std::string errorMessage;
+
+    if (!CellAnim::readArchive(path, contents, errorMessage)) {
+        std::cout << path << ": " << errorMessage << "\n\n";
+        return true;
+    }
+
+    std::vector<CellAnimRasterizer::Sheet> allSheets;
+    for (const auto& texture : contents.tplTextures)
+        allSheets.push_back({ texture.data.data(), texture.width, texture.height });
+    for (const auto& texture : contents.ctpkTextures)
+        allSheets.push_back({ texture.data.data(), texture.width, texture.height });
+
+    if (allSheets.empty()) {
+        std::cout << path << ": no sheets\n\n";
+        return true;
+    }
+
+    bool allWithinTolerance = true;
+
+    for (size_t i = 0; i < contents.cellanims.size(); i++) {
+        const auto& cellanim = *contents.cellanims[i];
+
+        // The same sheets a session gives the renderer.
+        const unsigned baseIndex = contents.type == CellAnim::CELLANIM_TYPE_CTR ?
+            i : std::max(cellanim.getSheetIndex(), 0);
+
+        std::vector<CellAnimRasterizer::Sheet> sheets;
+        if (cellanim.getUsePalette()) {
+            for (size_t j = 0; j < allSheets.size(); j++)
+                sheets.push_back(allSheets[(baseIndex + j) % allSheets.size()]);
+        }
+        else
+            sheets.push_back(allSheets[baseIndex % allSheets.size()]);
+
+        std::vector<const CellAnim::AnimationKey*> keys;
+        for (const auto& animation : cellanim.getAnimations()) {
+            for (const auto& key : animation.keys) {
+                if (key.arrangementIndex < cellanim.getArrangements().size())
+                    keys.push_back(&key);
+            }
+        }
+
+        if (keys.empty())
+            continue;
+
+        size_t pixelCount = 0;
+
+        const double passesPerSecond = MeasureRate([&]() {
+            pixelCount = 0;
+            for (const auto* key : keys)
+                pixelCount += CellAnimRasterizer::renderKey(cellanim, *key, sheets).pixels.size() / 4;
+        });
+
+        Comparison comparison;
+
+        for (const auto* key : keys) {
+            const auto frame = CellAnimRasterizer::renderKey(cellanim, *key, sheets);
+            if (frame.pixels.empty())
+                continue;
+
+            std::vector<CellAnim::PartDrawCommand> commands;
+            CellAnim::makeDrawCommands(
+                commands, cellanim, *key, -1, 0xFFFFFFFF, true,
+                ImVec2(frame.originX, frame.originY), ImVec2(1.f, 1.f)
+            );
+
+            comparison.add(frame.pixels, ReferenceRasterize(frame.width, frame.height, commands, sheets));
+        }
+
+        std::cout <<
+            path << " (" << cellanim.getName() << ", " << keys.size() << " keys): " <<
+            std::fixed << std::setprecision(1) << passesPerSecond * keys.size() << " frames/s, " <<
+            std::setprecision(1) << pixelCount / double(keys.size()) << " pixels/frame\n";
+
+        PrintComparison(comparison);
+        allWithinTolerance &= comparison.withinTolerance();
+    }
+
+    std::cout << "\n";
+    return allWithinTolerance;
+}
+
+int main(int argc, char** argv) {
+    std::mt19937 rng(1234);
+
+    bool allWithinTolerance = BenchGenerated(rng);
+    std::cout << "\n";
+
+    for (int i = 1; i < argc; i++)
+        allWithinTolerance &= BenchArchive(argv[i]);
+
+    if (!allWithinTolerance) {
+        std::cout << "The rasterizer differs from the reference on more pixels than allowed.\n";
+        return 1;
+    }
+
+    return 0;
+}
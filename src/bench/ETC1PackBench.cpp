@@ -0,0 +1,197 @@
+// toast-bench-etc1-pack <image>...
+// Quality (PSNR) & throughput (blocks/s) of every ETC1 quality level on the
+// given sheets, on one thread & without the block cache.
+
+#include <cstdint>
+
+#include <cmath>
+
+#include <iostream>
+#include <iomanip>
+
+#include <string>
+
+#include <vector>
+
+#include <chrono>
+
+#include <functional>
+
+#include <algorithm>
+
+#include <rg_etc1.h>
+
+#include "stb/stb_image.h"
+
+#include "texture/ETC1FastPacker.hpp"
+
+// The fast packer should stay within this of rg_etc1 Medium.
+static constexpr double PSNR_TOLERANCE = 1.5;
+
+// A sheet split into 4x4 blocks of opaque RGBA32 pixels (row-major).
+typedef std::vector<uint32_t> BlockList;
+
+static bool LoadBlocks(const char* path, BlockList& blocks) {
+    int width, height;
+    unsigned char* imageData = stbi_load(path, &width, &height, nullptr, 4);
+    if (!imageData)
+        return false;
+
+    const uint32_t* pixels = reinterpret_cast<const uint32_t*>(imageData);
+
+    // Blocks on the edge repeat the last row & column.
+    for (int yy = 0; yy < height; yy += 4) {
+        for (int xx = 0; xx < width; xx += 4) {
+            for (int y = 0; y < 4; y++) {
+                for (int x = 0; x < 4; x++) {
+                    const int srcX = std::min(xx + x, width - 1);
+                    const int srcY = std::min(yy + y, height - 1);
+
+                    blocks.push_back(pixels[srcY * width + srcX] | 0xFF000000);
+                }
+            }
+        }
+    }
+
+    stbi_image_free(imageData);
+    return true;
+}
+
+struct PackResult {
+    double seconds;
+    double psnr;
+
+    std::vector<uint64_t> packedBlocks;
+};
+
+static PackResult MeasurePacker(
+    const BlockList& blocks,
+    const std::function<void(void* block, const uint32_t* pixels)>& pack
+) {
+    const size_t blockCount = blocks.size() / 16;
+
+    PackResult result;
+    result.packedBlocks.resize(blockCount);
+
+    const auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < blockCount; i++)
+        pack(&result.packedBlocks[i], blocks.data() + i * 16);
+    const auto end = std::chrono::steady_clock::now();
+
+    result.seconds = std::chrono::duration<double>(end - start).count();
+
+    double squaredError = 0.0;
+
+    for (size_t i = 0; i < blockCount; i++) {
+        uint32_t decoded[16];
+        rg_etc1::unpack_etc1_block(&result.packedBlocks[i], decoded);
+
+        for (unsigned j = 0; j < 16; j++) {
+            for (unsigned c = 0; c < 3; c++) {
+                const int a = (blocks[i * 16 + j] >> (c * 8)) & 0xFF;
+                const int b = (decoded[j] >> (c * 8)) & 0xFF;
+                squaredError += (a - b) * (a - b);
+            }
+        }
+    }
+
+    const double meanSquaredError = squaredError / (blockCount * 16 * 3);
+    result.psnr = meanSquaredError > 0.0 ?
+        10.0 * std::log10(255.0 * 255.0 / meanSquaredError) : 99.0;
+
+    return result;
+}
+
+static void PrintResult(const std::string& name, const PackResult& result, size_t blockCount) {
+    std::cout <<
+        "  " << std::left << std::setw(14) << name << std::right <<
+        std::fixed << std::setprecision(2) << std::setw(7) << result.psnr << " dB" <<
+        std::setw(12) << static_cast<unsigned long>(blockCount / result.seconds) << " blocks/s\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cout << "Usage: toast-bench-etc1-pack <image>...\n";
+        return 2;
+    }
+
+    rg_etc1::pack_etc1_block_init();
+
+    bool allMatch = true;
+    bool allWithinTolerance = true;
+
+    for (int i = 1; i < argc; i++) {
+        BlockList blocks;
+        if (!LoadBlocks(argv[i], blocks)) {
+            std::cout << argv[i] << ": unable to load image\n\n";
+            continue;
+        }
+
+        const size_t blockCount = blocks.size() / 16;
+
+        std::cout << argv[i] << " (" << blockCount << " blocks):\n";
+
+        std::vector<uint64_t> fastReference;
+        double fastPsnr = 0.0;
+
+        for (unsigned j = 0; j < static_cast<unsigned>(ETC1FastPacker::PackISA::Count); j++) {
+            const auto isa = static_cast<ETC1FastPacker::PackISA>(j);
+            if (!ETC1FastPacker::isPackISASupported(isa))
+                continue;
+
+            const PackResult result = MeasurePacker(blocks, [isa](void* block, const uint32_t* pixels) {
+                ETC1FastPacker::packBlock(isa, block, pixels);
+            });
+
+            if (fastReference.empty()) {
+                fastReference = result.packedBlocks;
+                fastPsnr = result.psnr;
+            }
+
+            const bool match = result.packedBlocks == fastReference;
+            allMatch &= match;
+
+            PrintResult(
+                std::string("Fast ") + ETC1FastPacker::getPackISAName(isa) + (match ? "" : " MISMATCH"),
+                result, blockCount
+            );
+        }
+
+        static constexpr const char* QUALITY_NAMES[] = { "Low", "Medium", "High" };
+
+        double mediumPsnr = 0.0;
+
+        for (unsigned j = 0; j < 3; j++) {
+            rg_etc1::etc1_pack_params params;
+            params.m_quality = static_cast<rg_etc1::etc1_quality>(j);
+            params.m_dithering = false;
+
+            const PackResult result = MeasurePacker(blocks, [&params](void* block, const uint32_t* pixels) {
+                rg_etc1::pack_etc1_block(block, pixels, params);
+            });
+
+            if (params.m_quality == rg_etc1::cMediumQuality)
+                mediumPsnr = result.psnr;
+
+            PrintResult(QUALITY_NAMES[j], result, blockCount);
+        }
+
+        const double psnrLoss = mediumPsnr - fastPsnr;
+        allWithinTolerance &= psnrLoss <= PSNR_TOLERANCE;
+
+        std::cout <<
+            "  Fast vs Medium: " << std::showpos << -psnrLoss << std::noshowpos << " dB" <<
+            (psnrLoss <= PSNR_TOLERANCE ? "" : " (over tolerance)") << "\n\n";
+    }
+
+    if (!allMatch) {
+        std::cout << "Some instruction sets don't match the scalar output!\n";
+        return 1;
+    }
+    if (!allWithinTolerance) {
+        std::cout << "The fast packer is more than " << PSNR_TOLERANCE << " dB below Medium on some images.\n";
+        return 1;
+    }
+
+    return 0;
+}
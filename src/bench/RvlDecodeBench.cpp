@@ -0,0 +1,149 @@
+// toast-bench-rvl-decode
+// Decode throughput (MPixel/s) of the RVL texture formats for every
+// instruction set supported by the CPU, checked against the scalar kernels.
+
+#include <cstdint>
+#include <cstdlib>
+
+#include <cstring>
+
+#include <iostream>
+
+#include <string>
+
+#include <vector>
+
+#include <chrono>
+#include <random>
+
+#include <algorithm>
+
+#include "texture/RvlImageConvert.hpp"
+#include "texture/RvlDecode/Kernels.hpp"
+
+#include "texture/TPL.hpp"
+
+using namespace RvlImageConvert::detail;
+
+static constexpr TPL::TPLImageFormat FORMATS[] = {
+    TPL::TPL_IMAGE_FORMAT_I4,
+    TPL::TPL_IMAGE_FORMAT_I8,
+    TPL::TPL_IMAGE_FORMAT_IA4,
+    TPL::TPL_IMAGE_FORMAT_IA8,
+    TPL::TPL_IMAGE_FORMAT_RGB565,
+    TPL::TPL_IMAGE_FORMAT_RGB5A3,
+    TPL::TPL_IMAGE_FORMAT_RGBA32,
+    TPL::TPL_IMAGE_FORMAT_C4,
+    TPL::TPL_IMAGE_FORMAT_C8,
+    TPL::TPL_IMAGE_FORMAT_C14X2,
+    TPL::TPL_IMAGE_FORMAT_CMPR
+};
+
+struct ImageSize {
+    unsigned width, height;
+};
+
+// The second size has edge tiles in every format.
+static constexpr ImageSize SIZES[] = {
+    { 1024, 1024 },
+    { 1002, 998 }
+};
+
+static double MeasureBest(
+    DecodeImplementation impl, unsigned iterations,
+    unsigned char* result, unsigned width, unsigned height,
+    const unsigned char* data, const uint32_t* palette
+) {
+    double best = 1e30;
+
+    for (unsigned i = 0; i < iterations; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        impl(result, width, height, data, palette);
+        const auto end = std::chrono::steady_clock::now();
+
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+
+    return best;
+}
+
+int main(int argc, char** argv) {
+    unsigned iterations = 20;
+    if (argc > 1)
+        iterations = std::max(1, std::atoi(argv[1]));
+
+    std::mt19937 rng(1234);
+
+    // C14X2 indexes up to 0x3FFF.
+    std::vector<uint32_t> palette(0x4000);
+    for (auto& color : palette)
+        color = rng();
+
+    std::cout << "Best ISA: " << getDecodeISAName(getBestDecodeISA()) << "\n\n";
+
+    bool allMatch = true;
+
+    for (const auto& size : SIZES) {
+        const size_t pixelCount = static_cast<size_t>(size.width) * size.height;
+
+        std::cout << size.width << "x" << size.height << ":\n";
+
+        for (const auto format : FORMATS) {
+            std::vector<unsigned char> data(
+                RvlImageConvert::getImageByteSize(format, size.width, size.height)
+            );
+            for (auto& byte : data)
+                byte = static_cast<unsigned char>(rng());
+
+            std::vector<unsigned char> expected(pixelCount * 4);
+            std::vector<unsigned char> result(pixelCount * 4);
+
+            const DecodeImplementation scalarImpl =
+                getDecodeTable(DecodeISA::Scalar).implementations[format];
+            scalarImpl(expected.data(), size.width, size.height, data.data(), palette.data());
+
+            const double scalarTime = MeasureBest(
+                scalarImpl, iterations,
+                result.data(), size.width, size.height, data.data(), palette.data()
+            );
+
+            std::cout << "  " << TPL::getImageFormatName(format) << ":";
+
+            for (unsigned i = 0; i < static_cast<unsigned>(DecodeISA::Count); i++) {
+                const DecodeISA isa = static_cast<DecodeISA>(i);
+                if (!isDecodeISASupported(isa))
+                    continue;
+
+                const DecodeImplementation impl = getDecodeTable(isa).implementations[format];
+
+                std::fill(result.begin(), result.end(), 0);
+                impl(result.data(), size.width, size.height, data.data(), palette.data());
+
+                const bool match = memcmp(result.data(), expected.data(), result.size()) == 0;
+                allMatch &= match;
+
+                const double time = isa == DecodeISA::Scalar ? scalarTime : MeasureBest(
+                    impl, iterations,
+                    result.data(), size.width, size.height, data.data(), palette.data()
+                );
+
+                std::cout <<
+                    " " << getDecodeISAName(isa) << " " <<
+                    static_cast<unsigned>(pixelCount / time / 1e6) << " MPix/s" <<
+                    " (x" << static_cast<unsigned>(scalarTime / time * 100) / 100.0 << ")" <<
+                    (match ? "" : " MISMATCH") << ";";
+            }
+
+            std::cout << "\n";
+        }
+
+        std::cout << "\n";
+    }
+
+    if (!allMatch) {
+        std::cout << "Some kernels don't match the scalar output!\n";
+        return 1;
+    }
+
+    return 0;
+}
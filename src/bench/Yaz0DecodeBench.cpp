@@ -0,0 +1,231 @@
+// toast-bench-yaz0-decode [file]...
+// Decode throughput (MB/s) of the Yaz0 decoder on generated data & on the
+// given files, compressed at a low & a high level, against a reference byte
+// loop (the decoder as it was before the fast path). Also checks that feeding
+// the stream in small & large chunks gives the same output.
+
+#include <cstdint>
+
+#include <iostream>
+#include <iomanip>
+
+#include <string>
+
+#include <vector>
+
+#include <chrono>
+#include <random>
+
+#include <algorithm>
+
+#include "compression/Yaz0.hpp"
+
+#include "util/FileUtil.hpp"
+
+static constexpr int LEVELS[] = { 2, 8 };
+
+static constexpr unsigned ITERATIONS = 10;
+
+// The size of the generated data.
+static constexpr size_t GENERATED_SIZE = 8 * 1024 * 1024;
+
+// Decode one operation at a time, copying runs byte by byte.
+static std::vector<unsigned char> ReferenceDecode(const unsigned char* data, size_t dataSize) {
+    if (dataSize < 0x10)
+        return {};
+
+    const size_t dstSize =
+        (size_t(data[4]) << 24) | (size_t(data[5]) << 16) |
+        (size_t(data[6]) << 8) | size_t(data[7]);
+
+    std::vector<unsigned char> dst(dstSize);
+
+    const unsigned char* src = data + 0x10;
+    const unsigned char* srcEnd = data + dataSize;
+
+    size_t dstPosition = 0;
+
+    uint8_t opByte = 0, opMask = 0;
+
+    while (dstPosition < dstSize) {
+        if (opMask == 0) {
+            if (src >= srcEnd)
+                return {};
+            opByte = *(src++);
+            opMask = 0x80;
+        }
+
+        if (opByte & opMask) {
+            if (src >= srcEnd)
+                return {};
+            dst[dstPosition++] = *(src++);
+        }
+        else {
+            if (srcEnd - src < 2)
+                return {};
+
+            const unsigned pair = (src[0] << 8) | src[1];
+            src += 2;
+
+            const size_t distance = (pair & 0xFFF) + 1;
+
+            size_t length = pair >> 12;
+            if (length == 0) {
+                if (src >= srcEnd)
+                    return {};
+                length = *(src++) + 0x12;
+            }
+            else
+                length += 2;
+
+            if (distance > dstPosition || length > dstSize - dstPosition)
+                return {};
+
+            for (; length > 0; length--, dstPosition++)
+                dst[dstPosition] = dst[dstPosition - distance];
+        }
+
+        opMask >>= 1;
+    }
+
+    return dst;
+}
+
+template <typename F>
+static double MeasureBest(F func) {
+    double best = 1e30;
+
+    for (unsigned i = 0; i < ITERATIONS; i++) {
+        const auto start = std::chrono::steady_clock::now();
+        func();
+        const auto end = std::chrono::steady_clock::now();
+
+        best = std::min(best, std::chrono::duration<double>(end - start).count());
+    }
+
+    return best;
+}
+
+// Whether feeding the stream in chunks of 1 to maxChunkSize bytes gives data.
+static bool CheckChunked(
+    const std::vector<unsigned char>& compressed, const std::vector<unsigned char>& data,
+    size_t maxChunkSize, std::mt19937& rng
+) {
+    Yaz0::Decoder decoder;
+
+    for (size_t position = 0; position < compressed.size();) {
+        const size_t chunkSize = std::min<size_t>(
+            compressed.size() - position, 1 + rng() % maxChunkSize
+        );
+        if (!decoder.feed(compressed.data() + position, chunkSize))
+            return false;
+
+        position += chunkSize;
+    }
+
+    return decoder.isFinished() && decoder.takeOutput() == data;
+}
+
+static bool Bench(const std::string& name, const std::vector<unsigned char>& data, std::mt19937& rng) {
+    bool allMatch = true;
+
+    for (const int level : LEVELS) {
+        const auto compressed = Yaz0::compress(data.data(), data.size(), level);
+        if (!compressed.has_value()) {
+            std::cout << name << ": compression failed\n";
+            return false;
+        }
+
+        std::vector<unsigned char> referenceResult, result;
+
+        const double referenceTime = MeasureBest([&]() {
+            referenceResult = ReferenceDecode(compressed->data(), compressed->size());
+        });
+        const double time = MeasureBest([&]() {
+            result = Yaz0::decompress(compressed->data(), compressed->size()).value_or(
+                std::vector<unsigned char>()
+            );
+        });
+
+        const bool match =
+            referenceResult == data && result == data &&
+            CheckChunked(*compressed, data, 7, rng) &&
+            CheckChunked(*compressed, data, 70000, rng);
+        allMatch &= match;
+
+        std::cout <<
+            name << " level " << level << ": " << std::fixed << std::setprecision(1) <<
+            "reference " << data.size() / referenceTime / 1e6 << " MB/s, " <<
+            "decoder " << data.size() / time / 1e6 << " MB/s" <<
+            " (x" << std::setprecision(2) << referenceTime / time << ")" <<
+            (match ? "" : " MISMATCH") << "\n";
+    }
+
+    return allMatch;
+}
+
+// 8x8 tiles of a few colors, like a sheet with large flat areas.
+static std::vector<unsigned char> GenerateTiles(std::mt19937& rng) {
+    std::vector<unsigned char> data(GENERATED_SIZE);
+
+    uint32_t colors[4];
+    for (auto& color : colors)
+        color = rng();
+
+    for (size_t i = 0; i < data.size(); i += 8 * 4) {
+        const uint32_t color = colors[rng() % 4];
+        for (size_t j = i; j < std::min(i + 8 * 4, data.size()); j++)
+            data[j] = static_cast<unsigned char>(color >> ((j % 4) * 8));
+    }
+
+    return data;
+}
+
+// Words from a small vocabulary, with short matches at all distances.
+static std::vector<unsigned char> GenerateText(std::mt19937& rng) {
+    std::vector<std::string> words(512);
+    for (auto& word : words) {
+        word.resize(2 + rng() % 8);
+        for (auto& c : word)
+            c = static_cast<char>('a' + rng() % 26);
+    }
+
+    std::vector<unsigned char> data;
+    data.reserve(GENERATED_SIZE);
+
+    while (data.size() < GENERATED_SIZE) {
+        const std::string& word = words[rng() % words.size()];
+        data.insert(data.end(), word.begin(), word.end());
+        data.push_back(' ');
+    }
+
+    data.resize(GENERATED_SIZE);
+    return data;
+}
+
+int main(int argc, char** argv) {
+    std::mt19937 rng(1234);
+
+    bool allMatch = true;
+
+    allMatch &= Bench("tiles", GenerateTiles(rng), rng);
+    allMatch &= Bench("text", GenerateText(rng), rng);
+
+    for (int i = 1; i < argc; i++) {
+        const auto data = FileUtil::openFileData(argv[i]);
+        if (!data.has_value()) {
+            std::cout << argv[i] << ": unable to read the file\n";
+            allMatch = false;
+            continue;
+        }
+
+        allMatch &= Bench(argv[i], *data, rng);
+    }
+
+    if (!allMatch) {
+        std::cout << "The decoder doesn't match the input!\n";
+        return 1;
+    }
+
+    return 0;
+}
@@ -578,7 +578,7 @@ bool CellAnim::CellAnimObject::deserializeImpl_CTR(const unsigned char* data, co
     return true;
 }
 
-std::vector<unsigned char> CellAnim::CellAnimObject::serializeImpl_RVL() {
+std::vector<unsigned char> CellAnim::CellAnimObject::serializeImpl_RVL() const {
     size_t fullSize = sizeof(RvlCellAnimHeader) + sizeof(AnimationsHeader);
     for (const CellAnim::Arrangement& arrangement : mArrangements)
         fullSize += sizeof(RvlArrangement) + (sizeof(RvlArrangementPart) * arrangement.parts.size());
@@ -640,7 +640,7 @@ std::vector<unsigned char> CellAnim::CellAnimObject::serializeImpl_RVL() {
     return result;
 }
 
-std::vector<unsigned char> CellAnim::CellAnimObject::serializeImpl_CTR() {
+std::vector<unsigned char> CellAnim::CellAnimObject::serializeImpl_CTR() const {
     std::map<std::string, unsigned> emitterNames;
     unsigned nextEmitterIndex { 0 };
 
@@ -772,7 +772,7 @@ CellAnimObject::CellAnimObject(const unsigned char* data, const size_t dataSize)
     }
 }
 
-std::vector<unsigned char> CellAnimObject::serialize() {
+std::vector<unsigned char> CellAnimObject::serialize() const {
     switch (mType) {
     case CELLANIM_TYPE_RVL:
         return serializeImpl_RVL();
@@ -796,7 +796,7 @@ size_t CellAnimObject::countArrangementUses(unsigned arrangementIndex) const {
     return usageCount;
 }
 
-std::vector<Arrangement>::iterator CellAnimObject::insertArrangement(const Arrangement& arrangement) {
+PersistentVector<Arrangement>::iterator CellAnimObject::insertArrangement(const Arrangement& arrangement) {
     mArrangements.push_back(arrangement);
     return std::prev(mArrangements.end());
 }
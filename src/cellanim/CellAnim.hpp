@@ -10,8 +10,12 @@
 
 #include <string>
 
+#include <memory>
+
 #include <algorithm>
 
+#include "PersistentVector.hpp"
+
 #include "Macro.hpp"
 
 namespace CellAnim {
@@ -413,8 +417,8 @@ public:
     bool getUsePalette() const { return mUsePalette; }
     void setUsePalette(bool usePalette) { mUsePalette = usePalette; }
 
-    std::vector<Arrangement>& getArrangements() { return mArrangements; }
-    const std::vector<Arrangement>& getArrangements() const { return mArrangements; }
+    PersistentVector<Arrangement>& getArrangements() { return mArrangements; }
+    const PersistentVector<Arrangement>& getArrangements() const { return mArrangements; }
 
     Arrangement& getArrangement(unsigned arrangementIndex) {
         if (arrangementIndex >= mArrangements.size()) {
@@ -435,8 +439,8 @@ public:
         return mArrangements[arrangementIndex];
     }
 
-    std::vector<Animation>& getAnimations() { return mAnimations; }
-    const std::vector<Animation>& getAnimations() const { return mAnimations; }
+    PersistentVector<Animation>& getAnimations() { return mAnimations; }
+    const PersistentVector<Animation>& getAnimations() const { return mAnimations; }
 
     Animation& getAnimation(unsigned animationIndex) {
         if (animationIndex >= mAnimations.size()) {
@@ -457,9 +461,17 @@ public:
         return mAnimations[animationIndex];
     }
 
-    [[nodiscard]] std::vector<unsigned char> serialize();
+    [[nodiscard]] std::vector<unsigned char> serialize() const;
+
+    // A copy that stays as it is while this object is edited, e.g. to export
+    // or process on another thread. It's O(1): the arrangements & animations
+    // are shared until either copy is edited. Make it on the thread editing
+    // this object.
+    std::shared_ptr<CellAnimObject> snapshot() const {
+        return std::make_shared<CellAnimObject>(*this);
+    }
 
-    std::vector<Arrangement>::iterator insertArrangement(const Arrangement& arrangement);
+    PersistentVector<Arrangement>::iterator insertArrangement(const Arrangement& arrangement);
     unsigned duplicateArrangement(unsigned arrangementIndex) {
         auto it = insertArrangement(mArrangements.at(arrangementIndex));
         return std::distance(mArrangements.begin(), it);
@@ -471,8 +483,8 @@ private:
     bool deserializeImpl_RVL(const unsigned char* data, const size_t dataSize);
     bool deserializeImpl_CTR(const unsigned char* data, const size_t dataSize);
 
-    std::vector<unsigned char> serializeImpl_RVL();
-    std::vector<unsigned char> serializeImpl_CTR();
+    std::vector<unsigned char> serializeImpl_RVL() const;
+    std::vector<unsigned char> serializeImpl_CTR() const;
 
 private:
     bool mInitialized { false };
@@ -490,8 +502,8 @@ private:
     //     - This also applies if usePalette is false and the texture is paletted.
     bool mUsePalette { false };
 
-    std::vector<Arrangement> mArrangements;
-    std::vector<Animation> mAnimations;
+    PersistentVector<Arrangement> mArrangements;
+    PersistentVector<Animation> mAnimations;
 };
 
 } // namespace CellAnim
@@ -0,0 +1,673 @@
+#include "CellAnimArchive.hpp"
+
+#include <cstdint>
+
+#include <sstream>
+
+#include <algorithm>
+
+#include <optional>
+
+#include <utility>
+
+#include "archive/Archive.hpp"
+
+#include "archive/DARCH.hpp"
+#include "archive/SARC.hpp"
+
+#include "compression/Yaz0.hpp"
+#include "compression/NZlib.hpp"
+
+#include "texture/ETC1BlockCache.hpp"
+
+#include "EditorDataPackage.hpp"
+
+#include "util/FileUtil.hpp"
+
+#include "util/ShiftJISUtil.hpp"
+
+#include "Logging.hpp"
+
+#include "Macro.hpp"
+
+namespace CellAnim {
+
+constexpr size_t FILE_READ_CHUNK_SIZE = 0x40000;
+
+static bool readRvlArchive(ArchiveContents& contents, const Archive::DARCHObject& archive, std::string& errorMessage) {
+    const Archive::Directory* rootDir = archive.findDirectory(".");
+    if (!rootDir) {
+        errorMessage = "The archive does not contain the root directory: are you sure this is a cellanim archive?";
+        return false;
+    }
+
+    // Every layout archive has the directory "./blyt". If this directory exists
+    // we should throw an error.
+    if (archive.findDirectory("./blyt")) {
+        errorMessage = "The selected file is a layout archive; please choose a cellanim archive instead.";
+        return false;
+    }
+
+    const Archive::File* __tplSearch = archive.findFile("./cellanim.tpl");
+    if (!__tplSearch) {
+        errorMessage = "The texture file (cellanim.tpl) was not found: are you sure this is a cellanim archive?";
+        return false;
+    }
+
+    TPL::TPLObject tplObject (__tplSearch->data.data(), __tplSearch->data.size());
+    if (!tplObject.isInitialized()) {
+        errorMessage = "The texture file (cellanim.tpl) could not be deserialized; it might be corrupted.";
+        return false;
+    }
+
+    std::vector<const Archive::File*> brcadFiles;
+    for (const auto& file : rootDir->files) {
+        if (
+            file.name.size() >= 6 &&
+            file.name.substr(file.name.size() - STR_LIT_LEN(".brcad")) == ".brcad"
+        )
+            brcadFiles.push_back(&file);
+    }
+
+    if (brcadFiles.empty()) {
+        errorMessage =
+            "The archive does not contain any cellanim data files (.brcad): are you\n"
+            "sure this is a cellanim archive?";
+        return false;
+    }
+
+    // Sort cellanim files alphabetically for consistency when exporting.
+    std::sort(
+        brcadFiles.begin(), brcadFiles.end(),
+        [](const Archive::File*& a, const Archive::File*& b) {
+            return a->name < b->name;
+        }
+    );
+
+    contents.cellanims.resize(brcadFiles.size());
+
+    // Cellanims.
+    for (size_t i = 0; i < brcadFiles.size(); i++) {
+        auto& cellanim = contents.cellanims[i];
+        const Archive::File* file = brcadFiles[i];
+
+        cellanim = std::make_shared<CellAnimObject>(
+            file->data.data(), file->data.size()
+        );
+        cellanim->setName(file->name.substr(0, file->name.size() - STR_LIT_LEN(".brcad")));
+
+        if (!cellanim->isInitialized()) {
+            errorMessage = "A cellanim data file (.brcad) could not be deserialized; it might be corrupted.";
+            return false;
+        }
+
+        if (cellanim->getType() != CELLANIM_TYPE_RVL) {
+            errorMessage = "A cellanim data file (.brcad) is in the wrong format (expected Wii, got 3DS).";
+            return false;
+        }
+    }
+
+    // Headers (animation names).
+    for (size_t i = 0; i < brcadFiles.size(); i++) {
+        const Archive::File* brcadFile = brcadFiles[i];
+
+        int cellanimNameLen = brcadFile->name.size() - STR_LIT_LEN(".brcad");
+
+        // Find header file
+        const Archive::File* headerFile = archive.findFile(
+            "./rcad_" + brcadFile->name.substr(0, cellanimNameLen) + "_labels.h"
+        );
+
+        if (!headerFile)
+            continue;
+
+        std::istringstream stringStream(ShiftJISUtil::convertToUTF8(
+            reinterpret_cast<const char*>(headerFile->data.data()), headerFile->data.size()
+        ));
+        std::string line;
+
+        while (std::getline(stringStream, line)) {
+            while (!line.empty() && (line.back() == '\r' || line.back() == '\n')) {
+                line.pop_back();
+            }
+            if (line.compare(0, 7, "#define") == 0) {
+                std::istringstream lineStream(line);
+                std::string defineTag, key;
+                unsigned value;
+
+                lineStream >> defineTag >> key >> value;
+
+                std::string comment;
+                std::getline(lineStream, comment);
+
+                size_t commentStart = comment.find_first_not_of(" \t//");
+                if (commentStart != std::string::npos) {
+                    comment = comment.substr(commentStart);
+                }
+                else {
+                    comment.clear(); // No comment.
+                }
+
+                auto& animations = contents.cellanims[i]->getAnimations();
+                if (value < animations.size()) {
+                    auto& animation = contents.cellanims[i]->getAnimation(value);
+
+                    // +1 because of the trailing underscore.
+                    animation.name = key.substr(cellanimNameLen + 1);
+                    if (comment != "(null)")
+                        animation.comment = comment;
+                }
+            }
+        }
+    }
+
+    // Sheets.
+    contents.tplTextures = std::move(tplObject.mTextures);
+
+    // Editor data.
+    const Archive::File* tedSearch = archive.findFile(
+        std::string("./") + std::string(EditorDataProc::ARCHIVE_FILENAME)
+    );
+    if (tedSearch) {
+        EditorDataProc::Apply(contents, tedSearch->data.data(), tedSearch->data.size());
+    }
+
+    return true;
+}
+
+static bool readCtrArchive(ArchiveContents& contents, const Archive::SARCObject& archive, std::string& errorMessage) {
+    // Every layout archive has the directory "blyt". If this directory exists
+    // we should throw an error.
+    if (archive.findDirectory("blyt")) {
+        errorMessage = "The selected file is a layout archive; please choose a cellanim archive instead.";
+        return false;
+    }
+
+    const Archive::Directory* rootDir = archive.findDirectory("arc");
+    if (!rootDir) {
+        errorMessage = "The archive does not contain the root directory: are you sure this is a cellanim archive?";
+        return false;
+    }
+
+    std::vector<const Archive::File*> bccadFiles;
+    for (const auto& file : rootDir->files) {
+        if (
+            file.name.size() >= STR_LIT_LEN(".bccad") &&
+            file.name.substr(file.name.size() - STR_LIT_LEN(".bccad")) == ".bccad"
+        )
+            bccadFiles.push_back(&file);
+    }
+
+    if (bccadFiles.empty()) {
+        errorMessage =
+            "The archive does not contain any cellanim data files (.bccad): are you\n"
+            "sure this is a cellanim archive?";
+        return false;
+    }
+
+    std::vector<const Archive::File*> ctpkFiles;
+
+    for (const auto* bccadFile : bccadFiles) {
+        std::string baseName = bccadFile->name.substr(0, bccadFile->name.find_last_of('.'));
+
+        // The names usually do mirror each other; an exact match is also the
+        // longest possible match of the search below, so it can be skipped.
+        const Archive::File* bestMatch = archive.findFile("arc/" + baseName + ".ctpk");
+        size_t bestMatchLength = 0;
+
+        if (!bestMatch) {
+            for (const auto& file : rootDir->files) {
+                if (file.name.size() >= STR_LIT_LEN(".ctpk") &&
+                    file.name.substr(file.name.size() - STR_LIT_LEN(".ctpk")) == ".ctpk") {
+
+                    std::string ctpkBaseName = file.name.substr(0, file.name.find_last_of('.'));
+
+                    // HACK: because of some edge-cases where the developers didn't exactly mirror the
+                    // BCCAD and CTPK filenames, we have to do a substring search -_-
+
+                    if (baseName.find(ctpkBaseName) != std::string::npos) {
+                        // Prioritize longest match.
+                        if (ctpkBaseName.size() > bestMatchLength) {
+                            bestMatch = &file;
+                            bestMatchLength = ctpkBaseName.size();
+                        }
+                    }
+                }
+            }
+        }
+
+        if (!bestMatch) {
+            errorMessage =
+                "One or more cellanim data files (.bccad) could not be matched with a\n"
+                "texture file (.ctpk); one may be missing.";
+            return false;
+        }
+
+        ctpkFiles.push_back(bestMatch);
+    }
+
+    contents.cellanims.resize(bccadFiles.size());
+
+    // Cellanims.
+    for (size_t i = 0; i < bccadFiles.size(); i++) {
+        auto& cellanim = contents.cellanims[i];
+        const auto* file = bccadFiles[i];
+
+        cellanim = std::make_shared<CellAnimObject>(
+            file->data.data(), file->data.size()
+        );
+        cellanim->setName(file->name.substr(0, file->name.size() - STR_LIT_LEN(".bccad")));
+
+        if (!cellanim->isInitialized()) {
+            errorMessage = "A cellanim data file (.bccad) could not be deserialized; it might be corrupted.";
+            return false;
+        }
+
+        if (cellanim->getType() != CELLANIM_TYPE_CTR) {
+            errorMessage = "A cellanim data file (.bccad) is in the wrong format (expected 3DS, got Wii).";
+            return false;
+        }
+
+        cellanim->setSheetIndex(i);
+    }
+
+    // Sheets.
+    contents.ctpkTextures.reserve(ctpkFiles.size());
+    contents.ctpkNames.reserve(ctpkFiles.size());
+
+    for (size_t i = 0; i < ctpkFiles.size(); i++) {
+        const auto* file = ctpkFiles[i];
+
+        CTPK::CTPKObject ctpkObject = CTPK::CTPKObject(
+            file->data.data(), file->data.size()
+        );
+        if (!ctpkObject.isInitialized()) {
+            errorMessage = "A texture file (.ctpk) could not be deserialized; it might be corrupted.";
+            return false;
+        }
+
+        if (ctpkObject.mTextures.empty()) {
+            errorMessage = "No textures were found in a texture file (.ctpk) when at least one was expected.";
+            return false;
+        }
+
+        auto& texture = ctpkObject.mTextures[0];
+        texture.rotateCCW();
+
+        contents.ctpkTextures.push_back(std::move(texture));
+        contents.ctpkNames.push_back(file->name.substr(0, file->name.size() - STR_LIT_LEN(".ctpk")));
+    }
+
+    // Editor data.
+    const Archive::File* tedSearch = archive.findFile(
+        std::string("arc/") + std::string(EditorDataProc::ARCHIVE_FILENAME)
+    );
+    if (tedSearch) {
+        EditorDataProc::Apply(contents, tedSearch->data.data(), tedSearch->data.size());
+    }
+
+    return true;
+}
+
+bool readArchive(std::string_view filePath, ArchiveContents& contents, std::string& errorMessage) {
+    if (!FileUtil::doesFileExist(filePath)) {
+        Logging::error("[CellAnim::readArchive] File does not exist: {}", filePath);
+
+        errorMessage = "The specified file could not be opened because it does not exist.";
+        return false;
+    }
+
+    // Archives are decompressed while the file is still being read, straight
+    // into a single buffer sized from their header; the compressed file is
+    // never held in memory as a whole.
+    std::optional<Yaz0::Decoder> yaz0Decoder;
+    std::optional<NZlib::Decoder> nzlibDecoder;
+    bool decodeError = false;
+    bool formatUnknown = false;
+
+    bool readOk = FileUtil::readFileChunked(filePath, FILE_READ_CHUNK_SIZE,
+        [&yaz0Decoder, &nzlibDecoder, &decodeError, &formatUnknown](const unsigned char* chunk, size_t chunkSize) {
+            if (!yaz0Decoder.has_value() && !nzlibDecoder.has_value()) {
+                // We check for Yaz0 first since it has a magic value.
+                if (Yaz0::checkDataValid(chunk, chunkSize))
+                    yaz0Decoder.emplace();
+                else if (NZlib::checkDataValid(chunk, chunkSize))
+                    nzlibDecoder.emplace();
+                else {
+                    formatUnknown = true;
+                    return false;
+                }
+            }
+
+            if (yaz0Decoder.has_value())
+                decodeError = !yaz0Decoder->feed(chunk, chunkSize);
+            else
+                decodeError = !nzlibDecoder->feed(chunk, chunkSize);
+
+            return !decodeError;
+        }
+    );
+
+    if (!readOk && !decodeError && !formatUnknown) {
+        Logging::error("[CellAnim::readArchive] Error opening file at path: {}", filePath);
+
+        errorMessage = "The specified file could not be opened; do you have read permissions?";
+        return false;
+    }
+
+    const bool decodeFinished =
+        (yaz0Decoder.has_value() && yaz0Decoder->isFinished()) ||
+        (nzlibDecoder.has_value() && nzlibDecoder->isFinished());
+
+    if ((yaz0Decoder.has_value() || nzlibDecoder.has_value()) && (decodeError || !decodeFinished)) {
+        errorMessage = "The archive data could not be decompressed; it might be corrupted.";
+        return false;
+    }
+
+    std::vector<unsigned char> data;
+
+    if (yaz0Decoder.has_value()) {
+        contents.type = CELLANIM_TYPE_RVL;
+
+        Logging::info(
+            "[CellAnim::readArchive] Decompressed {}kb of Yaz0 data while reading.",
+            yaz0Decoder->getDecompressedSize() / 1024
+        );
+
+        data = yaz0Decoder->takeOutput();
+    }
+    else if (nzlibDecoder.has_value()) {
+        contents.type = CELLANIM_TYPE_CTR;
+
+        if (nzlibDecoder->getPaddingSize() > 0) {
+            Logging::warn(
+                "[CellAnim::readArchive] Compressed data is padded by {} bytes; strange..",
+                nzlibDecoder->getPaddingSize()
+            );
+        }
+
+        Logging::info(
+            "[CellAnim::readArchive] Decompressed {}kb of NZlib data while reading.",
+            nzlibDecoder->getDecompressedSize() / 1024
+        );
+
+        data = nzlibDecoder->takeOutput();
+    }
+    else {
+        errorMessage = "The compressed data is invalid: are you sure this is a cellanim archive?";
+        return false;
+    }
+
+    // The files of the archive reference the decompressed data instead of
+    // copying out of it.
+    const Archive::SharedBuffer archiveData =
+        std::make_shared<const std::vector<unsigned char>>(std::move(data));
+
+    switch (contents.type) {
+    case CELLANIM_TYPE_RVL: {
+        Archive::DARCHObject archive = Archive::DARCHObject(archiveData);
+
+        if (!archive.isInitialized()) {
+            errorMessage = "The archive data could not be deserialized: are you sure this is a cellanim archive?";
+            return false;
+        }
+
+        return readRvlArchive(contents, archive, errorMessage);
+    }
+    case CELLANIM_TYPE_CTR: {
+        Archive::SARCObject archive = Archive::SARCObject(archiveData);
+
+        if (!archive.isInitialized()) {
+            errorMessage = "The archive data could not be deserialized: are you sure this is a cellanim archive?";
+
+            if (archiveData->size() >= 4) {
+                const uint32_t observedMagic = *reinterpret_cast<const uint32_t*>(archiveData->data());
+                switch (observedMagic) {
+                case IDENTIFIER_TO_U32('C','G','F','X'):
+                    errorMessage = "The selected file is a BCRES; please choose a cellanim archive instead.";
+                    break;
+                case IDENTIFIER_TO_U32('S','P','B','D'):
+                    errorMessage = "The selected file is an effect file; please choose a cellanim archive instead.";
+                    break;
+
+                default:
+                    break;
+                }
+            }
+
+            return false;
+        }
+
+        return readCtrArchive(contents, archive, errorMessage);
+    }
+
+    default:
+        throw std::runtime_error("CellAnim::readArchive: invalid type; this shouldn't be reached");
+    }
+}
+
+// Yaz0::compress & NZlib::compress (gather variants) share this signature.
+using CompressFunc = bool (*)(
+    const Yaz0::GatherFunc& gather, const size_t dataSize, int compressionLevel, const Yaz0::Sink& sink
+);
+
+// The archive image is never assembled; the compressor gathers it from the
+// scatter list as it goes.
+static bool compressArchive(
+    const Archive::ScatterList& archiveScatter, int compressionLevel, CompressFunc compress,
+    std::vector<unsigned char>& output
+) {
+    output.clear();
+
+    return compress(
+        [&archiveScatter](size_t offset, size_t size, unsigned char* scratch) {
+            return archiveScatter.gather(offset, size, scratch);
+        },
+        archiveScatter.getSize(),
+        compressionLevel,
+        [&output](const unsigned char* data, size_t dataSize) {
+            output.insert(output.end(), data, data + dataSize);
+            return true;
+        }
+    );
+}
+
+static bool serializeRvlArchive(
+    const ArchiveContents& contents, int compressionLevel,
+    std::vector<unsigned char>& output, std::string& errorMessage
+) {
+    Archive::DARCHObject archive;
+
+    auto& directory = archive.getStructure().newDirectory(".");
+
+    // BRCAD files
+    for (const auto& cellanim : contents.cellanims) {
+        Archive::File file(cellanim->getName() + ".brcad");
+
+        Logging::info(
+            "[CellAnim::serializeArchive] Serializing cellanim \"{}\"..",
+            cellanim->getName()
+        );
+
+        // Make sure usePalette is synced.
+        const unsigned sheetIndex = static_cast<unsigned>(cellanim->getSheetIndex());
+        if (sheetIndex < contents.tplTextures.size()) {
+            cellanim->setUsePalette(
+                TPL::getImageFormatPaletted(contents.tplTextures[sheetIndex].format)
+            );
+        }
+
+        file.data = cellanim->serialize();
+
+        directory.addFile(std::move(file));
+    }
+
+    // Header files
+    for (const auto& cellanim : contents.cellanims) {
+        const std::string& cellanimName = cellanim->getName();
+
+        Archive::File file(
+            "rcad_" + cellanimName + "_labels.h"
+        );
+
+        Logging::info(
+            "[CellAnim::serializeArchive] Writing label header for cellanim \"{}\"..",
+            cellanimName
+        );
+
+        std::ostringstream stream;
+        const auto& animations = std::as_const(*cellanim).getAnimations();
+        for (size_t j = 0; j < animations.size(); j++) {
+            const auto& animation = animations[j];
+            if (animation.name.empty())
+                continue;
+
+            stream <<
+                "#define " << cellanimName << '_' << animation.name << '\t' << std::to_string(j) <<
+                "\t// " << (animation.comment.empty() ? "(null)" : animation.comment) << "\r\n";
+        }
+
+        const std::string strUtf8 = stream.str();
+        const std::string strShiftJIS = ShiftJISUtil::convertToShiftJIS(strUtf8.c_str(), strUtf8.length());
+
+        file.data = std::vector<unsigned char>(strShiftJIS.begin(), strShiftJIS.end());
+
+        directory.addFile(std::move(file));
+    }
+
+    // TPL file
+    {
+        Archive::File file("cellanim.tpl");
+
+        TPL::TPLObject tplObject;
+        tplObject.mTextures = contents.tplTextures;
+
+        Logging::info("[CellAnim::serializeArchive] Serializing textures..");
+
+        file.data = tplObject.serialize();
+
+        directory.addFile(std::move(file));
+    }
+
+    // TED file
+    auto editorDataOpt = EditorDataProc::Create(contents);
+    if (editorDataOpt.has_value()) {
+        Archive::File file { std::string(EditorDataProc::ARCHIVE_FILENAME) };
+
+        file.data = std::move(*editorDataOpt);
+
+        directory.addFile(std::move(file));
+    }
+
+    Logging::info("[CellAnim::serializeArchive] Serializing archive..");
+
+    directory.sortAlphabetic();
+
+    Logging::info("[CellAnim::serializeArchive] Compressing archive..");
+
+    bool compressOk = compressArchive(
+        archive.serializeScatter(), compressionLevel, &Yaz0::compress, output
+    );
+    if (!compressOk) {
+        errorMessage =
+            "An error occurred when compressing the archive; please check the log for\n"
+            "more details.";
+        return false;
+    }
+
+    return true;
+}
+
+static bool serializeCtrArchive(
+    const ArchiveContents& contents, int compressionLevel,
+    std::vector<unsigned char>& output, std::string& errorMessage
+) {
+    Archive::SARCObject archive;
+
+    auto& directory = archive.getStructure().newDirectory("arc");
+
+    // BCCAD files
+    for (const auto& cellanim : contents.cellanims) {
+        Archive::File file(cellanim->getName() + ".bccad");
+
+        Logging::info(
+            "[CellAnim::serializeArchive] Serializing cellanim \"{}\"..",
+            cellanim->getName()
+        );
+
+        file.data = cellanim->serialize();
+
+        directory.addFile(std::move(file));
+    }
+
+    // CTPK files
+    for (size_t i = 0; i < contents.ctpkTextures.size(); i++) {
+        const std::string& name = contents.ctpkNames.at(i);
+
+        Archive::File file(name + ".ctpk");
+
+        CTPK::CTPKTexture ctpkTex = contents.ctpkTextures[i];
+
+        ctpkTex.rotateCW();
+
+        ctpkTex.sourcePath = "data/" + name + "_rot.tga";
+
+        CTPK::CTPKObject ctpkObject;
+        ctpkObject.mTextures.assign(1, std::move(ctpkTex));
+
+        Logging::info(
+            "[CellAnim::serializeArchive] Serializing texture \"{}\"..",
+            name
+        );
+
+        file.data = ctpkObject.serialize();
+
+        directory.addFile(std::move(file));
+    }
+
+    if (!contents.ctpkTextures.empty())
+        ETC1BlockCache::flush();
+
+    // TED file
+    auto editorDataOpt = EditorDataProc::Create(contents);
+    if (editorDataOpt.has_value()) {
+        Archive::File file { std::string(EditorDataProc::ARCHIVE_FILENAME) };
+
+        file.data = std::move(*editorDataOpt);
+
+        directory.addFile(std::move(file));
+    }
+
+    Logging::info("[CellAnim::serializeArchive] Serializing archive..");
+
+    Logging::info("[CellAnim::serializeArchive] Compressing archive..");
+
+    bool compressOk = compressArchive(
+        archive.serializeScatter(), compressionLevel, &NZlib::compress, output
+    );
+    if (!compressOk) {
+        errorMessage =
+            "An error occurred when compressing the archive; please check the log for\n"
+            "more details.";
+        return false;
+    }
+
+    return true;
+}
+
+bool serializeArchive(
+    const ArchiveContents& contents, int compressionLevel,
+    std::vector<unsigned char>& output, std::string& errorMessage
+) {
+    switch (contents.type) {
+    case CELLANIM_TYPE_RVL:
+        return serializeRvlArchive(contents, compressionLevel, output, errorMessage);
+    case CELLANIM_TYPE_CTR:
+        return serializeCtrArchive(contents, compressionLevel, output, errorMessage);
+
+    default:
+        throw std::runtime_error("CellAnim::serializeArchive: invalid type; this shouldn't be reached");
+    }
+}
+
+} // namespace CellAnim
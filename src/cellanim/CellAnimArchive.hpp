@@ -0,0 +1,57 @@
+#ifndef CELL_ANIM_ARCHIVE_HPP
+#define CELL_ANIM_ARCHIVE_HPP
+
+#include <cstddef>
+
+#include <memory>
+
+#include <string>
+#include <string_view>
+
+#include <vector>
+
+#include "CellAnim.hpp"
+
+#include "texture/TPL.hpp"
+#include "texture/CTPK.hpp"
+
+namespace CellAnim {
+
+// The contents of a cellanim archive (.szs). This is everything a session is
+// loaded from & exported to, without any of the editor state; it doesn't need
+// a GL context or the GUI.
+struct ArchiveContents {
+    CellAnimType type { CELLANIM_TYPE_INVALID };
+
+    // Sorted by name.
+    std::vector<std::shared_ptr<CellAnimObject>> cellanims;
+
+    // RVL: the textures of cellanim.tpl, indexed by the cellanim sheet index.
+    std::vector<TPL::TPLTexture> tplTextures;
+
+    // CTR: one texture file (.ctpk) per cellanim, in the same order. The
+    // textures are stored upright (the files store them rotated).
+    std::vector<CTPK::CTPKTexture> ctpkTextures;
+    // The names of the texture files, without the extension.
+    std::vector<std::string> ctpkNames;
+};
+
+// Read, decompress and deserialize a cellanim archive (.szs). The editor data
+// in the archive (if any) is applied to the cellanims.
+//
+// Returns: true if succeeded, false if failed; errorMessage is set to a
+//          description of the problem that can be shown to the user.
+bool readArchive(std::string_view filePath, ArchiveContents& contents, std::string& errorMessage);
+
+// Serialize and compress a cellanim archive, including editor data.
+//
+// Returns: true if succeeded, false if failed; errorMessage is set to a
+//          description of the problem that can be shown to the user.
+bool serializeArchive(
+    const ArchiveContents& contents, int compressionLevel,
+    std::vector<unsigned char>& output, std::string& errorMessage
+);
+
+} // namespace CellAnim
+
+#endif // CELL_ANIM_ARCHIVE_HPP
@@ -0,0 +1,77 @@
+#include "CellAnimDrawCache.hpp"
+
+#include <functional>
+
+namespace CellAnim {
+
+bool DrawCache::Key::operator==(const Key& rhs) const {
+    return
+        arrangementRevision == rhs.arrangementRevision &&
+        arrangementIndex == rhs.arrangementIndex &&
+        keyTransform == rhs.keyTransform &&
+        keyOpacity == rhs.keyOpacity &&
+        keyForeColor == rhs.keyForeColor && keyBackColor == rhs.keyBackColor &&
+        partIndex == rhs.partIndex &&
+        colorMod == rhs.colorMod && allowOpacity == rhs.allowOpacity &&
+        offset.x == rhs.offset.x && offset.y == rhs.offset.y &&
+        scale.x == rhs.scale.x && scale.y == rhs.scale.y &&
+        sheetWidth == rhs.sheetWidth && sheetHeight == rhs.sheetHeight;
+}
+
+size_t DrawCache::KeyHash::operator()(const Key& key) const {
+    // Keys drawn in the same frame mostly differ in these.
+    size_t hash = std::hash<uint64_t>()(key.arrangementRevision);
+    hash = hash * 31 + key.arrangementIndex;
+    hash = hash * 31 + static_cast<size_t>(key.partIndex);
+    hash = hash * 31 + key.colorMod;
+    hash = hash * 31 + static_cast<size_t>(key.keyTransform.position.x);
+    hash = hash * 31 + static_cast<size_t>(key.keyTransform.position.y);
+
+    return hash;
+}
+
+const std::vector<PartDrawCommand>& DrawCache::get(
+    const CellAnimObject& cellanim, const AnimationKey& key, int partIndex,
+    uint32_t colorMod, bool allowOpacity,
+    ImVec2 offset, ImVec2 scale,
+    int frame
+) {
+    if (mSweepFrame != frame) {
+        std::erase_if(mEntries, [frame](const auto& item) {
+            return item.second.lastUsedFrame < frame - 1;
+        });
+        mSweepFrame = frame;
+    }
+
+    const Key cacheKey {
+        .arrangementRevision = cellanim.getArrangements().revisionOf(key.arrangementIndex),
+        .arrangementIndex = key.arrangementIndex,
+        .keyTransform = key.transform,
+        .keyOpacity = key.opacity,
+        .keyForeColor = key.foreColor,
+        .keyBackColor = key.backColor,
+        .partIndex = partIndex,
+        .colorMod = colorMod,
+        .allowOpacity = allowOpacity,
+        .offset = offset,
+        .scale = scale,
+        .sheetWidth = static_cast<float>(cellanim.getSheetWidth()),
+        .sheetHeight = static_cast<float>(cellanim.getSheetHeight())
+    };
+
+    auto [it, inserted] = mEntries.try_emplace(cacheKey);
+    Entry& entry = it->second;
+
+    entry.lastUsedFrame = frame;
+
+    if (inserted) {
+        makeDrawCommands(
+            entry.commands, cellanim, key, partIndex, colorMod, allowOpacity, offset, scale
+        );
+        mMissCount++;
+    }
+
+    return entry.commands;
+}
+
+} // namespace CellAnim
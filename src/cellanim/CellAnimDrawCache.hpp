@@ -0,0 +1,79 @@
+#ifndef CELL_ANIM_DRAW_CACHE_HPP
+#define CELL_ANIM_DRAW_CACHE_HPP
+
+#include <imgui.h>
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+#include <unordered_map>
+
+#include "CellAnim.hpp"
+#include "CellAnimDrawData.hpp"
+
+/*
+    The draw commands of the keys drawn in the last frame, so that drawing a
+    key again as it was doesn't make them again.
+
+    The arrangement of a key is identified by the revision of its chunk in the
+    arrangement list, which any non-const access renews; the cellanim must be
+    read through const references for the cache to hit.
+*/
+
+namespace CellAnim {
+
+class DrawCache {
+public:
+    // The draw commands of the key (see makeDrawCommands), made again only if
+    // anything they depend on changed. frame is the number of the frame being
+    // drawn; the entries not used in the frame before it are dropped.
+    const std::vector<PartDrawCommand>& get(
+        const CellAnimObject& cellanim, const AnimationKey& key, int partIndex,
+        uint32_t colorMod, bool allowOpacity,
+        ImVec2 offset, ImVec2 scale,
+        int frame
+    );
+
+    // How many times the draw commands had to be made.
+    size_t getMissCount() const { return mMissCount; }
+
+private:
+    // Everything the draw commands of a key are made from.
+    struct Key {
+        uint64_t arrangementRevision;
+        unsigned arrangementIndex;
+
+        TransformValues keyTransform;
+        uint8_t keyOpacity;
+        CTRColor keyForeColor, keyBackColor;
+
+        int partIndex;
+        uint32_t colorMod;
+        bool allowOpacity;
+
+        ImVec2 offset, scale;
+        float sheetWidth, sheetHeight;
+
+        bool operator==(const Key& rhs) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Entry {
+        int lastUsedFrame;
+
+        std::vector<PartDrawCommand> commands;
+    };
+
+    std::unordered_map<Key, Entry, KeyHash> mEntries;
+    int mSweepFrame { 0 };
+
+    size_t mMissCount { 0 };
+};
+
+} // namespace CellAnim
+
+#endif // CELL_ANIM_DRAW_CACHE_HPP
@@ -0,0 +1,172 @@
+#include "CellAnimDrawData.hpp"
+
+#include <cstddef>
+
+#include <cmath>
+
+#include <algorithm>
+
+#include "Macro.hpp"
+
+namespace CellAnim {
+
+// Note: 'angle' is in degrees.
+static ImVec2 rotateVec2(const ImVec2& v, float angle, const ImVec2& origin) {
+    const float s = std::sin(angle * ((float)M_PI / 180.f));
+    const float c = std::cos(angle * ((float)M_PI / 180.f));
+
+    float vx = v.x - origin.x;
+    float vy = v.y - origin.y;
+
+    float x = vx * c - vy * s;
+    float y = vx * s + vy * c;
+
+    return { x + origin.x, y + origin.y };
+}
+
+std::array<ImVec2, 4> getPartWorldQuad(
+    const TransformValues& keyTransform, const Arrangement& arrangement, unsigned partIndex,
+    ImVec2 offset, ImVec2 scale
+) {
+    std::array<ImVec2, 4> transformedQuad;
+
+    const ArrangementPart& part = arrangement.parts.at(partIndex);
+
+    const auto& tempOffset = arrangement.tempOffset;
+    const auto& tempScale  = arrangement.tempScale;
+
+    ImVec2 keyCenter = offset;
+
+    ImVec2 topLeftOffset {
+        static_cast<float>(part.transform.position.x),
+        static_cast<float>(part.transform.position.y)
+    };
+
+    ImVec2 bottomRightOffset {
+        (topLeftOffset.x + (part.cellSize.x * part.transform.scale.x)),
+        (topLeftOffset.y + (part.cellSize.y * part.transform.scale.y))
+    };
+
+    topLeftOffset = {
+        (topLeftOffset.x * tempScale.x) + tempOffset.x,
+        (topLeftOffset.y * tempScale.y) + tempOffset.y
+    };
+    bottomRightOffset = {
+        (bottomRightOffset.x * tempScale.x) + tempOffset.x,
+        (bottomRightOffset.y * tempScale.y) + tempOffset.y
+    };
+
+    transformedQuad = {
+        topLeftOffset,
+        { bottomRightOffset.x, topLeftOffset.y },
+        bottomRightOffset,
+        { topLeftOffset.x, bottomRightOffset.y },
+    };
+
+    const ImVec2 center = AVERAGE_IMVEC2(topLeftOffset, bottomRightOffset);
+
+    // Transformations
+    {
+        // Rotation
+        float rotAngle = part.transform.angle;
+
+        if ((tempScale.x < 0.f) ^ (tempScale.y < 0.f))
+            rotAngle = -rotAngle;
+
+        for (auto& point : transformedQuad)
+            point = rotateVec2(point, rotAngle, center);
+
+        // Key & renderer scale
+        for (auto& point : transformedQuad) {
+            point.x = (point.x * keyTransform.scale.x * scale.x) + keyCenter.x;
+            point.y = (point.y * keyTransform.scale.y * scale.y) + keyCenter.y;
+        }
+
+        // Key rotation
+        for (auto& point : transformedQuad)
+            point = rotateVec2(point, keyTransform.angle, keyCenter);
+
+        // Key offset addition
+        for (auto& point : transformedQuad) {
+            point.x += keyTransform.position.x * scale.x;
+            point.y += keyTransform.position.y * scale.y;
+        }
+    }
+
+    return transformedQuad;
+}
+
+void makeDrawCommands(
+    std::vector<PartDrawCommand>& commands,
+    const CellAnimObject& cellanim, const AnimationKey& key, int partIndex,
+    uint32_t colorMod, bool allowOpacity,
+    ImVec2 offset, ImVec2 scale
+) {
+    const Arrangement& arrangement = cellanim.getArrangement(key.arrangementIndex);
+
+    commands.clear();
+    commands.reserve(arrangement.parts.size());
+
+    const float texWidth = cellanim.getSheetWidth();
+    const float texHeight = cellanim.getSheetHeight();
+
+    for (size_t i = 0; i < arrangement.parts.size(); i++) {
+        if (partIndex >= 0 && partIndex != static_cast<int>(i))
+            continue;
+
+        const ArrangementPart& part = arrangement.parts.at(i);
+
+        // Skip invisible parts
+        if (((part.opacity == 0) && allowOpacity) || !part.editorVisible)
+            continue;
+
+        PartDrawCommand command {};
+
+        command.quad = getPartWorldQuad(key.transform, arrangement, i, offset, scale);
+
+        ImVec2 uvTopLeft = {
+            part.cellOrigin.x / texWidth,
+            part.cellOrigin.y / texHeight
+        };
+        ImVec2 uvBottomRight = {
+            uvTopLeft.x + (part.cellSize.x / texWidth),
+            uvTopLeft.y + (part.cellSize.y / texHeight)
+        };
+
+        command.uvs = std::array<ImVec2, 4>({
+            uvTopLeft,
+            { uvBottomRight.x, uvTopLeft.y },
+            uvBottomRight,
+            { uvTopLeft.x, uvBottomRight.y }
+        });
+
+        if (part.flipX) {
+            std::swap(command.uvs[0], command.uvs[1]);
+            std::swap(command.uvs[2], command.uvs[3]);
+        }
+        if (part.flipY) {
+            std::swap(command.uvs[0], command.uvs[3]);
+            std::swap(command.uvs[1], command.uvs[2]);
+        }
+
+        command.textureVarying = part.textureVarying;
+
+        unsigned baseAlpha = allowOpacity ?
+            ((unsigned(part.opacity) * unsigned(key.opacity)) / 0xFF) :
+            0xFF;
+
+        unsigned vertexAlpha = (baseAlpha * ((colorMod >> 24) & 0xFF)) / 0xFF;
+        command.vertexColor = (colorMod & 0x00FFFFFF) | (vertexAlpha << 24);
+
+        command.colors = PartColors {
+            .backColorA = part.backColor,
+            .backColorB = key.backColor,
+            .foreColorA = part.foreColor,
+            .foreColorB = key.foreColor
+        };
+
+        commands.push_back(std::move(command));
+    }
+}
+
+} // namespace CellAnim
@@ -0,0 +1,73 @@
+#ifndef CELL_ANIM_DRAW_DATA_HPP
+#define CELL_ANIM_DRAW_DATA_HPP
+
+#include <imgui.h>
+
+#include <cstdint>
+
+#include <array>
+#include <vector>
+
+#include "CellAnim.hpp"
+
+/*
+    What drawing a key comes down to: one textured quad per visible part, in
+    world space. Shared by the GL renderer & the software rasterizer, so both
+    draw the same thing.
+*/
+
+namespace CellAnim {
+
+// The colors a part is blended with (multiply, then screen); A is the part's
+// & B the key's.
+struct PartColors {
+    CTRColor backColorA, backColorB;
+    CTRColor foreColorA, foreColorB;
+
+    bool operator==(const PartColors& rhs) const {
+        return
+            backColorA == rhs.backColorA && backColorB == rhs.backColorB &&
+            foreColorA == rhs.foreColorA && foreColorB == rhs.foreColorB;
+    }
+    bool operator!=(const PartColors& rhs) const {
+        return !(*this == rhs);
+    }
+};
+
+struct PartDrawCommand {
+    // Top-left, top-right, bottom-right & bottom-left corners of the cell;
+    // always a parallelogram.
+    std::array<ImVec2, 4> quad;
+    std::array<ImVec2, 4> uvs;
+
+    // The sheet is picked by the one drawing the command (base sheet index +
+    // texture varying), since the sheets aren't part of the cellanim.
+    unsigned textureVarying;
+
+    // RGBA; the alpha includes the part & key opacity.
+    uint32_t vertexColor;
+
+    PartColors colors;
+};
+
+// The world quad of a part. The key is centered on offset; scale is the zoom
+// on top of the key's own scale.
+std::array<ImVec2, 4> getPartWorldQuad(
+    const TransformValues& keyTransform, const Arrangement& arrangement, unsigned partIndex,
+    ImVec2 offset, ImVec2 scale
+);
+
+// Make the draw commands of a key, in drawing order (replacing the contents
+// of commands). If partIndex isn't negative, only that part is drawn. colorMod
+// multiplies the vertex colors; the part & key opacity are ignored unless
+// allowOpacity is set.
+void makeDrawCommands(
+    std::vector<PartDrawCommand>& commands,
+    const CellAnimObject& cellanim, const AnimationKey& key, int partIndex,
+    uint32_t colorMod, bool allowOpacity,
+    ImVec2 offset, ImVec2 scale
+);
+
+} // namespace CellAnim
+
+#endif // CELL_ANIM_DRAW_DATA_HPP
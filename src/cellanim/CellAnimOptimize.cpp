@@ -0,0 +1,92 @@
+#include "CellAnimOptimize.hpp"
+
+#include <vector>
+
+#include <utility>
+
+namespace CellAnim {
+
+// Erase the arrangements where keep is false and point the animation keys to
+// the new indices. remap maps each original index to the original index of
+// the arrangement that replaces it (itself if it is kept).
+static size_t eraseArrangements(
+    CellAnimObject& cellanim,
+    const std::vector<bool>& keep, const std::vector<unsigned>& remap
+) {
+    auto& arrangements = cellanim.getArrangements();
+
+    std::vector<unsigned> newIndex(arrangements.size());
+
+    size_t writeIndex = 0;
+    for (size_t i = 0; i < arrangements.size(); i++) {
+        if (!keep[i])
+            continue;
+
+        if (writeIndex != i)
+            arrangements[writeIndex] = std::move(arrangements[i]);
+
+        newIndex[i] = writeIndex++;
+    }
+
+    const size_t removedCount = arrangements.size() - writeIndex;
+    arrangements.resize(writeIndex);
+
+    for (auto& animation : cellanim.getAnimations()) {
+        for (auto& key : animation.keys) {
+            if (key.arrangementIndex < remap.size())
+                key.arrangementIndex = newIndex[remap[key.arrangementIndex]];
+        }
+    }
+
+    return removedCount;
+}
+
+void removeAnimationNames(CellAnimObject& cellanim) {
+    for (auto& animation : cellanim.getAnimations())
+        animation.name.clear();
+}
+
+size_t removeUnusedArrangements(CellAnimObject& cellanim) {
+    const size_t arrangementCount = cellanim.getArrangements().size();
+
+    std::vector<bool> used(arrangementCount, false);
+    for (const auto& animation : std::as_const(cellanim).getAnimations()) {
+        for (const auto& key : animation.keys) {
+            if (key.arrangementIndex < arrangementCount)
+                used[key.arrangementIndex] = true;
+        }
+    }
+
+    std::vector<unsigned> remap(arrangementCount);
+    for (size_t i = 0; i < arrangementCount; i++)
+        remap[i] = i;
+
+    return eraseArrangements(cellanim, used, remap);
+}
+
+size_t removeDuplicateArrangements(CellAnimObject& cellanim) {
+    const auto& arrangements = cellanim.getArrangements();
+    const size_t arrangementCount = arrangements.size();
+
+    std::vector<bool> keep(arrangementCount, true);
+
+    std::vector<unsigned> remap(arrangementCount);
+    for (size_t i = 0; i < arrangementCount; i++)
+        remap[i] = i;
+
+    for (size_t i = 0; i < arrangementCount; i++) {
+        if (!keep[i])
+            continue;
+
+        for (size_t j = i + 1; j < arrangementCount; j++) {
+            if (keep[j] && arrangements[i] == arrangements[j]) {
+                keep[j] = false;
+                remap[j] = i;
+            }
+        }
+    }
+
+    return eraseArrangements(cellanim, keep, remap);
+}
+
+} // namespace CellAnim
@@ -0,0 +1,26 @@
+#ifndef CELL_ANIM_OPTIMIZE_HPP
+#define CELL_ANIM_OPTIMIZE_HPP
+
+#include <cstddef>
+
+#include "CellAnim.hpp"
+
+namespace CellAnim {
+
+// Clear the names of all animations.
+void removeAnimationNames(CellAnimObject& cellanim);
+
+// Remove arrangements that aren't used by any animation key.
+//
+// Returns: the amount of arrangements removed.
+size_t removeUnusedArrangements(CellAnimObject& cellanim);
+
+// Merge arrangements that are equal; the animation keys are pointed to the
+// first of each.
+//
+// Returns: the amount of arrangements removed.
+size_t removeDuplicateArrangements(CellAnimObject& cellanim);
+
+} // namespace CellAnim
+
+#endif // CELL_ANIM_OPTIMIZE_HPP
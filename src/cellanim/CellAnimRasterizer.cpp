@@ -0,0 +1,517 @@
+#include "CellAnimRasterizer.hpp"
+
+#include <cstdint>
+
+#include <cstring>
+
+#include <cmath>
+
+#include <limits>
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "util/ParallelUtil.hpp"
+
+#include "Logging.hpp"
+
+// Tiles are square; one tile is drawn by one thread at a time.
+constexpr unsigned TILE_SIZE = 64;
+
+// Largest frame renderKey makes, in pixels.
+constexpr size_t MAX_FRAME_PIXELS = size_t(16384) * 16384;
+
+namespace {
+
+// An RGBA pixel as four floats from 0 to 1.
+
+#if defined(__SSE2__)
+
+typedef __m128 Pixel;
+
+inline Pixel MakePixel(float r, float g, float b, float a) { return _mm_setr_ps(r, g, b, a); }
+inline Pixel Splat(float value) { return _mm_set1_ps(value); }
+
+inline Pixel LoadPixel(const float* src) { return _mm_loadu_ps(src); }
+inline void StorePixel(float* dst, Pixel pixel) { _mm_storeu_ps(dst, pixel); }
+
+inline Pixel Add(Pixel a, Pixel b) { return _mm_add_ps(a, b); }
+inline Pixel Sub(Pixel a, Pixel b) { return _mm_sub_ps(a, b); }
+inline Pixel Mul(Pixel a, Pixel b) { return _mm_mul_ps(a, b); }
+
+inline Pixel Lerp(Pixel a, Pixel b, float t) {
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), _mm_set1_ps(t)));
+}
+
+inline Pixel Clamp01(Pixel pixel) {
+    return _mm_min_ps(_mm_max_ps(pixel, _mm_setzero_ps()), _mm_set1_ps(1.f));
+}
+
+inline float GetAlpha(Pixel pixel) {
+    return _mm_cvtss_f32(_mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3)));
+}
+
+// RGB multiplied by alpha.
+inline Pixel Premultiply(Pixel pixel) {
+    const __m128 alpha = _mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3));
+
+    const __m128 rgbMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    const __m128 alphaOne = _mm_set_ps(1.f, 0.f, 0.f, 0.f);
+
+    return _mm_mul_ps(pixel, _mm_or_ps(_mm_and_ps(alpha, rgbMask), alphaOne));
+}
+
+inline Pixel LoadRGBA32(const unsigned char* src) {
+    uint32_t value;
+    std::memcpy(&value, src, sizeof(uint32_t));
+
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i channels = _mm_cvtsi32_si128(static_cast<int>(value));
+    channels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(channels, zero), zero);
+
+    return _mm_mul_ps(_mm_cvtepi32_ps(channels), _mm_set1_ps(1.f / 255.f));
+}
+
+inline void StoreRGBA32(unsigned char* dst, Pixel pixel) {
+    __m128 channels = _mm_add_ps(_mm_mul_ps(Clamp01(pixel), _mm_set1_ps(255.f)), _mm_set1_ps(.5f));
+
+    __m128i packed = _mm_cvttps_epi32(channels);
+    packed = _mm_packs_epi32(packed, packed);
+    packed = _mm_packus_epi16(packed, packed);
+
+    const uint32_t value = static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+    std::memcpy(dst, &value, sizeof(uint32_t));
+}
+
+#else // defined(__SSE2__)
+
+struct Pixel {
+    float c[4];
+};
+
+inline Pixel MakePixel(float r, float g, float b, float a) { return Pixel {{ r, g, b, a }}; }
+inline Pixel Splat(float value) { return Pixel {{ value, value, value, value }}; }
+
+inline Pixel LoadPixel(const float* src) {
+    return Pixel {{ src[0], src[1], src[2], src[3] }};
+}
+inline void StorePixel(float* dst, Pixel pixel) {
+    std::memcpy(dst, pixel.c, sizeof(pixel.c));
+}
+
+inline Pixel Add(Pixel a, Pixel b) {
+    return Pixel {{ a.c[0] + b.c[0], a.c[1] + b.c[1], a.c[2] + b.c[2], a.c[3] + b.c[3] }};
+}
+inline Pixel Sub(Pixel a, Pixel b) {
+    return Pixel {{ a.c[0] - b.c[0], a.c[1] - b.c[1], a.c[2] - b.c[2], a.c[3] - b.c[3] }};
+}
+inline Pixel Mul(Pixel a, Pixel b) {
+    return Pixel {{ a.c[0] * b.c[0], a.c[1] * b.c[1], a.c[2] * b.c[2], a.c[3] * b.c[3] }};
+}
+
+inline Pixel Lerp(Pixel a, Pixel b, float t) {
+    return Add(a, Mul(Sub(b, a), Splat(t)));
+}
+
+inline Pixel Clamp01(Pixel pixel) {
+    for (float& channel : pixel.c)
+        channel = std::min(std::max(channel, 0.f), 1.f);
+    return pixel;
+}
+
+inline float GetAlpha(Pixel pixel) { return pixel.c[3]; }
+
+// RGB multiplied by alpha.
+inline Pixel Premultiply(Pixel pixel) {
+    const float alpha = pixel.c[3];
+    return Pixel {{ pixel.c[0] * alpha, pixel.c[1] * alpha, pixel.c[2] * alpha, alpha }};
+}
+
+inline Pixel LoadRGBA32(const unsigned char* src) {
+    constexpr float scale = 1.f / 255.f;
+    return Pixel {{ src[0] * scale, src[1] * scale, src[2] * scale, src[3] * scale }};
+}
+
+inline void StoreRGBA32(unsigned char* dst, Pixel pixel) {
+    pixel = Clamp01(pixel);
+    for (unsigned i = 0; i < 4; i++)
+        dst[i] = static_cast<unsigned char>(pixel.c[i] * 255.f + .5f);
+}
+
+#endif // defined(__SSE2__)
+
+// Premultiplied RGBA32 to straight; fully transparent pixels become zero.
+inline void StoreStraightRGBA32(unsigned char* dst, Pixel pixel) {
+    const float alpha = GetAlpha(pixel);
+    if (alpha <= 0.f) {
+        std::memset(dst, 0, 4);
+        return;
+    }
+
+    const float scale = 1.f / alpha;
+    StoreRGBA32(dst, Mul(pixel, MakePixel(scale, scale, scale, 1.f)));
+}
+
+// A command, ready to be drawn. s & t go from 0 to 1 across the quad (along
+// the top & left edge); both are linear in the pixel position, as are the
+// texel coordinates.
+struct QuadSetup {
+    // At pixel (0, 0); x & y are pixel centers.
+    float s0, sdx, sdy;
+    float t0, tdx, tdy;
+
+    // Texel coordinates, with the texel centers on whole numbers.
+    float u0, udx, udy;
+    float v0, vdx, vdy;
+
+    // Bounds in pixels; max is exclusive.
+    int minX, minY, maxX, maxY;
+
+    const CellAnimRasterizer::Sheet* sheet;
+
+    // The shader's two multiply & screen passes come down to
+    // color * colorMul + colorAdd (alpha untouched), then the vertex color.
+    Pixel colorMul, colorAdd;
+    Pixel vertexColor;
+};
+
+bool MakeQuadSetup(
+    QuadSetup& setup, const CellAnim::PartDrawCommand& command,
+    const CellAnimRasterizer::Sheet& sheet, unsigned width, unsigned height
+) {
+    const auto& quad = command.quad;
+    const auto& uvs = command.uvs;
+
+    const ImVec2 p0 = quad[0];
+    const ImVec2 e1 { quad[1].x - p0.x, quad[1].y - p0.y };
+    const ImVec2 e2 { quad[3].x - p0.x, quad[3].y - p0.y };
+
+    const float det = e1.x * e2.y - e1.y * e2.x;
+    if (std::fabs(det) < 1e-6f || !std::isfinite(det))
+        return false;
+
+    const float invDet = 1.f / det;
+
+    setup.sdx = e2.y * invDet;
+    setup.sdy = -e2.x * invDet;
+    setup.s0 = (p0.y * e2.x - p0.x * e2.y) * invDet;
+
+    setup.tdx = -e1.y * invDet;
+    setup.tdy = e1.x * invDet;
+    setup.t0 = (p0.x * e1.y - p0.y * e1.x) * invDet;
+
+    const float sheetW = static_cast<float>(sheet.width);
+    const float sheetH = static_cast<float>(sheet.height);
+
+    const float us = (uvs[1].x - uvs[0].x) * sheetW, ut = (uvs[3].x - uvs[0].x) * sheetW;
+    const float vs = (uvs[1].y - uvs[0].y) * sheetH, vt = (uvs[3].y - uvs[0].y) * sheetH;
+
+    setup.u0 = uvs[0].x * sheetW - .5f + us * setup.s0 + ut * setup.t0;
+    setup.udx = us * setup.sdx + ut * setup.tdx;
+    setup.udy = us * setup.sdy + ut * setup.tdy;
+
+    setup.v0 = uvs[0].y * sheetH - .5f + vs * setup.s0 + vt * setup.t0;
+    setup.vdx = vs * setup.sdx + vt * setup.tdx;
+    setup.vdy = vs * setup.sdy + vt * setup.tdy;
+
+    float minX = quad[0].x, maxX = quad[0].x;
+    float minY = quad[0].y, maxY = quad[0].y;
+    for (const ImVec2& point : quad) {
+        minX = std::min(minX, point.x);
+        maxX = std::max(maxX, point.x);
+        minY = std::min(minY, point.y);
+        maxY = std::max(maxY, point.y);
+    }
+
+    setup.minX = static_cast<int>(std::max(std::floor(minX), 0.f));
+    setup.minY = static_cast<int>(std::max(std::floor(minY), 0.f));
+    setup.maxX = static_cast<int>(std::min(std::ceil(maxX), static_cast<float>(width)));
+    setup.maxY = static_cast<int>(std::min(std::ceil(maxY), static_cast<float>(height)));
+
+    if (setup.minX >= setup.maxX || setup.minY >= setup.maxY)
+        return false;
+
+    setup.sheet = &sheet;
+
+    const auto& colors = command.colors;
+
+    // (c * fore) screen back = c * fore * (1 - back) + back
+    const auto passMul = [](const CellAnim::CTRColor& fore, const CellAnim::CTRColor& back) {
+        return MakePixel(fore.r * (1.f - back.r), fore.g * (1.f - back.g), fore.b * (1.f - back.b), 1.f);
+    };
+
+    const Pixel mulA = passMul(colors.foreColorA, colors.backColorA);
+    const Pixel mulB = passMul(colors.foreColorB, colors.backColorB);
+    const Pixel addA = MakePixel(colors.backColorA.r, colors.backColorA.g, colors.backColorA.b, 0.f);
+    const Pixel addB = MakePixel(colors.backColorB.r, colors.backColorB.g, colors.backColorB.b, 0.f);
+
+    setup.colorMul = Mul(mulA, mulB);
+    setup.colorAdd = Add(Mul(addA, mulB), addB);
+
+    const uint32_t vertexColor = command.vertexColor;
+    setup.vertexColor = MakePixel(
+        ((vertexColor >> 0) & 0xFF) / 255.f,
+        ((vertexColor >> 8) & 0xFF) / 255.f,
+        ((vertexColor >> 16) & 0xFF) / 255.f,
+        ((vertexColor >> 24) & 0xFF) / 255.f
+    );
+
+    return true;
+}
+
+// Narrow [lo, hi) to the x for which value + step * x is in [0, 1).
+inline void RestrictSpan(float value, float step, float& lo, float& hi) {
+    if (step == 0.f) {
+        if (value < 0.f || value >= 1.f)
+            hi = lo;
+        return;
+    }
+
+    const float x0 = -value / step;
+    const float x1 = (1.f - value) / step;
+
+    if (step > 0.f) {
+        lo = std::max(lo, x0);
+        hi = std::min(hi, x1);
+    }
+    else {
+        lo = std::max(lo, x1);
+        hi = std::min(hi, x0);
+    }
+}
+
+inline Pixel SampleBilinear(const CellAnimRasterizer::Sheet& sheet, float u, float v) {
+    const float floorU = std::floor(u);
+    const float floorV = std::floor(v);
+
+    const float weightU = u - floorU;
+    const float weightV = v - floorV;
+
+    const int maxX = static_cast<int>(sheet.width) - 1;
+    const int maxY = static_cast<int>(sheet.height) - 1;
+
+    const int x0 = std::clamp(static_cast<int>(floorU), 0, maxX);
+    const int x1 = std::clamp(static_cast<int>(floorU) + 1, 0, maxX);
+    const int y0 = std::clamp(static_cast<int>(floorV), 0, maxY);
+    const int y1 = std::clamp(static_cast<int>(floorV) + 1, 0, maxY);
+
+    const size_t stride = static_cast<size_t>(sheet.width) * 4;
+
+    const unsigned char* row0 = sheet.pixels + stride * y0;
+    const unsigned char* row1 = sheet.pixels + stride * y1;
+
+    const Pixel top = Lerp(LoadRGBA32(row0 + x0 * 4), LoadRGBA32(row0 + x1 * 4), weightU);
+    const Pixel bottom = Lerp(LoadRGBA32(row1 + x0 * 4), LoadRGBA32(row1 + x1 * 4), weightU);
+
+    return Lerp(top, bottom, weightV);
+}
+
+// Draw the part of a command inside a tile. tile holds the premultiplied
+// pixels of the tile (tileWidth wide), starting at (tileX, tileY).
+void DrawQuad(
+    const QuadSetup& setup,
+    float* tile, int tileX, int tileY, int tileWidth, int tileHeight
+) {
+    const int beginY = std::max(setup.minY, tileY);
+    const int endY = std::min(setup.maxY, tileY + tileHeight);
+
+    const int tileEndX = std::min(setup.maxX, tileX + tileWidth);
+
+    for (int y = beginY; y < endY; y++) {
+        const float centerY = static_cast<float>(y) + .5f;
+
+        float lo = -std::numeric_limits<float>::infinity();
+        float hi = std::numeric_limits<float>::infinity();
+
+        RestrictSpan(setup.s0 + setup.sdy * centerY, setup.sdx, lo, hi);
+        RestrictSpan(setup.t0 + setup.tdy * centerY, setup.tdx, lo, hi);
+
+        if (!(lo < hi))
+            continue;
+
+        // Pixels with their center in [lo, hi).
+        const float spanBegin = std::ceil(lo - .5f);
+        const float spanEnd = std::ceil(hi - .5f);
+
+        const int beginX = static_cast<int>(std::max(spanBegin, static_cast<float>(std::max(setup.minX, tileX))));
+        const int endX = static_cast<int>(std::min(spanEnd, static_cast<float>(tileEndX)));
+
+        if (beginX >= endX)
+            continue;
+
+        const float rowU = setup.u0 + setup.udy * centerY;
+        const float rowV = setup.v0 + setup.vdy * centerY;
+
+        float* dst = tile + (static_cast<size_t>(y - tileY) * tileWidth + (beginX - tileX)) * 4;
+
+        for (int x = beginX; x < endX; x++, dst += 4) {
+            const float centerX = static_cast<float>(x) + .5f;
+
+            const Pixel texel = SampleBilinear(
+                *setup.sheet, rowU + setup.udx * centerX, rowV + setup.vdx * centerX
+            );
+
+            const Pixel color = Mul(Clamp01(Add(Mul(texel, setup.colorMul), setup.colorAdd)), setup.vertexColor);
+
+            const float alpha = GetAlpha(color);
+            if (alpha <= 0.f)
+                continue;
+
+            const Pixel result = Add(Premultiply(color), Mul(LoadPixel(dst), Splat(1.f - alpha)));
+            StorePixel(dst, result);
+        }
+    }
+}
+
+} // namespace
+
+namespace CellAnimRasterizer {
+
+void rasterize(
+    unsigned char* image, unsigned width, unsigned height,
+    const std::vector<CellAnim::PartDrawCommand>& commands,
+    const std::vector<Sheet>& sheets
+) {
+    if (image == nullptr || width == 0 || height == 0 || sheets.empty())
+        return;
+
+    std::vector<QuadSetup> setups;
+    setups.reserve(commands.size());
+
+    for (const auto& command : commands) {
+        const Sheet& sheet = sheets[command.textureVarying % sheets.size()];
+        if (sheet.pixels == nullptr || sheet.width == 0 || sheet.height == 0)
+            continue;
+
+        QuadSetup setup;
+        if (MakeQuadSetup(setup, command, sheet, width, height))
+            setups.push_back(setup);
+    }
+
+    if (setups.empty())
+        return;
+
+    const unsigned tileCountX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    const unsigned tileCountY = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    // The commands overlapping each tile, in drawing order.
+    std::vector<std::vector<unsigned>> bins(tileCountX * tileCountY);
+
+    for (unsigned i = 0; i < setups.size(); i++) {
+        const QuadSetup& setup = setups[i];
+
+        for (unsigned ty = setup.minY / TILE_SIZE; ty <= (setup.maxY - 1) / TILE_SIZE; ty++) {
+            for (unsigned tx = setup.minX / TILE_SIZE; tx <= (setup.maxX - 1) / TILE_SIZE; tx++)
+                bins[ty * tileCountX + tx].push_back(i);
+        }
+    }
+
+    const size_t stride = static_cast<size_t>(width) * 4;
+
+    ParallelUtil::parallelFor(bins.size(), 1, [&](size_t begin, size_t end) {
+        std::vector<float> tile(TILE_SIZE * TILE_SIZE * 4);
+
+        for (size_t i = begin; i < end; i++) {
+            if (bins[i].empty())
+                continue;
+
+            const int tileX = static_cast<int>((i % tileCountX) * TILE_SIZE);
+            const int tileY = static_cast<int>((i / tileCountX) * TILE_SIZE);
+
+            const int tileWidth = std::min<int>(TILE_SIZE, width - tileX);
+            const int tileHeight = std::min<int>(TILE_SIZE, height - tileY);
+
+            for (int y = 0; y < tileHeight; y++) {
+                const unsigned char* src = image + stride * (tileY + y) + tileX * 4;
+                float* dst = tile.data() + static_cast<size_t>(y) * tileWidth * 4;
+
+                for (int x = 0; x < tileWidth; x++)
+                    StorePixel(dst + x * 4, Premultiply(LoadRGBA32(src + x * 4)));
+            }
+
+            for (unsigned index : bins[i])
+                DrawQuad(setups[index], tile.data(), tileX, tileY, tileWidth, tileHeight);
+
+            for (int y = 0; y < tileHeight; y++) {
+                unsigned char* dst = image + stride * (tileY + y) + tileX * 4;
+                const float* src = tile.data() + static_cast<size_t>(y) * tileWidth * 4;
+
+                for (int x = 0; x < tileWidth; x++)
+                    StoreStraightRGBA32(dst + x * 4, LoadPixel(src + x * 4));
+            }
+        }
+    });
+}
+
+Frame renderKey(
+    const CellAnim::CellAnimObject& cellanim, const CellAnim::AnimationKey& key,
+    const std::vector<Sheet>& sheets,
+    float scale, bool allowOpacity
+) {
+    Frame frame;
+
+    std::vector<CellAnim::PartDrawCommand> commands;
+    CellAnim::makeDrawCommands(
+        commands, cellanim, key, -1, 0xFFFFFFFF, allowOpacity,
+        ImVec2(0.f, 0.f), ImVec2(scale, scale)
+    );
+
+    if (commands.empty())
+        return frame;
+
+    float minX = std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = std::numeric_limits<float>::lowest();
+
+    for (const auto& command : commands) {
+        for (const ImVec2& point : command.quad) {
+            minX = std::min(minX, point.x);
+            minY = std::min(minY, point.y);
+            maxX = std::max(maxX, point.x);
+            maxY = std::max(maxY, point.y);
+        }
+    }
+
+    minX = std::floor(minX);
+    minY = std::floor(minY);
+
+    const float frameWidth = std::ceil(maxX - minX);
+    const float frameHeight = std::ceil(maxY - minY);
+
+    if (!(frameWidth >= 1.f && frameHeight >= 1.f))
+        return frame;
+
+    if (static_cast<double>(frameWidth) * frameHeight > static_cast<double>(MAX_FRAME_PIXELS)) {
+        Logging::error(
+            "[CellAnimRasterizer::renderKey] The frame is too large ({}x{})",
+            frameWidth, frameHeight
+        );
+        return frame;
+    }
+
+    for (auto& command : commands) {
+        for (ImVec2& point : command.quad) {
+            point.x -= minX;
+            point.y -= minY;
+        }
+    }
+
+    frame.width = static_cast<unsigned>(frameWidth);
+    frame.height = static_cast<unsigned>(frameHeight);
+
+    frame.originX = -minX;
+    frame.originY = -minY;
+
+    frame.pixels.assign(static_cast<size_t>(frame.width) * frame.height * 4, 0);
+
+    rasterize(frame.pixels.data(), frame.width, frame.height, commands, sheets);
+
+    return frame;
+}
+
+} // namespace CellAnimRasterizer
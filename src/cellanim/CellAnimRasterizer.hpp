@@ -0,0 +1,60 @@
+#ifndef CELL_ANIM_RASTERIZER_HPP
+#define CELL_ANIM_RASTERIZER_HPP
+
+#include <vector>
+
+#include "CellAnim.hpp"
+#include "CellAnimDrawData.hpp"
+
+/*
+    Software rasterizer for cellanim frames; draws the same commands as the GL
+    renderer without a GL context (thumbnails, previews, exported frames).
+
+    Parts are sampled & blended like the renderer's shader: bilinear sampling
+    clamped to the edges, the fore/back colors of the part & key, then the
+    vertex color. The image is split into tiles that are drawn in parallel,
+    each with the commands overlapping it, in order. Colors are blended like
+    GL (source alpha, one minus source alpha); the alpha channel is blended
+    with "over", so frames drawn on a transparent background keep the right
+    alpha.
+*/
+
+namespace CellAnimRasterizer {
+
+// An RGBA32 sheet (width * height * 4 bytes).
+struct Sheet {
+    const unsigned char* pixels;
+    unsigned width, height;
+};
+
+// Draw the commands onto an RGBA32 image (width * height * 4 bytes), over its
+// contents. The quads are in image pixels. A command samples
+// sheets[textureVarying % sheets.size()]; commands are skipped if there are no
+// sheets.
+void rasterize(
+    unsigned char* image, unsigned width, unsigned height,
+    const std::vector<CellAnim::PartDrawCommand>& commands,
+    const std::vector<Sheet>& sheets
+);
+
+// A key drawn on its own, cropped to its bounds.
+struct Frame {
+    // RGBA32; empty if nothing is visible.
+    std::vector<unsigned char> pixels;
+    unsigned width { 0 }, height { 0 };
+
+    // Position of the key's origin in the image.
+    float originX { 0.f }, originY { 0.f };
+};
+
+// Draw a key on a transparent background. scale is the zoom (e.g. 2 for twice
+// the size).
+Frame renderKey(
+    const CellAnim::CellAnimObject& cellanim, const CellAnim::AnimationKey& key,
+    const std::vector<Sheet>& sheets,
+    float scale = 1.f, bool allowOpacity = true
+);
+
+} // namespace CellAnimRasterizer
+
+#endif // CELL_ANIM_RASTERIZER_HPP
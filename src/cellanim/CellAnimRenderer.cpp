@@ -1,6 +1,7 @@
 #include "CellAnimRenderer.hpp"
 
 #include <cstddef>
+#include <cstdint>
 
 #include <cmath>
 
@@ -8,6 +9,8 @@
 
 #include <algorithm>
 
+#include <utility>
+
 #include <string_view>
 
 #include "glInclude.hpp"
@@ -167,14 +170,9 @@ void CellAnimRenderer::endShader() {
     glDeleteFramebuffers(1, &sTexDrawFramebuffer);
 }
 
-struct RenderPartCallbackData {
-    CellAnim::CTRColor backColorA, backColorB;
-    CellAnim::CTRColor foreColorA, foreColorB;
-};
-
 void CellAnimRenderer::renderPartCallback(const ImDrawList* parentList, const ImDrawCmd* cmd) {
-    const RenderPartCallbackData* renderData =
-        reinterpret_cast<const RenderPartCallbackData*>(cmd->UserCallbackData);
+    const CellAnim::PartColors* renderData =
+        reinterpret_cast<const CellAnim::PartColors*>(cmd->UserCallbackData);
 
     const auto& foreColorA = renderData->foreColorA;
     const auto& backColorA = renderData->backColorA;
@@ -243,7 +241,7 @@ void CellAnimRenderer::drawOnionSkin(
 
     const unsigned keyCount = animation.keys.size();
 
-    auto _drawOnionSkin = [this, rollOver, keyCount, drawList, animation](int startIndex, int endIndex, int step, uint32_t color) {
+    auto _drawOnionSkin = [this, rollOver, keyCount, drawList, &animation](int startIndex, int endIndex, int step, uint32_t color) {
         int i = startIndex;
         while ((step < 0) ? (i >= endIndex) : (i <= endIndex)) {
             int wrappedIndex = i;
@@ -273,167 +271,25 @@ void CellAnimRenderer::drawOnionSkin(
         _drawOnionSkin(keyIndex + 1, keyIndex + frontCount, 1, IM_COL32(64, 255, 64, opacity));
 }
 
-// Note: 'angle' is in degrees.
-static ImVec2 rotateVec2(const ImVec2& v, float angle, const ImVec2& origin) {
-    const float s = std::sin(angle * ((float)M_PI / 180.f));
-    const float c = std::cos(angle * ((float)M_PI / 180.f));
-
-    float vx = v.x - origin.x;
-    float vy = v.y - origin.y;
-
-    float x = vx * c - vy * s;
-    float y = vx * s + vy * c;
-
-    return { x + origin.x, y + origin.y };
-}
-
 std::array<ImVec2, 4> CellAnimRenderer::getPartWorldQuad(const CellAnim::AnimationKey& key, unsigned partIndex) const {
-    std::array<ImVec2, 4> transformedQuad;
-
-    NONFATAL_ASSERT_RETVAL(mCellAnim, transformedQuad);
-
-    const CellAnim::Arrangement& arrangement = mCellAnim->getArrangements().at(key.arrangementIndex);
-    const CellAnim::ArrangementPart& part = arrangement.parts.at(partIndex);
-
-    const auto& tempOffset = arrangement.tempOffset;
-    const auto& tempScale  = arrangement.tempScale;
-
-    ImVec2 keyCenter = mOffset;
-
-    ImVec2 topLeftOffset {
-        static_cast<float>(part.transform.position.x),
-        static_cast<float>(part.transform.position.y)
-    };
-
-    ImVec2 bottomRightOffset {
-        (topLeftOffset.x + (part.cellSize.x * part.transform.scale.x)),
-        (topLeftOffset.y + (part.cellSize.y * part.transform.scale.y))
-    };
-
-    topLeftOffset = {
-        (topLeftOffset.x * tempScale.x) + tempOffset.x,
-        (topLeftOffset.y * tempScale.y) + tempOffset.y
-    };
-    bottomRightOffset = {
-        (bottomRightOffset.x * tempScale.x) + tempOffset.x,
-        (bottomRightOffset.y * tempScale.y) + tempOffset.y
-    };
-
-    transformedQuad = {
-        topLeftOffset,
-        { bottomRightOffset.x, topLeftOffset.y },
-        bottomRightOffset,
-        { topLeftOffset.x, bottomRightOffset.y },
-    };
-
-    const ImVec2 center = AVERAGE_IMVEC2(topLeftOffset, bottomRightOffset);
-
-    // Transformations
-    {
-        // Rotation
-        float rotAngle = part.transform.angle;
+    NONFATAL_ASSERT_RETVAL(mCellAnim, (std::array<ImVec2, 4> {}));
 
-        if ((tempScale.x < 0.f) ^ (tempScale.y < 0.f))
-            rotAngle = -rotAngle;
-
-        for (auto& point : transformedQuad)
-            point = rotateVec2(point, rotAngle, center);
-
-        // Key & renderer scale
-        for (auto& point : transformedQuad) {
-            point.x = (point.x * key.transform.scale.x * mScale.x) + keyCenter.x;
-            point.y = (point.y * key.transform.scale.y * mScale.y) + keyCenter.y;
-        }
-
-        // Key rotation
-        for (auto& point : transformedQuad)
-            point = rotateVec2(point, key.transform.angle, keyCenter);
-
-        // Key offset addition
-        for (auto& point : transformedQuad) {
-            point.x += key.transform.position.x * mScale.x;
-            point.y += key.transform.position.y * mScale.y;
-        }
-    }
-
-    return transformedQuad;
+    return CellAnim::getPartWorldQuad(
+        key.transform, std::as_const(*mCellAnim).getArrangements().at(key.arrangementIndex), partIndex,
+        mOffset, mScale
+    );
 }
 
 std::array<ImVec2, 4> CellAnimRenderer::getPartWorldQuad(const CellAnim::TransformValues& keyTransform, const CellAnim::Arrangement& arrangement, unsigned partIndex) const {
-    std::array<ImVec2, 4> transformedQuad;
-
-    NONFATAL_ASSERT_RETVAL(mCellAnim, transformedQuad);
-
-    const CellAnim::ArrangementPart& part = arrangement.parts.at(partIndex);
-
-    const auto& tempOffset = arrangement.tempOffset;
-    const auto& tempScale  = arrangement.tempScale;
-
-    ImVec2 keyCenter = mOffset;
-
-    ImVec2 topLeftOffset {
-        static_cast<float>(part.transform.position.x),
-        static_cast<float>(part.transform.position.y)
-    };
-
-    ImVec2 bottomRightOffset {
-        (topLeftOffset.x + (part.cellSize.x * part.transform.scale.x)),
-        (topLeftOffset.y + (part.cellSize.y * part.transform.scale.y))
-    };
-
-    topLeftOffset = {
-        (topLeftOffset.x * tempScale.x) + tempOffset.x,
-        (topLeftOffset.y * tempScale.y) + tempOffset.y
-    };
-    bottomRightOffset = {
-        (bottomRightOffset.x * tempScale.x) + tempOffset.x,
-        (bottomRightOffset.y * tempScale.y) + tempOffset.y
-    };
-
-    transformedQuad = {
-        topLeftOffset,
-        { bottomRightOffset.x, topLeftOffset.y },
-        bottomRightOffset,
-        { topLeftOffset.x, bottomRightOffset.y },
-    };
-
-    const ImVec2 center = AVERAGE_IMVEC2(topLeftOffset, bottomRightOffset);
-
-    // Transformations
-    {
-        // Rotation
-        float rotAngle = part.transform.angle;
-
-        if ((tempScale.x < 0.f) ^ (tempScale.y < 0.f))
-            rotAngle = -rotAngle;
-
-        for (auto& point : transformedQuad)
-            point = rotateVec2(point, rotAngle, center);
-
-        // Key & renderer scale
-        for (auto& point : transformedQuad) {
-            point.x = (point.x * keyTransform.scale.x * mScale.x) + keyCenter.x;
-            point.y = (point.y * keyTransform.scale.y * mScale.y) + keyCenter.y;
-        }
-
-        // Key rotation
-        for (auto& point : transformedQuad)
-            point = rotateVec2(point, keyTransform.angle, keyCenter);
-
-        // Key offset addition
-        for (auto& point : transformedQuad) {
-            point.x += keyTransform.position.x * mScale.x;
-            point.y += keyTransform.position.y * mScale.y;
-        }
-    }
+    NONFATAL_ASSERT_RETVAL(mCellAnim, (std::array<ImVec2, 4> {}));
 
-    return transformedQuad;
+    return CellAnim::getPartWorldQuad(keyTransform, arrangement, partIndex, mOffset, mScale);
 }
 
 ImRect CellAnimRenderer::getKeyWorldRect(const CellAnim::AnimationKey& key) const {
     NONFATAL_ASSERT_RETVAL(mCellAnim, ImRect());
 
-    const auto& arrangement = mCellAnim->getArrangement(key.arrangementIndex);
+    const auto& arrangement = std::as_const(*mCellAnim).getArrangement(key.arrangementIndex);
 
     std::vector<std::array<ImVec2, 4>> quads(arrangement.parts.size());
     for (size_t i = 0; i < arrangement.parts.size(); i++)
@@ -456,92 +312,6 @@ ImRect CellAnimRenderer::getKeyWorldRect(const CellAnim::AnimationKey& key) cons
     return ImRect({ minX, minY }, { maxX, maxY });
 }
 
-struct PartDrawCommand {
-    std::array<ImVec2, 4> quad;
-    std::array<ImVec2, 4> uvs;
-    GLuint textureId;
-    uint32_t vertexColor;
-    RenderPartCallbackData callbackData;
-};
-
-template<typename T>
-static std::vector<PartDrawCommand> constructDrawData(
-    const CellAnimRenderer& renderer,
-    const CellAnim::CellAnimObject& cellanim, TextureGroup<T>& textureGroup,
-    const CellAnim::AnimationKey& key, int partIndex,
-    uint32_t colorMod, bool allowOpacity
-) {
-    const CellAnim::Arrangement& arrangement = cellanim.getArrangement(key.arrangementIndex);
-
-    std::vector<PartDrawCommand> drawData;
-    drawData.reserve(arrangement.parts.size());
-
-    const float texWidth = cellanim.getSheetWidth();
-    const float texHeight = cellanim.getSheetHeight();
-
-    for (size_t i = 0; i < arrangement.parts.size(); i++) {
-        if (partIndex >= 0 && partIndex != static_cast<int>(i))
-            continue;
-
-        const CellAnim::ArrangementPart& part = arrangement.parts.at(i);
-
-        // Skip invisible parts
-        if (((part.opacity == 0) && allowOpacity) || !part.editorVisible)
-            continue;
-
-        PartDrawCommand command {};
-
-        command.quad = renderer.getPartWorldQuad(key, i);
-
-        ImVec2 uvTopLeft = {
-            part.cellOrigin.x / texWidth,
-            part.cellOrigin.y / texHeight
-        };
-        ImVec2 uvBottomRight = {
-            uvTopLeft.x + (part.cellSize.x / texWidth),
-            uvTopLeft.y + (part.cellSize.y / texHeight)
-        };
-
-        command.uvs = std::array<ImVec2, 4>({
-            uvTopLeft,
-            { uvBottomRight.x, uvTopLeft.y },
-            uvBottomRight,
-            { uvTopLeft.x, uvBottomRight.y }
-        });
-
-        if (part.flipX) {
-            std::swap(command.uvs[0], command.uvs[1]);
-            std::swap(command.uvs[2], command.uvs[3]);
-        }
-        if (part.flipY) {
-            std::swap(command.uvs[0], command.uvs[3]);
-            std::swap(command.uvs[1], command.uvs[2]);
-        }
-
-        const auto& texture = textureGroup.getTextureByVarying(part.textureVarying);
-
-        command.textureId = texture->getTextureId();
-
-        unsigned baseAlpha = allowOpacity ?
-            ((unsigned(part.opacity) * unsigned(key.opacity)) / 0xFF) :
-            0xFF;
-
-        unsigned vertexAlpha = (baseAlpha * ((colorMod >> 24) & 0xFF)) / 0xFF;
-        command.vertexColor = (colorMod & 0x00FFFFFF) | (vertexAlpha << 24);
-
-        command.callbackData = RenderPartCallbackData {
-            .backColorA = part.backColor,
-            .backColorB = key.backColor,
-            .foreColorA = part.foreColor,
-            .foreColorB = key.foreColor
-        };
-
-        drawData.push_back(std::move(command));
-    }
-
-    return drawData;
-}
-
 static inline std::array<ImVec2, 6> quadToTriangles(const std::array<ImVec2, 4>& quad) {
     return std::array<ImVec2, 6>({
         quad[0], quad[1], quad[3],
@@ -565,19 +335,29 @@ void CellAnimRenderer::drawImpl(
         mScale = ImVec2(1.f, 1.f);
     }
 
-    std::vector<PartDrawCommand> drawData = constructDrawData(
-        *this, *mCellAnim, *mTextureGroup,
-        key, partIndex, colorMod, allowOpacity
+    // Read through a const reference so the revision isn't renewed.
+    const std::vector<CellAnim::PartDrawCommand>& drawData = mDrawCache.get(
+        std::as_const(*mCellAnim), key, partIndex, colorMod, allowOpacity, mOffset, mScale,
+        ImGui::GetFrameCount()
     );
 
     switch (drawMethod) {
     case DrawMethod::DrawList: {
-        for (auto& cmd : drawData) {
-            // ImGui will copy the userdata.
-            currentDrawList->AddCallback(CellAnimRenderer::renderPartCallback, &cmd.callbackData, sizeof(cmd.callbackData));
+        // The colors are only set when they change; ImGui merges the quads in
+        // between into one draw call per texture.
+        const CellAnim::PartColors* lastColors = nullptr;
+
+        for (const auto& cmd : drawData) {
+            if (!lastColors || *lastColors != cmd.colors) {
+                // ImGui will copy the userdata.
+                currentDrawList->AddCallback(CellAnimRenderer::renderPartCallback, (void*)&cmd.colors, sizeof(cmd.colors));
+                lastColors = &cmd.colors;
+            }
+
+            const GLuint textureId = mTextureGroup->getTextureByVarying(cmd.textureVarying)->syncAndGetTextureId();
 
             currentDrawList->AddImageQuad(
-                static_cast<ImTextureID>(cmd.textureId),
+                static_cast<ImTextureID>(textureId),
                 cmd.quad[0], cmd.quad[1], cmd.quad[2], cmd.quad[3],
                 cmd.uvs[0], cmd.uvs[1], cmd.uvs[2], cmd.uvs[3],
                 cmd.vertexColor
@@ -674,22 +454,35 @@ void CellAnimRenderer::drawImpl(
         glActiveTexture(GL_TEXTURE0);
         glUniform1i(sTextureUniform, 0);
 
-        for (size_t i = 0; i < drawData.size(); i++) {
-            const auto& cmd = drawData[i];
+        // Runs of parts with the same texture & colors are drawn at once.
+        size_t runStart = 0;
+        while (runStart < drawData.size()) {
+            const auto& cmd = drawData[runStart];
+            const GLuint textureId = mTextureGroup->getTextureByVarying(cmd.textureVarying)->syncAndGetTextureId();
 
-            const auto& foreColorA = cmd.callbackData.foreColorA;
-            const auto& backColorA = cmd.callbackData.backColorA;
+            size_t runEnd = runStart + 1;
+            while (
+                runEnd < drawData.size() &&
+                drawData[runEnd].colors == cmd.colors &&
+                mTextureGroup->getTextureByVarying(drawData[runEnd].textureVarying)->syncAndGetTextureId() == textureId
+            )
+                runEnd++;
 
-            const auto& foreColorB = cmd.callbackData.foreColorB;
-            const auto& backColorB = cmd.callbackData.backColorB;
+            const auto& foreColorA = cmd.colors.foreColorA;
+            const auto& backColorA = cmd.colors.backColorA;
+
+            const auto& foreColorB = cmd.colors.foreColorB;
+            const auto& backColorB = cmd.colors.backColorB;
 
             glUniform3f(sForeColorAUniform, foreColorA.r, foreColorA.g, foreColorA.b);
             glUniform3f(sBackColorAUniform, backColorA.r, backColorA.g, backColorA.b);
             glUniform3f(sForeColorBUniform, foreColorB.r, foreColorB.g, foreColorB.b);
             glUniform3f(sBackColorBUniform, backColorB.r, backColorB.g, backColorB.b);
 
-            glBindTexture(GL_TEXTURE_2D, cmd.textureId);
-            glDrawArrays(GL_TRIANGLES, i * 6, 6);
+            glBindTexture(GL_TEXTURE_2D, textureId);
+            glDrawArrays(GL_TRIANGLES, runStart * 6, (runEnd - runStart) * 6);
+
+            runStart = runEnd;
         }
 
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
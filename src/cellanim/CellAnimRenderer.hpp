@@ -6,9 +6,14 @@
 
 #include <cstdint>
 
+#include <array>
+#include <vector>
+
 #include <memory>
 
 #include "CellAnim.hpp"
+#include "CellAnimDrawData.hpp"
+#include "CellAnimDrawCache.hpp"
 
 #include "texture/TextureEx.hpp"
 #include "texture/TextureGroup.hpp"
@@ -105,6 +110,9 @@ private:
 
     bool mVisible { true };
 
+    // One entry per key drawn (onion skin included).
+    CellAnim::DrawCache mDrawCache;
+
 public: // TODO: filthy HACK ..
     // These get set by InternDraw.
     ImVec2 mDrawTexSize;
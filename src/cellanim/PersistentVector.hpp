@@ -0,0 +1,364 @@
+#ifndef PERSISTENT_VECTOR_HPP
+#define PERSISTENT_VECTOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include <vector>
+
+#include <utility>
+#include <type_traits>
+
+#include <memory>
+#include <atomic>
+
+#include <iterator>
+#include <initializer_list>
+
+#include <stdexcept>
+#include <string>
+
+namespace CellAnim {
+
+/*
+    Vector stored as chunks that are shared between copies & copied on write.
+
+    Copying is O(1): the copy shares all chunks. Editing an element only copies
+    its chunk (& the small list of chunks) if it's shared; inserting or erasing
+    rewrites the chunks after the position, like std::vector moves the
+    elements after it.
+
+    A copy is a frozen snapshot: it can be read on any thread while the
+    original keeps being edited, since shared chunks are never written to.
+    Copies must be made on the thread editing the original.
+*/
+
+template <typename T>
+class PersistentVector {
+public:
+    static constexpr size_t CHUNK_SIZE = 32;
+
+private:
+    struct Chunk {
+        // CHUNK_SIZE elements, except for the last chunk.
+        std::vector<T> elements;
+        // Renewed each time the chunk is taken for writing.
+        uint64_t revision;
+    };
+    typedef std::vector<std::shared_ptr<Chunk>> ChunkList;
+
+public:
+    template <bool IsConst>
+    class Iterator {
+        friend class PersistentVector;
+
+        typedef std::conditional_t<IsConst, const PersistentVector, PersistentVector> Vector;
+
+    public:
+        typedef std::random_access_iterator_tag iterator_category;
+        typedef T value_type;
+        typedef std::ptrdiff_t difference_type;
+        typedef std::conditional_t<IsConst, const T*, T*> pointer;
+        typedef std::conditional_t<IsConst, const T&, T&> reference;
+
+        Iterator() = default;
+
+        // Mutable to const.
+        template <bool OtherConst, typename = std::enable_if_t<IsConst && !OtherConst>>
+        Iterator(const Iterator<OtherConst>& other) :
+            mVector(other.mVector), mIndex(other.mIndex)
+        {}
+
+        reference operator*() const { return (*mVector)[mIndex]; }
+        pointer operator->() const { return &(*mVector)[mIndex]; }
+        reference operator[](difference_type n) const { return (*mVector)[mIndex + n]; }
+
+        Iterator& operator++() { mIndex++; return *this; }
+        Iterator& operator--() { mIndex--; return *this; }
+        Iterator operator++(int) { Iterator it = *this; mIndex++; return it; }
+        Iterator operator--(int) { Iterator it = *this; mIndex--; return it; }
+
+        Iterator& operator+=(difference_type n) { mIndex += n; return *this; }
+        Iterator& operator-=(difference_type n) { mIndex -= n; return *this; }
+
+        Iterator operator+(difference_type n) const { return Iterator(mVector, mIndex + n); }
+        Iterator operator-(difference_type n) const { return Iterator(mVector, mIndex - n); }
+        friend Iterator operator+(difference_type n, const Iterator& it) { return it + n; }
+
+        difference_type operator-(const Iterator& rhs) const {
+            return static_cast<difference_type>(mIndex) - static_cast<difference_type>(rhs.mIndex);
+        }
+
+        bool operator==(const Iterator& rhs) const { return mIndex == rhs.mIndex; }
+        bool operator!=(const Iterator& rhs) const { return mIndex != rhs.mIndex; }
+        bool operator<(const Iterator& rhs) const { return mIndex < rhs.mIndex; }
+        bool operator>(const Iterator& rhs) const { return mIndex > rhs.mIndex; }
+        bool operator<=(const Iterator& rhs) const { return mIndex <= rhs.mIndex; }
+        bool operator>=(const Iterator& rhs) const { return mIndex >= rhs.mIndex; }
+
+    private:
+        Iterator(Vector* vector, size_t index) :
+            mVector(vector), mIndex(index)
+        {}
+
+        template <bool> friend class Iterator;
+
+        Vector* mVector { nullptr };
+        size_t mIndex { 0 };
+    };
+
+    typedef T value_type;
+    typedef size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef T& reference;
+    typedef const T& const_reference;
+
+    typedef Iterator<false> iterator;
+    typedef Iterator<true> const_iterator;
+
+public:
+    PersistentVector() = default;
+    explicit PersistentVector(size_t count) { resize(count); }
+    PersistentVector(std::initializer_list<T> list) { append(list.begin(), list.end()); }
+    PersistentVector(const std::vector<T>& vector) { append(vector.begin(), vector.end()); }
+
+    PersistentVector& operator=(const std::vector<T>& vector) {
+        clear();
+        append(vector.begin(), vector.end());
+        return *this;
+    }
+
+    std::vector<T> toVector() const { return std::vector<T>(begin(), end()); }
+
+    // Whether the chunk holding the element at index is shared with another
+    // vector; if so, the elements of that chunk are the same in both.
+    bool sharesChunkWith(const PersistentVector& other, size_t index) const {
+        return
+            index < mSize && index < other.mSize &&
+            (*mChunks)[index / CHUNK_SIZE] == (*other.mChunks)[index / CHUNK_SIZE];
+    }
+
+    size_t size() const { return mSize; }
+    bool empty() const { return mSize == 0; }
+
+    // Changes whenever the chunk holding the element at index is taken for
+    // writing (by any non-const access to its elements). Equal revisions mean
+    // equal elements, across copies too; only a write through a reference
+    // kept after the revision was read goes unnoticed.
+    uint64_t revisionOf(size_t index) const {
+        checkIndex(index);
+        return (*mChunks)[index / CHUNK_SIZE]->revision;
+    }
+
+    // Whether every chunk has the same revision as in other (so the elements
+    // are all the same); used to tell if a copy was edited since it was made.
+    bool sameRevisions(const PersistentVector& other) const {
+        if (mSize != other.mSize)
+            return false;
+
+        for (size_t i = 0; i < mSize; i += CHUNK_SIZE) {
+            if (revisionOf(i) != other.revisionOf(i))
+                return false;
+        }
+
+        return true;
+    }
+
+    const T& operator[](size_t index) const {
+        return (*mChunks)[index / CHUNK_SIZE]->elements[index % CHUNK_SIZE];
+    }
+    // Copies the element's chunk if it's shared.
+    T& operator[](size_t index) {
+        return editChunk(index / CHUNK_SIZE)->elements[index % CHUNK_SIZE];
+    }
+
+    const T& at(size_t index) const {
+        checkIndex(index);
+        return (*this)[index];
+    }
+    T& at(size_t index) {
+        checkIndex(index);
+        return (*this)[index];
+    }
+
+    const T& front() const { return (*this)[0]; }
+    T& front() { return (*this)[0]; }
+    const T& back() const { return (*this)[mSize - 1]; }
+    T& back() { return (*this)[mSize - 1]; }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, mSize); }
+    const_iterator cbegin() const { return begin(); }
+    const_iterator cend() const { return end(); }
+
+    // Writing through these copies the chunks written to if they're shared.
+    iterator begin() { return iterator(this, 0); }
+    iterator end() { return iterator(this, mSize); }
+
+    void clear() {
+        mChunks.reset();
+        mSize = 0;
+    }
+
+    // The value may be an element of this vector.
+    void push_back(const T& value) {
+        T copy(value);
+        *appendSlot() = std::move(copy);
+    }
+    void push_back(T&& value) { *appendSlot() = std::move(value); }
+
+    template <typename... Args>
+    T& emplace_back(Args&&... args) {
+        T* slot = appendSlot();
+        *slot = T(std::forward<Args>(args)...);
+        return *slot;
+    }
+
+    void pop_back() { truncate(mSize - 1); }
+
+    void resize(size_t count) {
+        if (count < mSize)
+            truncate(count);
+        else {
+            while (mSize < count)
+                appendSlot();
+        }
+    }
+
+    // The inserted values may be elements of this vector.
+    iterator insert(const_iterator pos, const T& value) {
+        return insert(pos, &value, &value + 1);
+    }
+
+    template <typename InputIt>
+    iterator insert(const_iterator pos, InputIt first, InputIt last) {
+        const size_t index = pos.mIndex;
+
+        std::vector<T> values(first, last);
+
+        std::vector<T> tail = takeTail(index);
+        append(std::make_move_iterator(values.begin()), std::make_move_iterator(values.end()));
+        append(std::make_move_iterator(tail.begin()), std::make_move_iterator(tail.end()));
+
+        return iterator(this, index);
+    }
+
+    iterator erase(const_iterator pos) {
+        return erase(pos, pos + 1);
+    }
+    iterator erase(const_iterator first, const_iterator last) {
+        const size_t index = first.mIndex;
+
+        std::vector<T> tail = takeTail(last.mIndex);
+        truncate(index);
+        append(std::make_move_iterator(tail.begin()), std::make_move_iterator(tail.end()));
+
+        return iterator(this, index);
+    }
+
+private:
+    void checkIndex(size_t index) const {
+        if (index >= mSize) {
+            throw std::out_of_range(
+                "PersistentVector: index out of bounds (" +
+                std::to_string(index) + " >= " + std::to_string(mSize) + ")"
+            );
+        }
+    }
+
+    template <typename Ptr>
+    static bool isUnique(const Ptr& ptr) {
+        if (ptr.use_count() != 1)
+            return false;
+
+        // See the writes of the previous owners, which dropped their copies
+        // on other threads.
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return true;
+    }
+
+    ChunkList& editChunkList() {
+        if (!mChunks)
+            mChunks = std::make_shared<ChunkList>();
+        else if (!isUnique(mChunks))
+            mChunks = std::make_shared<ChunkList>(*mChunks);
+
+        return *mChunks;
+    }
+
+    static uint64_t nextRevision() {
+        static std::atomic<uint64_t> lastRevision { 0 };
+        return lastRevision.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+    std::shared_ptr<Chunk>& editChunk(size_t chunkIndex) {
+        std::shared_ptr<Chunk>& chunk = editChunkList()[chunkIndex];
+        if (!isUnique(chunk))
+            chunk = std::make_shared<Chunk>(*chunk);
+
+        chunk->revision = nextRevision();
+
+        return chunk;
+    }
+
+    // Add a default element to the end.
+    T* appendSlot() {
+        if ((mSize % CHUNK_SIZE) == 0) {
+            auto chunk = std::make_shared<Chunk>();
+            chunk->elements.reserve(CHUNK_SIZE);
+
+            editChunkList().push_back(std::move(chunk));
+        }
+
+        std::vector<T>& elements = editChunk(mSize / CHUNK_SIZE)->elements;
+        elements.emplace_back();
+
+        mSize++;
+
+        return &elements.back();
+    }
+
+    template <typename InputIt>
+    void append(InputIt first, InputIt last) {
+        for (; first != last; ++first)
+            *appendSlot() = *first;
+    }
+
+    void truncate(size_t count) {
+        if (count >= mSize)
+            return;
+        if (count == 0) {
+            clear();
+            return;
+        }
+
+        ChunkList& chunks = editChunkList();
+        chunks.resize((count + CHUNK_SIZE - 1) / CHUNK_SIZE);
+
+        if ((count % CHUNK_SIZE) != 0)
+            editChunk(chunks.size() - 1)->elements.resize(count % CHUNK_SIZE);
+
+        mSize = count;
+    }
+
+    // Remove the elements from index on & return them.
+    std::vector<T> takeTail(size_t index) {
+        std::vector<T> tail;
+        tail.reserve(mSize - index);
+
+        for (size_t i = index; i < mSize; i++)
+            tail.push_back(std::as_const(*this)[i]);
+
+        truncate(index);
+
+        return tail;
+    }
+
+private:
+    std::shared_ptr<ChunkList> mChunks;
+    size_t mSize { 0 };
+};
+
+} // namespace CellAnim
+
+#endif // PERSISTENT_VECTOR_HPP
@@ -0,0 +1,477 @@
+// toast-cli
+// Batch loading, validation, optimization & conversion of cellanim archives,
+// without a GL context.
+
+#include <cstddef>
+
+#include <cstdlib>
+
+#include <clocale>
+
+#include <iostream>
+#include <fstream>
+
+#include <filesystem>
+
+#include <string>
+#include <string_view>
+
+#include <vector>
+
+#include <optional>
+
+#include <algorithm>
+
+#include <utility>
+
+#include <thread>
+#include <atomic>
+
+#include "cellanim/CellAnim.hpp"
+#include "cellanim/CellAnimArchive.hpp"
+#include "cellanim/CellAnimOptimize.hpp"
+
+#include "texture/TPL.hpp"
+#include "texture/CTPK.hpp"
+
+#include "manager/ConfigManager.hpp"
+
+#include "util/ParallelUtil.hpp"
+
+#include "Logging.hpp"
+
+namespace fs = std::filesystem;
+
+static constexpr std::string_view USAGE =
+    "Usage: toast-cli [options] <path>...\n"
+    "\n"
+    "Each path is a cellanim archive (.szs) or a directory that is searched\n"
+    "recursively for them.\n"
+    "\n"
+    "Options:\n"
+    "  -o, --output <dir>     Write the archives to <dir>, mirroring the input tree\n"
+    "      --in-place         Overwrite the input archives\n"
+    "      --validate         Only load & validate the archives; nothing is written\n"
+    "      --optimize         Remove unused & duplicate arrangements\n"
+    "      --strip-names      Remove animation names\n"
+    "      --format <name>    Convert all sheets to the format (e.g. CMPR, RGB5A3,\n"
+    "                         ETC1A4, RGBA4444); Wii formats apply to Wii archives\n"
+    "                         and 3DS formats to 3DS archives\n"
+    "      --level <0-9>      Compression level (default: 9)\n"
+    "      --etc1 <quality>   ETC1 quality: fast, low, medium or high\n"
+    "                         (default: medium)\n"
+    "      --cmpr <quality>   CMPR quality: fast or high (default: high)\n"
+    "      --dither <mode>    Dithering when a sheet has too many colors for C4/C8:\n"
+    "                         none, ordered or diffusion (default: diffusion)\n"
+    "  -j, --jobs <count>     Amount of archives processed at once\n"
+    "  -h, --help             Show this message\n";
+
+struct Options {
+    std::optional<fs::path> outputDir;
+    bool inPlace { false };
+
+    bool validateOnly { false };
+    bool optimize { false };
+    bool stripNames { false };
+
+    std::optional<TPL::TPLImageFormat> tplFormat;
+    std::optional<CTPK::CTPKImageFormat> ctpkFormat;
+
+    unsigned jobCount { 0 };
+};
+
+struct Job {
+    fs::path inputPath;
+    fs::path outputPath;
+};
+
+static std::optional<TPL::TPLImageFormat> findTPLFormat(std::string_view name) {
+    for (unsigned i = 0; i < TPL::TPL_IMAGE_FORMAT_COUNT; i++) {
+        const auto format = static_cast<TPL::TPLImageFormat>(i);
+        if (name == TPL::getImageFormatName(format) && name != "Invalid format")
+            return format;
+    }
+    return std::nullopt;
+}
+
+static std::optional<CTPK::CTPKImageFormat> findCTPKFormat(std::string_view name) {
+    for (unsigned i = 0; i < CTPK::CTPK_IMAGE_FORMAT_COUNT; i++) {
+        const auto format = static_cast<CTPK::CTPKImageFormat>(i);
+        if (name == CTPK::getImageFormatName(format))
+            return format;
+    }
+    return std::nullopt;
+}
+
+static bool isArchivePath(const fs::path& path) {
+    return path.extension() == ".szs";
+}
+
+// Check that the cellanims only reference arrangements & sheets that exist.
+static bool validateContents(const CellAnim::ArchiveContents& contents, std::string& errorMessage) {
+    const size_t sheetCount = contents.type == CellAnim::CELLANIM_TYPE_RVL ?
+        contents.tplTextures.size() : contents.ctpkTextures.size();
+
+    for (const auto& cellanim : contents.cellanims) {
+        const unsigned sheetIndex = static_cast<unsigned>(cellanim->getSheetIndex());
+        if (sheetIndex >= sheetCount) {
+            errorMessage =
+                "cellanim \"" + cellanim->getName() + "\" references sheet no. " +
+                std::to_string(sheetIndex) + " (" + std::to_string(sheetCount) + " exist)";
+            return false;
+        }
+
+        const size_t arrangementCount = cellanim->getArrangements().size();
+
+        const auto& animations = std::as_const(*cellanim).getAnimations();
+        for (size_t i = 0; i < animations.size(); i++) {
+            for (const auto& key : animations[i].keys) {
+                if (key.arrangementIndex >= arrangementCount) {
+                    errorMessage =
+                        "animation no. " + std::to_string(i) + " of cellanim \"" + cellanim->getName() +
+                        "\" references arrangement no. " + std::to_string(key.arrangementIndex) +
+                        " (" + std::to_string(arrangementCount) + " exist)";
+                    return false;
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static void convertFormat(CellAnim::ArchiveContents& contents, const Options& options) {
+    switch (contents.type) {
+    case CellAnim::CELLANIM_TYPE_RVL:
+        if (!options.tplFormat.has_value())
+            break;
+
+        for (auto& texture : contents.tplTextures) {
+            texture.format = *options.tplFormat;
+            // The palette is regenerated when serializing.
+            texture.palette.clear();
+        }
+        break;
+    case CellAnim::CELLANIM_TYPE_CTR:
+        if (!options.ctpkFormat.has_value())
+            break;
+
+        for (auto& texture : contents.ctpkTextures) {
+            if (texture.targetFormat == *options.ctpkFormat)
+                continue;
+
+            texture.targetFormat = *options.ctpkFormat;
+            // The image needs to be encoded again.
+            texture.cachedTargetData.clear();
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+static bool writeFile(const fs::path& path, const std::vector<unsigned char>& data) {
+    std::error_code error;
+    if (path.has_parent_path())
+        fs::create_directories(path.parent_path(), error);
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    file.close();
+
+    return !file.fail();
+}
+
+static bool processJob(const Job& job, const Options& options) {
+    const std::string inputPath = job.inputPath.string();
+
+    CellAnim::ArchiveContents contents;
+    std::string errorMessage;
+
+    if (!CellAnim::readArchive(inputPath, contents, errorMessage)) {
+        Logging::error("[toast-cli] {}: {}", inputPath, errorMessage);
+        return false;
+    }
+
+    if (!validateContents(contents, errorMessage)) {
+        Logging::error("[toast-cli] {}: invalid archive: {}", inputPath, errorMessage);
+        return false;
+    }
+
+    if (options.validateOnly) {
+        Logging::info("[toast-cli] {}: OK ({} cellanims)", inputPath, contents.cellanims.size());
+        return true;
+    }
+
+    for (const auto& cellanim : contents.cellanims) {
+        if (options.stripNames)
+            CellAnim::removeAnimationNames(*cellanim);
+
+        if (options.optimize) {
+            size_t removedCount = CellAnim::removeUnusedArrangements(*cellanim);
+            removedCount += CellAnim::removeDuplicateArrangements(*cellanim);
+
+            if (removedCount > 0) {
+                Logging::info(
+                    "[toast-cli] {}: removed {} arrangements from cellanim \"{}\"",
+                    inputPath, removedCount, cellanim->getName()
+                );
+            }
+        }
+    }
+
+    convertFormat(contents, options);
+
+    std::vector<unsigned char> output;
+    if (!CellAnim::serializeArchive(
+        contents, ConfigManager::getInstance().getConfig().compressionLevel,
+        output, errorMessage
+    )) {
+        Logging::error("[toast-cli] {}: {}", inputPath, errorMessage);
+        return false;
+    }
+
+    if (!writeFile(job.outputPath, output)) {
+        Logging::error("[toast-cli] {}: could not write output file \"{}\"", inputPath, job.outputPath.string());
+        return false;
+    }
+
+    Logging::info("[toast-cli] {} -> {} ({}kb)", inputPath, job.outputPath.string(), output.size() / 1024);
+    return true;
+}
+
+static bool collectJobs(const std::vector<fs::path>& inputPaths, const Options& options, std::vector<Job>& jobs) {
+    auto getOutputPath = [&options](const fs::path& inputPath, const fs::path& relativePath) {
+        if (!options.outputDir.has_value())
+            return inputPath;
+        return *options.outputDir / relativePath;
+    };
+
+    for (const auto& inputPath : inputPaths) {
+        std::error_code error;
+
+        if (fs::is_directory(inputPath, error)) {
+            for (
+                auto it = fs::recursive_directory_iterator(inputPath, error);
+                it != fs::recursive_directory_iterator(); it.increment(error)
+            ) {
+                if (error)
+                    break;
+                if (!it->is_regular_file() || !isArchivePath(it->path()))
+                    continue;
+
+                jobs.push_back(Job {
+                    .inputPath = it->path(),
+                    .outputPath = getOutputPath(it->path(), fs::relative(it->path(), inputPath))
+                });
+            }
+
+            if (error) {
+                Logging::error("[toast-cli] Could not read directory \"{}\": {}", inputPath.string(), error.message());
+                return false;
+            }
+        }
+        else if (fs::is_regular_file(inputPath, error)) {
+            jobs.push_back(Job {
+                .inputPath = inputPath,
+                .outputPath = getOutputPath(inputPath, inputPath.filename())
+            });
+        }
+        else {
+            Logging::error("[toast-cli] No such file or directory: \"{}\"", inputPath.string());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int main(int argc, const char **argv) {
+    std::setlocale(LC_ALL, "C.UTF-8");
+
+    Logging::open("toast-cli.log");
+
+    ConfigManager& configManager = ConfigManager::createSingleton();
+    configManager.loadDefault();
+
+    Config config = configManager.getConfig();
+
+    Options options;
+    std::vector<fs::path> inputPaths;
+
+    for (int i = 1; i < argc; i++) {
+        const std::string_view arg = argv[i];
+
+        auto nextValue = [&](std::string_view& value) {
+            if (i + 1 >= argc) {
+                std::cerr << "toast-cli: missing value for " << arg << '\n';
+                return false;
+            }
+            value = argv[++i];
+            return true;
+        };
+
+        std::string_view value;
+
+        if (arg == "-h" || arg == "--help") {
+            std::cout << USAGE;
+            return 0;
+        }
+        else if (arg == "-o" || arg == "--output") {
+            if (!nextValue(value))
+                return 2;
+            options.outputDir = fs::path(value);
+        }
+        else if (arg == "--in-place")
+            options.inPlace = true;
+        else if (arg == "--validate")
+            options.validateOnly = true;
+        else if (arg == "--optimize")
+            options.optimize = true;
+        else if (arg == "--strip-names")
+            options.stripNames = true;
+        else if (arg == "--format") {
+            if (!nextValue(value))
+                return 2;
+
+            options.tplFormat = findTPLFormat(value);
+            options.ctpkFormat = findCTPKFormat(value);
+
+            if (!options.tplFormat.has_value() && !options.ctpkFormat.has_value()) {
+                std::cerr << "toast-cli: unknown format: " << value << '\n';
+                return 2;
+            }
+        }
+        else if (arg == "--level") {
+            if (!nextValue(value))
+                return 2;
+
+            const int level = std::atoi(std::string(value).c_str());
+            if (level < 0 || level > 9) {
+                std::cerr << "toast-cli: compression level must be 0 .. 9\n";
+                return 2;
+            }
+            config.compressionLevel = level;
+        }
+        else if (arg == "--etc1") {
+            if (!nextValue(value))
+                return 2;
+
+            if (value == "fast")
+                config.etc1Quality = ETC1Quality::Fast;
+            else if (value == "low")
+                config.etc1Quality = ETC1Quality::Low;
+            else if (value == "medium")
+                config.etc1Quality = ETC1Quality::Medium;
+            else if (value == "high")
+                config.etc1Quality = ETC1Quality::High;
+            else {
+                std::cerr << "toast-cli: unknown ETC1 quality: " << value << '\n';
+                return 2;
+            }
+        }
+        else if (arg == "--cmpr") {
+            if (!nextValue(value))
+                return 2;
+
+            if (value == "fast")
+                config.cmprQuality = CMPRQuality::Fast;
+            else if (value == "high")
+                config.cmprQuality = CMPRQuality::High;
+            else {
+                std::cerr << "toast-cli: unknown CMPR quality: " << value << '\n';
+                return 2;
+            }
+        }
+        else if (arg == "--dither") {
+            if (!nextValue(value))
+                return 2;
+
+            if (value == "none")
+                config.paletteDithering = PaletteDithering::None;
+            else if (value == "ordered")
+                config.paletteDithering = PaletteDithering::Ordered;
+            else if (value == "diffusion")
+                config.paletteDithering = PaletteDithering::ErrorDiffusion;
+            else {
+                std::cerr << "toast-cli: unknown dithering mode: " << value << '\n';
+                return 2;
+            }
+        }
+        else if (arg == "-j" || arg == "--jobs") {
+            if (!nextValue(value))
+                return 2;
+
+            const int jobCount = std::atoi(std::string(value).c_str());
+            if (jobCount <= 0) {
+                std::cerr << "toast-cli: job count must be at least 1\n";
+                return 2;
+            }
+            options.jobCount = jobCount;
+        }
+        else if (!arg.empty() && arg[0] == '-') {
+            std::cerr << "toast-cli: unknown option: " << arg << "\n\n" << USAGE;
+            return 2;
+        }
+        else
+            inputPaths.push_back(fs::path(arg));
+    }
+
+    if (inputPaths.empty()) {
+        std::cerr << USAGE;
+        return 2;
+    }
+
+    if (!options.validateOnly && !options.outputDir.has_value() && !options.inPlace) {
+        std::cerr << "toast-cli: specify an output directory (-o) or --in-place\n";
+        return 2;
+    }
+
+    configManager.setConfig(config);
+
+    std::vector<Job> jobs;
+    if (!collectJobs(inputPaths, options, jobs))
+        return 1;
+
+    if (jobs.empty()) {
+        Logging::warn("[toast-cli] No archives (.szs) were found.");
+        return 0;
+    }
+
+    unsigned numThreads = options.jobCount;
+    if (numThreads == 0)
+        numThreads = ParallelUtil::getHardwareThreadCount();
+    numThreads = static_cast<unsigned>(std::min<size_t>(numThreads, jobs.size()));
+
+    std::atomic<size_t> nextJob { 0 };
+    std::atomic<size_t> failedCount { 0 };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+
+    for (unsigned t = 0; t < numThreads; t++) {
+        threads.emplace_back([&jobs, &options, &nextJob, &failedCount]() {
+            size_t jobIndex;
+            while ((jobIndex = nextJob.fetch_add(1)) < jobs.size()) {
+                if (!processJob(jobs[jobIndex], options))
+                    failedCount++;
+            }
+        });
+    }
+
+    for (auto& thread : threads)
+        thread.join();
+
+    Logging::info(
+        "[toast-cli] Finished: {} of {} archives succeeded.",
+        jobs.size() - failedCount.load(), jobs.size()
+    );
+
+    Logging::close();
+
+    return failedCount.load() == 0 ? 0 : 1;
+}
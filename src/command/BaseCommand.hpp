@@ -1,12 +1,18 @@
 #ifndef BASE_COMMAND_HPP
 #define BASE_COMMAND_HPP
 
+#include <cstddef>
+
 class BaseCommand {
 public:
     virtual ~BaseCommand() {}
 
     virtual void execute() {}
     virtual void rollback() {}
+
+    // Approximate amount of memory held by the command, counted against the
+    // undo history budget. Commands holding just a few values count as free.
+    virtual size_t getMemoryUsage() const { return 0; }
 };
 
 #endif // BASE_COMMAND_HPP
\ No newline at end of file
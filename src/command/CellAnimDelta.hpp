@@ -0,0 +1,335 @@
+#ifndef CELLANIM_DELTA_HPP
+#define CELLANIM_DELTA_HPP
+
+#include <cstddef>
+
+#include <utility>
+
+#include <vector>
+#include <string>
+
+#include <optional>
+
+#include <algorithm>
+
+#include "cellanim/CellAnim.hpp"
+
+#include "Logging.hpp"
+
+/*
+    Differences between two versions of cellanim data, kept by commands
+    instead of copies of both versions.
+
+    Unchanged elements aren't stored at all; changed arrangements & animations
+    only store their changed parts, keys & fields. A delta is applied to the
+    version it was made from & reverted on the version it leads to, which the
+    order of the undo history guarantees.
+*/
+
+namespace CellAnimDelta {
+
+// How elements are compared, measured & diffed.
+template <typename T>
+struct Traits;
+
+// A whole value before & after.
+template <typename T>
+class ValueDelta {
+public:
+    ValueDelta(const T& from, const T& to) :
+        mFrom(from), mTo(to)
+    {}
+
+    void apply(T& value) const { value = mTo; }
+    void revert(T& value) const { value = mFrom; }
+
+    size_t getMemoryUsage() const {
+        return Traits<T>::getMemoryUsage(mFrom) + Traits<T>::getMemoryUsage(mTo);
+    }
+
+private:
+    T mFrom, mTo;
+};
+
+// The index after the run of elements from index on that are known to be the
+// same in both vectors without comparing them.
+template <typename FromVector, typename ToVector>
+size_t SkipShared(const FromVector&, const ToVector&, size_t index) {
+    return index;
+}
+template <typename T>
+size_t SkipShared(const CellAnim::PersistentVector<T>& from, const CellAnim::PersistentVector<T>& to, size_t index) {
+    if (!from.sharesChunkWith(to, index))
+        return index;
+
+    constexpr size_t chunkSize = CellAnim::PersistentVector<T>::CHUNK_SIZE;
+
+    const size_t chunkEnd = (index / chunkSize + 1) * chunkSize;
+    return std::min({ chunkEnd, from.size(), to.size() });
+}
+
+// Changes from one vector to another. The common beginning & end are skipped,
+// the elements in between are diffed in place, and the elements one version
+// has more than the other are stored whole. Works on std::vector &
+// CellAnim::PersistentVector.
+template <typename T>
+class VectorDelta {
+public:
+    VectorDelta() = default;
+
+    template <typename FromVector, typename ToVector>
+    VectorDelta(const FromVector& from, const ToVector& to) :
+        mFromSize(from.size()), mToSize(to.size())
+    {
+        const size_t minSize = std::min(from.size(), to.size());
+
+        size_t prefix = 0;
+        while (prefix < minSize) {
+            const size_t next = SkipShared(from, to, prefix);
+            if (next != prefix)
+                prefix = next;
+            else if (Traits<T>::isSame(from[prefix], to[prefix]))
+                prefix++;
+            else
+                break;
+        }
+
+        // If the sizes are the same, the elements are all diffed in place.
+        size_t suffix = 0;
+        while (
+            from.size() != to.size() && suffix < minSize - prefix &&
+            Traits<T>::isSame(from[from.size() - 1 - suffix], to[to.size() - 1 - suffix])
+        )
+            suffix++;
+
+        mRestIndex = minSize - suffix;
+
+        for (size_t i = prefix; i < mRestIndex; i++) {
+            const size_t next = SkipShared(from, to, i);
+            if (next != i) {
+                i = next - 1;
+                continue;
+            }
+
+            if (!Traits<T>::isSame(from[i], to[i]))
+                mChanges.emplace_back(i, typename Traits<T>::Delta(from[i], to[i]));
+        }
+
+        mFromRest.assign(from.begin() + mRestIndex, from.end() - suffix);
+        mToRest.assign(to.begin() + mRestIndex, to.end() - suffix);
+
+        mMemoryUsage = sizeof(*this);
+        for (const auto& [index, delta] : mChanges)
+            mMemoryUsage += sizeof(index) + delta.getMemoryUsage();
+        for (const T& element : mFromRest)
+            mMemoryUsage += Traits<T>::getMemoryUsage(element);
+        for (const T& element : mToRest)
+            mMemoryUsage += Traits<T>::getMemoryUsage(element);
+    }
+
+    bool isEmpty() const {
+        return mChanges.empty() && mFromRest.empty() && mToRest.empty();
+    }
+
+    template <typename Vector>
+    void apply(Vector& vector) const {
+        if (vector.size() != mFromSize) {
+            Logging::error("[VectorDelta::apply] Expected {} elements, got {}", mFromSize, vector.size());
+            return;
+        }
+
+        for (const auto& [index, delta] : mChanges)
+            delta.apply(vector[index]);
+
+        replaceRest(vector, mFromRest.size(), mToRest);
+    }
+
+    template <typename Vector>
+    void revert(Vector& vector) const {
+        if (vector.size() != mToSize) {
+            Logging::error("[VectorDelta::revert] Expected {} elements, got {}", mToSize, vector.size());
+            return;
+        }
+
+        for (const auto& [index, delta] : mChanges)
+            delta.revert(vector[index]);
+
+        replaceRest(vector, mToRest.size(), mFromRest);
+    }
+
+    size_t getMemoryUsage() const { return mMemoryUsage; }
+
+private:
+    template <typename Vector>
+    void replaceRest(Vector& vector, size_t count, const std::vector<T>& rest) const {
+        auto it = vector.erase(vector.begin() + mRestIndex, vector.begin() + mRestIndex + count);
+        vector.insert(it, rest.begin(), rest.end());
+    }
+
+private:
+    size_t mFromSize { 0 }, mToSize { 0 };
+
+    // Changed elements present in both versions.
+    std::vector<std::pair<size_t, typename Traits<T>::Delta>> mChanges;
+
+    // Where the elements only one version has start.
+    size_t mRestIndex { 0 };
+    std::vector<T> mFromRest, mToRest;
+
+    size_t mMemoryUsage { sizeof(*this) };
+};
+
+template <>
+struct Traits<std::string> {
+    static size_t getMemoryUsage(const std::string& string) {
+        return sizeof(string) + string.size();
+    }
+};
+
+template <>
+struct Traits<CellAnim::ArrangementPart> {
+    using Delta = ValueDelta<CellAnim::ArrangementPart>;
+
+    // Editor fields included; operator== skips them.
+    static bool isSame(const CellAnim::ArrangementPart& a, const CellAnim::ArrangementPart& b) {
+        return
+            a == b &&
+            a.editorVisible == b.editorVisible &&
+            a.editorLocked == b.editorLocked &&
+            a.editorName == b.editorName;
+    }
+    static size_t getMemoryUsage(const CellAnim::ArrangementPart& part) {
+        return sizeof(part) + part.emitterName.size() + part.editorName.size();
+    }
+};
+
+template <>
+struct Traits<CellAnim::AnimationKey> {
+    using Delta = ValueDelta<CellAnim::AnimationKey>;
+
+    static bool isSame(const CellAnim::AnimationKey& a, const CellAnim::AnimationKey& b) {
+        return a == b;
+    }
+    static size_t getMemoryUsage(const CellAnim::AnimationKey& key) {
+        return sizeof(key);
+    }
+};
+
+class ArrangementDelta {
+public:
+    ArrangementDelta(const CellAnim::Arrangement& from, const CellAnim::Arrangement& to) :
+        mParts(from.parts, to.parts),
+        mFromTempOffset(from.tempOffset), mToTempOffset(to.tempOffset),
+        mFromTempScale(from.tempScale), mToTempScale(to.tempScale)
+    {}
+
+    void apply(CellAnim::Arrangement& arrangement) const {
+        mParts.apply(arrangement.parts);
+
+        arrangement.tempOffset = mToTempOffset;
+        arrangement.tempScale = mToTempScale;
+    }
+    void revert(CellAnim::Arrangement& arrangement) const {
+        mParts.revert(arrangement.parts);
+
+        arrangement.tempOffset = mFromTempOffset;
+        arrangement.tempScale = mFromTempScale;
+    }
+
+    size_t getMemoryUsage() const {
+        return sizeof(*this) - sizeof(mParts) + mParts.getMemoryUsage();
+    }
+
+private:
+    VectorDelta<CellAnim::ArrangementPart> mParts;
+
+    CellAnim::IntVec2 mFromTempOffset, mToTempOffset;
+    CellAnim::FltVec2 mFromTempScale, mToTempScale;
+};
+
+class AnimationDelta {
+public:
+    AnimationDelta(const CellAnim::Animation& from, const CellAnim::Animation& to) :
+        mKeys(from.keys, to.keys),
+        mFromInterpolated(from.isInterpolated), mToInterpolated(to.isInterpolated)
+    {
+        if (from.name != to.name)
+            mName.emplace(from.name, to.name);
+        if (from.comment != to.comment)
+            mComment.emplace(from.comment, to.comment);
+    }
+
+    void apply(CellAnim::Animation& animation) const {
+        mKeys.apply(animation.keys);
+
+        if (mName)
+            mName->apply(animation.name);
+        if (mComment)
+            mComment->apply(animation.comment);
+
+        animation.isInterpolated = mToInterpolated;
+    }
+    void revert(CellAnim::Animation& animation) const {
+        mKeys.revert(animation.keys);
+
+        if (mName)
+            mName->revert(animation.name);
+        if (mComment)
+            mComment->revert(animation.comment);
+
+        animation.isInterpolated = mFromInterpolated;
+    }
+
+    size_t getMemoryUsage() const {
+        return sizeof(*this) - sizeof(mKeys) + mKeys.getMemoryUsage() +
+            (mName ? mName->getMemoryUsage() : 0) +
+            (mComment ? mComment->getMemoryUsage() : 0);
+    }
+
+private:
+    VectorDelta<CellAnim::AnimationKey> mKeys;
+
+    std::optional<ValueDelta<std::string>> mName;
+    std::optional<ValueDelta<std::string>> mComment;
+
+    bool mFromInterpolated, mToInterpolated;
+};
+
+template <>
+struct Traits<CellAnim::Arrangement> {
+    using Delta = ArrangementDelta;
+
+    static bool isSame(const CellAnim::Arrangement& a, const CellAnim::Arrangement& b) {
+        return
+            a.tempOffset == b.tempOffset &&
+            a.tempScale == b.tempScale &&
+            std::equal(
+                a.parts.begin(), a.parts.end(), b.parts.begin(), b.parts.end(),
+                Traits<CellAnim::ArrangementPart>::isSame
+            );
+    }
+    static size_t getMemoryUsage(const CellAnim::Arrangement& arrangement) {
+        size_t usage = sizeof(arrangement);
+        for (const auto& part : arrangement.parts)
+            usage += Traits<CellAnim::ArrangementPart>::getMemoryUsage(part);
+        return usage;
+    }
+};
+
+template <>
+struct Traits<CellAnim::Animation> {
+    using Delta = AnimationDelta;
+
+    static bool isSame(const CellAnim::Animation& a, const CellAnim::Animation& b) {
+        return a == b;
+    }
+    static size_t getMemoryUsage(const CellAnim::Animation& animation) {
+        return sizeof(animation) +
+            animation.keys.size() * sizeof(CellAnim::AnimationKey) +
+            animation.name.size() + animation.comment.size();
+    }
+};
+
+} // namespace CellAnimDelta
+
+#endif // CELLANIM_DELTA_HPP
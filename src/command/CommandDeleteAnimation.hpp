@@ -5,6 +5,8 @@
 
 #include "cellanim/CellAnim.hpp"
 
+#include "CellAnimDelta.hpp"
+
 #include "manager/SessionManager.hpp"
 #include "manager/PlayerManager.hpp"
 
@@ -38,13 +40,17 @@ public:
         SessionManager::getInstance().setCurrentSessionModified(true);
     }
 
+    size_t getMemoryUsage() const override {
+        return CellAnimDelta::Traits<CellAnim::Animation>::getMemoryUsage(mAnimation);
+    }
+
 private:
     unsigned mCellAnimIndex;
     unsigned mAnimationIndex;
 
     CellAnim::Animation mAnimation;
 
-    std::vector<CellAnim::Animation>& getAnimations() {
+    CellAnim::PersistentVector<CellAnim::Animation>& getAnimations() {
         return
             SessionManager::getInstance().getCurrentSession()
             ->cellanims.at(mCellAnimIndex).object
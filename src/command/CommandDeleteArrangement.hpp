@@ -5,6 +5,8 @@
 
 #include "cellanim/CellAnim.hpp"
 
+#include "CellAnimDelta.hpp"
+
 #include "manager/SessionManager.hpp"
 #include "manager/PlayerManager.hpp"
 
@@ -64,13 +66,17 @@ public:
         SessionManager::getInstance().setCurrentSessionModified(true);
     }
 
+    size_t getMemoryUsage() const override {
+        return CellAnimDelta::Traits<CellAnim::Arrangement>::getMemoryUsage(mArrangement);
+    }
+
 private:
     unsigned mCellAnimIndex;
     unsigned mArrangementIndex;
 
     CellAnim::Arrangement mArrangement;
 
-    std::vector<CellAnim::Arrangement>& getArrangements() {
+    CellAnim::PersistentVector<CellAnim::Arrangement>& getArrangements() {
         return
             SessionManager::getInstance().getCurrentSession()
             ->cellanims.at(mCellAnimIndex).object
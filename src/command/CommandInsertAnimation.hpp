@@ -8,6 +8,8 @@
 
 #include "cellanim/CellAnim.hpp"
 
+#include "CellAnimDelta.hpp"
+
 class CommandInsertAnimation : public BaseCommand {
 public:
     // Constructor: Insert animation by cellanimIndex and animationIndex from animation.
@@ -43,6 +45,10 @@ public:
         SessionManager::getInstance().setCurrentSessionModified(true);
     }
 
+    size_t getMemoryUsage() const override {
+        return CellAnimDelta::Traits<CellAnim::Animation>::getMemoryUsage(mAnimation);
+    }
+
 private:
     unsigned mCellAnimIndex;
     unsigned mAnimationIndex;
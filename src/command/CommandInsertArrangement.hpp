@@ -9,6 +9,8 @@
 
 #include "cellanim/CellAnim.hpp"
 
+#include "CellAnimDelta.hpp"
+
 class CommandInsertArrangement : public BaseCommand {
 public:
     // Constructor: Insert arrangement by cellanimIndex and arrangementIndex from arrangement.
@@ -50,6 +52,10 @@ public:
         SessionManager::getInstance().setCurrentSessionModified(true);
     }
 
+    size_t getMemoryUsage() const override {
+        return CellAnimDelta::Traits<CellAnim::Arrangement>::getMemoryUsage(mArrangement);
+    }
+
 private:
     unsigned mCellAnimIndex;
     unsigned mArrangementIndex;
@@ -3,8 +3,12 @@
 
 #include "BaseCommand.hpp"
 
+#include <optional>
+
 #include "cellanim/CellAnim.hpp"
 
+#include "CellAnimDelta.hpp"
+
 #include "manager/SessionManager.hpp"
 #include "manager/PlayerManager.hpp"
 
@@ -18,16 +22,15 @@ public:
         CellAnim::Animation newAnimation
     ) :
         mCellAnimIndex(cellanimIndex), mAnimationIndex(animationIndex),
-        mNewAnimation(newAnimation),
         mIsError(false)
     {
-        if (mNewAnimation.keys.empty()) {
+        if (newAnimation.keys.empty()) {
             Logging::error("[CommmandModifyAnimation] Cannot submit animation with no keys: it's super illegal!!!");
             mIsError = true;
             return;
         }
 
-        mOldAnimation = getAnimation();
+        mDelta.emplace(getAnimation(), newAnimation);
     }
     ~CommandModifyAnimation() = default;
 
@@ -36,7 +39,7 @@ public:
             return;
         }
 
-        getAnimation() = mNewAnimation;
+        mDelta->apply(getAnimation());
 
         PlayerManager::getInstance().validateState();
 
@@ -48,19 +51,23 @@ public:
             return;
         }
 
-        getAnimation() = mOldAnimation;
+        mDelta->revert(getAnimation());
 
         PlayerManager::getInstance().validateState();
 
         SessionManager::getInstance().setCurrentSessionModified(true);
     }
 
+    size_t getMemoryUsage() const override {
+        return mDelta ? mDelta->getMemoryUsage() : 0;
+    }
+
 private:
     unsigned mCellAnimIndex;
     unsigned mAnimationIndex;
 
-    CellAnim::Animation mOldAnimation;
-    CellAnim::Animation mNewAnimation;
+    // Empty if mIsError.
+    std::optional<CellAnimDelta::AnimationDelta> mDelta;
 
     bool mIsError;
 
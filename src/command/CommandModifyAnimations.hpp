@@ -5,6 +5,8 @@
 
 #include "cellanim/CellAnim.hpp"
 
+#include "CellAnimDelta.hpp"
+
 #include "manager/SessionManager.hpp"
 #include "manager/PlayerManager.hpp"
 
@@ -13,17 +15,15 @@ public:
     // Constructor: Replace animations by cellanimIndex by newAnimations.
     CommandModifyAnimations(
         unsigned cellanimIndex,
-        std::vector<CellAnim::Animation> newAnimations
+        CellAnim::PersistentVector<CellAnim::Animation> newAnimations
     ) :
         mCellAnimIndex(cellanimIndex),
-        mNewAnimations(newAnimations)
-    {
-        mOldAnimations = getAnimations();
-    }
+        mDelta(getAnimations(), newAnimations)
+    {}
     ~CommandModifyAnimations() = default;
 
     void execute() override {
-        getAnimations() = mNewAnimations;
+        mDelta.apply(getAnimations());
 
         PlayerManager::getInstance().validateState();
 
@@ -31,20 +31,23 @@ public:
     }
 
     void rollback() override {
-        getAnimations() = mOldAnimations;
+        mDelta.revert(getAnimations());
 
         PlayerManager::getInstance().validateState();
 
         SessionManager::getInstance().setCurrentSessionModified(true);
     }
 
+    size_t getMemoryUsage() const override {
+        return mDelta.getMemoryUsage();
+    }
+
 private:
     unsigned mCellAnimIndex;
 
-    std::vector<CellAnim::Animation> mOldAnimations;
-    std::vector<CellAnim::Animation> mNewAnimations;
+    CellAnimDelta::VectorDelta<CellAnim::Animation> mDelta;
 
-    std::vector<CellAnim::Animation>& getAnimations() {
+    CellAnim::PersistentVector<CellAnim::Animation>& getAnimations() {
         return
             SessionManager::getInstance().getCurrentSession()
             ->cellanims.at(mCellAnimIndex).object
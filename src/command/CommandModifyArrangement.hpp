@@ -5,6 +5,8 @@
 
 #include "cellanim/CellAnim.hpp"
 
+#include "CellAnimDelta.hpp"
+
 #include "manager/SessionManager.hpp"
 #include "manager/PlayerManager.hpp"
 
@@ -17,14 +19,12 @@ public:
         CellAnim::Arrangement newArrangement
     ) :
         mCellAnimIndex(cellanimIndex), mArrangementIndex(arrangementIndex),
-        mNewArrangement(newArrangement)
-    {
-        mOldArrangement = getArrangement();
-    }
+        mDelta(getArrangement(), newArrangement)
+    {}
     ~CommandModifyArrangement() = default;
 
     void execute() override {
-        getArrangement() = mNewArrangement;
+        mDelta.apply(getArrangement());
 
         PlayerManager::getInstance().validateState();
 
@@ -32,19 +32,22 @@ public:
     }
 
     void rollback() override {
-        getArrangement() = mOldArrangement;
+        mDelta.revert(getArrangement());
 
         PlayerManager::getInstance().validateState();
 
         SessionManager::getInstance().setCurrentSessionModified(true);
     }
 
+    size_t getMemoryUsage() const override {
+        return mDelta.getMemoryUsage();
+    }
+
 private:
     unsigned mCellAnimIndex;
     unsigned mArrangementIndex;
 
-    CellAnim::Arrangement mOldArrangement;
-    CellAnim::Arrangement mNewArrangement;
+    CellAnimDelta::ArrangementDelta mDelta;
 
     CellAnim::Arrangement& getArrangement() {
         return
@@ -5,6 +5,8 @@
 
 #include "cellanim/CellAnim.hpp"
 
+#include "CellAnimDelta.hpp"
+
 #include "manager/SessionManager.hpp"
 #include "manager/PlayerManager.hpp"
 
@@ -14,17 +16,15 @@ public:
     // Constructor: Replace arrangements by cellanimIndex by newArrangements.
     CommandModifyArrangements(
         unsigned cellanimIndex,
-        std::vector<CellAnim::Arrangement> newArrangements
+        CellAnim::PersistentVector<CellAnim::Arrangement> newArrangements
     ) :
         mCellAnimIndex(cellanimIndex),
-        mNewArrangements(newArrangements)
-    {
-        mOldArrangements = getArrangements();
-    }
+        mDelta(getArrangements(), newArrangements)
+    {}
     ~CommandModifyArrangements() = default;
 
     void execute() override {
-        getArrangements() = mNewArrangements;
+        mDelta.apply(getArrangements());
 
         PlayerManager::getInstance().validateState();
 
@@ -32,20 +32,23 @@ public:
     }
 
     void rollback() override {
-        getArrangements() = mOldArrangements;
+        mDelta.revert(getArrangements());
 
         PlayerManager::getInstance().validateState();
 
         SessionManager::getInstance().setCurrentSessionModified(true);
     }
 
+    size_t getMemoryUsage() const override {
+        return mDelta.getMemoryUsage();
+    }
+
 private:
     unsigned mCellAnimIndex;
 
-    std::vector<CellAnim::Arrangement> mOldArrangements;
-    std::vector<CellAnim::Arrangement> mNewArrangements;
+    CellAnimDelta::VectorDelta<CellAnim::Arrangement> mDelta;
 
-    std::vector<CellAnim::Arrangement>& getArrangements() {
+    CellAnim::PersistentVector<CellAnim::Arrangement>& getArrangements() {
         return
             SessionManager::getInstance().getCurrentSession()
             ->cellanims.at(mCellAnimIndex).object
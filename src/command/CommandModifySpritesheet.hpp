@@ -10,11 +10,15 @@
 class CommandModifySpritesheet : public BaseCommand {
 public:
     // Constructor: Replace spritesheet from sheetIndex by newSheet (shared ownership).
+    //     - keepCellAnimSize: keep the sheet size of the current cellanim, for
+    //       when newSheet is the old sheet rescaled (the cells are kept as-is).
     CommandModifySpritesheet(
-        unsigned sheetIndex, std::shared_ptr<TextureEx> newSheet
+        unsigned sheetIndex, std::shared_ptr<TextureEx> newSheet,
+        bool keepCellAnimSize = false
     ) :
         mSheetIndex(sheetIndex),
-        mNewSheet(std::move(newSheet)), mOldSheet(getSheet())
+        mNewSheet(std::move(newSheet)), mOldSheet(getSheet()),
+        mKeepCellAnimSize(keepCellAnimSize)
     {}
     ~CommandModifySpritesheet() = default;
 
@@ -23,8 +27,10 @@ public:
 
         Session* currentSession = SessionManager::getInstance().getCurrentSession();
 
-        currentSession->getCurrentCellAnim().object->setSheetWidth(mNewSheet->getWidth());
-        currentSession->getCurrentCellAnim().object->setSheetHeight(mNewSheet->getHeight());
+        if (!mKeepCellAnimSize) {
+            currentSession->getCurrentCellAnim().object->setSheetWidth(mNewSheet->getWidth());
+            currentSession->getCurrentCellAnim().object->setSheetHeight(mNewSheet->getHeight());
+        }
         currentSession->getCurrentCellAnim().object->setUsePalette(TPL::getImageFormatPaletted(
             mNewSheet->getTPLOutputFormat()
         ));
@@ -37,8 +43,10 @@ public:
 
         Session* currentSession = SessionManager::getInstance().getCurrentSession();
 
-        currentSession->getCurrentCellAnim().object->setSheetWidth(mOldSheet->getWidth());
-        currentSession->getCurrentCellAnim().object->setSheetHeight(mOldSheet->getHeight());
+        if (!mKeepCellAnimSize) {
+            currentSession->getCurrentCellAnim().object->setSheetWidth(mOldSheet->getWidth());
+            currentSession->getCurrentCellAnim().object->setSheetHeight(mOldSheet->getHeight());
+        }
         currentSession->getCurrentCellAnim().object->setUsePalette(TPL::getImageFormatPaletted(
             mOldSheet->getTPLOutputFormat()
         ));
@@ -46,12 +54,23 @@ public:
         currentSession->modified = true;
     }
 
+    // Both sheets are pinned by the command.
+    size_t getMemoryUsage() const override {
+        return GetImageSize(*mNewSheet) + GetImageSize(*mOldSheet);
+    }
+
 private:
+    static size_t GetImageSize(const TextureEx& texture) {
+        return size_t(texture.getWidth()) * texture.getHeight() * 4;
+    }
+
     unsigned mSheetIndex;
 
     std::shared_ptr<TextureEx> mNewSheet;
     std::shared_ptr<TextureEx> mOldSheet;
 
+    bool mKeepCellAnimSize;
+
     std::shared_ptr<TextureEx>& getSheet() {
         return SessionManager::getInstance().getCurrentSession()
             ->sheets->getTextureByIndex(mSheetIndex);
@@ -78,7 +78,7 @@ private:
         }
     }
 
-    std::vector<CellAnim::Animation>& getAnimations() {
+    CellAnim::PersistentVector<CellAnim::Animation>& getAnimations() {
         return
             SessionManager::getInstance().getCurrentSession()
             ->cellanims.at(mCellAnimIndex).object
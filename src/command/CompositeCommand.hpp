@@ -24,6 +24,14 @@ public:
         }
     }
 
+    size_t getMemoryUsage() const override {
+        size_t usage = 0;
+        for (const auto& cmd : commands) {
+            usage += cmd->getMemoryUsage();
+        }
+        return usage;
+    }
+
 private:
     std::vector<std::shared_ptr<BaseCommand>> commands;
 };
@@ -1,11 +1,17 @@
 #include "NZlib.hpp"
 
+#include <cstring>
+
 #include <algorithm>
 
 #include <chrono>
 
+#include <atomic>
+
 #include <zlib-ng.h>
 
+#include "util/ParallelUtil.hpp"
+
 #include "Logging.hpp"
 
 #include "Macro.hpp"
@@ -14,40 +20,224 @@ constexpr unsigned int MIN_ZLIB_DATA_SIZE = 6;
 
 namespace NZlib {
 
-std::optional<std::vector<unsigned char>> compress(const unsigned char* data, const size_t dataSize, int compressionLevel) {
+// Data larger than this is cut into blocks that are deflated in parallel.
+constexpr size_t PARALLEL_BLOCK_SIZE = 0x20000;
+// Every block is deflated with the data before it as preset dictionary; this
+// is the most deflate can reach back.
+constexpr size_t DEFLATE_DICTIONARY_SIZE = 0x8000;
+
+// Without parallelism, data that has to be gathered is compressed in chunks of
+// this size.
+constexpr size_t SERIAL_GATHER_SIZE = 0x40000;
+
+constexpr int DEFLATE_WINDOW_BITS = 15;
+constexpr int DEFLATE_MEM_LEVEL = 8;
+
+// The zlib header deflate would write for this level (CMF, FLG).
+static uint16_t getZlibHeader(int compressionLevel) {
+    if (compressionLevel == Z_DEFAULT_COMPRESSION)
+        compressionLevel = 6;
+
+    unsigned levelFlags;
+    if (compressionLevel < 2)
+        levelFlags = 0;
+    else if (compressionLevel < 6)
+        levelFlags = 1;
+    else if (compressionLevel == 6)
+        levelFlags = 2;
+    else
+        levelFlags = 3;
+
+    uint16_t header = (0x78 << 8) | (levelFlags << 6);
+    header += 31 - (header % 31);
+
+    return header;
+}
+
+struct DeflateBlock {
+    std::vector<unsigned char> output;
+    uint32_t adler;
+};
+
+// Deflate one block as raw deflate data. Blocks other than the last end with a
+// sync flush, so that they are byte-aligned and can simply be concatenated.
+static bool deflateBlock(
+    const unsigned char* dictionary, const size_t dictionarySize,
+    const unsigned char* data, const size_t dataSize,
+    const bool isLastBlock,
+    int compressionLevel,
+    DeflateBlock& block
+) {
+    zng_stream stream {};
+
+    int initResult = zng_deflateInit2(
+        &stream, compressionLevel, Z_DEFLATED,
+        -DEFLATE_WINDOW_BITS, DEFLATE_MEM_LEVEL, Z_DEFAULT_STRATEGY
+    );
+    if (initResult != Z_OK) {
+        Logging::error("[NZlib::deflateBlock] zng_deflateInit2 failed (code {})!", initResult);
+        return false;
+    }
+
+    if (dictionarySize > 0)
+        zng_deflateSetDictionary(&stream, dictionary, dictionarySize);
+
+    const int flush = isLastBlock ? Z_FINISH : Z_SYNC_FLUSH;
+
+    // The bound doesn't account for the flush marker; the buffer is grown in
+    // the (unlikely) case it doesn't fit.
+    block.output.resize(zng_deflateBound(&stream, dataSize) + 16);
+
+    stream.next_in = data;
+    stream.avail_in = dataSize;
+
+    size_t outputSize = 0;
+    bool ok = true;
+
+    while (true) {
+        stream.next_out = block.output.data() + outputSize;
+        stream.avail_out = block.output.size() - outputSize;
+
+        int deflateResult = zng_deflate(&stream, flush);
+        outputSize = block.output.size() - stream.avail_out;
+
+        if (deflateResult == Z_STREAM_ERROR) {
+            Logging::error("[NZlib::deflateBlock] zng_deflate failed (code {})!", deflateResult);
+            ok = false;
+            break;
+        }
+
+        if (isLastBlock ? (deflateResult == Z_STREAM_END) : (stream.avail_out != 0))
+            break;
+
+        block.output.resize(block.output.size() * 2);
+    }
+
+    zng_deflateEnd(&stream);
+
+    block.output.resize(outputSize);
+    block.adler = zng_adler32(zng_adler32(0, nullptr, 0), data, dataSize);
+
+    return ok;
+}
+
+// pigz-style parallel compression: the blocks are deflated independently and
+// joined into one standard zlib stream, with their checksums combined into the
+// Adler-32 of the whole data.
+static bool compressParallel(
+    const GatherFunc& gather, const size_t dataSize,
+    int compressionLevel,
+    const Encoder::Sink& sink
+) {
+    const size_t blockCount = (dataSize + PARALLEL_BLOCK_SIZE - 1) / PARALLEL_BLOCK_SIZE;
+
+    std::vector<DeflateBlock> blocks(blockCount);
+    std::atomic<bool> failed { false };
+
+    // Runs on the shared pool, so compressing inside other parallel work
+    // (e.g. exporting several archives at once) doesn't oversubscribe.
+    ParallelUtil::parallelFor(blockCount, 1, [&](size_t begin, size_t end) {
+        // Holds the dictionary and block if they need to be gathered.
+        std::vector<unsigned char> scratch(DEFLATE_DICTIONARY_SIZE + PARALLEL_BLOCK_SIZE);
+
+        for (size_t block = begin; block < end && !failed; block++) {
+            const size_t blockStart = block * PARALLEL_BLOCK_SIZE;
+            const size_t blockEnd = std::min(blockStart + PARALLEL_BLOCK_SIZE, dataSize);
+
+            const size_t dictionarySize = std::min(blockStart, DEFLATE_DICTIONARY_SIZE);
+
+            const unsigned char* dictionary = gather(
+                blockStart - dictionarySize, dictionarySize + (blockEnd - blockStart),
+                scratch.data()
+            );
+
+            if (!deflateBlock(
+                dictionary, dictionarySize,
+                dictionary + dictionarySize, blockEnd - blockStart,
+                blockEnd == dataSize, compressionLevel, blocks[block]
+            ))
+                failed = true;
+        }
+    });
+
+    if (failed)
+        return false;
+
+    unsigned char header[sizeof(uint32_t) + sizeof(uint16_t)];
+
+    *reinterpret_cast<uint32_t*>(header) = BYTESWAP_32(static_cast<uint32_t>(dataSize));
+    *reinterpret_cast<uint16_t*>(header + sizeof(uint32_t)) = BYTESWAP_16(getZlibHeader(compressionLevel));
+
+    if (!sink(header, sizeof(header)))
+        return false;
+
+    uint32_t adler = blocks[0].adler;
+    for (size_t i = 0; i < blockCount; i++) {
+        if (!sink(blocks[i].output.data(), blocks[i].output.size()))
+            return false;
+
+        // Free the output as we go.
+        blocks[i].output = std::vector<unsigned char>();
+
+        if (i > 0) {
+            const size_t blockSize = std::min(PARALLEL_BLOCK_SIZE, dataSize - (i * PARALLEL_BLOCK_SIZE));
+            adler = zng_adler32_combine(adler, blocks[i].adler, blockSize);
+        }
+    }
+
+    const uint32_t trailer = BYTESWAP_32(adler);
+    return sink(reinterpret_cast<const unsigned char*>(&trailer), sizeof(trailer));
+}
+
+bool compress(const GatherFunc& gather, const size_t dataSize, int compressionLevel, const Encoder::Sink& sink) {
     if (dataSize > 0xFFFFFFFF) {
         Logging::error("[NZlib::compress] Unable to compress: size of data is more than 4GiB!");
-        return std::nullopt; // return nothing (std::optional)
+        return false;
     }
     if (dataSize == 0) {
         Logging::error("[NZlib::compress] Unable to compress: size of data is zero");
-        return std::nullopt; // return nothing (std::optional)
+        return false;
     }
 
     auto compressStartTime = std::chrono::high_resolution_clock::now();
 
-    std::vector<unsigned char> deflated(
-        sizeof(uint32_t) + zng_compressBound(dataSize)
-    );
+    size_t compressedSize = 0;
+    auto countingSink = [&sink, &compressedSize](const unsigned char* chunk, size_t chunkSize) {
+        compressedSize += chunkSize;
+        return sink(chunk, chunkSize);
+    };
+
+    const size_t blockCount = (dataSize + PARALLEL_BLOCK_SIZE - 1) / PARALLEL_BLOCK_SIZE;
 
-    *reinterpret_cast<uint32_t*>(deflated.data()) = BYTESWAP_32(static_cast<uint32_t>(dataSize));
+    // Storing (level 0) isn't worth splitting up.
+    if (compressionLevel != 0 && blockCount > 1 && ParallelUtil::getThreadCount() > 1) {
+        if (!compressParallel(gather, dataSize, compressionLevel, countingSink))
+            return false;
+    }
+    else {
+        Encoder encoder(dataSize, compressionLevel, countingSink);
+        if (!encoder.isInitialized())
+            return false;
 
-    unsigned char* dest = deflated.data() + sizeof(uint32_t);
-    size_t destLen = deflated.size() - sizeof(uint32_t);
+        std::vector<unsigned char> scratch(std::min(dataSize, SERIAL_GATHER_SIZE));
 
-    int compResult = zng_compress2(dest, &destLen, data, dataSize, compressionLevel);
-    if (compResult != Z_OK) {
-        Logging::error("[NZlib::compress] zng_compress2 failed (code {})!", compResult);
-        return std::nullopt; // return nothing (std::optional)
+        for (size_t offset = 0; offset < dataSize; offset += SERIAL_GATHER_SIZE) {
+            const size_t size = std::min(dataSize - offset, SERIAL_GATHER_SIZE);
+            if (!encoder.write(gather(offset, size, scratch.data()), size))
+                return false;
+        }
+
+        if (!encoder.finish())
+            return false;
     }
 
-    deflated.resize(sizeof(uint32_t) + destLen);
+    const size_t destLen = compressedSize - sizeof(uint32_t);
 
     auto compressTotalTime = std::chrono::high_resolution_clock::now() - compressStartTime;
 
     auto compressTotalTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(compressTotalTime).count();
 
-    float reductionRate = ((dataSize - destLen) / static_cast<float>(dataSize)) * 100.f;
+    float reductionRate = ((static_cast<float>(dataSize) - destLen) / static_cast<float>(dataSize)) * 100.f;
 
     Logging::info(
         "[NZlib::compress] Successfully compressed {}kb of data down to {}kb ({}% reduction) in {}ms.",
@@ -57,6 +247,26 @@ std::optional<std::vector<unsigned char>> compress(const unsigned char* data, co
         compressTotalTimeMs
     );
 
+    return true;
+}
+
+std::optional<std::vector<unsigned char>> compress(const unsigned char* data, const size_t dataSize, int compressionLevel) {
+    // The result grows with the output instead of reserving zng_compressBound
+    // (which is larger than the input) upfront.
+    std::vector<unsigned char> deflated;
+
+    bool ok = compress(
+        [data](size_t offset, size_t, unsigned char*) { return data + offset; },
+        dataSize, compressionLevel,
+        [&deflated](const unsigned char* chunk, size_t chunkSize) {
+            deflated.insert(deflated.end(), chunk, chunk + chunkSize);
+            return true;
+        }
+    );
+
+    if (!ok)
+        return std::nullopt; // return nothing (std::optional)
+
     return deflated;
 }
 
@@ -76,40 +286,31 @@ std::optional<std::vector<unsigned char>> decompress(const unsigned char* data,
         return std::nullopt;
     }
 
-    const uint32_t inflateSize = BYTESWAP_32(*reinterpret_cast<const uint32_t*>(data));
-    if (inflateSize == 0) {
-        Logging::error("[NZlib::decompress] Invalid inflate size!");
-        return std::nullopt;
-    }
-
     auto decompressStartTime = std::chrono::high_resolution_clock::now();
 
-    std::vector<unsigned char> inflated(inflateSize);
-
-    unsigned char* dest = inflated.data();
-    size_t destLen = inflated.size();
-
-    const unsigned char* src = data + sizeof(uint32_t);
-    size_t srcLen = deflateSize;
+    Decoder decoder;
+    if (!decoder.feed(data, dataSize)) {
+        return std::nullopt; // return nothing (std::optional)
+    }
 
-    int decompResult = zng_uncompress2(dest, &destLen, src, &srcLen);
-    if (decompResult != Z_OK) {
-        Logging::error("[NZlib::decompress] zng_uncompress2 failed (code {})!", decompResult);
+    if (!decoder.isFinished()) {
+        Logging::error("[NZlib::decompress] Invalid NZlib binary: compressed data ends early!");
         return std::nullopt; // return nothing (std::optional)
     }
 
+    std::vector<unsigned char> inflated = decoder.takeOutput();
+
     auto decompressEndTime = std::chrono::high_resolution_clock::now() - decompressStartTime;
 
     auto decompressWorkTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(decompressEndTime).count();
 
-    if (srcLen < deflateSize) {
-        size_t padLength = deflateSize - srcLen;
-        Logging::warn("[NZlib::decompress] Compressed data is padded by {} bytes; strange..", padLength);
+    if (decoder.getPaddingSize() > 0) {
+        Logging::warn("[NZlib::decompress] Compressed data is padded by {} bytes; strange..", decoder.getPaddingSize());
     }
 
     Logging::info(
         "[NZlib::decompress] Decompressed {}kb of data in {}ms from {}kb of compressed data.",
-        inflateSize / 1024,
+        inflated.size() / 1024,
         decompressWorkTimeMs,
         dataSize / 1024
     );
@@ -143,4 +344,195 @@ bool checkDataValid(const unsigned char* data, const size_t dataSize) {
     return true;
 }
 
+Encoder::Encoder(const size_t dataSize, int compressionLevel, Sink sink) :
+    mSink(std::move(sink)), mDataSize(dataSize)
+{
+    if (dataSize > 0xFFFFFFFF) {
+        Logging::error("[NZlib::Encoder::Encoder] Unable to compress: size of data is more than 4GiB!");
+        return;
+    }
+
+    zng_stream* stream = new zng_stream {};
+
+    int initResult = zng_deflateInit(stream, compressionLevel);
+    if (initResult != Z_OK) {
+        Logging::error("[NZlib::Encoder::Encoder] zng_deflateInit failed (code {})!", initResult);
+        delete stream;
+        return;
+    }
+
+    mStream = stream;
+
+    mOutputBuffer.resize(OUTPUT_BUFFER_SIZE);
+
+    // The header goes out with the first block of compressed data.
+    *reinterpret_cast<uint32_t*>(mOutputBuffer.data()) = BYTESWAP_32(static_cast<uint32_t>(dataSize));
+
+    mStream->next_out = mOutputBuffer.data() + sizeof(uint32_t);
+    mStream->avail_out = mOutputBuffer.size() - sizeof(uint32_t);
+}
+
+Encoder::~Encoder() {
+    if (mStream != nullptr) {
+        zng_deflateEnd(mStream);
+        delete mStream;
+    }
+}
+
+bool Encoder::deflateInput(int flush) {
+    while (true) {
+        int deflateResult = zng_deflate(mStream, flush);
+        if (deflateResult == Z_STREAM_ERROR) {
+            Logging::error("[NZlib::Encoder::deflateInput] zng_deflate failed (code {})!", deflateResult);
+            return false;
+        }
+
+        const bool streamEnd = deflateResult == Z_STREAM_END;
+
+        if (mStream->avail_out == 0 || streamEnd) {
+            const size_t outputSize = mOutputBuffer.size() - mStream->avail_out;
+            if (!mSink(mOutputBuffer.data(), outputSize))
+                return false;
+
+            mCompressedSize += outputSize;
+
+            mStream->next_out = mOutputBuffer.data();
+            mStream->avail_out = mOutputBuffer.size();
+        }
+        else if (flush == Z_NO_FLUSH && mStream->avail_in == 0) {
+            return true;
+        }
+
+        if (streamEnd)
+            return true;
+    }
+}
+
+bool Encoder::write(const unsigned char* data, const size_t dataSize) {
+    if (mStream == nullptr)
+        return false;
+
+    if (dataSize > mDataSize - mWrittenSize) {
+        Logging::error("[NZlib::Encoder::write] More data was written than declared!");
+        return false;
+    }
+
+    const unsigned char* dataEnd = data + dataSize;
+    while (data < dataEnd) {
+        const uint32_t inputSize = std::min<size_t>(dataEnd - data, 0xFFFFFFFF);
+
+        mStream->next_in = data;
+        mStream->avail_in = inputSize;
+
+        if (!deflateInput(Z_NO_FLUSH))
+            return false;
+
+        data += inputSize;
+    }
+
+    mWrittenSize += dataSize;
+    return true;
+}
+
+bool Encoder::finish() {
+    if (mStream == nullptr)
+        return false;
+
+    if (mWrittenSize != mDataSize) {
+        Logging::error("[NZlib::Encoder::finish] Less data was written than declared!");
+        return false;
+    }
+
+    mStream->next_in = nullptr;
+    mStream->avail_in = 0;
+
+    return deflateInput(Z_FINISH);
+}
+
+Decoder::~Decoder() {
+    if (mStream != nullptr) {
+        zng_inflateEnd(mStream);
+        delete mStream;
+    }
+}
+
+bool Decoder::readHeader() {
+    const uint32_t inflateSize = BYTESWAP_32(*reinterpret_cast<const uint32_t*>(mHeader));
+    if (inflateSize == 0) {
+        Logging::error("[NZlib::Decoder::feed] Invalid inflate size!");
+        return false;
+    }
+
+    zng_stream* stream = new zng_stream {};
+
+    int initResult = zng_inflateInit(stream);
+    if (initResult != Z_OK) {
+        Logging::error("[NZlib::Decoder::feed] zng_inflateInit failed (code {})!", initResult);
+        delete stream;
+        return false;
+    }
+
+    mStream = stream;
+
+    mOutput.resize(inflateSize);
+
+    mStream->next_out = mOutput.data();
+    mStream->avail_out = inflateSize;
+
+    return true;
+}
+
+bool Decoder::feed(const unsigned char* data, const size_t dataSize) {
+    const unsigned char* dataEnd = data + dataSize;
+
+    if (mHeaderSize < HEADER_SIZE) {
+        const size_t copySize = std::min<size_t>(HEADER_SIZE - mHeaderSize, dataSize);
+
+        std::memcpy(mHeader + mHeaderSize, data, copySize);
+        mHeaderSize += copySize;
+        data += copySize;
+
+        if (mHeaderSize < HEADER_SIZE)
+            return true;
+        if (!readHeader())
+            return false;
+    }
+
+    if (mStream == nullptr)
+        return false;
+
+    while (data < dataEnd && !mFinished) {
+        const uint32_t inputSize = std::min<size_t>(dataEnd - data, 0xFFFFFFFF);
+
+        mStream->next_in = data;
+        mStream->avail_in = inputSize;
+
+        int inflateResult = zng_inflate(mStream, Z_NO_FLUSH);
+
+        data += inputSize - mStream->avail_in;
+
+        if (inflateResult == Z_STREAM_END) {
+            if (mStream->total_out != mOutput.size()) {
+                Logging::error("[NZlib::Decoder::feed] Invalid NZlib binary: inflated size is smaller than the header says!");
+                return false;
+            }
+
+            mFinished = true;
+        }
+        else if (inflateResult == Z_BUF_ERROR && mStream->avail_out == 0) {
+            Logging::error("[NZlib::Decoder::feed] Invalid NZlib binary: inflated size is larger than the header says!");
+            return false;
+        }
+        else if (inflateResult != Z_OK && inflateResult != Z_BUF_ERROR) {
+            Logging::error("[NZlib::Decoder::feed] zng_inflate failed (code {})!", inflateResult);
+            return false;
+        }
+    }
+
+    if (mFinished)
+        mPaddingSize += dataEnd - data;
+
+    return true;
+}
+
 } // namespace NZlib
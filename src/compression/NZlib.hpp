@@ -1,12 +1,18 @@
 #ifndef NZLIB_HPP
 #define NZLIB_HPP
 
+#include <cstdint>
+
 #include <cstddef>
 
 #include <vector>
 
 #include <optional>
 
+#include <functional>
+
+struct zng_stream_s;
+
 namespace NZlib {
 
 [[nodiscard]] std::optional<std::vector<unsigned char>> compress(const unsigned char* data, const size_t dataSize, int compressionLevel);
@@ -15,6 +21,108 @@ namespace NZlib {
 
 bool checkDataValid(const unsigned char* data, const size_t dataSize);
 
+// Get size bytes of the data starting at offset. Data that isn't contiguous in
+// memory (e.g. an archive serialized to a scatter list) is copied to scratch,
+// which has room for size bytes; otherwise a pointer to it can be returned
+// directly.
+using GatherFunc = std::function<const unsigned char*(size_t offset, size_t size, unsigned char* scratch)>;
+
+// Incremental compression: the data can be written in pieces of any size, and
+// the compressed output is handed to the sink as it is produced, so no buffer
+// for the whole result is needed.
+class Encoder {
+public:
+    // Returns: false to abort compression.
+    using Sink = std::function<bool(const unsigned char* data, size_t dataSize)>;
+
+    // dataSize: the total size of the data that will be written (stored in
+    // the header).
+    Encoder(const size_t dataSize, int compressionLevel, Sink sink);
+    ~Encoder();
+
+    Encoder(const Encoder&) = delete;
+    Encoder& operator=(const Encoder&) = delete;
+
+    bool isInitialized() const { return mStream != nullptr; }
+
+    // Returns: false if compression failed or the sink aborted, true otherwise.
+    bool write(const unsigned char* data, const size_t dataSize);
+
+    // Flush the remaining output. Must be called once after all data has been
+    // written.
+    bool finish();
+
+    // Size of the output produced so far, header included.
+    size_t getCompressedSize() const { return mCompressedSize; }
+
+private:
+    bool deflateInput(int flush);
+
+private:
+    static constexpr size_t OUTPUT_BUFFER_SIZE = 0x10000;
+
+    zng_stream_s* mStream { nullptr };
+    Sink mSink;
+
+    size_t mDataSize;
+    size_t mWrittenSize { 0 };
+
+    size_t mCompressedSize { 0 };
+
+    std::vector<unsigned char> mOutputBuffer;
+};
+
+// Compress data that is gathered in pieces (see GatherFunc), handing the output
+// to sink as it is produced. The data is never needed in memory as a whole.
+//
+// Returns: false if compression failed or the sink aborted, true otherwise.
+bool compress(const GatherFunc& gather, const size_t dataSize, int compressionLevel, const Encoder::Sink& sink);
+
+// Incremental decompression: compressed data can be fed in chunks of any size,
+// e.g. while the file is still being read. The output is inflated straight
+// into a single buffer sized from the header.
+class Decoder {
+public:
+    Decoder() = default;
+    ~Decoder();
+
+    Decoder(const Decoder&) = delete;
+    Decoder& operator=(const Decoder&) = delete;
+
+    // Decode the next chunk of compressed data. Data following the end of the
+    // stream is ignored.
+    //
+    // Returns: false if the data is invalid, true otherwise.
+    bool feed(const unsigned char* data, const size_t dataSize);
+
+    bool isFinished() const { return mFinished; }
+
+    // Zero until the header has been fed.
+    size_t getDecompressedSize() const { return mOutput.size(); }
+
+    // Amount of compressed bytes that were padding after the end of the stream.
+    size_t getPaddingSize() const { return mPaddingSize; }
+
+    // Take the decompressed data. Only valid once isFinished() is true.
+    std::vector<unsigned char> takeOutput() { return std::move(mOutput); }
+
+private:
+    bool readHeader();
+
+private:
+    static constexpr size_t HEADER_SIZE = sizeof(uint32_t);
+
+    unsigned char mHeader[HEADER_SIZE];
+    size_t mHeaderSize { 0 };
+
+    zng_stream_s* mStream { nullptr };
+
+    std::vector<unsigned char> mOutput;
+
+    bool mFinished { false };
+    size_t mPaddingSize { 0 };
+};
+
 } // namespace NZlib
 
 #endif // NZLIB_HPP
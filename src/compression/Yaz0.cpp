@@ -2,6 +2,10 @@
 
 #include <cstdint>
 
+#include <cstring>
+
+#include <algorithm>
+
 #include <chrono>
 
 #include "Yaz0/Compress.hpp"
@@ -28,6 +32,27 @@ constexpr size_t MAX_MATCH_LENGTH = 0x111;
 
 namespace Yaz0 {
 
+static void logCompressResult(const size_t dataSize, const size_t resultSize, long long compressTotalTimeMs) {
+    if (resultSize >= dataSize) {
+        Logging::info(
+            "[Yaz0::compress] Successfully stored {}kb of data in {}ms (final size: {}kb).",
+            dataSize / 1024,
+            compressTotalTimeMs,
+            resultSize / 1024
+        );
+    }
+    else {
+        float reductionRate = ((dataSize - resultSize) / static_cast<float>(dataSize)) * 100.f;
+        Logging::info(
+            "[Yaz0::compress] Successfully compressed {}kb of data down to {}kb in {}ms ({}% reduction).",
+            dataSize / 1024,
+            resultSize / 1024,
+            compressTotalTimeMs,
+            reductionRate
+        );
+    }
+}
+
 std::optional<std::vector<unsigned char>> compress(const unsigned char* data, const size_t dataSize, int compressionLevel) {
     if (dataSize > 0xFFFFFFFF) {
         Logging::error("[Yaz0::compress] Unable to compress: size of data is more than 4GiB!");
@@ -45,35 +70,59 @@ std::optional<std::vector<unsigned char>> compress(const unsigned char* data, co
         .decompressedSize = BYTESWAP_32(static_cast<uint32_t>(dataSize)),
     };
 
+    const detail::CompressParams params = detail::getCompressParams(compressionLevel);
+
     auto compressStartTime = std::chrono::high_resolution_clock::now();
 
-    size_t finalSize = detail::compressImpl(data, dataSize, result.data());
+    size_t finalSize = detail::compressImpl(data, dataSize, result.data(), params);
     result.resize(finalSize);
 
     auto compressTotalTime = std::chrono::high_resolution_clock::now() - compressStartTime;
 
     auto compressTotalTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(compressTotalTime).count();
 
-    if (result.size() >= dataSize) {
-        Logging::info(
-            "[Yaz0::compress] Successfully stored {}kb of data in {}ms (final size: {}kb).",
-            dataSize / 1024,
-            compressTotalTimeMs,
-            result.size() / 1024
-        );
+    logCompressResult(dataSize, result.size(), compressTotalTimeMs);
+
+    return result;
+}
+
+bool compress(const GatherFunc& gather, const size_t dataSize, int compressionLevel, const Sink& sink) {
+    if (dataSize > 0xFFFFFFFF) {
+        Logging::error("[Yaz0::compress] Unable to compress: size of data is more than 4GiB!");
+        return false;
     }
-    else {
-        float reductionRate = ((dataSize - result.size()) / static_cast<float>(dataSize)) * 100.f;
-        Logging::info(
-            "[Yaz0::compress] Successfully compressed {}kb of data down to {}kb in {}ms ({}% reduction).",
-            dataSize / 1024,
-            result.size() / 1024,
-            compressTotalTimeMs,
-            reductionRate
-        );
+    if (dataSize == 0) {
+        Logging::error("[Yaz0::compress] Unable to compress: size of data is zero");
+        return false;
     }
 
-    return result;
+    const Yaz0Header header {
+        .decompressedSize = BYTESWAP_32(static_cast<uint32_t>(dataSize)),
+    };
+
+    const detail::CompressParams params = detail::getCompressParams(compressionLevel);
+
+    auto compressStartTime = std::chrono::high_resolution_clock::now();
+
+    size_t compressedSize = 0;
+    bool ok = detail::compressStreamImpl(
+        gather, dataSize, reinterpret_cast<const unsigned char*>(&header), params,
+        [&sink, &compressedSize](const unsigned char* chunk, size_t chunkSize) {
+            compressedSize += chunkSize;
+            return sink(chunk, chunkSize);
+        }
+    );
+
+    if (!ok)
+        return false;
+
+    auto compressTotalTime = std::chrono::high_resolution_clock::now() - compressStartTime;
+
+    auto compressTotalTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(compressTotalTime).count();
+
+    logCompressResult(dataSize, compressedSize, compressTotalTimeMs);
+
+    return true;
 }
 
 std::optional<std::vector<unsigned char>> decompress(const unsigned char* data, const size_t dataSize) {
@@ -96,47 +145,18 @@ std::optional<std::vector<unsigned char>> decompress(const unsigned char* data,
 
     auto decompressStartTime = std::chrono::high_resolution_clock::now();
 
-    std::vector<unsigned char> destination(decompressedSize);
-
-    const unsigned char* srcByte = data + sizeof(Yaz0Header);
-
-    unsigned char* dstStart = destination.data();
-    unsigned char* dstEnd = destination.data() + decompressedSize;
-
-    uint8_t opByte, opMask = 0;
-
-    for (unsigned char* dstByte = dstStart; dstByte < dstEnd; opMask >>= 1) {
-        // No more operation bits left; refresh.
-        if (opMask == 0) {
-            opByte = *(srcByte++);
-            opMask = (1 << 7);
-        }
-
-        // Copy one byte.
-        if (opByte & opMask) {
-            *(dstByte++) = *(srcByte++);
-        }
-        // Run-length data.
-        else {
-            int distToDest = (*srcByte << 8) | *(srcByte + 1);
-            srcByte += 2;
-
-            int runSrcIdx = (dstByte - dstStart) - (distToDest & 0xfff);
-
-            int runLen = ((distToDest >> 12) == 0) ?
-                (*(srcByte++) + 0x12) : ((distToDest >> 12) + 2);
-
-            for (; runLen > 0; runLen--, dstByte++, runSrcIdx++) {
-                if (UNLIKELY(dstByte >= dstEnd)) {
-                    Logging::error("[Yaz0::decompress] Invalid Yaz0 binary: run length is out of bounds!");
-                    return std::nullopt; // return nothing (std::optional)
-                }
+    Decoder decoder;
+    if (!decoder.feed(data, dataSize)) {
+        return std::nullopt; // return nothing (std::optional)
+    }
 
-                *dstByte = dstStart[runSrcIdx - 1];
-            }
-        }
+    if (!decoder.isFinished()) {
+        Logging::error("[Yaz0::decompress] Invalid Yaz0 binary: compressed data ends early!");
+        return std::nullopt; // return nothing (std::optional)
     }
 
+    std::vector<unsigned char> destination = decoder.takeOutput();
+
     auto decompressEndTime = std::chrono::high_resolution_clock::now() - decompressStartTime;
 
     auto decompressWorkTimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(decompressEndTime).count();
@@ -166,4 +186,71 @@ bool checkDataValid(const unsigned char* data, const size_t dataSize) {
     return true;
 }
 
+bool Decoder::readHeader() {
+    const Yaz0Header* header = reinterpret_cast<const Yaz0Header*>(mHeader);
+    if (header->magic != YAZ0_MAGIC) {
+        Logging::error("[Yaz0::Decoder::feed] Invalid Yaz0 binary: header magic is nonmatching!");
+        return false;
+    }
+
+    const uint32_t decompressedSize = BYTESWAP_32(header->decompressedSize);
+    if (decompressedSize == 0) {
+        Logging::error("[Yaz0::Decoder::feed] Invalid Yaz0 binary: decompressed size is zero!");
+        return false;
+    }
+
+    mOutput.resize(decompressedSize);
+
+    mState.dstStart = mOutput.data();
+    mState.dstSize = decompressedSize;
+
+    return true;
+}
+
+bool Decoder::feed(const unsigned char* data, const size_t dataSize) {
+    const unsigned char* dataEnd = data + dataSize;
+
+    if (mHeaderSize < HEADER_SIZE) {
+        const size_t copySize = std::min<size_t>(HEADER_SIZE - mHeaderSize, dataSize);
+
+        std::memcpy(mHeader + mHeaderSize, data, copySize);
+        mHeaderSize += copySize;
+        data += copySize;
+
+        if (mHeaderSize < HEADER_SIZE)
+            return true;
+        if (!readHeader())
+            return false;
+    }
+
+    size_t consumed;
+
+    // Finish the operation that was split between the last chunk and this one;
+    // bytes are moved over one at a time until it can be decoded.
+    while (mCarrySize > 0 && data < dataEnd && !isFinished()) {
+        mCarry[mCarrySize++] = *(data++);
+
+        if (!detail::decodeImpl(mState, mCarry, mCarrySize, consumed))
+            return false;
+
+        std::memmove(mCarry, mCarry + consumed, mCarrySize - consumed);
+        mCarrySize -= consumed;
+    }
+
+    if (data >= dataEnd || isFinished())
+        return true;
+
+    if (!detail::decodeImpl(mState, data, dataEnd - data, consumed))
+        return false;
+
+    data += consumed;
+
+    if (!isFinished()) {
+        mCarrySize = dataEnd - data;
+        std::memcpy(mCarry, data, mCarrySize);
+    }
+
+    return true;
+}
+
 } // namespace Yaz0
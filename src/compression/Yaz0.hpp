@@ -7,6 +7,10 @@
 
 #include <optional>
 
+#include <functional>
+
+#include "Yaz0/Decompress.hpp"
+
 namespace Yaz0 {
 
 [[nodiscard]] std::optional<std::vector<unsigned char>> compress(const unsigned char* data, const size_t dataSize, int compressionLevel);
@@ -15,6 +19,71 @@ namespace Yaz0 {
 
 bool checkDataValid(const unsigned char* data, const size_t dataSize);
 
+// Get size bytes of the data starting at offset. Data that isn't contiguous in
+// memory (e.g. an archive serialized to a scatter list) is copied to scratch,
+// which has room for size bytes; otherwise a pointer to it can be returned
+// directly.
+using GatherFunc = std::function<const unsigned char*(size_t offset, size_t size, unsigned char* scratch)>;
+
+// Returns: false to abort compression.
+using Sink = std::function<bool(const unsigned char* data, size_t dataSize)>;
+
+// Compress data that is gathered in pieces (see GatherFunc), handing the output
+// to sink as it is produced. The data is never needed in memory as a whole:
+// it is gathered in segments, each with the 0x1000 bytes before it as
+// history, so matches do reach back into the previous segment. The output is
+// one ordinary Yaz0 stream; segments can't be decoded on their own.
+//
+// Returns: false if compression failed or the sink aborted, true otherwise.
+bool compress(const GatherFunc& gather, const size_t dataSize, int compressionLevel, const Sink& sink);
+
+// Incremental decompression: compressed data can be fed in chunks of any size,
+// e.g. while the file is still being read.
+class Decoder {
+public:
+    Decoder() = default;
+    ~Decoder() = default;
+
+    // Decode the next chunk of compressed data. Data following the end of the
+    // stream is ignored.
+    //
+    // Returns: false if the data is invalid, true otherwise.
+    bool feed(const unsigned char* data, const size_t dataSize);
+
+    bool isFinished() const {
+        return mHeaderSize == HEADER_SIZE && mState.dstPosition == mState.dstSize;
+    }
+
+    // Zero until the header has been fed.
+    size_t getDecompressedSize() const { return mState.dstSize; }
+
+    // The output is final up to this position; it grows with every chunk fed.
+    size_t getOutputPosition() const { return mState.dstPosition; }
+    const unsigned char* getOutput() const { return mOutput.data(); }
+
+    // Take the decompressed data. Only valid once isFinished() is true.
+    std::vector<unsigned char> takeOutput() { return std::move(mOutput); }
+
+private:
+    bool readHeader();
+
+private:
+    static constexpr size_t HEADER_SIZE = 0x10;
+
+    // An operation is at most 3 bytes (+ the op byte before it).
+    static constexpr size_t MAX_CARRY_SIZE = 4;
+
+    unsigned char mHeader[HEADER_SIZE];
+    size_t mHeaderSize { 0 };
+
+    std::vector<unsigned char> mOutput;
+    detail::DecodeState mState;
+
+    // Start of an operation that was split between chunks.
+    unsigned char mCarry[MAX_CARRY_SIZE];
+    size_t mCarrySize { 0 };
+};
+
 } // namespace Yaz0
 
 #endif // YAZ0_HPP
@@ -9,82 +9,492 @@
 
 #include "Compress.hpp"
 
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+
+#include <memory>
+
+#include <vector>
+
 #include "Window.hpp"
 
+#include "util/ParallelUtil.hpp"
+
 namespace Yaz0 {
 
 namespace detail {
 
 constexpr size_t HEADER_SIZE = 0x10;
 
-constexpr size_t MIN_MATCH_LENGTH = 3;
-constexpr size_t MAX_MATCH_LENGTH = 0xFF + 0x12;
+constexpr size_t MIN_MATCH_LENGTH = Window::MIN_MATCH_LENGTH;
+constexpr size_t MAX_MATCH_LENGTH = Window::MAX_MATCH_LENGTH;
+
+// Matches at least this long are encoded with the three-byte form.
+constexpr size_t LONG_MATCH_LENGTH = 0x12;
+
+// Cost (in bits) of each operation, including its bit in the op byte.
+constexpr uint32_t LITERAL_COST = 1 + 8;
+constexpr uint32_t SHORT_MATCH_COST = 1 + 16;
+constexpr uint32_t LONG_MATCH_COST = 1 + 24;
+
+// The optimal parse is solved in blocks to bound its memory usage; matches are
+// clipped to the end of the block.
+constexpr size_t OPTIMAL_BLOCK_SIZE = 0x40000;
+// See compressOptimal.
+constexpr size_t OPTIMAL_SKIP_SEARCH_LENGTH = 0x10;
+
+// Data larger than this is split into segments that are compressed in parallel.
+constexpr size_t PARALLEL_SEGMENT_SIZE = 0x80000;
+
+constexpr int MAX_COMPRESSION_LEVEL = 9;
+
+static constexpr CompressParams LEVEL_PARAMS[MAX_COMPRESSION_LEVEL + 1] = {
+    { CompressStrategy::Store,   0,                   0                }, // 0
+    { CompressStrategy::Greedy,  1,                   16               }, // 1
+    { CompressStrategy::Greedy,  4,                   32               }, // 2
+    { CompressStrategy::Greedy,  8,                   64               }, // 3
+    { CompressStrategy::Lazy,    16,                  64               }, // 4
+    { CompressStrategy::Lazy,    32,                  128              }, // 5
+    { CompressStrategy::Lazy,    128,                 MAX_MATCH_LENGTH }, // 6
+    { CompressStrategy::Lazy,    512,                 MAX_MATCH_LENGTH }, // 7
+    { CompressStrategy::Lazy,    Window::WINDOW_SIZE, MAX_MATCH_LENGTH }, // 8
+    { CompressStrategy::Optimal, 1024,                MAX_MATCH_LENGTH }  // 9
+};
+
+CompressParams getCompressParams(int compressionLevel) {
+    return LEVEL_PARAMS[std::clamp(compressionLevel, 0, MAX_COMPRESSION_LEVEL)];
+}
 
 size_t maxCompressedSize(const size_t dataSize) {
     // Header + every byte + all op bytes needed (just copy, no RLE).
     return HEADER_SIZE + dataSize + ((dataSize + 7) / 8);
 }
 
-size_t compressImpl(
-    const unsigned char* dataStart, const size_t dataSize,
-    unsigned char* bufferStart
-) {
-    Window* window = new Window(dataStart, dataSize);
+namespace {
+
+// Packs operations into the output buffer, grouping them under op bytes.
+class Writer {
+public:
+    Writer(unsigned char* bufferStart) :
+        mBuffer(bufferStart),
+        mPosition(HEADER_SIZE)
+    {}
+
+    void literal(unsigned char byte) {
+        beginOp(true);
+        mBuffer[mPosition++] = byte;
+    }
+
+    // distance: amount of bytes to look back (1 .. 0x1000).
+    void match(size_t distance, size_t length) {
+        beginOp(false);
+
+        const size_t lookbackOffset = distance - 1;
+
+        if (length >= LONG_MATCH_LENGTH) {
+            mBuffer[mPosition++] = (lookbackOffset >> 8) & 0xFF;
+            mBuffer[mPosition++] = (lookbackOffset >> 0) & 0xFF;
+            mBuffer[mPosition++] = (length - LONG_MATCH_LENGTH) & 0xFF;
+        }
+        else {
+            mBuffer[mPosition++] = (((length - 2) << 4) | (lookbackOffset >> 8)) & 0xFF;
+            mBuffer[mPosition++] = (lookbackOffset >> 0) & 0xFF;
+        }
+    }
+
+    size_t getPosition() const { return mPosition; }
+
+    // Output before this position is final; after it is the op byte of the
+    // group that is still being filled.
+    size_t getFinalPosition() const { return (mOpMask != 0) ? mOpPosition : mPosition; }
+
+    // Drop the output before position (once it has been written elsewhere),
+    // moving the rest to the start of the buffer.
+    void discardBefore(size_t position) {
+        std::memmove(mBuffer, mBuffer + position, mPosition - position);
+
+        mPosition -= position;
+        if (mOpMask != 0)
+            mOpPosition -= position;
+    }
+
+private:
+    void beginOp(bool isLiteral) {
+        // No more operation bits left; start a new op byte.
+        if (mOpMask == 0) {
+            mOpPosition = mPosition++;
+            mBuffer[mOpPosition] = 0x00;
+            mOpMask = (1 << 7);
+        }
+
+        if (isLiteral)
+            mBuffer[mOpPosition] |= mOpMask;
+
+        mOpMask >>= 1;
+    }
+
+private:
+    unsigned char* mBuffer;
+
+    size_t mPosition;
+
+    size_t mOpPosition { 0 };
+    unsigned mOpMask { 0 };
+};
+
+// Operations of a range that is parsed on a worker thread. They can't be packed
+// into op bytes right away since the op byte groups of the preceding ranges are
+// not known yet; replay() writes them once they are.
+class OpBuffer {
+public:
+    void literal(unsigned char byte) {
+        mOps.push_back(byte);
+    }
+
+    void match(size_t distance, size_t length) {
+        mOps.push_back(
+            OP_IS_MATCH |
+            (static_cast<uint32_t>(distance) << OP_DISTANCE_SHIFT) |
+            static_cast<uint32_t>(length)
+        );
+    }
+
+    void clear() { mOps.clear(); }
+
+    void replay(Writer& writer) const {
+        for (const uint32_t op : mOps) {
+            if (op & OP_IS_MATCH) {
+                writer.match(
+                    (op & ~OP_IS_MATCH) >> OP_DISTANCE_SHIFT,
+                    op & OP_LENGTH_MASK
+                );
+            }
+            else {
+                writer.literal(static_cast<unsigned char>(op));
+            }
+        }
+    }
+
+private:
+    static constexpr uint32_t OP_IS_MATCH = 1u << 31;
+
+    static constexpr uint32_t OP_DISTANCE_SHIFT = 16;
+    static constexpr uint32_t OP_LENGTH_MASK = (1u << OP_DISTANCE_SHIFT) - 1;
+
+    std::vector<uint32_t> mOps;
+};
 
-    size_t srcPosition = 0;
-    size_t dstPosition = HEADER_SIZE + 1;
+} // namespace
 
-    size_t opPosition = HEADER_SIZE;
-    size_t opMask = (1 << 7);
+// The parsers below encode the range [srcStart, srcEnd) of the data into sink
+// (Writer or OpBuffer). Matches never reach past srcEnd, and only the 0x1000
+// bytes before srcStart are used as history, so ranges can be parsed
+// independently of each other.
 
-    while (srcPosition < dataSize) {
+template <typename Sink>
+static void compressStore(
+    const unsigned char* dataStart, const size_t srcStart, const size_t srcEnd,
+    Sink& writer
+) {
+    for (size_t srcPosition = srcStart; srcPosition < srcEnd; srcPosition++) {
+        writer.literal(dataStart[srcPosition]);
+    }
+}
+
+template <typename Sink>
+static void compressGreedy(
+    const unsigned char* dataStart, const size_t srcStart, const size_t srcEnd,
+    const CompressParams& params, Sink& writer
+) {
+    auto window = std::make_unique<Window>(
+        dataStart, srcEnd, params.maxChainLength, params.niceLength
+    );
+    window->seek(srcStart);
+
+    size_t srcPosition = srcStart;
+    while (srcPosition < srcEnd) {
         Window::SearchResult search = window->search(srcPosition);
         if (search.length < MIN_MATCH_LENGTH) {
-            bufferStart[opPosition] |= opMask;
-            bufferStart[dstPosition++] = dataStart[srcPosition++];
+            writer.literal(dataStart[srcPosition++]);
         }
         else {
+            writer.match(srcPosition - search.offset, search.length);
+            srcPosition += search.length;
+        }
+    }
+}
+
+template <typename Sink>
+static void compressLazy(
+    const unsigned char* dataStart, const size_t srcStart, const size_t srcEnd,
+    const CompressParams& params, Sink& writer
+) {
+    auto window = std::make_unique<Window>(
+        dataStart, srcEnd, params.maxChainLength, params.niceLength
+    );
+    window->seek(srcStart);
+
+    size_t srcPosition = srcStart;
+    while (srcPosition < srcEnd) {
+        Window::SearchResult search = window->search(srcPosition);
+        if (search.length < MIN_MATCH_LENGTH) {
+            writer.literal(dataStart[srcPosition++]);
+            continue;
+        }
+
+        // Matches that are already nice are taken as-is.
+        if (search.length < params.niceLength && (srcPosition + 1) < srcEnd) {
             Window::SearchResult secondSearch = window->search(srcPosition + 1);
             if ((search.length + 1) < secondSearch.length) {
-                bufferStart[opPosition] |= opMask;
-                bufferStart[dstPosition++] = dataStart[srcPosition++];
-
-                opMask >>= 1;
-                if (opMask == 0) {
-                    opMask = (1 << 7);
-                    opPosition = dstPosition++;
-                    bufferStart[opPosition] = 0x00;
-                }
-
+                writer.literal(dataStart[srcPosition++]);
                 search = secondSearch;
             }
-            
-            size_t lookbackOffset = srcPosition - search.offset - 1;
+        }
+
+        writer.match(srcPosition - search.offset, search.length);
+        srcPosition += search.length;
+    }
+}
+
+template <typename Sink>
+static void compressOptimal(
+    const unsigned char* dataStart, const size_t srcStart, const size_t srcEnd,
+    const CompressParams& params, Sink& writer
+) {
+    auto window = std::make_unique<Window>(
+        dataStart, srcEnd, params.maxChainLength, params.niceLength
+    );
+    window->seek(srcStart);
+
+    const size_t blockCapacity = std::min(srcEnd - srcStart, OPTIMAL_BLOCK_SIZE);
 
-            if (search.length >= 0x12) {
-                bufferStart[dstPosition++] = (lookbackOffset >> 8) & 0xFF;
-                bufferStart[dstPosition++] = (lookbackOffset >> 0) & 0xFF;
-                bufferStart[dstPosition++] = (search.length - 0x12) & 0xFF;
+    // Longest match at every position of the block (0 if none). After the cost
+    // pass this holds the chosen operation length instead (1 for a literal).
+    std::vector<uint16_t> matchLength(blockCapacity);
+    std::vector<uint16_t> matchDistance(blockCapacity);
+    // Minimum cost (in bits) to encode the rest of the block from every position.
+    std::vector<uint32_t> cost(blockCapacity + 1);
+
+    for (size_t blockStart = srcStart; blockStart < srcEnd; blockStart += OPTIMAL_BLOCK_SIZE) {
+        const size_t blockSize = std::min(srcEnd - blockStart, OPTIMAL_BLOCK_SIZE);
+
+        for (size_t i = 0; i < blockSize; i++) {
+            const size_t srcPosition = blockStart + i;
+
+            // Deep inside a long match the tail of the previous match is taken as
+            // the longest match, which saves a full chain search per byte.
+            if (i > 0 && matchLength[i - 1] > OPTIMAL_SKIP_SEARCH_LENGTH) {
+                matchLength[i] = matchLength[i - 1] - 1;
+                matchDistance[i] = matchDistance[i - 1];
+                continue;
             }
-            else {
-                bufferStart[dstPosition++] = (((search.length - 2) << 4) | (lookbackOffset >> 8)) & 0xFF;
-                bufferStart[dstPosition++] = (lookbackOffset >> 0) & 0xFF;
+
+            Window::SearchResult search = window->search(srcPosition);
+            if (search.length < MIN_MATCH_LENGTH) {
+                matchLength[i] = 0;
+                continue;
             }
 
-            srcPosition += search.length;
+            matchLength[i] = static_cast<uint16_t>(std::min<size_t>(search.length, blockSize - i));
+            matchDistance[i] = static_cast<uint16_t>(srcPosition - search.offset);
         }
 
-        opMask >>= 1;
-        if (opMask == 0) {
-            opMask = (1 << 7);
-            opPosition = dstPosition++;
-            bufferStart[opPosition] = 0x00;
+        cost[blockSize] = 0;
+
+        for (size_t i = blockSize; i-- > 0;) {
+            uint32_t bestCost = LITERAL_COST + cost[i + 1];
+            size_t bestLength = 1;
+
+            // Any prefix of the longest match is a valid match too. Ties go to
+            // the longer operation.
+            const size_t longestMatch = matchLength[i];
+            if (longestMatch >= MIN_MATCH_LENGTH) {
+                const size_t shortEnd = std::min(longestMatch, LONG_MATCH_LENGTH - 1);
+                for (size_t length = MIN_MATCH_LENGTH; length <= shortEnd; length++) {
+                    const uint32_t matchCost = cost[i + length] + SHORT_MATCH_COST;
+                    if (matchCost <= bestCost) {
+                        bestCost = matchCost;
+                        bestLength = length;
+                    }
+                }
+            }
+            if (longestMatch >= LONG_MATCH_LENGTH) {
+                // All long matches cost the same, so only the cheapest remainder
+                // matters; find its value first, then the longest length with it.
+                uint32_t minRemainCost = cost[i + LONG_MATCH_LENGTH];
+                for (size_t length = LONG_MATCH_LENGTH + 1; length <= longestMatch; length++) {
+                    minRemainCost = std::min(minRemainCost, cost[i + length]);
+                }
+
+                if ((minRemainCost + LONG_MATCH_COST) <= bestCost) {
+                    bestCost = minRemainCost + LONG_MATCH_COST;
+
+                    bestLength = longestMatch;
+                    while (cost[i + bestLength] != minRemainCost) {
+                        bestLength--;
+                    }
+                }
+            }
+
+            cost[i] = bestCost;
+            matchLength[i] = static_cast<uint16_t>(bestLength);
+        }
+
+        for (size_t i = 0; i < blockSize; i += matchLength[i]) {
+            if (matchLength[i] == 1)
+                writer.literal(dataStart[blockStart + i]);
+            else
+                writer.match(matchDistance[i], matchLength[i]);
         }
     }
+}
+
+template <typename Sink>
+static void compressRange(
+    const unsigned char* dataStart, const size_t srcStart, const size_t srcEnd,
+    const CompressParams& params, Sink& sink
+) {
+    switch (params.strategy) {
+    case CompressStrategy::Store:
+        compressStore(dataStart, srcStart, srcEnd, sink);
+        break;
+    case CompressStrategy::Greedy:
+        compressGreedy(dataStart, srcStart, srcEnd, params, sink);
+        break;
+    case CompressStrategy::Lazy:
+        compressLazy(dataStart, srcStart, srcEnd, params, sink);
+        break;
+    case CompressStrategy::Optimal:
+        compressOptimal(dataStart, srcStart, srcEnd, params, sink);
+        break;
+    }
+}
+
+// Amount of segments worth parsing in parallel.
+static unsigned getWorkerCount(const size_t segmentCount) {
+    return static_cast<unsigned>(std::min<size_t>(ParallelUtil::getThreadCount(), segmentCount));
+}
 
-    delete window;
+size_t compressImpl(
+    const unsigned char* dataStart, const size_t dataSize,
+    unsigned char* bufferStart,
+    const CompressParams& params
+) {
+    Writer writer (bufferStart);
+
+    const size_t segmentCount = (dataSize + PARALLEL_SEGMENT_SIZE - 1) / PARALLEL_SEGMENT_SIZE;
+    const unsigned numThreads = getWorkerCount(segmentCount);
+
+    if (params.strategy == CompressStrategy::Store || numThreads <= 1) {
+        compressRange(dataStart, 0, dataSize, params, writer);
+        return writer.getPosition();
+    }
+
+    // Back-references only reach 0x1000 bytes back, so the data is cut into
+    // segments that are parsed in parallel with the preceding 0x1000 bytes as
+    // history. The operations are then packed in order into one stream.
+
+    std::vector<OpBuffer> segmentOps(segmentCount);
+
+    ParallelUtil::parallelFor(segmentCount, 1, [&](size_t begin, size_t end) {
+        for (size_t segment = begin; segment < end; segment++) {
+            const size_t srcStart = segment * PARALLEL_SEGMENT_SIZE;
+            const size_t srcEnd = std::min(srcStart + PARALLEL_SEGMENT_SIZE, dataSize);
+
+            compressRange(dataStart, srcStart, srcEnd, params, segmentOps[segment]);
+        }
+    });
+
+    for (const auto& ops : segmentOps)
+        ops.replay(writer);
+
+    return writer.getPosition();
+}
+
+bool compressStreamImpl(
+    const std::function<const unsigned char*(size_t offset, size_t size, unsigned char* scratch)>& gather,
+    const size_t dataSize,
+    const unsigned char* header,
+    const CompressParams& params,
+    const std::function<bool(const unsigned char* data, size_t dataSize)>& sink
+) {
+    const size_t segmentCount = (dataSize + PARALLEL_SEGMENT_SIZE - 1) / PARALLEL_SEGMENT_SIZE;
+    const unsigned numThreads = (params.strategy == CompressStrategy::Store) ?
+        1 : getWorkerCount(segmentCount);
+
+    // Room for one segment; an unfinished op group (op byte + up to seven
+    // operations) can be left over from the previous one.
+    std::vector<unsigned char> output(maxCompressedSize(PARALLEL_SEGMENT_SIZE) + 1 + (7 * 3));
+    std::memcpy(output.data(), header, HEADER_SIZE);
+
+    Writer writer (output.data());
+
+    auto flush = [&writer, &output, &sink]() {
+        const size_t finalPosition = writer.getFinalPosition();
+        if (!sink(output.data(), finalPosition))
+            return false;
+
+        writer.discardBefore(finalPosition);
+        return true;
+    };
+
+    // Every segment is gathered along with the 0x1000 bytes of history before
+    // it, same as the segments of compressImpl.
+    std::vector<std::vector<unsigned char>> scratch(numThreads);
+    for (auto& buffer : scratch)
+        buffer.resize(Window::WINDOW_SIZE + PARALLEL_SEGMENT_SIZE);
+
+    auto compressSegment = [&](size_t segment, unsigned slot, auto& segmentSink) {
+        const size_t srcStart = segment * PARALLEL_SEGMENT_SIZE;
+        const size_t srcEnd = std::min(srcStart + PARALLEL_SEGMENT_SIZE, dataSize);
+
+        const size_t historySize = std::min(srcStart, Window::WINDOW_SIZE);
+
+        const unsigned char* segmentData = gather(
+            srcStart - historySize, historySize + (srcEnd - srcStart),
+            scratch[slot].data()
+        );
+
+        compressRange(
+            segmentData, historySize, historySize + (srcEnd - srcStart),
+            params, segmentSink
+        );
+    };
+
+    if (numThreads <= 1) {
+        for (size_t segment = 0; segment < segmentCount; segment++) {
+            compressSegment(segment, 0, writer);
+            if (!flush())
+                return false;
+        }
+    }
+    else {
+        // Segments are done in batches so that only a bounded amount of parsed
+        // operations is held at once.
+        std::vector<OpBuffer> segmentOps(numThreads);
+
+        for (size_t batchStart = 0; batchStart < segmentCount; batchStart += numThreads) {
+            const unsigned batchSize = std::min<size_t>(numThreads, segmentCount - batchStart);
+
+            ParallelUtil::parallelFor(batchSize, 1, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    segmentOps[i].clear();
+                    compressSegment(batchStart + i, i, segmentOps[i]);
+                }
+            });
+
+            for (unsigned i = 0; i < batchSize; i++) {
+                segmentOps[i].replay(writer);
+                if (!flush())
+                    return false;
+            }
+        }
+    }
 
-    return dstPosition;
+    // The last op group is complete now.
+    return sink(output.data(), writer.getPosition());
 }
 
 } // namespace detail
@@ -12,18 +12,54 @@
 
 #include <cstddef>
 
+#include <functional>
+
 namespace Yaz0 {
 
 namespace detail {
 
+enum class CompressStrategy {
+    // Every byte is stored as a literal.
+    Store,
+    // Take the first usable match; short hash chains.
+    Greedy,
+    // Defer a match by one byte if the next position has a longer one.
+    Lazy,
+    // Minimum-cost parse over the longest match at every position.
+    Optimal
+};
+
+struct CompressParams {
+    CompressStrategy strategy;
+
+    // Maximum amount of hash chain entries visited per search.
+    size_t maxChainLength;
+    // Stop searching once a match of at least this length is found.
+    size_t niceLength;
+};
+
+// Compression levels follow zlib (0 .. 9); out of range levels are clamped.
+CompressParams getCompressParams(int compressionLevel);
+
 size_t maxCompressedSize(const size_t dataSize);
 size_t compressImpl(
     const unsigned char* dataStart, const size_t dataSize,
-    unsigned char* bufferStart
+    unsigned char* bufferStart,
+    const CompressParams& params
+);
+
+// Compress data that is gathered in pieces, handing the output (starting with
+// header) to sink as each segment is done.
+bool compressStreamImpl(
+    const std::function<const unsigned char*(size_t offset, size_t size, unsigned char* scratch)>& gather,
+    const size_t dataSize,
+    const unsigned char* header,
+    const CompressParams& params,
+    const std::function<bool(const unsigned char* data, size_t dataSize)>& sink
 );
 
 } // namespace detail
 
 } // namespace Yaz0
 
-#endif // YAZ0_WINDOW_HPP
+#endif // YAZ0_COMPRESS_HPP
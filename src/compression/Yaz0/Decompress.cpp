@@ -0,0 +1,167 @@
+#include "Decompress.hpp"
+
+#include <cstring>
+
+#include "Logging.hpp"
+
+#include "Macro.hpp"
+
+namespace Yaz0 {
+
+namespace detail {
+
+constexpr size_t MAX_RUN_LENGTH = 0xFF + 0x12;
+
+// Runs are copied in chunks of up to this size, writing at most
+// (RUN_COPY_CHUNK - 1) bytes past the end of the run.
+constexpr size_t RUN_COPY_CHUNK = 16;
+
+// The fast path is taken while the input holds a whole operation (op byte +
+// three bytes) and the output has room for the longest run plus the overrun
+// of the chunked copy, so no bounds checks are needed per byte.
+constexpr size_t FAST_SRC_MARGIN = 1 + 3;
+constexpr size_t FAST_DST_MARGIN = MAX_RUN_LENGTH + RUN_COPY_CHUNK;
+
+static inline void copyRunFast(unsigned char* dst, size_t distance, size_t length) {
+    const unsigned char* src = dst - distance;
+
+    // Chunks never read bytes they (or a later chunk) write as long as the
+    // distance is at least the chunk size.
+    if (distance >= 16) {
+        for (size_t i = 0; i < length; i += 16)
+            std::memcpy(dst + i, src + i, 16);
+    }
+    else if (distance >= 8) {
+        for (size_t i = 0; i < length; i += 8)
+            std::memcpy(dst + i, src + i, 8);
+    }
+    else {
+        // Expand the pattern byte by byte first; after that it can be copied in
+        // chunks from the closest multiple of the distance that is at least 8
+        // bytes back.
+        for (size_t i = 0; i < 8; i++)
+            dst[i] = src[i];
+
+        const size_t step = distance * ((8 + distance - 1) / distance);
+        for (size_t i = 8; i < length; i += 8)
+            std::memcpy(dst + i, dst + i - step, 8);
+    }
+}
+
+bool decodeImpl(
+    DecodeState& state,
+    const unsigned char* src, const size_t srcSize,
+    size_t& srcConsumed
+) {
+    const unsigned char* srcByte = src;
+    const unsigned char* srcEnd = src + srcSize;
+
+    unsigned char* dstStart = state.dstStart;
+    unsigned char* dstByte = dstStart + state.dstPosition;
+    unsigned char* dstEnd = dstStart + state.dstSize;
+
+    uint8_t opByte = state.opByte;
+    uint8_t opMask = state.opMask;
+
+    bool ok = true;
+
+    // Fast path.
+    while (
+        LIKELY(static_cast<size_t>(srcEnd - srcByte) >= FAST_SRC_MARGIN) &&
+        LIKELY(static_cast<size_t>(dstEnd - dstByte) >= FAST_DST_MARGIN)
+    ) {
+        // No more operation bits left; refresh.
+        if (opMask == 0) {
+            opByte = *(srcByte++);
+            opMask = (1 << 7);
+        }
+
+        // Copy one byte.
+        if (opByte & opMask) {
+            *(dstByte++) = *(srcByte++);
+        }
+        // Run-length data.
+        else {
+            const unsigned distToDest = (srcByte[0] << 8) | srcByte[1];
+            srcByte += 2;
+
+            const size_t distance = (distToDest & 0xFFF) + 1;
+            const size_t runLen = ((distToDest >> 12) == 0) ?
+                (*(srcByte++) + 0x12) : ((distToDest >> 12) + 2);
+
+            if (UNLIKELY(distance > static_cast<size_t>(dstByte - dstStart))) {
+                Logging::error("[Yaz0::detail::decodeImpl] Invalid Yaz0 binary: run source is out of bounds!");
+                ok = false;
+                break;
+            }
+
+            copyRunFast(dstByte, distance, runLen);
+            dstByte += runLen;
+        }
+
+        opMask >>= 1;
+    }
+
+    // Safe path for the tail of the input or output.
+    while (ok && dstByte < dstEnd) {
+        if (opMask == 0) {
+            if (srcByte >= srcEnd)
+                break;
+
+            opByte = *(srcByte++);
+            opMask = (1 << 7);
+        }
+
+        if (opByte & opMask) {
+            if (srcByte >= srcEnd)
+                break;
+
+            *(dstByte++) = *(srcByte++);
+        }
+        else {
+            if ((srcEnd - srcByte) < 2)
+                break;
+
+            const unsigned distToDest = (srcByte[0] << 8) | srcByte[1];
+            if ((distToDest >> 12) == 0 && (srcEnd - srcByte) < 3)
+                break;
+
+            srcByte += 2;
+
+            const size_t distance = (distToDest & 0xFFF) + 1;
+            const size_t runLen = ((distToDest >> 12) == 0) ?
+                (*(srcByte++) + 0x12) : ((distToDest >> 12) + 2);
+
+            if (UNLIKELY(distance > static_cast<size_t>(dstByte - dstStart))) {
+                Logging::error("[Yaz0::detail::decodeImpl] Invalid Yaz0 binary: run source is out of bounds!");
+                ok = false;
+                break;
+            }
+            if (UNLIKELY(runLen > static_cast<size_t>(dstEnd - dstByte))) {
+                Logging::error("[Yaz0::detail::decodeImpl] Invalid Yaz0 binary: run length is out of bounds!");
+                ok = false;
+                break;
+            }
+
+            const unsigned char* runSrc = dstByte - distance;
+            for (size_t i = 0; i < runLen; i++)
+                dstByte[i] = runSrc[i];
+
+            dstByte += runLen;
+        }
+
+        opMask >>= 1;
+    }
+
+    state.dstPosition = dstByte - dstStart;
+    state.opByte = opByte;
+    state.opMask = opMask;
+
+    srcConsumed = srcByte - src;
+
+    return ok;
+}
+
+} // namespace detail
+
+} // namespace Yaz0
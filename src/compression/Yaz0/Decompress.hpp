@@ -0,0 +1,38 @@
+#ifndef YAZ0_DECOMPRESS_HPP
+#define YAZ0_DECOMPRESS_HPP
+
+#include <cstdint>
+
+#include <cstddef>
+
+namespace Yaz0 {
+
+namespace detail {
+
+struct DecodeState {
+    unsigned char* dstStart { nullptr };
+    size_t dstSize { 0 };
+
+    // Amount of bytes decoded so far.
+    size_t dstPosition { 0 };
+
+    uint8_t opByte { 0 };
+    uint8_t opMask { 0 };
+};
+
+// Decode as many whole operations from src as possible. The amount of bytes
+// used is written to srcConsumed; the rest must be passed again (with more data
+// following it) on the next call.
+//
+// Returns: false if the data is invalid, true otherwise.
+bool decodeImpl(
+    DecodeState& state,
+    const unsigned char* src, const size_t srcSize,
+    size_t& srcConsumed
+);
+
+} // namespace detail
+
+} // namespace Yaz0
+
+#endif // YAZ0_DECOMPRESS_HPP
@@ -19,39 +19,43 @@ namespace Yaz0 {
 
 namespace detail {
 
-Window::Window(const unsigned char* data, const size_t dataSize) :
+Window::Window(
+    const unsigned char* data, const size_t dataSize,
+    const size_t maxChainLength, const size_t niceLength
+) :
     mData(data), mDataSize(dataSize),
+    mMaxChainLength(std::max<size_t>(maxChainLength, 1)),
+    mNiceLength(std::clamp(niceLength, MIN_MATCH_LENGTH, MAX_MATCH_LENGTH)),
     mPosition(0)
 {
-    size_t hash = 0;
-    for (size_t i = 0; i < std::min(MIN_MATCH_LENGTH - 1, dataSize); i++) {
-        hash = updateHash(hash, data[i]);
-    }
-
-    mHashStart = hash;
-    mHashEnd = hash;
-
     std::fill(mHashHead, mHashHead + HASH_SIZE, HASH_NULL);
-    std::fill(mHashTail, mHashTail + HASH_SIZE, HASH_NULL);
-    std::fill(mHashNext, mHashNext + WINDOW_SIZE, HASH_NULL);
+    std::fill(mHashPrev, mHashPrev + WINDOW_SIZE, HASH_NULL);
 }
 
 static inline size_t commonPrefixLength(
-    const unsigned char* a, size_t aLen,
-    const unsigned char* b, size_t bLen,
-    size_t maxLen
+    const unsigned char* a, const unsigned char* b, size_t maxLen
 ) {
-    size_t limit = aLen < bLen ? aLen : bLen;
-    if (maxLen < limit) {
-        limit = maxLen;
+    size_t i = 0;
+
+    // Compare eight bytes at a time; the first differing byte is found through
+    // the lowest set bit of the XOR (little-endian).
+    for (; i + sizeof(uint64_t) <= maxLen; i += sizeof(uint64_t)) {
+        uint64_t wordA, wordB;
+        std::memcpy(&wordA, a + i, sizeof(uint64_t));
+        std::memcpy(&wordB, b + i, sizeof(uint64_t));
+
+        const uint64_t diff = wordA ^ wordB;
+        if (diff != 0) {
+            return i + (__builtin_ctzll(diff) / 8);
+        }
     }
 
-    for (size_t i = 0; i < limit; i++) {
+    for (; i < maxLen; i++) {
         if (a[i] != b[i]) {
             return i;
         }
     }
-    return limit;
+    return maxLen;
 }
 
 Window::SearchResult Window::search(size_t searchPosition) {
@@ -72,36 +76,44 @@ Window::SearchResult Window::search(size_t searchPosition) {
 
     catchUpTo(searchPosition);
 
-    size_t hash = updateHash(mHashEnd, mData[mPosition + MIN_MATCH_LENGTH - 1]);
+    const size_t niceLength = std::min(mNiceLength, maxMatch);
+
+    const unsigned char* searchData = mData + searchPosition;
 
-    size_t position = mHashHead[hash];
     size_t bestLength = MIN_MATCH_LENGTH - 1;
     size_t bestOffset = 0;
 
-    while (position != HASH_NULL) {
-        size_t matchOffset = searchPosition - 1 - ((searchPosition - (position + 1)) & WINDOW_MASK);
-    
+    // Walk the chain from the most recent position backwards, so that a limited
+    // chain length still finds the closest candidates.
+    uint32_t position = mHashHead[hashAt(searchPosition)];
+    size_t chainLeft = mMaxChainLength;
+
+    while (position != HASH_NULL && chainLeft-- > 0) {
+        if (searchPosition - position > WINDOW_SIZE)
+            break;
+
+        const unsigned char* matchData = mData + position;
+
         if (
-            (mData[searchPosition + 0] == mData[matchOffset + 0]) &&
-            (mData[searchPosition + 1] == mData[matchOffset + 1]) &&
-            (mData[searchPosition + bestLength] == mData[matchOffset + bestLength])
+            (matchData[bestLength] == searchData[bestLength]) &&
+            (matchData[0] == searchData[0]) &&
+            (matchData[1] == searchData[1])
         ) {
-            size_t candidateLength = MIN_MATCH_LENGTH + commonPrefixLength(
-                mData + searchPosition + MIN_MATCH_LENGTH, mDataSize - (searchPosition + MIN_MATCH_LENGTH),
-                mData + matchOffset + MIN_MATCH_LENGTH, mDataSize - (matchOffset + MIN_MATCH_LENGTH),
-                MAX_MATCH_LENGTH - MIN_MATCH_LENGTH
-            );
-
+            size_t candidateLength = commonPrefixLength(searchData, matchData, maxMatch);
             if (candidateLength > bestLength) {
                 bestLength = candidateLength;
-                bestOffset = matchOffset;
+                bestOffset = position;
 
-                if (bestLength == maxMatch)
+                if (bestLength >= niceLength)
                     break;
             }
         }
 
-        position = mHashNext[position];
+        position = mHashPrev[position & WINDOW_MASK];
+    }
+
+    if (bestLength < MIN_MATCH_LENGTH) {
+        return Window::SearchResult();
     }
 
     return SearchResult(
@@ -109,46 +121,25 @@ Window::SearchResult Window::search(size_t searchPosition) {
     );
 }
 
-void Window::catchUpTo(size_t newPosition) {
+void Window::seek(size_t position) {
 #if !defined(NDEBUG)
-    newPosition = std::min(newPosition, mDataSize);
+    if (position < mPosition) {
+        throw std::runtime_error("Yaz0::Window::seek: moved backwards!");
+    }
 #endif // !defined(NDEBUG)
 
-    while (mPosition < newPosition) {
-        size_t pos = mPosition & WINDOW_MASK;
-
-        if (mPosition >= WINDOW_SIZE) {
-            if ((mPosition - WINDOW_SIZE + MIN_MATCH_LENGTH - 1) < mDataSize) {
-                mHashStart = updateHash(
-                    mHashStart,
-                    mData[mPosition - WINDOW_SIZE + MIN_MATCH_LENGTH - 1]
-                );
-
-                uint16_t head = mHashHead[mHashStart];
-                if (head != HASH_NULL) {
-                    uint16_t next = mHashNext[head];
-                    mHashHead[mHashStart] = next;
-                    if (next == HASH_NULL) {
-                        mHashTail[mHashStart] = HASH_NULL;
-                    }
-                }
-            }
-        }
-
-        if ((mPosition + MIN_MATCH_LENGTH - 1) < mDataSize) {
-            mHashEnd = updateHash(mHashEnd, mData[mPosition + MIN_MATCH_LENGTH - 1]);
+    mPosition = position - std::min(position, WINDOW_SIZE);
+}
 
-            uint16_t tail = mHashTail[mHashEnd];
+void Window::catchUpTo(size_t newPosition) {
+    newPosition = std::min(newPosition, mDataSize);
 
-            mHashNext[pos] = HASH_NULL;
-            mHashTail[mHashEnd] = static_cast<uint16_t>(pos);
+    while (mPosition < newPosition) {
+        if ((mPosition + MIN_MATCH_LENGTH) <= mDataSize) {
+            const size_t hash = hashAt(mPosition);
 
-            if (tail == HASH_NULL) {
-                mHashHead[mHashEnd] = static_cast<uint16_t>(pos);
-            }
-            else {
-                mHashNext[tail] = static_cast<uint16_t>(pos);
-            }
+            mHashPrev[mPosition & WINDOW_MASK] = mHashHead[hash];
+            mHashHead[hash] = static_cast<uint32_t>(mPosition);
         }
 
         mPosition++;
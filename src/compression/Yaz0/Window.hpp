@@ -20,7 +20,19 @@ namespace detail {
 
 class Window {
 public:
-    Window(const unsigned char* data, const size_t dataSize);
+    static constexpr size_t MIN_MATCH_LENGTH = 3;
+    static constexpr size_t MAX_MATCH_LENGTH = 0xFF + 0x12;
+
+    static constexpr size_t WINDOW_SIZE = 0x1000;
+    static constexpr size_t WINDOW_MASK = WINDOW_SIZE - 1;
+
+public:
+    // maxChainLength: the maximum amount of hash chain entries visited per search.
+    // niceLength: stop searching as soon as a match of at least this length is found.
+    Window(
+        const unsigned char* data, const size_t dataSize,
+        const size_t maxChainLength = WINDOW_SIZE, const size_t niceLength = MAX_MATCH_LENGTH
+    );
     ~Window() = default;
 
     struct SearchResult {
@@ -35,26 +47,31 @@ public:
         {}
     };
 
+    // Find the longest match for the data at searchPosition. Successive calls must
+    // never move backwards.
     SearchResult search(size_t searchPosition);
 
-private:
-    static constexpr size_t MIN_MATCH_LENGTH = 3;
-    static constexpr size_t MAX_MATCH_LENGTH = 0xFF + 0x12;
+    // Skip ahead to position without hashing everything before it; only the
+    // preceding WINDOW_SIZE bytes are kept as history. Must be called before the
+    // first search.
+    void seek(size_t position);
 
+private:
     static constexpr size_t HASH_BITS = 15;
     static constexpr size_t HASH_SIZE = 1ull << HASH_BITS;
 
     static constexpr size_t HASH_MASK = HASH_SIZE - 1;
     static constexpr size_t HASH_SHIFT = (HASH_BITS + MIN_MATCH_LENGTH - 1) / MIN_MATCH_LENGTH;
-    
-    static constexpr size_t HASH_NULL = 0xFFFF;
 
-    static constexpr size_t WINDOW_SIZE = 0x1000;
-    static constexpr size_t WINDOW_MASK = WINDOW_SIZE - 1;
+    static constexpr uint32_t HASH_NULL = 0xFFFFFFFF;
 
 private:
-    size_t updateHash(size_t hash, unsigned char byte) {
-        return ((hash << HASH_SHIFT) ^ static_cast<size_t>(byte)) & HASH_MASK;
+    size_t hashAt(size_t position) const {
+        return (
+            (static_cast<size_t>(mData[position + 0]) << (HASH_SHIFT * 2)) ^
+            (static_cast<size_t>(mData[position + 1]) << (HASH_SHIFT * 1)) ^
+            (static_cast<size_t>(mData[position + 2]) << (HASH_SHIFT * 0))
+        ) & HASH_MASK;
     }
 
     void catchUpTo(size_t newPosition);
@@ -63,14 +80,15 @@ private:
     const unsigned char* mData;
     size_t mDataSize;
 
-    size_t mPosition;
+    size_t mMaxChainLength;
+    size_t mNiceLength;
 
-    size_t mHashStart;
-    size_t mHashEnd;
+    size_t mPosition;
 
-    uint16_t mHashHead[HASH_SIZE];
-    uint16_t mHashTail[HASH_SIZE];
-    uint16_t mHashNext[WINDOW_SIZE];
+    // Most recent position for every hash.
+    uint32_t mHashHead[HASH_SIZE];
+    // Previous position with the same hash, indexed by (position & WINDOW_MASK).
+    uint32_t mHashPrev[WINDOW_SIZE];
 };
 
 } // namespace detail
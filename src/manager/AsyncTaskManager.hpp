@@ -24,6 +24,8 @@ public:
 
     void update();
 
+    bool hasTasks() const { return !mTasks.empty(); }
+
     template <typename TaskType>
     bool hasTaskOfType() const;
 
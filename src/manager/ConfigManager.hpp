@@ -36,6 +36,7 @@ NLOHMANN_JSON_SERIALIZE_ENUM(ThemeChoice, {
 });
 
 enum class ETC1Quality {
+    Fast, // ETC1FastPacker
     Low,
     Medium,
     High,
@@ -44,11 +45,40 @@ enum class ETC1Quality {
 };
 
 NLOHMANN_JSON_SERIALIZE_ENUM(ETC1Quality, {
+    {ETC1Quality::Fast, "Fast"},
     {ETC1Quality::Low, "Low"},
     {ETC1Quality::Medium, "Medium"},
     {ETC1Quality::High, "High"},
 });
 
+// Fast is meant for quick iteration, High for final saves.
+enum class CMPRQuality {
+    Fast,
+    High,
+
+    Count
+};
+
+NLOHMANN_JSON_SERIALIZE_ENUM(CMPRQuality, {
+    {CMPRQuality::Fast, "Fast"},
+    {CMPRQuality::High, "High"},
+});
+
+// Dithering used when a sheet has more colors than a paletted format holds.
+enum class PaletteDithering {
+    None,
+    Ordered,
+    ErrorDiffusion,
+
+    Count
+};
+
+NLOHMANN_JSON_SERIALIZE_ENUM(PaletteDithering, {
+    {PaletteDithering::None, "None"},
+    {PaletteDithering::Ordered, "Ordered"},
+    {PaletteDithering::ErrorDiffusion, "ErrorDiffusion"},
+});
+
 struct Config {
 public:
     static constexpr unsigned int MAX_RECENTLY_OPENED = 12;
@@ -74,12 +104,23 @@ public:
 
     unsigned updateRate { 120 };
 
+    // Wait for events instead of updating at the update rate while nothing
+    // is happening.
+    bool idleWhenInactive { true };
+
+    // Memory the undo history of a session may use, in MiB.
+    unsigned undoHistoryBudget { 256 };
+
     BackupBehaviour backupBehaviour { BackupBehaviour::Save };
 
     unsigned compressionLevel { 9 };
 
     ETC1Quality etc1Quality { ETC1Quality::Medium };
 
+    CMPRQuality cmprQuality { CMPRQuality::High };
+
+    PaletteDithering paletteDithering { PaletteDithering::ErrorDiffusion };
+
     bool allowNewAnimCreate { false };
 
     bool operator==(const Config& rhs) const {
@@ -92,9 +133,13 @@ public:
             lastWindowHeight == rhs.lastWindowHeight &&
             canvasLMBPanEnabled == rhs.canvasLMBPanEnabled &&
             updateRate == rhs.updateRate &&
+            idleWhenInactive == rhs.idleWhenInactive &&
+            undoHistoryBudget == rhs.undoHistoryBudget &&
             backupBehaviour == rhs.backupBehaviour &&
             compressionLevel == rhs.compressionLevel &&
             etc1Quality == rhs.etc1Quality &&
+            cmprQuality == rhs.cmprQuality &&
+            paletteDithering == rhs.paletteDithering &&
             allowNewAnimCreate == rhs.allowNewAnimCreate;
     }
 
@@ -110,9 +155,13 @@ public:
             { "lastWindowMaximized", _config.lastWindowMaximized },
             { "canvasLMBPanEnabled", _config.canvasLMBPanEnabled },
             { "updateRate", _config.updateRate },
+            { "idleWhenInactive", _config.idleWhenInactive },
+            { "undoHistoryBudget", _config.undoHistoryBudget },
             { "backupBehaviour", _config.backupBehaviour },
             { "compressionLevel", _config.compressionLevel },
             { "etc1Quality", _config.etc1Quality },
+            { "cmprQuality", _config.cmprQuality },
+            { "paletteDithering", _config.paletteDithering },
             { "allowNewAnimCreate", _config.allowNewAnimCreate }
         };
     }
@@ -126,9 +175,13 @@ public:
         _config.lastWindowMaximized = j.value("lastWindowMaximized", _config.lastWindowMaximized);
         _config.canvasLMBPanEnabled = j.value("canvasLMBPanEnabled", _config.canvasLMBPanEnabled);
         _config.updateRate =          j.value("updateRate", _config.updateRate);
+        _config.idleWhenInactive =    j.value("idleWhenInactive", _config.idleWhenInactive);
+        _config.undoHistoryBudget =   j.value("undoHistoryBudget", _config.undoHistoryBudget);
         _config.backupBehaviour =     j.value("backupBehaviour", _config.backupBehaviour);
         _config.compressionLevel =    j.value("compressionLevel", _config.compressionLevel);
         _config.etc1Quality =         j.value("etc1Quality", _config.etc1Quality);
+        _config.cmprQuality =         j.value("cmprQuality", _config.cmprQuality);
+        _config.paletteDithering =    j.value("paletteDithering", _config.paletteDithering);
         _config.allowNewAnimCreate =  j.value("allowNewAnimCreate", _config.allowNewAnimCreate);
     }
 };
@@ -25,6 +25,9 @@ std::future<void> MainThreadTaskManager::queueTask(std::function<void()> func) {
 
     mQueueCondition.notify_one();
 
+    // Wake up the main loop if it's idle.
+    glfwPostEmptyEvent();
+
     return future;
 }
 
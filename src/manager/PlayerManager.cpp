@@ -40,12 +40,12 @@ void PlayerManager::update() {
 
     mTickPrev = tickNow;
 
-    const auto& keys = getCellAnim()->getAnimation(mAnimationIndex).keys;
-    const auto& arrangements = getCellAnim()->getArrangements();
+    const auto& keys = getCellAnim().getAnimation(mAnimationIndex).keys;
+    const auto& arrangements = getCellAnim().getArrangements();
 
     unsigned arrangementIdxBefore = keys.at(mKeyIndex).arrangementIndex;
 
-    const auto& currentAnimation = getCellAnim()->getAnimation(mAnimationIndex);
+    const auto& currentAnimation = getCellAnim().getAnimation(mAnimationIndex);
 
     while (delta >= mTimeLeft) {
         if (mHoldFramesLeft > 1) {
@@ -129,16 +129,23 @@ void PlayerManager::setAnimationIndex(unsigned index) {
     keySelState.validateSelection();
 }
 
-CellAnim::Animation& PlayerManager::getAnimation() const {
+const CellAnim::Animation& PlayerManager::getAnimation() const {
     if (arrangementModeEnabled())
         return arrangementModeAnim;
 
-    return getCellAnim()->getAnimation(mAnimationIndex);
+    return getCellAnim().getAnimation(mAnimationIndex);
+}
+
+CellAnim::Animation& PlayerManager::editAnimation() const {
+    if (arrangementModeEnabled())
+        return arrangementModeAnim;
+
+    return editCellAnim().getAnimation(mAnimationIndex);
 }
 
 void PlayerManager::setKeyIndex(unsigned index) {
     const auto& keys = getAnimation().keys;
-    const auto& arrangements = getCellAnim()->getArrangements();
+    const auto& arrangements = getCellAnim().getArrangements();
 
     if (keys.at(mKeyIndex).arrangementIndex != keys.at(index).arrangementIndex) {
         matchSelectedParts(
@@ -207,11 +214,11 @@ void PlayerManager::setElapsedFrames(size_t frames) {
 
 void PlayerManager::validateState() {
     if (SessionManager::getInstance().getCurrentSessionIndex() >= 0) {
-        unsigned arrangementCount = getCellAnim()->getArrangements().size();
+        unsigned arrangementCount = getCellAnim().getArrangements().size();
         if (getArrangementModeIdx() >= arrangementCount)
             setArrangementModeIdx(arrangementCount - 1);
 
-        unsigned animCount = getCellAnim()->getAnimations().size();
+        unsigned animCount = getCellAnim().getAnimations().size();
         unsigned animIndex = std::min(
             mAnimationIndex,
             animCount - 1
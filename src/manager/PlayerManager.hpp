@@ -33,21 +33,32 @@ public:
     unsigned getAnimationIndex() const { return mAnimationIndex; }
     void setAnimationIndex(unsigned index);
 
-    CellAnim::Animation& getAnimation() const;
+    // The get* accessors are for reading. The edit* ones take the element for
+    // writing, which copies its chunk if it's shared & renews its revision
+    // (see PersistentVector), so only call them to actually write.
+
+    const CellAnim::Animation& getAnimation() const;
+    CellAnim::Animation& editAnimation() const;
 
     unsigned getKeyIndex() const { return mKeyIndex; }
     void setKeyIndex(unsigned index);
 
-    CellAnim::AnimationKey& getKey() const {
+    const CellAnim::AnimationKey& getKey() const {
         return getAnimation().keys.at(mKeyIndex);
     }
+    CellAnim::AnimationKey& editKey() const {
+        return editAnimation().keys.at(mKeyIndex);
+    }
 
     unsigned getArrangementIndex() const {
         return getKey().arrangementIndex;
     }
 
-    CellAnim::Arrangement& getArrangement() const {
-        return getCellAnim()->getArrangement(getArrangementIndex());
+    const CellAnim::Arrangement& getArrangement() const {
+        return getCellAnim().getArrangement(getArrangementIndex());
+    }
+    CellAnim::Arrangement& editArrangement() const {
+        return editCellAnim().getArrangement(getArrangementIndex());
     }
 
     unsigned getKeyCount() const {
@@ -74,8 +85,8 @@ public:
         return static_cast<float>(getTotalFrames()) / getElapsedFrames();
     }
 
-    CellAnim::AnimationKey& getKeyAtFrame(size_t frame) {
-        auto& animation = getCellAnim()->getAnimation(mAnimationIndex);
+    const CellAnim::AnimationKey& getKeyAtFrame(size_t frame) const {
+        const auto& animation = getCellAnim().getAnimation(mAnimationIndex);
 
         size_t i;
         size_t currentFrame = 0;
@@ -103,8 +114,12 @@ public:
     OnionSkinState& getOnionSkinState() { return mOnionSkinState; }
 
 private:
-    const std::shared_ptr<CellAnim::CellAnimObject>& getCellAnim() const {
-        return SessionManager::getInstance().getCurrentSession()
+    const CellAnim::CellAnimObject& getCellAnim() const {
+        return *SessionManager::getInstance().getCurrentSession()
+            ->getCurrentCellAnim().object;
+    }
+    CellAnim::CellAnimObject& editCellAnim() const {
+        return *SessionManager::getInstance().getCurrentSession()
             ->getCurrentCellAnim().object;
     }
 
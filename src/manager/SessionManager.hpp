@@ -55,9 +55,14 @@ public:
 
     // Export a session as a cellanim archive (.szs) to the specified path.
     // Note: if dstFilePath is empty, then the session's resourcePath is used.
+    //       If cellanims is given, those snapshots are written instead of the
+    //       session's cellanims, which can then be edited while exporting.
     //
     // Returns: true if succeeded, false if failed
-    bool exportSession(unsigned sessionIndex, std::string_view dstFilePath = {});
+    bool exportSession(
+        unsigned sessionIndex, std::string_view dstFilePath = {},
+        std::vector<std::shared_ptr<CellAnim::CellAnimObject>> cellanims = {}
+    );
 
     void removeSession(unsigned sessionIndex);
 
@@ -0,0 +1,206 @@
+#include "AsyncTaskExportAnimation.hpp"
+
+#include <cstddef>
+
+#include <cmath>
+
+#include <algorithm>
+
+#include <limits>
+
+#include <utility>
+
+#include <fstream>
+
+#include "cellanim/CellAnimDrawData.hpp"
+#include "cellanim/CellAnimRasterizer.hpp"
+
+#include "texture/APNGHack.hpp"
+
+#include "manager/PromptPopupManager.hpp"
+
+#include "Logging.hpp"
+
+// Largest canvas that is exported, in pixels.
+constexpr size_t MAX_CANVAS_PIXELS = size_t(8192) * 8192;
+
+// Longest a single APNG frame can be held (the delay is 16-bit).
+constexpr unsigned MAX_HOLD_FRAMES = 0xFFFF;
+
+AsyncTaskExportAnimation::AsyncTaskExportAnimation(
+    AsyncTaskId id,
+    Session* session, unsigned animationIndex, unsigned frameRate,
+    std::string filePath
+) :
+    AsyncTask(id, "Exporting animation.."),
+
+    mCellAnim(session->getCurrentCellAnim().object->snapshot()),
+
+    mAnimationIndex(animationIndex), mFrameRate(frameRate),
+    mFilePath(std::move(filePath))
+{
+    auto& sheets = *session->sheets;
+    if (sheets.getTextureCount() == 0)
+        return;
+
+    // The same lookup as TextureGroup::getTextureByVarying: the rasterizer
+    // picks sheet (varying % count), so the sheets start at the base index.
+    const unsigned baseIndex = mCellAnim->getSheetIndex();
+    const unsigned sheetCount = mCellAnim->getUsePalette() ? sheets.getTextureCount() : 1;
+
+    mSheets.resize(sheetCount);
+    for (unsigned i = 0; i < sheetCount; i++) {
+        unsigned revision;
+        mSheets[i].pixels = sheets.getTextureByIndex(baseIndex + i)->getPixels(
+            mSheets[i].width, mSheets[i].height, revision
+        );
+    }
+}
+
+void AsyncTaskExportAnimation::run() {
+    Logging::info("[AsyncTaskExportAnimation::run] Exporting animation to path \"{}\"..", mFilePath);
+
+    if (mAnimationIndex >= mCellAnim->getAnimations().size()) {
+        mErrorMessage = "The animation no longer exists.";
+        return;
+    }
+
+    const CellAnim::Animation& animation = std::as_const(*mCellAnim).getAnimation(mAnimationIndex);
+
+    std::vector<CellAnimRasterizer::Sheet> sheets;
+    sheets.reserve(mSheets.size());
+    for (const auto& sheet : mSheets)
+        sheets.push_back({ sheet.pixels.data(), sheet.width, sheet.height });
+
+    // The canvas fits every key.
+    std::vector<std::vector<CellAnim::PartDrawCommand>> keyCommands (animation.keys.size());
+
+    float minX = std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = std::numeric_limits<float>::lowest();
+
+    for (size_t i = 0; i < animation.keys.size(); i++) {
+        const auto& key = animation.keys[i];
+        if (key.holdFrames == 0)
+            continue;
+
+        CellAnim::makeDrawCommands(
+            keyCommands[i], *mCellAnim, key, -1, 0xFFFFFFFF, true,
+            ImVec2(0.f, 0.f), ImVec2(1.f, 1.f)
+        );
+
+        for (const auto& command : keyCommands[i]) {
+            for (const ImVec2& point : command.quad) {
+                minX = std::min(minX, point.x);
+                minY = std::min(minY, point.y);
+                maxX = std::max(maxX, point.x);
+                maxY = std::max(maxY, point.y);
+            }
+        }
+    }
+
+    if (minX > maxX) {
+        mErrorMessage = "The animation has nothing to draw.";
+        return;
+    }
+
+    minX = std::floor(minX);
+    minY = std::floor(minY);
+
+    const float canvasWidth = std::max(std::ceil(maxX - minX), 1.f);
+    const float canvasHeight = std::max(std::ceil(maxY - minY), 1.f);
+
+    if (static_cast<double>(canvasWidth) * canvasHeight > static_cast<double>(MAX_CANVAS_PIXELS)) {
+        Logging::error(
+            "[AsyncTaskExportAnimation::run] The canvas is too large ({}x{})",
+            canvasWidth, canvasHeight
+        );
+        mErrorMessage = "The animation is too large to export.";
+        return;
+    }
+
+    APNGHack::BuildData buildData {
+        .canvasW = static_cast<unsigned>(canvasWidth),
+        .canvasH = static_cast<unsigned>(canvasHeight),
+        .frameRate = mFrameRate
+    };
+
+    const size_t canvasSize = size_t(buildData.canvasW) * buildData.canvasH * 4;
+
+    // The current & previous frame; only what changed between them is kept.
+    std::vector<unsigned char> canvases[2] {
+        std::vector<unsigned char>(canvasSize), std::vector<unsigned char>(canvasSize)
+    };
+    unsigned currentCanvas = 0;
+
+    const unsigned char* previousCanvas = nullptr;
+
+    for (size_t i = 0; i < animation.keys.size(); i++) {
+        const auto& key = animation.keys[i];
+        if (key.holdFrames == 0)
+            continue;
+
+        auto& commands = keyCommands[i];
+        for (auto& command : commands) {
+            for (ImVec2& point : command.quad) {
+                point.x -= minX;
+                point.y -= minY;
+            }
+        }
+
+        auto& canvas = canvases[currentCanvas];
+
+        std::fill(canvas.begin(), canvas.end(), 0);
+        CellAnimRasterizer::rasterize(
+            canvas.data(), buildData.canvasW, buildData.canvasH,
+            commands, sheets
+        );
+
+        for (unsigned framesLeft = key.holdFrames; framesLeft > 0;) {
+            const unsigned holdFrames = std::min(framesLeft, MAX_HOLD_FRAMES);
+
+            APNGHack::addFrame(buildData, canvas.data(), previousCanvas, holdFrames);
+            previousCanvas = canvas.data();
+
+            framesLeft -= holdFrames;
+        }
+
+        currentCanvas ^= 1;
+    }
+
+    std::vector<unsigned char> data = APNGHack::build(buildData);
+    if (data.empty()) {
+        mErrorMessage = "The animation could not be encoded.";
+        return;
+    }
+
+    std::ofstream file(mFilePath, std::ios::binary);
+    if (!file.is_open()) {
+        Logging::error("[AsyncTaskExportAnimation::run] Could not open output file! Aborting..");
+
+        mErrorMessage =
+            "The output file could not be opened for writing; do you have file creation\n"
+            "and/or writing permissions?";
+        return;
+    }
+
+    file.write(reinterpret_cast<const char*>(data.data()), data.size());
+    file.close();
+
+    Logging::info(
+        "[AsyncTaskExportAnimation::run] Exported {} frames ({} bytes)",
+        buildData.frames.size(), data.size()
+    );
+
+    mResult.store(true);
+}
+
+void AsyncTaskExportAnimation::effect() {
+    if (mResult)
+        return;
+
+    PromptPopupManager::getInstance().queue(PromptPopupManager::createPrompt(
+        "An error occurred while exporting the animation..", mErrorMessage
+    ));
+}
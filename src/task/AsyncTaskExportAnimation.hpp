@@ -0,0 +1,51 @@
+#ifndef ASYNC_TASK_EXPORTANIMATION_HPP
+#define ASYNC_TASK_EXPORTANIMATION_HPP
+
+#include "AsyncTask.hpp"
+
+#include <string>
+
+#include <vector>
+
+#include <memory>
+
+#include "cellanim/CellAnim.hpp"
+
+#include "Session.hpp"
+
+// Render every key of an animation & write them to an animated PNG.
+class AsyncTaskExportAnimation : public AsyncTask {
+public:
+    AsyncTaskExportAnimation(
+        AsyncTaskId id,
+        Session* session, unsigned animationIndex, unsigned frameRate,
+        std::string filePath
+    );
+
+protected:
+    void run() override;
+    void effect() override;
+
+private:
+    struct SheetPixels {
+        std::vector<unsigned char> pixels;
+        unsigned width, height;
+    };
+
+private:
+    // Snapshot of the cellanim & copies of its sheets, taken on the main
+    // thread; the session can be edited while exporting.
+    std::shared_ptr<CellAnim::CellAnimObject> mCellAnim;
+    // In the order texture varyings index them.
+    std::vector<SheetPixels> mSheets;
+
+    unsigned mAnimationIndex;
+    unsigned mFrameRate;
+
+    std::string mFilePath;
+
+    std::string mErrorMessage;
+    std::atomic<bool> mResult { false };
+};
+
+#endif // ASYNC_TASK_EXPORTANIMATION_HPP
@@ -15,7 +15,9 @@ AsyncTaskExportSession::AsyncTaskExportSession(
     mSessionIndex(sessionIndex), mFilePath(std::move(filePath)),
     mUseSessionPath(false),
     mResult(false)
-{}
+{
+    snapshotCellAnims();
+}
 
 AsyncTaskExportSession::AsyncTaskExportSession(
     AsyncTaskId id,
@@ -25,7 +27,20 @@ AsyncTaskExportSession::AsyncTaskExportSession(
 
     mSessionIndex(sessionIndex),
     mUseSessionPath(true)
-{}
+{
+    snapshotCellAnims();
+}
+
+// The task is created on the main thread, which edits the cellanims; the
+// snapshots stay as they are while the session keeps being edited.
+void AsyncTaskExportSession::snapshotCellAnims() {
+    auto& sessions = SessionManager::getInstance().getSessions();
+    if (mSessionIndex >= sessions.size())
+        return;
+
+    for (const auto& cellanim : sessions[mSessionIndex].cellanims)
+        mCellAnims.push_back(cellanim.object->snapshot());
+}
 
 void AsyncTaskExportSession::run() {
     std::string_view dstFilePath = "";
@@ -34,7 +49,7 @@ void AsyncTaskExportSession::run() {
     }
 
     bool exportResult = SessionManager::getInstance().exportSession(
-        mSessionIndex, dstFilePath
+        mSessionIndex, dstFilePath, std::move(mCellAnims)
     );
     mResult.store(exportResult);
 }
@@ -5,6 +5,12 @@
 
 #include <string>
 
+#include <vector>
+
+#include <memory>
+
+#include "cellanim/CellAnim.hpp"
+
 class AsyncTaskExportSession : public AsyncTask {
 public:
     AsyncTaskExportSession(
@@ -20,12 +26,17 @@ protected:
     void run() override;
     void effect() override;
 
+private:
+    void snapshotCellAnims();
+
 private:
     unsigned mSessionIndex;
     std::string mFilePath;
 
     bool mUseSessionPath;
 
+    std::vector<std::shared_ptr<CellAnim::CellAnimObject>> mCellAnims;
+
     std::atomic<bool> mResult;
 };
 
@@ -2,11 +2,19 @@
 
 #include <cstddef>
 
-#include <unordered_set>
+#include <vector>
 
-#include "manager/MainThreadTaskManager.hpp"
+#include <utility>
 
-#include "manager/PlayerManager.hpp"
+#include "cellanim/CellAnimOptimize.hpp"
+
+#include "command/CompositeCommand.hpp"
+#include "command/CommandModifyAnimations.hpp"
+#include "command/CommandModifyArrangements.hpp"
+#include "command/CommandModifySpritesheet.hpp"
+
+#include "manager/SessionManager.hpp"
+#include "manager/PromptPopupManager.hpp"
 
 #include "stb/stb_image_resize2.h"
 
@@ -16,123 +24,29 @@ AsyncTaskOptimizeCellanim::AsyncTaskOptimizeCellanim(
 ) :
     AsyncTask(id, "Optimizing cellanim .."),
 
-    mSession(session), mOptions(options)
-{}
-
-static void removeAnimationNames(Session* session) {
-    auto& animations = session->getCurrentCellAnim().object->getAnimations();
-
-    MainThreadTaskManager::getInstance().queueTask([&animations]() {
-        for (auto& animation : animations)
-            animation.name.clear();
-    }).get();
-}
-
-static void removeUnusedArrangements(Session* session) {
-    std::shared_ptr cellanim = session->getCurrentCellAnim().object;
-
-    std::unordered_set<unsigned> usedIndices;
-    std::vector<unsigned> toErase;
-
-    for (const auto& anim : cellanim->getAnimations()) {
-        for (const auto& key : anim.keys)
-            usedIndices.insert(key.arrangementIndex);
-    }
-
-    for (size_t i = 0; i < cellanim->getArrangements().size(); i++) {
-        if (usedIndices.find(i) == usedIndices.end())
-            toErase.push_back(i);
-    }
-
-    auto& animations = cellanim->getAnimations();
-    auto& arrangements = cellanim->getArrangements();
-
-    MainThreadTaskManager::getInstance().queueTask(
-    [&arrangements, &toErase, &animations]() {
-        for (size_t i = 0; i < toErase.size(); i++) {
-            unsigned index = toErase.at(i);
-
-            auto it = arrangements.begin() + index;
-            arrangements.erase(it);
-
-            for (size_t j = i; j < toErase.size(); j++) {
-                if (toErase.at(j) > index)
-                    toErase.at(j)--;
-            }
-
-            for (auto& animation : animations) {
-                for (auto& key : animation.keys) {
-                    if (key.arrangementIndex > index)
-                        key.arrangementIndex--;
-                }
-            }
-        }
-
-        PlayerManager::getInstance().validateState();
-    }).get();
-}
-
-static void removeDuplicateArrangements(Session* session) {
-    std::shared_ptr cellanim = session->getCurrentCellAnim().object;
+    mSession(session), mOptions(options),
 
-    auto& arrangements = cellanim->getArrangements();
-    auto& animations = cellanim->getAnimations();
+    // The cellanim is read while drawing, so the task works on a snapshot; the
+    // result is pushed as a command once done.
+    mCellAnimIndex(session->getCurrentCellAnimIndex()),
+    mOriginalCellAnim(session->getCurrentCellAnim().object->snapshot()),
+    mCellAnim(mOriginalCellAnim->snapshot()),
 
-    // map from original index to the deduplicated index
-    std::unordered_map<unsigned, unsigned> remap;
-    std::vector<unsigned> toErase;
-
-    for (size_t i = 0; i < arrangements.size(); ++i) {
-        if (remap.find(i) != remap.end())
-            continue;
-
-        for (size_t j = i + 1; j < arrangements.size(); ++j) {
-            if (arrangements[i] == arrangements[j]) {
-                remap[j] = i;
-                toErase.push_back(j);
-            }
-        }
-    }
-
-    std::sort(toErase.begin(), toErase.end());
-    toErase.erase(std::unique(toErase.begin(), toErase.end()), toErase.end());
-
-    MainThreadTaskManager::getInstance().queueTask(
-    [&arrangements, &animations, toErase, remap]() mutable {
-        for (auto& animation : animations) {
-            for (auto& key : animation.keys) {
-                auto it = remap.find(key.arrangementIndex);
-                if (it != remap.end()) {
-                    key.arrangementIndex = it->second;
-                }
-            }
-        }
-
-        for (auto it = toErase.rbegin(); it != toErase.rend(); ++it) {
-            arrangements.erase(arrangements.begin() + *it);
-
-            for (auto& [from, to] : remap) {
-                if (from > *it) remap[from]--;
-                if (to > *it) remap[from] = --remap[from];
-            }
-
-            for (auto& animation : animations) {
-                for (auto& key : animation.keys) {
-                    if (key.arrangementIndex > *it)
-                        key.arrangementIndex--;
-                }
-            }
-        }
-
-        PlayerManager::getInstance().validateState();
-    }).get();
-}
+    mSheetIndex(session->getCurrentCellAnim().object->getSheetIndex()),
+    mSheet(session->getCurrentCellAnimSheet())
+{}
 
-static void downscaleSpritesheet(Session* session, const OptimizeCellanimOptions& options) {
-    std::shared_ptr sheet = session->getCurrentCellAnimSheet();
+// Make a downscaled copy of the sheet; the sheet itself is left as-is.
+static std::shared_ptr<TextureEx> downscaleSpritesheet(
+    const TextureEx& sheet, const OptimizeCellanimOptions& options,
+    unsigned& revision
+) {
+    unsigned width, height;
+    // RGBA image
+    std::vector<unsigned char> originalPixels = sheet.getPixels(width, height, revision);
 
-    unsigned newWidth = sheet->getWidth();
-    unsigned newHeight = sheet->getHeight();
+    unsigned newWidth = width;
+    unsigned newHeight = height;
 
     switch (options.downscaleSpritesheet) {
     case OptimizeCellanimOptions::DownscaleOption_0_875x:
@@ -156,48 +70,94 @@ static void downscaleSpritesheet(Session* session, const OptimizeCellanimOptions
     if (newHeight & 1) newHeight++;
 
     // RGBA image
-    unsigned char* originalPixels = new unsigned char[sheet->getWidth() * sheet->getHeight() * 4];
-
-    MainThreadTaskManager::getInstance().queueTask([&sheet, originalPixels]() {
-        glBindTexture(GL_TEXTURE_2D, sheet->getTextureId());
-        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, originalPixels);
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }).get();
-
-    // RGBA image
-    unsigned char* downscaledPixels = new unsigned char[sheet->getWidth() * sheet->getHeight() * 4];
+    std::vector<unsigned char> downscaledPixels(newWidth * newHeight * 4);
 
     stbir_resize_uint8_linear(
-        originalPixels, sheet->getWidth(), sheet->getHeight(),
-        sheet->getWidth() * 4,
-        downscaledPixels, newWidth, newHeight,
+        originalPixels.data(), width, height,
+        width * 4,
+        downscaledPixels.data(), newWidth, newHeight,
         newWidth * 4,
         STBIR_RGBA
     );
 
-    delete[] originalPixels;
-
-    sheet->loadRGBA32(downscaledPixels, newWidth, newHeight);
-
-    delete[] downscaledPixels;
+    return std::make_shared<TextureEx>(newWidth, newHeight, std::move(downscaledPixels));
 }
 
 void AsyncTaskOptimizeCellanim::run() {
     if (mOptions.removeAnimationNames)
-        removeAnimationNames(mSession);
+        CellAnim::removeAnimationNames(*mCellAnim);
 
     if (mOptions.removeUnusedArrangements)
-        removeUnusedArrangements(mSession);
+        CellAnim::removeUnusedArrangements(*mCellAnim);
 
     if (mOptions.removeDuplicateArrangements)
-        removeDuplicateArrangements(mSession);
+        CellAnim::removeDuplicateArrangements(*mCellAnim);
 
     if (mOptions.downscaleSpritesheet)
-        downscaleSpritesheet(mSession, mOptions);
+        mDownscaledSheet = downscaleSpritesheet(*mSheet, mOptions, mSheetRevision);
+}
+
+bool AsyncTaskOptimizeCellanim::wasEditedMeanwhile() const {
+    // Checked first; mSession is only valid if it's still open.
+    if (SessionManager::getInstance().getCurrentSession() != mSession)
+        return true;
+    if (mSession->getCurrentCellAnimIndex() != mCellAnimIndex)
+        return true;
+
+    const CellAnim::CellAnimObject& cellanim = *mSession->getCurrentCellAnim().object;
+
+    if (
+        !cellanim.getArrangements().sameRevisions(mOriginalCellAnim->getArrangements()) ||
+        !cellanim.getAnimations().sameRevisions(mOriginalCellAnim->getAnimations())
+    )
+        return true;
+
+    if (mDownscaledSheet) {
+        if (
+            cellanim.getSheetIndex() != static_cast<int>(mSheetIndex) ||
+            mSession->sheets->getTextureByIndex(mSheetIndex) != mSheet ||
+            mSheet->getRevision() != mSheetRevision
+        )
+            return true;
+    }
+
+    return false;
 }
 
 void AsyncTaskOptimizeCellanim::effect() {
-    // TODO: make this whole thing undo-able
-    mSession->clearUndoRedo();
-    //SessionManager::getInstance().SessionChanged();
+    // The result is made from the cellanim as it was when the task started;
+    // applying it over edits made since would revert them.
+    if (wasEditedMeanwhile()) {
+        PromptPopupManager::getInstance().queue(PromptPopupManager::createPrompt(
+            "The cellanim was edited while it was being optimized..",
+            "Nothing was changed; optimize the cellanim again to apply the optimizations."
+        ));
+        return;
+    }
+
+    auto composite = std::make_shared<CompositeCommand>();
+
+    // The animations go first, so that they never refer to arrangements that
+    // are gone (undoing restores the arrangements first).
+    composite->addCommand(std::make_shared<CommandModifyAnimations>(
+        mCellAnimIndex, std::as_const(*mCellAnim).getAnimations()
+    ));
+    composite->addCommand(std::make_shared<CommandModifyArrangements>(
+        mCellAnimIndex, std::as_const(*mCellAnim).getArrangements()
+    ));
+
+    if (mDownscaledSheet) {
+        // The output settings aren't touched by the worker; copied here.
+        mDownscaledSheet->setName(mSheet->getName());
+        mDownscaledSheet->setOutputMipCount(mSheet->getOutputMipCount());
+        mDownscaledSheet->setTPLOutputFormat(mSheet->getTPLOutputFormat());
+        mDownscaledSheet->setCTPKOutputFormat(mSheet->getCTPKOutputFormat());
+
+        // The cells stay in the cellanim's sheet space, which is kept.
+        composite->addCommand(std::make_shared<CommandModifySpritesheet>(
+            mSheetIndex, mDownscaledSheet, true
+        ));
+    }
+
+    mSession->addCommand(composite);
 }
@@ -3,6 +3,8 @@
 
 #include "AsyncTask.hpp"
 
+#include <memory>
+
 #include "glInclude.hpp"
 
 #include "Session.hpp"
@@ -32,8 +34,25 @@ protected:
     void effect() override;
 
 private:
+    // Whether the cellanim or its sheet changed since the task started.
+    bool wasEditedMeanwhile() const;
+
     Session* mSession;
     OptimizeCellanimOptions mOptions;
+
+    unsigned mCellAnimIndex;
+
+    // The cellanim as it was when the task started (to tell if it was edited
+    // while the task ran) & the copy the task works on.
+    std::shared_ptr<CellAnim::CellAnimObject> mOriginalCellAnim;
+    std::shared_ptr<CellAnim::CellAnimObject> mCellAnim;
+
+    unsigned mSheetIndex;
+    std::shared_ptr<TextureEx> mSheet;
+
+    // Made from the revision mSheetRevision of mSheet; null if not downscaled.
+    std::shared_ptr<TextureEx> mDownscaledSheet;
+    unsigned mSheetRevision { 0 };
 };
 
 #endif // ASYNC_TASK_OPTIMIZECELLANIM_HPP
@@ -0,0 +1,304 @@
+// toast-test-darch-serialize
+// Checks that DARCHObject::serialize gives the same bytes as the serializer it
+// replaced (kept here as the reference) on generated archives, & that parsing
+// the output back & serializing it again gives the same bytes.
+
+#include <cstdint>
+#include <cstring>
+
+#include <iostream>
+
+#include <string>
+
+#include <vector>
+#include <stack>
+#include <list>
+
+#include <random>
+
+#include <utility>
+
+#include "archive/DARCH.hpp"
+
+#include "Macro.hpp"
+
+namespace Reference {
+
+constexpr uint32_t DARCH_MAGIC = IDENTIFIER_TO_U32('U',0xAAu,'8','-');
+
+struct DARCHHeader {
+    uint32_t magic { DARCH_MAGIC };
+
+    int32_t nodeSectionStart;
+    int32_t nodeSectionSize;
+
+    int32_t dataSectionStart;
+
+    int32_t _reserved[4] { 0x00000000, 0x00000000, 0x00000000, 0x00000000 };
+} __attribute__((packed));
+
+struct DARCHNode {
+private:
+    uint32_t isDirAndNameOffset;
+
+public:
+    void setIsDirectory(bool _isDir) {
+        this->isDirAndNameOffset &= 0xFFFFFF00;
+        if (_isDir)
+            this->isDirAndNameOffset |= 1;
+    }
+
+    void setNameOffset(unsigned _nameOffset) {
+        uint32_t isDir = (this->isDirAndNameOffset & 0x000000FF);
+        uint32_t nameOffset = BYTESWAP_32(_nameOffset & 0x00FFFFFF);
+
+        this->isDirAndNameOffset = isDir | nameOffset;
+    }
+
+public:
+    union {
+        struct {
+            uint32_t dataOffset, dataSize;
+        } file;
+        struct {
+            uint32_t parent, nextOutOfDir;
+        } dir;
+    };
+} __attribute__((packed));
+
+// DARCHObject::serialize before it was built on serializeScatter.
+static std::vector<unsigned char> serialize(Archive::Directory& structure) {
+    std::vector<unsigned char> result(sizeof(DARCHHeader));
+
+    DARCHHeader *header = reinterpret_cast<DARCHHeader*>(result.data());
+    *header = DARCHHeader {
+        .nodeSectionStart = BYTESWAP_32(sizeof(DARCHHeader))
+    };
+
+    struct FlatEntry {
+        union {
+            Archive::Directory *dir;
+            Archive::File *file;
+        };
+        bool isDir;
+
+        unsigned parent;
+        unsigned nextOutOfDir;
+    };
+
+    std::vector<FlatEntry> flattenedArchive = {
+        {
+            .dir = &structure,
+            .isDir = true,
+
+            .parent = 0,
+        }
+    };
+
+    std::stack<std::pair<Archive::Directory *, std::list<Archive::File>::iterator>> fileItStack;
+    std::stack<std::pair<Archive::Directory *, std::list<Archive::Directory>::iterator>> directoryItStack;
+
+    fileItStack.push({ &structure, structure.files.begin() });
+    directoryItStack.push({ &structure, structure.subdirectories.begin() });
+
+    std::vector<unsigned> parentList = { 0 };
+
+    while (!fileItStack.empty()) {
+        const Archive::Directory* currentDir = fileItStack.top().first;
+
+        auto &fileIt = fileItStack.top().second;
+        auto &dirIt = directoryItStack.top().second;
+
+        if (fileIt != currentDir->files.end()) {
+            flattenedArchive.push_back({
+                .file = &(*fileIt),
+                .isDir = false,
+
+                .parent = parentList.back()
+            });
+            ++fileIt;
+        }
+        else if (dirIt != currentDir->subdirectories.end()) {
+            Archive::Directory* subDir = &(*dirIt);
+            flattenedArchive.push_back({
+                .dir = subDir,
+                .isDir = true,
+
+                .parent = parentList.back()
+            });
+
+            parentList.push_back(flattenedArchive.size() - 1);
+            ++dirIt;
+
+            fileItStack.push({ subDir, subDir->files.begin() });
+            directoryItStack.push({ subDir, subDir->subdirectories.begin() });
+        }
+        else {
+            for (unsigned parentIndex : parentList) {
+                flattenedArchive[parentIndex].nextOutOfDir = flattenedArchive.size();
+            }
+
+            parentList.pop_back();
+            fileItStack.pop();
+            directoryItStack.pop();
+        }
+    }
+
+    std::vector<unsigned> stringOffsets(flattenedArchive.size(), 0);
+    std::vector<unsigned> dataOffsets(flattenedArchive.size(), 0);
+
+    unsigned nextStringPoolOffset { 0 };
+
+    for (size_t i = 0; i < flattenedArchive.size(); ++i) {
+        const FlatEntry &entry = flattenedArchive[i];
+
+        stringOffsets[i] = nextStringPoolOffset;
+        nextStringPoolOffset += (
+            entry.isDir ? entry.dir->name.size() : entry.file->name.size()
+        ) + 1;
+    }
+
+    header->nodeSectionSize = BYTESWAP_32(static_cast<uint32_t>(
+        (sizeof(DARCHNode) * flattenedArchive.size()) + nextStringPoolOffset
+    ));
+
+    unsigned baseDataOffset = ALIGN_UP_32(
+        sizeof(DARCHHeader) +
+        (sizeof(DARCHNode) * flattenedArchive.size()) +
+        nextStringPoolOffset
+    );
+    unsigned nextDataOffset = baseDataOffset;
+
+    header->dataSectionStart = BYTESWAP_32(baseDataOffset);
+
+    for (size_t i = 1; i < flattenedArchive.size(); ++i) {
+        const FlatEntry &entry = flattenedArchive[i];
+
+        if (!entry.isDir) {
+            dataOffsets[i] = nextDataOffset;
+
+            nextDataOffset += entry.file->data.size();
+            if (i != (flattenedArchive.size() - 1))
+                nextDataOffset = ALIGN_UP_32(nextDataOffset);
+        }
+    }
+
+    result.resize(nextDataOffset);
+
+    for (size_t i = 0; i < flattenedArchive.size(); ++i) {
+        const FlatEntry &entry = flattenedArchive[i];
+        DARCHNode *node = reinterpret_cast<DARCHNode*>(
+            result.data() + sizeof(DARCHHeader) +
+            (sizeof(DARCHNode) * i)
+        );
+
+        node->setIsDirectory(entry.isDir);
+        node->setNameOffset(stringOffsets[i]);
+
+        char *nameDest = reinterpret_cast<char *>(
+            result.data() + sizeof(DARCHHeader) +
+            (sizeof(DARCHNode) * flattenedArchive.size()) +
+            stringOffsets[i]
+        );
+
+        if (entry.isDir) {
+            node->dir.nextOutOfDir = BYTESWAP_32(entry.nextOutOfDir);
+            node->dir.parent = BYTESWAP_32(entry.parent);
+
+            std::strcpy(nameDest, entry.dir->name.c_str());
+        }
+        else {
+            const unsigned char *fileData = entry.file->data.data();
+            unsigned fileDataSize = entry.file->data.size();
+
+            node->file.dataOffset = BYTESWAP_32(dataOffsets[i]);
+            node->file.dataSize = BYTESWAP_32(fileDataSize);
+
+            std::strcpy(nameDest, entry.file->name.c_str());
+            if (fileDataSize != 0)
+                std::memcpy(result.data() + dataOffsets[i], fileData, fileDataSize);
+        }
+    }
+
+    return result;
+}
+
+} // namespace Reference
+
+static void AddFile(Archive::Directory& directory, const std::string& name, size_t size, std::mt19937& rng) {
+    std::vector<unsigned char> data(size);
+    for (auto& byte : data)
+        byte = static_cast<unsigned char>(rng());
+
+    Archive::File file(name);
+    file.data = std::move(data);
+
+    directory.addFile(std::move(file));
+}
+
+// Files of random sizes (empty ones included) & subdirectories, some of them
+// empty, down to the given depth.
+static void Populate(Archive::Directory& directory, unsigned depth, std::mt19937& rng) {
+    const unsigned fileCount = rng() % 4;
+    for (unsigned i = 0; i < fileCount; i++)
+        AddFile(directory, "file" + std::to_string(i) + ".bin", rng() % 200, rng);
+
+    if (depth == 0)
+        return;
+
+    const unsigned dirCount = rng() % 3;
+    for (unsigned i = 0; i < dirCount; i++)
+        Populate(directory.newDirectory("dir" + std::to_string(i)), depth - 1, rng);
+}
+
+// Whether the archive serializes like the reference, & again after a round trip.
+static bool Check(const std::string& name, Archive::DARCHObject& archive) {
+    const std::vector<unsigned char> expected = Reference::serialize(archive.getStructure());
+    const std::vector<unsigned char> result = archive.serialize();
+
+    Archive::DARCHObject parsed(result.data(), result.size());
+    const std::vector<unsigned char> roundTrip = parsed.serialize();
+
+    const bool match = result == expected && roundTrip == expected;
+    if (!match) {
+        std::cout <<
+            name << ": MISMATCH (reference " << expected.size() << " bytes, serialize " <<
+            result.size() << " bytes, round trip " << roundTrip.size() << " bytes)\n";
+    }
+
+    return match;
+}
+
+int main() {
+    std::mt19937 rng(1234);
+
+    bool allMatch = true;
+
+    {
+        Archive::DARCHObject archive;
+        archive.getStructure().newDirectory(".");
+        allMatch &= Check("empty directory", archive);
+    }
+
+    {
+        Archive::DARCHObject archive;
+        Archive::Directory& root = archive.getStructure().newDirectory(".");
+        AddFile(root, "a.bin", 5, rng);
+        root.newDirectory("empty");
+        allMatch &= Check("file then empty directory", archive);
+    }
+
+    for (unsigned i = 0; i < 500; i++) {
+        Archive::DARCHObject archive;
+        Populate(archive.getStructure().newDirectory("."), 3, rng);
+        allMatch &= Check("generated #" + std::to_string(i), archive);
+    }
+
+    if (!allMatch) {
+        std::cout << "DARCHObject::serialize differs from the reference.\n";
+        return 1;
+    }
+
+    std::cout << "All archives match.\n";
+    return 0;
+}
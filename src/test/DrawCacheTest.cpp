@@ -0,0 +1,136 @@
+// toast-test-draw-cache
+// Checks that drawing the keys of a cellanim again in a frame with no edits
+// hits the draw cache (also after a snapshot is taken, like exporting does),
+// & that taking an arrangement for writing only makes the keys of its chunk
+// miss.
+
+#include <cstddef>
+#include <cstdint>
+
+#include <iostream>
+
+#include <string>
+
+#include <vector>
+
+#include <memory>
+
+#include <iterator>
+
+#include <utility>
+
+#include "cellanim/CellAnim.hpp"
+#include "cellanim/CellAnimDrawCache.hpp"
+
+// More than two chunks of arrangements.
+static constexpr unsigned ARRANGEMENT_COUNT = 70;
+
+// The arrangements drawn; 0 & 1 share a chunk, 40 & 65 are in others.
+static constexpr unsigned DRAWN_ARRANGEMENTS[] = { 0, 1, 40, 65 };
+
+static CellAnim::CellAnimObject MakeCellAnim() {
+    CellAnim::CellAnimObject cellanim;
+    cellanim.setSheetWidth(512);
+    cellanim.setSheetHeight(512);
+
+    for (unsigned i = 0; i < ARRANGEMENT_COUNT; i++) {
+        CellAnim::Arrangement arrangement;
+
+        for (unsigned j = 0; j < 3; j++) {
+            CellAnim::ArrangementPart part;
+
+            part.cellOrigin = CellAnim::UintVec2(i * 4, j * 16);
+            part.cellSize = CellAnim::UintVec2(16, 16);
+            part.transform.position = CellAnim::IntVec2(j * 8, static_cast<int>(i));
+
+            arrangement.parts.push_back(std::move(part));
+        }
+
+        cellanim.getArrangements().push_back(std::move(arrangement));
+    }
+
+    CellAnim::Animation animation;
+    for (const unsigned arrangementIndex : DRAWN_ARRANGEMENTS) {
+        CellAnim::AnimationKey key;
+        key.arrangementIndex = arrangementIndex;
+
+        animation.keys.push_back(key);
+    }
+
+    cellanim.getAnimations().push_back(std::move(animation));
+
+    return cellanim;
+}
+
+// Draw every key of the first animation like the canvas does: the cellanim
+// is only read, through a const reference.
+static void DrawFrame(CellAnim::DrawCache& cache, const CellAnim::CellAnimObject& cellanim, int frame) {
+    for (const auto& key : cellanim.getAnimation(0).keys) {
+        cache.get(
+            cellanim, key, -1, 0xFFFFFFFF, true,
+            ImVec2(256.f, 256.f), ImVec2(1.f, 1.f),
+            frame
+        );
+    }
+}
+
+// Whether drawing a frame missed the cache the given number of times.
+static bool CheckFrame(
+    const std::string& name, CellAnim::DrawCache& cache, const CellAnim::CellAnimObject& cellanim,
+    int frame, size_t expectedMisses
+) {
+    const size_t missesBefore = cache.getMissCount();
+    DrawFrame(cache, cellanim, frame);
+    const size_t misses = cache.getMissCount() - missesBefore;
+
+    const bool match = misses == expectedMisses;
+    if (!match) {
+        std::cout <<
+            name << ": MISMATCH (" << misses << " misses, expected " << expectedMisses << ")\n";
+    }
+
+    return match;
+}
+
+int main() {
+    CellAnim::CellAnimObject cellanim = MakeCellAnim();
+    const size_t keyCount = std::size(DRAWN_ARRANGEMENTS);
+
+    CellAnim::DrawCache cache;
+    int frame = 1;
+
+    bool allMatch = true;
+
+    allMatch &= CheckFrame("first frame", cache, cellanim, frame++, keyCount);
+    allMatch &= CheckFrame("frame with no edits", cache, cellanim, frame++, 0);
+
+    // Snapshots share the chunks without taking them for writing.
+    std::shared_ptr<CellAnim::CellAnimObject> snapshot = cellanim.snapshot();
+    allMatch &= CheckFrame("frame after a snapshot", cache, cellanim, frame++, 0);
+    allMatch &= CheckFrame("snapshot", cache, *snapshot, frame++, 0);
+
+    // Arrangements 0 & 1 share a chunk, so both their keys are made again.
+    cellanim.getArrangement(0).parts.at(0).opacity = 128;
+    allMatch &= CheckFrame("frame after an edit", cache, cellanim, frame++, 2);
+    allMatch &= CheckFrame("frame with no edits after an edit", cache, cellanim, frame++, 0);
+
+    // Any non-const access takes the chunk for writing, which is why reads
+    // go through const references.
+    static_cast<void>(cellanim.getArrangement(40));
+    allMatch &= CheckFrame("frame after a non-const read", cache, cellanim, frame++, 1);
+
+    static_cast<void>(std::as_const(cellanim).getArrangement(65));
+    allMatch &= CheckFrame("frame after a const read", cache, cellanim, frame++, 0);
+
+    // Entries not drawn in the frame before are dropped.
+    frame += 2;
+    allMatch &= CheckFrame("frame after skipped frames", cache, cellanim, frame++, keyCount);
+
+    if (!allMatch) {
+        std::cout << "The draw cache doesn't hit or miss as expected.\n";
+        return 1;
+    }
+
+    std::cout << "All frames hit & miss the draw cache as expected.\n";
+    return 0;
+}
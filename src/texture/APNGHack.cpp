@@ -2,13 +2,21 @@
 
 #include <cstdint>
 #include <cstring>
+#include <cstdlib>
+
+#include <algorithm>
 
 #include "util/CRC32Util.hpp"
+#include "util/ParallelUtil.hpp"
 
 #include <zlib-ng.h>
 
+#include "Logging.hpp"
+
 #include "Macro.hpp"
 
+using namespace APNGHack;
+
 enum class PNGColorType : uint8_t {
     Grayscale      = 0, // Luminance values (bpp is bitDepth).
     Truecolor      = 2, // RGB values (bpp is bitDepth*3).
@@ -91,18 +99,6 @@ struct PNGActlChunk {
     uint32_t crc[0];
 } __attribute__((packed));
 
-// Specifies how the draw buffer is cleared when drawing a frame.
-enum class APNGDisposeOp : uint8_t {
-    None     = 0, // Don't do anything; leave the buffer as is.
-    Clear    = 1, // Clear the buffer before drawing.
-    Previous = 2, // Copy the previous frame before drawing.
-};
-
-enum class APNGBlendOp : uint8_t {
-    Source = 0,
-    Over   = 1
-};
-
 struct PNGFctlChunk {
     uint32_t chunkDataSize { BYTESWAP_32(26) };
     uint8_t crcStart[0];
@@ -141,37 +137,261 @@ static const PNGDummyChunk* FindPNGChunk(const void* pngDataStart, const void* p
     return nullptr;
 }
 
-std::vector<unsigned char> APNGHack::build(const BuildData& buildData) {
-    unsigned finalSize = sizeof(PNGFileHeader) +
-        sizeof(PNGIhdrChunk) + 4 +
-        sizeof(PNGActlChunk) + 4 +
-        sizeof(PNGDummyChunk) + 4; // IEND
 
-    std::vector<std::vector<unsigned char>> dataList (buildData.frames.size());
+constexpr unsigned RGBA_BPP = 4;
+
+// https://www.w3.org/TR/png/#9Filter-type-4-Paeth
+static inline int PaethPredictor(int a, int b, int c) {
+    const int p = a + b - c;
+    const int pa = std::abs(p - a);
+    const int pb = std::abs(p - b);
+    const int pc = std::abs(p - c);
+
+    if (pa <= pb && pa <= pc)
+        return a;
+    if (pb <= pc)
+        return b;
+    return c;
+}
+
+// Prefix every row with a filter type & filter it. The filter is picked per row
+// with the usual heuristic: the smallest sum of the filtered bytes taken as
+// signed values, which tends to deflate best.
+static std::vector<unsigned char> FilterImage(const unsigned char* rgba, unsigned width, unsigned height) {
+    constexpr unsigned FILTER_COUNT = 5;
+
+    const size_t rowSize = size_t(width) * RGBA_BPP;
+
+    std::vector<unsigned char> filtered ((rowSize + 1) * height);
+
+    std::vector<unsigned char> candidates[FILTER_COUNT];
+    for (auto& candidate : candidates)
+        candidate.resize(rowSize);
+
+    const std::vector<unsigned char> zeroRow (rowSize, 0);
+
+    for (unsigned y = 0; y < height; y++) {
+        const unsigned char* row = rgba + (rowSize * y);
+        const unsigned char* prevRow = (y > 0) ? row - rowSize : zeroRow.data();
+
+        unsigned sums[FILTER_COUNT] {};
+
+        for (size_t x = 0; x < rowSize; x++) {
+            const int a = (x >= RGBA_BPP) ? row[x - RGBA_BPP] : 0;
+            const int b = prevRow[x];
+            const int c = (x >= RGBA_BPP) ? prevRow[x - RGBA_BPP] : 0;
+
+            const unsigned char values[FILTER_COUNT] {
+                row[x],
+                static_cast<unsigned char>(row[x] - a),
+                static_cast<unsigned char>(row[x] - b),
+                static_cast<unsigned char>(row[x] - ((a + b) >> 1)),
+                static_cast<unsigned char>(row[x] - PaethPredictor(a, b, c))
+            };
+
+            for (unsigned f = 0; f < FILTER_COUNT; f++) {
+                candidates[f][x] = values[f];
+                sums[f] += std::abs(static_cast<int>(static_cast<int8_t>(values[f])));
+            }
+        }
+
+        const unsigned bestFilter = std::min_element(sums, sums + FILTER_COUNT) - sums;
+
+        unsigned char* dstRow = filtered.data() + ((rowSize + 1) * y);
+        dstRow[0] = static_cast<unsigned char>(bestFilter);
+        memcpy(dstRow + 1, candidates[bestFilter].data(), rowSize);
+    }
+
+    return filtered;
+}
+
+static bool DeflateImage(const std::vector<unsigned char>& data, int compressionLevel, std::vector<unsigned char>& output) {
+    zng_stream strm {};
+
+    int initResult = zng_deflateInit2(&strm, compressionLevel, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY);
+    if (initResult != Z_OK) {
+        Logging::error("[APNGHack::build] zng_deflateInit2 failed (code {})!", initResult);
+        return false;
+    }
+
+    output.resize(zng_deflateBound(&strm, data.size()));
+
+    strm.next_in = data.data();
+    strm.avail_in = data.size();
+    strm.next_out = output.data();
+    strm.avail_out = output.size();
+
+    int deflateResult = zng_deflate(&strm, Z_FINISH);
+
+    output.resize(strm.total_out);
+
+    zng_deflateEnd(&strm);
+
+    if (deflateResult != Z_STREAM_END) {
+        Logging::error("[APNGHack::build] zng_deflate failed (code {})!", deflateResult);
+        return false;
+    }
+
+    return true;
+}
+
+void APNGHack::addFrame(
+    BuildData& buildData,
+    const unsigned char* canvas, const unsigned char* previousCanvas,
+    unsigned holdFrames
+) {
+    const unsigned canvasW = buildData.canvasW;
+    const unsigned canvasH = buildData.canvasH;
+
+    const size_t canvasRowSize = size_t(canvasW) * RGBA_BPP;
+
+    // The first frame is always the whole canvas (it's the default image).
+    if (!previousCanvas || buildData.frames.empty()) {
+        buildData.frames.push_back(BuildFrame {
+            .rgbaData = std::vector<unsigned char>(canvas, canvas + (canvasRowSize * canvasH)),
+            .width = canvasW, .height = canvasH,
+            .holdFrames = holdFrames,
+            .blendOp = APNGBlendOp::Source
+        });
+        return;
+    }
+
+    // Find the rectangle that changed. Pixels that are transparent before &
+    // after count as unchanged, whatever their color.
+    unsigned minX = canvasW, minY = canvasH;
+    unsigned maxX = 0, maxY = 0;
+
+    // Over can be used if blending gives the new pixel exactly: it's opaque,
+    // or drawn onto a transparent pixel.
+    bool canBlendOver = true;
+
+    for (unsigned y = 0; y < canvasH; y++) {
+        const unsigned char* row = canvas + (canvasRowSize * y);
+        const unsigned char* prevRow = previousCanvas + (canvasRowSize * y);
+
+        if (memcmp(row, prevRow, canvasRowSize) == 0)
+            continue;
+
+        for (unsigned x = 0; x < canvasW; x++) {
+            const unsigned char* pixel = row + (x * RGBA_BPP);
+            const unsigned char* prevPixel = prevRow + (x * RGBA_BPP);
+
+            if (memcmp(pixel, prevPixel, RGBA_BPP) == 0 || (pixel[3] == 0 && prevPixel[3] == 0))
+                continue;
+
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+            minY = std::min(minY, y);
+            maxY = std::max(maxY, y);
+
+            if (pixel[3] != 0xFF && prevPixel[3] != 0)
+                canBlendOver = false;
+        }
+    }
+
+    if (minX > maxX) {
+        BuildFrame& lastFrame = buildData.frames.back();
+        if (lastFrame.holdFrames + holdFrames <= 0xFFFF) {
+            lastFrame.holdFrames += holdFrames;
+            return;
+        }
+
+        // The delay doesn't fit; blend a transparent pixel over instead, which
+        // leaves the canvas as is.
+        buildData.frames.push_back(BuildFrame {
+            .rgbaData = std::vector<unsigned char>(RGBA_BPP, 0),
+            .width = 1, .height = 1,
+            .holdFrames = holdFrames,
+            .blendOp = APNGBlendOp::Over
+        });
+        return;
+    }
+
+    BuildFrame frame {
+        .width = maxX - minX + 1, .height = maxY - minY + 1,
+        .offsetX = minX, .offsetY = minY,
+        .holdFrames = holdFrames,
+        .blendOp = canBlendOver ? APNGBlendOp::Over : APNGBlendOp::Source
+    };
+    frame.rgbaData.resize(size_t(frame.width) * frame.height * RGBA_BPP);
+
+    const size_t frameRowSize = size_t(frame.width) * RGBA_BPP;
+
+    for (unsigned y = 0; y < frame.height; y++) {
+        const size_t srcOffset = (canvasRowSize * (minY + y)) + (size_t(minX) * RGBA_BPP);
+        unsigned char* dstRow = frame.rgbaData.data() + (frameRowSize * y);
+
+        memcpy(dstRow, canvas + srcOffset, frameRowSize);
+
+        // Blending over, unchanged pixels can be left transparent; runs of
+        // zeroes deflate to next to nothing.
+        if (frame.blendOp == APNGBlendOp::Over) {
+            const unsigned char* prevRow = previousCanvas + srcOffset;
+            for (size_t i = 0; i < frameRowSize; i += RGBA_BPP) {
+                if (memcmp(dstRow + i, prevRow + i, RGBA_BPP) == 0 || (dstRow[i + 3] == 0 && prevRow[i + 3] == 0))
+                    memset(dstRow + i, 0, RGBA_BPP);
+            }
+        }
+    }
+
+    buildData.frames.push_back(std::move(frame));
+}
+
+std::vector<unsigned char> APNGHack::build(const BuildData& buildData) {
+    if (buildData.frames.empty()) {
+        Logging::error("[APNGHack::build] No frames to build");
+        return {};
+    }
 
-    // Precompute size of APNG binary and prepare compressed image data.
     for (unsigned i = 0; i < buildData.frames.size(); i++) {
         const auto& frame = buildData.frames[i];
 
-        std::vector<unsigned char> buffer (zng_compressBound(frame.rgbaData.size()));
+        const bool fitsCanvas =
+            frame.width != 0 && frame.height != 0 &&
+            frame.offsetX + frame.width <= buildData.canvasW &&
+            frame.offsetY + frame.height <= buildData.canvasH;
+        // The first frame is the default image, so it has to cover the canvas.
+        const bool coversCanvas =
+            frame.width == buildData.canvasW && frame.height == buildData.canvasH;
+
+        if (
+            !fitsCanvas || (i == 0 && !coversCanvas) ||
+            frame.rgbaData.size() != size_t(frame.width) * frame.height * RGBA_BPP ||
+            frame.holdFrames > 0xFFFF
+        ) {
+            Logging::error("[APNGHack::build] Frame no. {} is invalid", i + 1);
+            return {};
+        }
+    }
 
-        zng_stream strm {};
-        strm.next_in = frame.rgbaData.data();
-        strm.avail_in = frame.rgbaData.size();
-        strm.next_out = buffer.data();
-        strm.avail_out = buffer.size();
+    size_t finalSize = sizeof(PNGFileHeader) +
+        sizeof(PNGIhdrChunk) + 4 +
+        sizeof(PNGActlChunk) + 4 +
+        sizeof(PNGDummyChunk) + 4; // IEND
 
-        zng_deflateInit2(&strm, Z_BEST_COMPRESSION, 8, 15, 8, 0);
+    std::vector<std::vector<unsigned char>> dataList (buildData.frames.size());
+    std::vector<char> dataValid (buildData.frames.size(), false);
 
-        zng_deflate(&strm, Z_FINISH);
+    // Filter & compress the frames.
+    ParallelUtil::parallelFor(buildData.frames.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const auto& frame = buildData.frames[i];
 
-        buffer.resize(strm.total_out);
+            dataValid[i] = DeflateImage(
+                FilterImage(frame.rgbaData.data(), frame.width, frame.height),
+                buildData.compressionLevel, dataList[i]
+            );
+        }
+    });
 
-        zng_deflateEnd(&strm);
+    // Precompute size of APNG binary.
+    for (unsigned i = 0; i < buildData.frames.size(); i++) {
+        if (!dataValid[i])
+            return {};
 
         finalSize += sizeof(PNGFctlChunk) + 4;
         // IDAT/fdAT chunk.
-        finalSize += sizeof(PNGDummyChunk) + buffer.size() + 4;
+        finalSize += sizeof(PNGDummyChunk) + dataList[i].size() + 4;
 
         // fdAT chunks have an extra 4 bytes.
         if (i != 0)
@@ -190,7 +410,7 @@ std::vector<unsigned char> APNGHack::build(const BuildData& buildData) {
         .bitDepth = 8,
         .colorType = PNGColorType::TruecolorAlpha,
         .compressionMethod = PNGCompressionMethod::Zlib,
-        .filterMethod = PNGFilterMethod::None,
+        .filterMethod = PNGFilterMethod::None, // Method 0 (adaptive filtering).
         .interlaceMethod = PNGInterlaceMethod::None
     };
 
@@ -212,22 +432,24 @@ std::vector<unsigned char> APNGHack::build(const BuildData& buildData) {
 
     PNGDummyChunk* currentChunk = reinterpret_cast<PNGDummyChunk*>(chunkActl->crc + 1);
 
-    // Write fcTL & IDAT/fdAT chunks.
+    // Write fcTL & IDAT/fdAT chunks. fcTL & fdAT chunks share one sequence:
+    // the first fcTL is 0, then every frame takes the next two numbers (the
+    // IDAT chunk has none).
     for (unsigned i = 0; i < buildData.frames.size(); i++) {
         const auto& frame = buildData.frames[i];
         const bool isFirstFrame = i == 0;
 
         PNGFctlChunk* chunkFctl = reinterpret_cast<PNGFctlChunk*>(currentChunk);
         *chunkFctl = PNGFctlChunk {
-            .sequenceNumber = BYTESWAP_32(i),
+            .sequenceNumber = BYTESWAP_32(isFirstFrame ? 0 : (i * 2) - 1),
             .frameW = BYTESWAP_32(frame.width),
             .frameH = BYTESWAP_32(frame.height),
             .offsetX = BYTESWAP_32(frame.offsetX),
             .offsetY = BYTESWAP_32(frame.offsetY),
-            .delayNum = BYTESWAP_16(frame.holdFrames),
-            .delayDen = BYTESWAP_16(buildData.frameRate),
+            .delayNum = BYTESWAP_16(static_cast<uint16_t>(frame.holdFrames)),
+            .delayDen = BYTESWAP_16(static_cast<uint16_t>(buildData.frameRate)),
             .disposeOpr = APNGDisposeOp::None,
-            .blendOpr = APNGBlendOp::Source
+            .blendOpr = frame.blendOp
         };
 
         *chunkFctl->crc = BYTESWAP_32(CRC32Util::compute(std::string_view(
@@ -248,27 +470,26 @@ std::vector<unsigned char> APNGHack::build(const BuildData& buildData) {
 
         // Write sequence number.
         if (!isFirstFrame) {
-            uint32_t* destSequenceNumber = reinterpret_cast<uint32_t*>(destIdat->chunkData);
-
-            // Sequence numbers are 1-indexed ONLY HERE for some reason.
-            *destSequenceNumber = BYTESWAP_32(i + 1);
+            uint32_t sequenceNumber = BYTESWAP_32(i * 2);
+            memcpy(destIdat->chunkData, &sequenceNumber, sizeof(sequenceNumber));
         }
 
-        uint32_t* destCRC = reinterpret_cast<uint32_t*>(
-            destIdat->chunkData + dstDataSize
-        );
+        uint8_t* destCRC = destIdat->chunkData + dstDataSize;
 
-        *destCRC = BYTESWAP_32(CRC32Util::compute(std::string_view(
+        uint32_t crc = BYTESWAP_32(CRC32Util::compute(std::string_view(
             reinterpret_cast<char*>(destIdat->crcStart),
             reinterpret_cast<char*>(destCRC)
         )));
+        memcpy(destCRC, &crc, sizeof(crc));
 
-        currentChunk = reinterpret_cast<PNGDummyChunk*>(destCRC + 1);
+        currentChunk = reinterpret_cast<PNGDummyChunk*>(destCRC + 4);
     }
 
     currentChunk->chunkDataSize = 0;
     currentChunk->chunkIdentifier = PNG_IEND_ID;
-    *reinterpret_cast<uint32_t*>(currentChunk->chunkData) = BYTESWAP_32(CRC32Util::compute("IEND"));
+
+    uint32_t iendCRC = BYTESWAP_32(CRC32Util::compute("IEND"));
+    memcpy(currentChunk->chunkData, &iendCRC, sizeof(iendCRC));
 
     return finalData;
 }
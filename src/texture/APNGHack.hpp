@@ -1,24 +1,53 @@
 #ifndef APNGHACK_HPP
 #define APNGHACK_HPP
 
+#include <cstdint>
+
 #include <vector>
 
 namespace APNGHack {
 
+// Specifies how the draw buffer is cleared when drawing a frame.
+enum class APNGDisposeOp : uint8_t {
+    None     = 0, // Don't do anything; leave the buffer as is.
+    Clear    = 1, // Clear the buffer before drawing.
+    Previous = 2, // Copy the previous frame before drawing.
+};
+
+// Specifies how a frame is drawn onto the buffer.
+enum class APNGBlendOp : uint8_t {
+    Source = 0, // Replace the frame's rectangle, alpha included.
+    Over   = 1  // Alpha-blend the frame over the rectangle.
+};
+
 struct BuildFrame {
     std::vector<unsigned char> rgbaData; // Expected to be (width * height * 4) bytes in size.
     unsigned width, height; // Must not be larger than the canvas size.
     unsigned offsetX { 0 }, offsetY { 0 }; // Originates from top-left.
 
-    unsigned holdFrames { 30 };
+    unsigned holdFrames { 30 }; // At most 0xFFFF.
+
+    APNGBlendOp blendOp { APNGBlendOp::Source };
 };
 
 struct BuildData {
     std::vector<BuildFrame> frames;
     unsigned canvasW, canvasH;
     unsigned frameRate { 60 };
+
+    int compressionLevel { 6 }; // zlib level (0 - 9).
 };
 
+// Append a frame given as the whole canvas (canvasW * canvasH * 4 bytes). Only
+// the rectangle that changed since previousCanvas is stored; pass nullptr for
+// the first frame. If nothing changed, the previous frame is held longer.
+void addFrame(
+    BuildData& buildData,
+    const unsigned char* canvas, const unsigned char* previousCanvas,
+    unsigned holdFrames
+);
+
+// Frames are filtered & deflated in parallel.
 [[nodiscard]] std::vector<unsigned char> build(const BuildData& buildData);
 
 } // namespace APNGHack
@@ -0,0 +1,709 @@
+#include "CMPRPacker.hpp"
+
+#include <cstring>
+
+#include <cmath>
+
+#include <array>
+
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// The kernels are compiled for their instruction set per function, so the
+// rest of the program doesn't require it; they are only called if the CPU
+// supports it.
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+#define HAS_X86_KERNELS
+#endif
+
+namespace {
+
+// Least squares refinement passes in High mode; most blocks stop improving
+// after one or two.
+constexpr unsigned REFINE_PASSES = 3;
+
+// The pixels of a block as 16-bit lanes: (R | G << 16) & B.
+struct BlockPixels {
+    alignas(32) uint32_t rg[16];
+    alignas(32) uint32_t b[16];
+
+    // All bits are set for opaque pixels.
+    alignas(32) uint32_t opaqueMask[16];
+};
+
+// The colors of a block as (R | G << 16) & B. In three-color mode the fourth
+// color (transparent) repeats the third, so that it's never picked.
+struct BlockPalette {
+    uint32_t rg[4];
+    uint32_t b[4];
+};
+
+// Find the closest palette color for every pixel. The indices are returned
+// as they're stored: a byte per row, with the first pixel in the top bits.
+// Returns the squared error of the opaque pixels. On equal errors the lower
+// index is taken.
+typedef uint32_t (*MatchColorsFunc)(const BlockPixels& pixels, const BlockPalette& palette, uint32_t& indexBits);
+
+// Shift of the index of a pixel (row-major) in the index bits.
+inline unsigned GetIndexShift(unsigned i) {
+    return (i / 4) * 8 + 6 - (i % 4) * 2;
+}
+
+uint32_t MatchColors_Scalar(const BlockPixels& pixels, const BlockPalette& palette, uint32_t& indexBits) {
+    uint32_t error = 0;
+    indexBits = 0;
+
+    for (unsigned i = 0; i < 16; i++) {
+        uint32_t bestKey = UINT32_MAX;
+
+        for (unsigned c = 0; c < 4; c++) {
+            const int dr = static_cast<int>(pixels.rg[i] & 0xFFFF) - static_cast<int>(palette.rg[c] & 0xFFFF);
+            const int dg = static_cast<int>(pixels.rg[i] >> 16) - static_cast<int>(palette.rg[c] >> 16);
+            const int db = static_cast<int>(pixels.b[i]) - static_cast<int>(palette.b[c]);
+
+            const uint32_t key = (static_cast<uint32_t>(dr * dr + dg * dg + db * db) << 2) | c;
+            bestKey = std::min(bestKey, key);
+        }
+
+        error += (bestKey >> 2) & pixels.opaqueMask[i];
+        indexBits |= (bestKey & 3) << GetIndexShift(i);
+    }
+
+    return error;
+}
+
+#ifdef HAS_X86_KERNELS
+
+// Pack the indices (the low two bits of 32-bit lanes, four rows in order) to
+// a byte per row with the first pixel in the top bits.
+TARGET_SSE41 inline uint32_t PackIndexRows(__m128i rows) {
+    // (i0 * 64 + i1 * 16), (i2 * 4 + i3) per row, then summed per row.
+    const __m128i pairs = _mm_maddubs_epi16(rows, _mm_set1_epi32(0x01041040));
+    const __m128i rowBytes = _mm_madd_epi16(pairs, _mm_set1_epi16(1));
+
+    const __m128i packed16 = _mm_packus_epi32(rowBytes, rowBytes);
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(_mm_packus_epi16(packed16, packed16)));
+}
+
+TARGET_SSE41 uint32_t MatchColors_SSE41(const BlockPixels& pixels, const BlockPalette& palette, uint32_t& indexBits) {
+    __m128i keys[4];
+
+    for (unsigned row = 0; row < 4; row++) {
+        const __m128i rg = _mm_load_si128(reinterpret_cast<const __m128i*>(pixels.rg + row * 4));
+        const __m128i b = _mm_load_si128(reinterpret_cast<const __m128i*>(pixels.b + row * 4));
+
+        __m128i rowKeys = _mm_set1_epi32(-1);
+
+        for (unsigned c = 0; c < 4; c++) {
+            const __m128i drg = _mm_sub_epi16(rg, _mm_set1_epi32(static_cast<int>(palette.rg[c])));
+            const __m128i db = _mm_sub_epi16(b, _mm_set1_epi32(static_cast<int>(palette.b[c])));
+
+            const __m128i err = _mm_add_epi32(_mm_madd_epi16(drg, drg), _mm_madd_epi16(db, db));
+
+            rowKeys = _mm_min_epu32(
+                rowKeys,
+                _mm_or_si128(_mm_slli_epi32(err, 2), _mm_set1_epi32(static_cast<int>(c)))
+            );
+        }
+
+        keys[row] = rowKeys;
+    }
+
+    __m128i sum = _mm_setzero_si128();
+    for (unsigned row = 0; row < 4; row++) {
+        const __m128i opaqueMask = _mm_load_si128(reinterpret_cast<const __m128i*>(pixels.opaqueMask + row * 4));
+        sum = _mm_add_epi32(sum, _mm_and_si128(_mm_srli_epi32(keys[row], 2), opaqueMask));
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    const __m128i mask3 = _mm_set1_epi32(3);
+    const __m128i indices = _mm_packus_epi16(
+        _mm_packus_epi32(_mm_and_si128(keys[0], mask3), _mm_and_si128(keys[1], mask3)),
+        _mm_packus_epi32(_mm_and_si128(keys[2], mask3), _mm_and_si128(keys[3], mask3))
+    );
+    indexBits = PackIndexRows(indices);
+
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+}
+
+TARGET_AVX2 uint32_t MatchColors_AVX2(const BlockPixels& pixels, const BlockPalette& palette, uint32_t& indexBits) {
+    __m256i keys[2];
+
+    for (unsigned half = 0; half < 2; half++) {
+        const __m256i rg = _mm256_load_si256(reinterpret_cast<const __m256i*>(pixels.rg + half * 8));
+        const __m256i b = _mm256_load_si256(reinterpret_cast<const __m256i*>(pixels.b + half * 8));
+
+        __m256i halfKeys = _mm256_set1_epi32(-1);
+
+        for (unsigned c = 0; c < 4; c++) {
+            const __m256i drg = _mm256_sub_epi16(rg, _mm256_set1_epi32(static_cast<int>(palette.rg[c])));
+            const __m256i db = _mm256_sub_epi16(b, _mm256_set1_epi32(static_cast<int>(palette.b[c])));
+
+            const __m256i err = _mm256_add_epi32(_mm256_madd_epi16(drg, drg), _mm256_madd_epi16(db, db));
+
+            halfKeys = _mm256_min_epu32(
+                halfKeys,
+                _mm256_or_si256(_mm256_slli_epi32(err, 2), _mm256_set1_epi32(static_cast<int>(c)))
+            );
+        }
+
+        keys[half] = halfKeys;
+    }
+
+    const __m256i errors = _mm256_add_epi32(
+        _mm256_and_si256(
+            _mm256_srli_epi32(keys[0], 2),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(pixels.opaqueMask))
+        ),
+        _mm256_and_si256(
+            _mm256_srli_epi32(keys[1], 2),
+            _mm256_load_si256(reinterpret_cast<const __m256i*>(pixels.opaqueMask + 8))
+        )
+    );
+
+    __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(errors), _mm256_extracti128_si256(errors, 1));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    // The packs work per 128-bit lane, which leaves the rows in the order
+    // 0, 2, 1, 3.
+    const __m256i mask3 = _mm256_set1_epi32(3);
+    const __m256i indices16 = _mm256_packus_epi32(
+        _mm256_and_si256(keys[0], mask3), _mm256_and_si256(keys[1], mask3)
+    );
+    const __m128i indices = _mm_shuffle_epi32(
+        _mm_packus_epi16(_mm256_castsi256_si128(indices16), _mm256_extracti128_si256(indices16, 1)),
+        _MM_SHUFFLE(3, 1, 2, 0)
+    );
+    indexBits = PackIndexRows(indices);
+
+    return static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+}
+
+#endif // HAS_X86_KERNELS
+
+MatchColorsFunc GetMatchColors(CMPRPacker::PackISA isa) {
+    switch (isa) {
+#ifdef HAS_X86_KERNELS
+    case CMPRPacker::PackISA::SSE41:
+        return MatchColors_SSE41;
+    case CMPRPacker::PackISA::AVX2:
+        return MatchColors_AVX2;
+#endif
+    default:
+        return MatchColors_Scalar;
+    }
+}
+
+inline int Expand5(int value) {
+    return (value << 3) | (value >> 2);
+}
+inline int Expand6(int value) {
+    return (value << 2) | (value >> 4);
+}
+
+template <unsigned Bits>
+inline int Quantize(float value) {
+    constexpr float MAX = static_cast<float>((1 << Bits) - 1);
+    return static_cast<int>(std::clamp(value, 0.f, 255.f) * MAX / 255.f + .5f);
+}
+
+inline uint16_t ToRGB565(const float color[3]) {
+    return static_cast<uint16_t>(
+        (Quantize<5>(color[0]) << 11) | (Quantize<6>(color[1]) << 5) | Quantize<5>(color[2])
+    );
+}
+
+void GetPalette(uint16_t color0, uint16_t color1, bool threeColor, BlockPalette& palette) {
+    int colors[4][3];
+
+    colors[0][0] = Expand5((color0 >> 11) & 0x1F);
+    colors[0][1] = Expand6((color0 >> 5) & 0x3F);
+    colors[0][2] = Expand5(color0 & 0x1F);
+
+    colors[1][0] = Expand5((color1 >> 11) & 0x1F);
+    colors[1][1] = Expand6((color1 >> 5) & 0x3F);
+    colors[1][2] = Expand5(color1 & 0x1F);
+
+    for (unsigned c = 0; c < 3; c++) {
+        if (threeColor) {
+            colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+            colors[3][c] = colors[2][c];
+        }
+        else {
+            colors[2][c] = (colors[1][c] * 3 + colors[0][c] * 5) >> 3;
+            colors[3][c] = (colors[0][c] * 3 + colors[1][c] * 5) >> 3;
+        }
+    }
+
+    for (unsigned i = 0; i < 4; i++) {
+        palette.rg[i] = colors[i][0] | (colors[i][1] << 16);
+        palette.b[i] = colors[i][2];
+    }
+}
+
+struct BlockCandidate {
+    uint32_t error { UINT32_MAX };
+
+    uint16_t colors[2];
+    uint32_t indexBits;
+};
+
+struct BlockContext {
+    MatchColorsFunc matchColors;
+
+    BlockPixels pixels;
+    bool threeColor;
+
+    // Of the opaque pixels.
+    unsigned opaqueCount;
+    int minColor[3], maxColor[3];
+    int sums[3];
+
+    BlockCandidate best;
+
+    void tryEndpoints(uint16_t color0, uint16_t color1) {
+        BlockPalette palette;
+        GetPalette(color0, color1, threeColor, palette);
+
+        uint32_t indexBits;
+        const uint32_t error = matchColors(pixels, palette, indexBits);
+
+        if (error < best.error)
+            best = { error, { color0, color1 }, indexBits };
+    }
+};
+
+inline void GetPixel(const BlockPixels& pixels, unsigned i, int color[3]) {
+    color[0] = pixels.rg[i] & 0xFFFF;
+    color[1] = pixels.rg[i] >> 16;
+    color[2] = pixels.b[i];
+}
+
+// The corners of the bounding box, inset a little since the extremes are
+// rarely met. The diagonal follows the correlation of the channels with the
+// channel that varies most.
+void TryBoundingBox(BlockContext& context) {
+    float lo[3], hi[3];
+
+    unsigned mainChannel = 0;
+    for (unsigned c = 0; c < 3; c++) {
+        const int inset = (context.maxColor[c] - context.minColor[c]) >> 4;
+
+        lo[c] = static_cast<float>(context.minColor[c] + inset);
+        hi[c] = static_cast<float>(context.maxColor[c] - inset);
+
+        if (
+            context.maxColor[c] - context.minColor[c] >
+            context.maxColor[mainChannel] - context.minColor[mainChannel]
+        )
+            mainChannel = c;
+    }
+
+    // Covariance with the main channel (times the opaque pixel count squared).
+    int covariance[3] {};
+
+    const int count = static_cast<int>(context.opaqueCount);
+
+    for (unsigned i = 0; i < 16; i++) {
+        if (!context.pixels.opaqueMask[i])
+            continue;
+
+        int color[3];
+        GetPixel(context.pixels, i, color);
+
+        const int mainDelta = color[mainChannel] * count - context.sums[mainChannel];
+        for (unsigned c = 0; c < 3; c++)
+            covariance[c] += ((color[c] * count - context.sums[c]) >> 4) * (mainDelta >> 4);
+    }
+
+    for (unsigned c = 0; c < 3; c++) {
+        if (covariance[c] < 0)
+            std::swap(lo[c], hi[c]);
+    }
+
+    context.tryEndpoints(ToRGB565(hi), ToRGB565(lo));
+}
+
+// The extremes of the colors along their principal axis.
+void TryPrincipalAxis(BlockContext& context) {
+    float mean[3];
+    for (unsigned c = 0; c < 3; c++)
+        mean[c] = static_cast<float>(context.sums[c]) / context.opaqueCount;
+
+    float covariance[6] {};
+
+    for (unsigned i = 0; i < 16; i++) {
+        if (!context.pixels.opaqueMask[i])
+            continue;
+
+        int color[3];
+        GetPixel(context.pixels, i, color);
+
+        const float r = color[0] - mean[0];
+        const float g = color[1] - mean[1];
+        const float b = color[2] - mean[2];
+
+        covariance[0] += r * r;
+        covariance[1] += r * g;
+        covariance[2] += r * b;
+        covariance[3] += g * g;
+        covariance[4] += g * b;
+        covariance[5] += b * b;
+    }
+
+    // Power iteration, starting from the bounding box.
+    float axis[3];
+    for (unsigned c = 0; c < 3; c++)
+        axis[c] = static_cast<float>(context.maxColor[c] - context.minColor[c]);
+
+    for (unsigned iteration = 0; iteration < 8; iteration++) {
+        const float r = axis[0] * covariance[0] + axis[1] * covariance[1] + axis[2] * covariance[2];
+        const float g = axis[0] * covariance[1] + axis[1] * covariance[3] + axis[2] * covariance[4];
+        const float b = axis[0] * covariance[2] + axis[1] * covariance[4] + axis[2] * covariance[5];
+
+        const float length = std::max({ std::fabs(r), std::fabs(g), std::fabs(b) });
+        if (length < 1e-6f)
+            return;
+
+        axis[0] = r / length;
+        axis[1] = g / length;
+        axis[2] = b / length;
+    }
+
+    const float axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+
+    float minT = 0.f, maxT = 0.f;
+
+    for (unsigned i = 0; i < 16; i++) {
+        if (!context.pixels.opaqueMask[i])
+            continue;
+
+        int color[3];
+        GetPixel(context.pixels, i, color);
+
+        const float t = (
+            (color[0] - mean[0]) * axis[0] +
+            (color[1] - mean[1]) * axis[1] +
+            (color[2] - mean[2]) * axis[2]
+        ) / axisLengthSq;
+
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+
+    float lo[3], hi[3];
+    for (unsigned c = 0; c < 3; c++) {
+        lo[c] = mean[c] + axis[c] * minT;
+        hi[c] = mean[c] + axis[c] * maxT;
+    }
+
+    context.tryEndpoints(ToRGB565(hi), ToRGB565(lo));
+}
+
+// The endpoints that suit the indices of the best candidate best (least
+// squares). Returns false if the indices don't pin down two endpoints.
+bool TryLeastSquares(BlockContext& context) {
+    // Weights of the endpoints for each index.
+    static constexpr float WEIGHTS_4[4][2] = { { 1.f, 0.f }, { 0.f, 1.f }, { 5.f / 8.f, 3.f / 8.f }, { 3.f / 8.f, 5.f / 8.f } };
+    static constexpr float WEIGHTS_3[4][2] = { { 1.f, 0.f }, { 0.f, 1.f }, { .5f, .5f }, { .5f, .5f } };
+
+    const auto& weights = context.threeColor ? WEIGHTS_3 : WEIGHTS_4;
+
+    float aa = 0.f, ab = 0.f, bb = 0.f;
+    float ax[3] {}, bx[3] {};
+
+    for (unsigned i = 0; i < 16; i++) {
+        if (!context.pixels.opaqueMask[i])
+            continue;
+
+        const unsigned index = (context.best.indexBits >> GetIndexShift(i)) & 3;
+
+        const float a = weights[index][0];
+        const float b = weights[index][1];
+
+        int color[3];
+        GetPixel(context.pixels, i, color);
+
+        aa += a * a;
+        ab += a * b;
+        bb += b * b;
+
+        for (unsigned c = 0; c < 3; c++) {
+            ax[c] += a * color[c];
+            bx[c] += b * color[c];
+        }
+    }
+
+    const float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-4f)
+        return false;
+
+    float color0[3], color1[3];
+    for (unsigned c = 0; c < 3; c++) {
+        color0[c] = (bb * ax[c] - ab * bx[c]) / determinant;
+        color1[c] = (aa * bx[c] - ab * ax[c]) / determinant;
+    }
+
+    const BlockCandidate previous = context.best;
+    context.tryEndpoints(ToRGB565(color0), ToRGB565(color1));
+
+    return context.best.error < previous.error;
+}
+
+// Endpoint pairs whose third color (5:3) is closest to each 8-bit value.
+template <unsigned Bits>
+std::array<std::array<uint8_t, 2>, 256> BuildSingleColorTable() {
+    constexpr int COUNT = 1 << Bits;
+
+    std::array<std::array<uint8_t, 2>, 256> table;
+
+    for (int value = 0; value < 256; value++) {
+        int bestError = 256;
+
+        for (int a = 0; a < COUNT; a++) {
+            for (int b = 0; b < COUNT; b++) {
+                const int expandedA = Bits == 5 ? Expand5(a) : Expand6(a);
+                const int expandedB = Bits == 5 ? Expand5(b) : Expand6(b);
+
+                const int error = std::abs(((expandedA * 5 + expandedB * 3) >> 3) - value);
+                if (error < bestError) {
+                    bestError = error;
+                    table[value] = { static_cast<uint8_t>(a), static_cast<uint8_t>(b) };
+                }
+            }
+        }
+    }
+
+    return table;
+}
+
+// Endpoints whose third color is as close to a color as possible.
+void GetSingleColorEndpoints(const int color[3], uint16_t& color0, uint16_t& color1) {
+    static const auto table5 = BuildSingleColorTable<5>();
+    static const auto table6 = BuildSingleColorTable<6>();
+
+    color0 = (table5[color[0]][0] << 11) | (table6[color[1]][0] << 5) | table5[color[2]][0];
+    color1 = (table5[color[0]][1] << 11) | (table6[color[1]][1] << 5) | table5[color[2]][1];
+}
+
+// The average color, hit as closely as the third color allows.
+void TrySingleColor(BlockContext& context) {
+    int average[3];
+    for (unsigned c = 0; c < 3; c++)
+        average[c] = (context.sums[c] + static_cast<int>(context.opaqueCount) / 2) / static_cast<int>(context.opaqueCount);
+
+    uint16_t color0, color1;
+    GetSingleColorEndpoints(average, color0, color1);
+
+    context.tryEndpoints(color0, color1);
+}
+
+void WriteBlock(
+    unsigned char* block,
+    uint16_t color0, uint16_t color1, uint32_t indexBits,
+    bool threeColor, uint32_t transparentBits
+) {
+    // The order of the colors selects the mode: four colors if the first is
+    // greater, otherwise three colors & transparency.
+    if (threeColor) {
+        if (color0 > color1) {
+            std::swap(color0, color1);
+            // 0 <-> 1; 2 stays.
+            indexBits ^= ~(indexBits >> 1) & 0x55555555;
+        }
+        indexBits |= transparentBits;
+    }
+    else {
+        if (color0 < color1) {
+            std::swap(color0, color1);
+            // 0 <-> 1, 2 <-> 3.
+            indexBits ^= 0x55555555;
+        }
+        // Both colors are the same anyway.
+        else if (color0 == color1)
+            indexBits = 0;
+    }
+
+    block[0] = static_cast<unsigned char>(color0 >> 8);
+    block[1] = static_cast<unsigned char>(color0);
+    block[2] = static_cast<unsigned char>(color1 >> 8);
+    block[3] = static_cast<unsigned char>(color1);
+    memcpy(block + 4, &indexBits, 4);
+}
+
+unsigned PackSingleColorBlock(unsigned char* block, uint32_t pixel) {
+    if ((pixel >> 24) < 0x80) {
+        WriteBlock(block, 0, 0, 0, true, UINT32_MAX);
+        return 0;
+    }
+
+    const int color[3] {
+        static_cast<int>((pixel >> 0) & 0xFF),
+        static_cast<int>((pixel >> 8) & 0xFF),
+        static_cast<int>((pixel >> 16) & 0xFF)
+    };
+
+    uint16_t color0, color1;
+    GetSingleColorEndpoints(color, color0, color1);
+
+    BlockPalette palette;
+    GetPalette(color0, color1, false, palette);
+
+    const int dr = color[0] - static_cast<int>(palette.rg[2] & 0xFFFF);
+    const int dg = color[1] - static_cast<int>(palette.rg[2] >> 16);
+    const int db = color[2] - static_cast<int>(palette.b[2]);
+
+    // Every pixel is the third color.
+    WriteBlock(block, color0, color1, 0xAAAAAAAA, false, 0);
+
+    return static_cast<unsigned>(dr * dr + dg * dg + db * db) * 16;
+}
+
+} // namespace
+
+const char* CMPRPacker::getPackISAName(PackISA isa) {
+    switch (isa) {
+    case PackISA::Scalar:
+        return "Scalar";
+    case PackISA::SSE41:
+        return "SSE4.1";
+    case PackISA::AVX2:
+        return "AVX2";
+
+    default:
+        return "Unknown";
+    }
+}
+
+bool CMPRPacker::isPackISASupported(PackISA isa) {
+    switch (isa) {
+    case PackISA::Scalar:
+        return true;
+
+#ifdef HAS_X86_KERNELS
+    case PackISA::SSE41:
+        return __builtin_cpu_supports("sse4.1");
+    case PackISA::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+
+    default:
+        return false;
+    }
+}
+
+CMPRPacker::PackISA CMPRPacker::getBestPackISA() {
+    static const PackISA bestISA = []() {
+        for (PackISA isa : { PackISA::AVX2, PackISA::SSE41 }) {
+            if (isPackISASupported(isa))
+                return isa;
+        }
+        return PackISA::Scalar;
+    }();
+    return bestISA;
+}
+
+unsigned CMPRPacker::packBlock(PackMode mode, unsigned char* block, const uint32_t* pixels) {
+    return packBlock(getBestPackISA(), mode, block, pixels);
+}
+
+unsigned CMPRPacker::packBlock(PackISA isa, PackMode mode, unsigned char* block, const uint32_t* pixels) {
+    // Blocks of a single color are common in sheets; they're looked up
+    // directly.
+    if (std::all_of(pixels + 1, pixels + 16, [pixels](uint32_t pixel) { return pixel == pixels[0]; }))
+        return PackSingleColorBlock(block, pixels[0]);
+
+    BlockContext context;
+    context.matchColors = GetMatchColors(isa);
+
+    unsigned opaqueCount = 0;
+    int minColor[3] { 255, 255, 255 }, maxColor[3] {}, sums[3] {};
+
+    uint32_t transparentBits = 0;
+
+    // Branchless, so that it vectorizes.
+    for (unsigned i = 0; i < 16; i++) {
+        const uint32_t pixel = pixels[i];
+
+        const int color[3] {
+            static_cast<int>((pixel >> 0) & 0xFF),
+            static_cast<int>((pixel >> 8) & 0xFF),
+            static_cast<int>((pixel >> 16) & 0xFF)
+        };
+
+        context.pixels.rg[i] = color[0] | (color[1] << 16);
+        context.pixels.b[i] = color[2];
+
+        // Opaque if the alpha is 0x80 or above.
+        const uint32_t opaqueMask = 0u - (pixel >> 31);
+        context.pixels.opaqueMask[i] = opaqueMask;
+
+        transparentBits |= (~opaqueMask & 3u) << GetIndexShift(i);
+        opaqueCount += opaqueMask & 1;
+
+        for (unsigned c = 0; c < 3; c++) {
+            minColor[c] = std::min(minColor[c], color[c] | static_cast<int>(~opaqueMask & 0xFF));
+            maxColor[c] = std::max(maxColor[c], color[c] & static_cast<int>(opaqueMask));
+            sums[c] += color[c] & static_cast<int>(opaqueMask);
+        }
+    }
+
+    context.opaqueCount = opaqueCount;
+    for (unsigned c = 0; c < 3; c++) {
+        context.minColor[c] = minColor[c];
+        context.maxColor[c] = maxColor[c];
+        context.sums[c] = sums[c];
+    }
+
+    context.threeColor = context.opaqueCount < 16;
+
+    if (context.opaqueCount == 0) {
+        WriteBlock(block, 0, 0, 0, true, transparentBits);
+        return 0;
+    }
+
+    const bool singleColor =
+        context.minColor[0] == context.maxColor[0] &&
+        context.minColor[1] == context.maxColor[1] &&
+        context.minColor[2] == context.maxColor[2];
+
+    if (singleColor) {
+        if (context.threeColor) {
+            const float color[3] {
+                static_cast<float>(context.minColor[0]),
+                static_cast<float>(context.minColor[1]),
+                static_cast<float>(context.minColor[2])
+            };
+            context.tryEndpoints(ToRGB565(color), ToRGB565(color));
+        }
+        else
+            TrySingleColor(context);
+    }
+    else if (mode == PackMode::Fast)
+        TryBoundingBox(context);
+    else {
+        TryBoundingBox(context);
+        TryPrincipalAxis(context);
+        if (!context.threeColor)
+            TrySingleColor(context);
+
+        for (unsigned pass = 0; pass < REFINE_PASSES && context.best.error != 0; pass++) {
+            if (!TryLeastSquares(context))
+                break;
+        }
+    }
+
+    WriteBlock(
+        block,
+        context.best.colors[0], context.best.colors[1], context.best.indexBits,
+        context.threeColor, transparentBits
+    );
+
+    return context.best.error;
+}
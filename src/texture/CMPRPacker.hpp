@@ -0,0 +1,56 @@
+#ifndef CMPR_PACKER_HPP
+#define CMPR_PACKER_HPP
+
+#include <cstdint>
+
+/*
+    CMPR (DXT1) block packer.
+
+    The colors between the two endpoints are weighted 5:3 on the Wii (not
+    2:1 like on PC), which the packer fits for. Blocks with transparent pixels
+    use the three-color mode.
+
+    Fast:
+        The endpoints are the corners of the bounding box of the colors.
+    High:
+        The endpoints are the extremes along the principal axis of the colors,
+        refined by least squares to suit the chosen indices; the bounding box
+        and a single color fit are tried too.
+
+    The closest color for all pixels of a block is found at once.
+*/
+
+namespace CMPRPacker {
+
+enum class PackMode {
+    Fast,
+    High
+};
+
+enum class PackISA {
+    Scalar,
+    SSE41,
+    AVX2,
+
+    Count
+};
+
+const char* getPackISAName(PackISA isa);
+
+bool isPackISASupported(PackISA isa);
+
+// The best instruction set supported by the running CPU.
+PackISA getBestPackISA();
+
+// Pack 4x4 RGBA32 pixels (row-major, R in the lowest byte) to a CMPR block as
+// it's stored in a TPL (8 bytes). Pixels with an alpha below 0x80 are
+// transparent. Returns the squared RGB error of the opaque pixels.
+//
+// Every instruction set produces the same block.
+unsigned packBlock(PackMode mode, unsigned char* block, const uint32_t* pixels);
+// The instruction set must be supported.
+unsigned packBlock(PackISA isa, PackMode mode, unsigned char* block, const uint32_t* pixels);
+
+} // namespace CMPRPacker
+
+#endif // CMPR_PACKER_HPP
@@ -6,11 +6,11 @@
 
 #include "Logging.hpp"
 
-#include "manager/MainThreadTaskManager.hpp"
-
 #include "CtrImageConvert.hpp"
+#include "MipChain.hpp"
 
 #include "util/CRC32Util.hpp"
+#include "util/ParallelUtil.hpp"
 
 #include "stb/stb_image_resize2.h"
 
@@ -128,29 +128,6 @@ void CTPKTexture::rotateCW() {
     this->height = tempWidth;
 }
 
-GLuint CTPKTexture::createGPUTexture() const {
-    GLuint textureId { 0 };
-
-    MainThreadTaskManager::getInstance().queueTask([this, &textureId]() {
-        glGenTextures(1, &textureId);
-        glBindTexture(GL_TEXTURE_2D, textureId);
-
-        // CTPK textures are always clamped.
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, this->width, this->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, this->data.data());
-
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }).get();
-
-    return textureId;
-}
-
 CTPKObject::CTPKObject(const unsigned char* ctpkData, const size_t dataSize) {
     if (dataSize < sizeof(CtpkFileHeader)) {
         Logging::error("[CTPKObject::CTPKObject] Invalid CTPK binary: data size smaller than header size!");
@@ -173,6 +150,10 @@ CTPKObject::CTPKObject(const unsigned char* ctpkData, const size_t dataSize) {
 
     mTextures.resize(header->textureCount);
 
+    // The image data of every texture; the textures are decoded in parallel
+    // once all entries are read.
+    std::vector<const unsigned char*> imageDatas(header->textureCount);
+
     for (uint16_t i = 0; i < header->textureCount; i++) {
         const CtpkTextureEntry* textureIn = header->textureEntries + i;
         CTPKTexture& textureOut = mTextures[i];
@@ -216,11 +197,19 @@ CTPKObject::CTPKObject(const unsigned char* ctpkData, const size_t dataSize) {
             textureOut.cachedTargetData.assign(imageData, imageDataEnd);
         }
 
-        // Copy RGBA data.
-        textureOut.data.resize(textureOut.width * textureOut.height * 4);
-        CtrImageConvert::toRGBA32(textureOut, imageData);
+        imageDatas[i] = imageData;
     }
 
+    // Copy RGBA data.
+    ParallelUtil::parallelFor(mTextures.size(), 1, [this, &imageDatas](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            CTPKTexture& textureOut = mTextures[i];
+
+            textureOut.data.resize(textureOut.width * textureOut.height * 4);
+            CtrImageConvert::toRGBA32(textureOut, imageDatas[i]);
+        }
+    });
+
     mInitialized = true;
 }
 
@@ -376,49 +365,34 @@ std::vector<unsigned char> CTPKObject::serialize() {
     );
     header->dataSectionOffset = static_cast<uint32_t>(dataSectionStart - result.data());
 
+    // Every texture writes to its own part of the data section, so they're all
+    // converted in parallel.
     unsigned char* currentData = dataSectionStart;
     for (size_t i = 0; i < mTextures.size(); i++) {
         CtpkTextureEntry* texEntry = header->textureEntries + i;
 
         texEntry->dataOffset = static_cast<uint32_t>(currentData - dataSectionStart);
 
-        const auto& srcTexture = mTextures[i];
-        auto dstTexture = mTextures[i]; // Copy
-
-        // If texture dimensions were clamped, scale down to new size.
-        if (dstTexture.width != texEntry->width || dstTexture.height != texEntry->height) {
-            dstTexture.width = texEntry->width;
-            dstTexture.height = texEntry->height;
-
-            dstTexture.data.resize(dstTexture.width * dstTexture.height * 4);
+        currentData += CtrImageConvert::getImageByteSize(
+            mTextures[i].targetFormat, texEntry->width, texEntry->height, mTextures[i].mipCount
+        );
+    }
 
-            stbir_resize_uint8_linear(
-                srcTexture.data.data(), srcTexture.width, srcTexture.height,
-                srcTexture.width * 4,
-                dstTexture.data.data(), dstTexture.width, dstTexture.height,
-                dstTexture.width * 4,
-                STBIR_RGBA
-            );
-        }
+    ParallelUtil::parallelFor(mTextures.size(), 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const CtpkTextureEntry* texEntry = header->textureEntries + i;
 
-        for (unsigned j = 0; j < dstTexture.mipCount; j++) {
-            Logging::info(
-                "[CTPKObject::serialize] Writing data for texture no. {} (mip-level no. {}) ({}x{}, {})..",
-                i+1, j+1, dstTexture.width, dstTexture.height, getImageFormatName(dstTexture.targetFormat)
-            );
+            unsigned char* textureData = dataSectionStart + texEntry->dataOffset;
 
-            CtrImageConvert::fromRGBA32(dstTexture, currentData);
-            currentData += CtrImageConvert::getImageByteSize(
-                dstTexture.targetFormat, dstTexture.width, dstTexture.height, 1
-            );
+            const auto& srcTexture = mTextures[i];
+            auto dstTexture = mTextures[i]; // Copy
 
-            // Scale texture for next mip-level.
-            if ((j + 1) != dstTexture.mipCount) {
-                dstTexture.width = (dstTexture.width > 1) ? dstTexture.width / 2 : 1;
-                dstTexture.height = (dstTexture.height > 1) ? dstTexture.height / 2 : 1;
+            // If texture dimensions were clamped, scale down to new size.
+            if (dstTexture.width != texEntry->width || dstTexture.height != texEntry->height) {
+                dstTexture.width = texEntry->width;
+                dstTexture.height = texEntry->height;
 
-                // Not really necessary.
-                // dstTexture.data.resize(dstTexture.width * dstTexture.height * 4);
+                dstTexture.data.resize(dstTexture.width * dstTexture.height * 4);
 
                 stbir_resize_uint8_linear(
                     srcTexture.data.data(), srcTexture.width, srcTexture.height,
@@ -428,8 +402,31 @@ std::vector<unsigned char> CTPKObject::serialize() {
                     STBIR_RGBA
                 );
             }
+
+            // Every level is filtered from the one above it.
+            const std::vector<std::vector<unsigned char>> mipLevels = MipChain::build(
+                dstTexture.data.data(), dstTexture.width, dstTexture.height, dstTexture.mipCount
+            );
+
+            for (unsigned j = 0; j < dstTexture.mipCount; j++) {
+                const unsigned levelWidth = MipChain::getLevelSize(dstTexture.width, j);
+                const unsigned levelHeight = MipChain::getLevelSize(dstTexture.height, j);
+
+                Logging::info(
+                    "[CTPKObject::serialize] Writing data for texture no. {} (mip-level no. {}) ({}x{}, {})..",
+                    i+1, j+1, levelWidth, levelHeight, getImageFormatName(dstTexture.targetFormat)
+                );
+
+                CtrImageConvert::fromRGBA32(
+                    textureData, dstTexture.targetFormat, levelWidth, levelHeight,
+                    j == 0 ? dstTexture.data.data() : mipLevels[j - 1].data()
+                );
+                textureData += CtrImageConvert::getImageByteSize(
+                    dstTexture.targetFormat, levelWidth, levelHeight, 1
+                );
+            }
         }
-    }
+    });
 
     header->dataSectionSize = static_cast<uint32_t>(currentData - dataSectionStart);
 
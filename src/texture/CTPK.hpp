@@ -9,8 +9,6 @@
 
 #include <string>
 
-#include "glInclude.hpp"
-
 namespace CTPK {
 
 enum CTPKImageFormat : uint32_t {
@@ -109,8 +107,6 @@ public:
 public:
     void rotateCCW();
     void rotateCW();
-
-    [[nodiscard]] GLuint createGPUTexture() const;
 };
 
 class CTPKObject {
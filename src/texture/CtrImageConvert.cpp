@@ -2,12 +2,17 @@
 
 #include <vector>
 
-#include <thread>
+#include <algorithm>
 
 #include <cstdint>
 
+#include "ETC1BlockCache.hpp"
+#include "ETC1FastPacker.hpp"
+
 #include "Logging.hpp"
 
+#include "util/ParallelUtil.hpp"
+
 #include <rg_etc1.h>
 
 #include "manager/ConfigManager.hpp"
@@ -20,41 +25,236 @@ typedef void (*FromImplementation)(unsigned char*, unsigned, unsigned, const uns
 typedef void (*ToImplementation)(unsigned char*, unsigned, unsigned, const unsigned char*);
 
 /*
-    FROM implementations (x to RGBA32)
+    Pixel kernels
+
+    Uncompressed formats are made of 8x8 tiles; the pixels of a tile are
+    stored in Morton (Z) order. A tile is gathered into (or scattered from) 64
+    contiguous RGBA32 pixels in that order, so the pack & unpack kernels are
+    branchless loops over the whole tile that are vectorized by the compiler.
 */
 
-static void IMPLEMENTATION_FROM_RGBA4444(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data) {
-	unsigned readOffset { 0 };
+constexpr unsigned TILE_PIXEL_COUNT = 8 * 8;
 
-    for (unsigned yy = 0; yy < srcHeight; yy += 8) {
-        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
+struct MortonTable {
+    uint8_t x[TILE_PIXEL_COUNT];
+    uint8_t y[TILE_PIXEL_COUNT];
+};
 
-            for (unsigned y = 0; y < 8; y++) {
-                if (yy + y >= srcHeight) break;
+// Position in the tile of every pixel; the bits of the index alternate
+// between X & Y.
+static constexpr MortonTable MORTON_TABLE = []() {
+    MortonTable table {};
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        table.x[i] = (i & 1) | ((i >> 1) & 2) | ((i >> 2) & 4);
+        table.y[i] = ((i >> 1) & 1) | ((i >> 2) & 2) | ((i >> 3) & 4);
+    }
+    return table;
+}();
+
+static inline uint32_t GetR(uint32_t pixel) { return (pixel >>  0) & 0xFFu; }
+static inline uint32_t GetG(uint32_t pixel) { return (pixel >>  8) & 0xFFu; }
+static inline uint32_t GetB(uint32_t pixel) { return (pixel >> 16) & 0xFFu; }
+static inline uint32_t GetA(uint32_t pixel) { return (pixel >> 24) & 0xFFu; }
 
-                const unsigned rowBase = srcWidth * (yy + y);
+static inline uint32_t MakePixel(uint32_t r, uint32_t g, uint32_t b, uint32_t a) {
+    return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+// Rec. 601 luma.
+static inline uint32_t GetLuminance(uint32_t pixel) {
+    return (GetR(pixel) * 77 + GetG(pixel) * 150 + GetB(pixel) * 29 + 128) >> 8;
+}
 
-                for (unsigned x = 0; x < 8; x++) {
-                    if (xx + x >= srcWidth) break;
+// 8-bit channel to the nearest n-bit value & back.
+template <unsigned Bits>
+static inline uint32_t Reduce(uint32_t value) {
+    return (value * ((1u << Bits) - 1) + 127) / 255;
+}
+template <unsigned Bits>
+static inline uint32_t Expand(uint32_t value) {
+    if constexpr (Bits == 1)
+        return value * 0xFFu;
+    else
+        return (value << (8 - Bits)) | (value >> (2 * Bits - 8));
+}
 
-                    const unsigned writeOffset = (rowBase + xx + x) * 4;
+static void PACK_RGBA8888(unsigned char* out, const uint32_t* pixels) {
+    uint32_t* out32 = reinterpret_cast<uint32_t*>(out);
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++)
+        out32[i] = BYTESWAP_32(pixels[i]);
+}
+static void UNPACK_RGBA8888(uint32_t* pixels, const unsigned char* in) {
+    const uint32_t* in32 = reinterpret_cast<const uint32_t*>(in);
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++)
+        pixels[i] = BYTESWAP_32(in32[i]);
+}
 
-                    const uint16_t sourcePixel = *reinterpret_cast<const uint16_t*>(
-                        data + readOffset + (y * 2 * 8) + (x * 2)
-                    );
+static void PACK_RGB888(unsigned char* out, const uint32_t* pixels) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        out[i * 3 + 0] = GetB(pixels[i]);
+        out[i * 3 + 1] = GetG(pixels[i]);
+        out[i * 3 + 2] = GetR(pixels[i]);
+    }
+}
+static void UNPACK_RGB888(uint32_t* pixels, const unsigned char* in) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++)
+        pixels[i] = MakePixel(in[i * 3 + 2], in[i * 3 + 1], in[i * 3 + 0], 0xFFu);
+}
 
-                    result[writeOffset + 0] = ((sourcePixel >> 12) & 0xf) * 16;
-                    result[writeOffset + 1] = ((sourcePixel >>  8) & 0xf) * 16;
-                    result[writeOffset + 2] = ((sourcePixel >>  4) & 0xf) * 16;
-                    result[writeOffset + 3] = ((sourcePixel >>  0) & 0xf) * 16;
-                }
+static void PACK_RGBA5551(unsigned char* out, const uint32_t* pixels) {
+    uint16_t* out16 = reinterpret_cast<uint16_t*>(out);
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        out16[i] =
+            (Reduce<5>(GetR(pixels[i])) << 11) | (Reduce<5>(GetG(pixels[i])) << 6) |
+            (Reduce<5>(GetB(pixels[i])) << 1) | (GetA(pixels[i]) >> 7);
+    }
+}
+static void UNPACK_RGBA5551(uint32_t* pixels, const unsigned char* in) {
+    const uint16_t* in16 = reinterpret_cast<const uint16_t*>(in);
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        pixels[i] = MakePixel(
+            Expand<5>((in16[i] >> 11) & 0x1F), Expand<5>((in16[i] >> 6) & 0x1F),
+            Expand<5>((in16[i] >> 1) & 0x1F), Expand<1>(in16[i] & 0x1)
+        );
+    }
+}
+
+static void PACK_RGB565(unsigned char* out, const uint32_t* pixels) {
+    uint16_t* out16 = reinterpret_cast<uint16_t*>(out);
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        out16[i] =
+            (Reduce<5>(GetR(pixels[i])) << 11) | (Reduce<6>(GetG(pixels[i])) << 5) |
+            Reduce<5>(GetB(pixels[i]));
+    }
+}
+static void UNPACK_RGB565(uint32_t* pixels, const unsigned char* in) {
+    const uint16_t* in16 = reinterpret_cast<const uint16_t*>(in);
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        pixels[i] = MakePixel(
+            Expand<5>((in16[i] >> 11) & 0x1F), Expand<6>((in16[i] >> 5) & 0x3F),
+            Expand<5>(in16[i] & 0x1F), 0xFFu
+        );
+    }
+}
+
+static void PACK_RGBA4444(unsigned char* out, const uint32_t* pixels) {
+    uint16_t* out16 = reinterpret_cast<uint16_t*>(out);
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        out16[i] =
+            (Reduce<4>(GetR(pixels[i])) << 12) | (Reduce<4>(GetG(pixels[i])) << 8) |
+            (Reduce<4>(GetB(pixels[i])) << 4) | Reduce<4>(GetA(pixels[i]));
+    }
+}
+static void UNPACK_RGBA4444(uint32_t* pixels, const unsigned char* in) {
+    const uint16_t* in16 = reinterpret_cast<const uint16_t*>(in);
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        pixels[i] = MakePixel(
+            Expand<4>((in16[i] >> 12) & 0xF), Expand<4>((in16[i] >> 8) & 0xF),
+            Expand<4>((in16[i] >> 4) & 0xF), Expand<4>(in16[i] & 0xF)
+        );
+    }
+}
+
+static void PACK_LA88(unsigned char* out, const uint32_t* pixels) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        out[i * 2 + 0] = GetA(pixels[i]);
+        out[i * 2 + 1] = GetLuminance(pixels[i]);
+    }
+}
+static void UNPACK_LA88(uint32_t* pixels, const unsigned char* in) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        const uint32_t luminance = in[i * 2 + 1];
+        pixels[i] = MakePixel(luminance, luminance, luminance, in[i * 2 + 0]);
+    }
+}
+
+static void PACK_L8(unsigned char* out, const uint32_t* pixels) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++)
+        out[i] = GetLuminance(pixels[i]);
+}
+static void UNPACK_L8(uint32_t* pixels, const unsigned char* in) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++)
+        pixels[i] = MakePixel(in[i], in[i], in[i], 0xFFu);
+}
+
+static void PACK_A8(unsigned char* out, const uint32_t* pixels) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++)
+        out[i] = GetA(pixels[i]);
+}
+static void UNPACK_A8(uint32_t* pixels, const unsigned char* in) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++)
+        pixels[i] = MakePixel(0, 0, 0, in[i]);
+}
+
+static void PACK_LA44(unsigned char* out, const uint32_t* pixels) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++)
+        out[i] = (Reduce<4>(GetLuminance(pixels[i])) << 4) | Reduce<4>(GetA(pixels[i]));
+}
+static void UNPACK_LA44(uint32_t* pixels, const unsigned char* in) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        const uint32_t luminance = Expand<4>(in[i] >> 4);
+        pixels[i] = MakePixel(luminance, luminance, luminance, Expand<4>(in[i] & 0xF));
+    }
+}
+
+// 4-bit formats: the first pixel of a pair is in the low nibble.
+
+static void PACK_L4(unsigned char* out, const uint32_t* pixels) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT / 2; i++) {
+        out[i] =
+            Reduce<4>(GetLuminance(pixels[i * 2 + 0])) |
+            (Reduce<4>(GetLuminance(pixels[i * 2 + 1])) << 4);
+    }
+}
+static void UNPACK_L4(uint32_t* pixels, const unsigned char* in) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+        const uint32_t luminance = Expand<4>((in[i / 2] >> ((i & 1) * 4)) & 0xF);
+        pixels[i] = MakePixel(luminance, luminance, luminance, 0xFFu);
+    }
+}
+
+static void PACK_A4(unsigned char* out, const uint32_t* pixels) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT / 2; i++)
+        out[i] = Reduce<4>(GetA(pixels[i * 2 + 0])) | (Reduce<4>(GetA(pixels[i * 2 + 1])) << 4);
+}
+static void UNPACK_A4(uint32_t* pixels, const unsigned char* in) {
+    for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++)
+        pixels[i] = MakePixel(0, 0, 0, Expand<4>((in[i / 2] >> ((i & 1) * 4)) & 0xF));
+}
+
+/*
+    FROM implementations (x to RGBA32)
+*/
+
+template <unsigned BitsPerPixel, void (*UnpackTile)(uint32_t*, const unsigned char*)>
+static void IMPLEMENTATION_FROM_TILED(unsigned char* _result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data) {
+    uint32_t* result = reinterpret_cast<uint32_t*>(_result);
+
+    uint32_t pixels[TILE_PIXEL_COUNT];
+
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 8) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
+            UnpackTile(pixels, data + readOffset);
+            readOffset += TILE_PIXEL_COUNT * BitsPerPixel / 8;
+
+            const bool wholeTile = (xx + 8) <= srcWidth && (yy + 8) <= srcHeight;
+
+            for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+                const unsigned x = xx + MORTON_TABLE.x[i];
+                const unsigned y = yy + MORTON_TABLE.y[i];
+
+                if (wholeTile || (x < srcWidth && y < srcHeight))
+                    result[(y * srcWidth) + x] = pixels[i];
             }
-            readOffset += 2 * 8 * 8;
         }
     }
 }
 
-static void IMPLEMENTATION_FROM_ETC1A4(unsigned char* _result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data) {
+// ETC1A4 blocks are preceded by a block of 4-bit alpha values.
+template <bool HasAlpha>
+static void IMPLEMENTATION_FROM_ETC1(unsigned char* _result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data) {
     uint32_t* result = reinterpret_cast<uint32_t*>(_result);
 
     unsigned readOffset { 0 };
@@ -67,8 +267,11 @@ static void IMPLEMENTATION_FROM_ETC1A4(unsigned char* _result, unsigned srcWidth
 
                 uint32_t pixels[4 * 4];
 
-                uint64_t alphaData = *reinterpret_cast<const uint64_t*>(data + readOffset);
-                readOffset += 8;
+                uint64_t alphaData = 0;
+                if constexpr (HasAlpha) {
+                    alphaData = *reinterpret_cast<const uint64_t*>(data + readOffset);
+                    readOffset += 8;
+                }
 
                 // Nintendo stores their ETC1 blocks in little- instead of big-endian.
                 uint64_t blockData = BYTESWAP_64(*reinterpret_cast<const uint64_t*>(data + readOffset));
@@ -79,10 +282,14 @@ static void IMPLEMENTATION_FROM_ETC1A4(unsigned char* _result, unsigned srcWidth
                 // Alpha pass.
                 for (unsigned x = xx + xStart; x < xx + xStart + 4; x++) {
                     for (unsigned y = yy + yStart; y < yy + yStart + 4; y++) {
-                        // 4bit -> 8bit
-                        result[(y * srcWidth) + x] = ((alphaData & 0xF) << 24) | ((alphaData & 0xF) << 28);
+                        if constexpr (HasAlpha) {
+                            // 4bit -> 8bit
+                            result[(y * srcWidth) + x] = ((alphaData & 0xF) << 24) | ((alphaData & 0xF) << 28);
 
-                        alphaData >>= 4;
+                            alphaData >>= 4;
+                        }
+                        else
+                            result[(y * srcWidth) + x] = 0xFF000000;
                     }
                 }
 
@@ -102,59 +309,81 @@ static void IMPLEMENTATION_FROM_ETC1A4(unsigned char* _result, unsigned srcWidth
     TO implementations (RGBA32 to x)
 */
 
-static void IMPLEMENTATION_TO_ETC1A4(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* _data) {
-    rg_etc1::pack_etc1_block_init();
+template <unsigned BitsPerPixel, void (*PackTile)(unsigned char*, const uint32_t*)>
+static void IMPLEMENTATION_TO_TILED(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* _data) {
+    const uint32_t* data = reinterpret_cast<const uint32_t*>(_data);
 
-    rg_etc1::etc1_pack_params packerParams;
-    packerParams.m_quality = static_cast<rg_etc1::etc1_quality>(
-        std::min(ConfigManager::getInstance().getConfig().etc1Quality, ETC1Quality::High)
-    );
-    packerParams.m_dithering = false;
+    uint32_t pixels[TILE_PIXEL_COUNT];
 
-    const uint32_t* data = reinterpret_cast<const uint32_t*>(_data);
+    unsigned writeOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 8) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
+            const bool wholeTile = (xx + 8) <= srcWidth && (yy + 8) <= srcHeight;
 
-    // ETC1 packing is extremely slow, so to speed things up we opt to parallelize
-    // the packing process.
+            // Pixels outside of the image are transparent black.
+            for (unsigned i = 0; i < TILE_PIXEL_COUNT; i++) {
+                const unsigned x = xx + MORTON_TABLE.x[i];
+                const unsigned y = yy + MORTON_TABLE.y[i];
 
-    std::vector<std::thread> threads;
+                pixels[i] = (wholeTile || (x < srcWidth && y < srcHeight)) ?
+                    data[(y * srcWidth) + x] : 0x00000000;
+            }
 
-    unsigned numThreads = std::thread::hardware_concurrency();
-    if (numThreads == 0 || numThreads > 16)
-        numThreads = 4;
+            PackTile(result + writeOffset, pixels);
+            writeOffset += TILE_PIXEL_COUNT * BitsPerPixel / 8;
+        }
+    }
+}
 
-    threads.reserve(numThreads);
+template <bool HasAlpha>
+static void IMPLEMENTATION_TO_ETC1(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* _data) {
+    // The bands of an image are packed in parallel; only set up the packer
+    // tables once.
+    static const bool packerInitialized = (rg_etc1::pack_etc1_block_init(), true);
+    (void)packerInitialized;
 
-    unsigned totalTiles = (srcHeight + 7) / 8;
-    unsigned tilesPerThread = (totalTiles + numThreads - 1) / numThreads;
+    const ETC1Quality quality = std::min(
+        ConfigManager::getInstance().getConfig().etc1Quality, ETC1Quality::High
+    );
+
+    rg_etc1::etc1_pack_params packerParams;
+    packerParams.m_quality = static_cast<rg_etc1::etc1_quality>(
+        std::max(static_cast<int>(quality) - static_cast<int>(ETC1Quality::Low), 0)
+    );
+    packerParams.m_dithering = false;
 
-    auto worker = [result, data, srcWidth, &packerParams](unsigned yStart, unsigned yEnd) {
-        unsigned writeOffset = srcWidth * yStart;
+    const uint32_t* data = reinterpret_cast<const uint32_t*>(_data);
 
-        for (unsigned yy = yStart; yy < yEnd; yy += 8) {
-            for (unsigned xx = 0; xx < srcWidth; xx += 8) {
-                for (unsigned z = 0; z < 4; z++) {
-                    unsigned xStart = (z == 1 || z == 3) ? 4 : 0;
-                    unsigned yStart = (z == 2 || z == 3) ? 4 : 0;
+    unsigned writeOffset { 0 };
 
-                    uint32_t pixels[4 * 4];
+    for (unsigned yy = 0; yy < srcHeight; yy += 8) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
+            for (unsigned z = 0; z < 4; z++) {
+                unsigned xStart = (z == 1 || z == 3) ? 4 : 0;
+                unsigned yStart = (z == 2 || z == 3) ? 4 : 0;
 
-                    uint64_t* alphaData = reinterpret_cast<uint64_t*>(result + writeOffset);
-                    writeOffset += 8;
+                uint32_t pixels[4 * 4];
 
-                    uint64_t* blockData = reinterpret_cast<uint64_t*>(result + writeOffset);
+                uint64_t* alphaData = reinterpret_cast<uint64_t*>(result + writeOffset);
+                if constexpr (HasAlpha)
                     writeOffset += 8;
 
-                    // Fill pixels for packing.
-                    uint32_t* currentPixel = pixels;
-                    for (unsigned y = yy + yStart; y < yy + yStart + 4; y++) {
-                        for (unsigned x = xx + xStart; x < xx + xStart + 4; x++) {
-                            *currentPixel = data[(y * srcWidth) + x];
-                            *currentPixel |= 0xFF000000;
-                            currentPixel++;
-                        }
+                uint64_t* blockData = reinterpret_cast<uint64_t*>(result + writeOffset);
+                writeOffset += 8;
+
+                // Fill pixels for packing.
+                uint32_t* currentPixel = pixels;
+                for (unsigned y = yy + yStart; y < yy + yStart + 4; y++) {
+                    for (unsigned x = xx + xStart; x < xx + xStart + 4; x++) {
+                        *currentPixel = data[(y * srcWidth) + x];
+                        *currentPixel |= 0xFF000000;
+                        currentPixel++;
                     }
+                }
 
-                    // Write alpha block.
+                // Write alpha block.
+                if constexpr (HasAlpha) {
                     *alphaData = 0;
                     for (unsigned x = xx + xStart; x < xx + xStart + 4; x++) {
                         for (unsigned y = yy + yStart; y < yy + yStart + 4; y++) {
@@ -162,30 +391,83 @@ static void IMPLEMENTATION_TO_ETC1A4(unsigned char* result, unsigned srcWidth, u
                             *alphaData = (*alphaData >> 4) | (alpha4 << 60);
                         }
                     }
+                }
 
+                // Blocks that were packed before are reused.
+                const ETC1BlockCache::Key cacheKey = ETC1BlockCache::getKey(pixels, static_cast<unsigned>(quality));
+                if (ETC1BlockCache::find(cacheKey, *blockData))
+                    continue;
+
+                if (quality == ETC1Quality::Fast)
+                    ETC1FastPacker::packBlock(blockData, pixels);
+                else
                     rg_etc1::pack_etc1_block(blockData, pixels, packerParams);
 
-                    // Nintendo stores their ETC1 blocks in little- instead of big-endian.
-                    *blockData = BYTESWAP_64(*blockData);
-                }
+                // Nintendo stores their ETC1 blocks in little- instead of big-endian.
+                *blockData = BYTESWAP_64(*blockData);
+
+                ETC1BlockCache::insert(cacheKey, *blockData);
             }
         }
-    };
+    }
+}
 
-    for (unsigned i = 0; i < numThreads; i++) {
-        unsigned tileStart = i * tilesPerThread;
-        unsigned tileEnd = std::min(tileStart + tilesPerThread, totalTiles);
-        if (tileStart >= tileEnd)
-            break;
+// Minimum amount of pixels converted by one thread.
+constexpr unsigned PARALLEL_MIN_PIXELS = 0x8000;
+
+// Every format is made of 8x8 tiles.
+constexpr unsigned TILE_HEIGHT = 8;
 
-        unsigned yStart = tileStart * 8;
-        unsigned yEnd = std::min(tileEnd * 8, srcHeight);
+static unsigned getBitsPerPixel(const ImageFormat format) {
+    switch (format) {
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGBA8888:
+        return 32;
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGB888:
+        return 24;
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGBA5551:
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGB565:
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGBA4444:
+    case ImageFormat::CTPK_IMAGE_FORMAT_LA88:
+    case ImageFormat::CTPK_IMAGE_FORMAT_HL8:
+        return 16;
+    case ImageFormat::CTPK_IMAGE_FORMAT_L8:
+    case ImageFormat::CTPK_IMAGE_FORMAT_A8:
+    case ImageFormat::CTPK_IMAGE_FORMAT_LA44:
+    case ImageFormat::CTPK_IMAGE_FORMAT_ETC1A4:
+        return 8;
+    case ImageFormat::CTPK_IMAGE_FORMAT_L4:
+    case ImageFormat::CTPK_IMAGE_FORMAT_A4:
+    case ImageFormat::CTPK_IMAGE_FORMAT_ETC1:
+        return 4;
 
-        threads.emplace_back(worker, yStart, yEnd);
+    default:
+        return 0;
     }
+}
+
+// Run a conversion on bands of whole tile rows in parallel. The image data of
+// a band is contiguous, so every band is converted like a separate image.
+static void ForEachTileRowBand(
+    const ImageFormat format, const unsigned srcWidth, const unsigned srcHeight,
+    const std::function<void(size_t pixelOffset, size_t dataOffset, unsigned bandHeight)>& func
+) {
+    const unsigned tileRowCount = (srcHeight + TILE_HEIGHT - 1) / TILE_HEIGHT;
+
+    const unsigned tileByteSize = 8 * 8 * getBitsPerPixel(format) / 8;
 
-    for (auto& thread : threads)
-        thread.join();
+    const size_t tileRowByteSize = static_cast<size_t>((srcWidth + 7) / 8) * tileByteSize;
+    const size_t tileRowPixelCount = static_cast<size_t>(srcWidth) * TILE_HEIGHT;
+
+    // ETC1 packing is extremely slow, so it's always split as fine as possible.
+    const size_t grainSize = CTPK::getImageFormatCompressed(format) ?
+        1 : PARALLEL_MIN_PIXELS / std::max<size_t>(tileRowPixelCount, 1);
+
+    ParallelUtil::parallelFor(tileRowCount, grainSize, [&](size_t begin, size_t end) {
+        const unsigned y = static_cast<unsigned>(begin) * TILE_HEIGHT;
+        const unsigned bandHeight = std::min(static_cast<unsigned>(end) * TILE_HEIGHT, srcHeight) - y;
+
+        func(begin * tileRowPixelCount, begin * tileRowByteSize, bandHeight);
+    });
 }
 
 bool CtrImageConvert::toRGBA32(
@@ -197,12 +479,45 @@ bool CtrImageConvert::toRGBA32(
 ) {
     FromImplementation implementation;
     switch (format) {
-	case ImageFormat::CTPK_IMAGE_FORMAT_RGBA4444:
-		implementation = IMPLEMENTATION_FROM_RGBA4444;
-		break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGBA8888:
+        implementation = IMPLEMENTATION_FROM_TILED<32, UNPACK_RGBA8888>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGB888:
+        implementation = IMPLEMENTATION_FROM_TILED<24, UNPACK_RGB888>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGBA5551:
+        implementation = IMPLEMENTATION_FROM_TILED<16, UNPACK_RGBA5551>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGB565:
+        implementation = IMPLEMENTATION_FROM_TILED<16, UNPACK_RGB565>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGBA4444:
+        implementation = IMPLEMENTATION_FROM_TILED<16, UNPACK_RGBA4444>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_LA88:
+        implementation = IMPLEMENTATION_FROM_TILED<16, UNPACK_LA88>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_L8:
+        implementation = IMPLEMENTATION_FROM_TILED<8, UNPACK_L8>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_A8:
+        implementation = IMPLEMENTATION_FROM_TILED<8, UNPACK_A8>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_LA44:
+        implementation = IMPLEMENTATION_FROM_TILED<8, UNPACK_LA44>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_L4:
+        implementation = IMPLEMENTATION_FROM_TILED<4, UNPACK_L4>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_A4:
+        implementation = IMPLEMENTATION_FROM_TILED<4, UNPACK_A4>;
+        break;
 
+    case ImageFormat::CTPK_IMAGE_FORMAT_ETC1:
+        implementation = IMPLEMENTATION_FROM_ETC1<false>;
+        break;
     case ImageFormat::CTPK_IMAGE_FORMAT_ETC1A4:
-        implementation = IMPLEMENTATION_FROM_ETC1A4;
+        implementation = IMPLEMENTATION_FROM_ETC1<true>;
         break;
 
     default:
@@ -213,7 +528,9 @@ bool CtrImageConvert::toRGBA32(
         return false;
     }
 
-    implementation(buffer, srcWidth, srcHeight, data);
+    ForEachTileRowBand(format, srcWidth, srcHeight, [&](size_t pixelOffset, size_t dataOffset, unsigned bandHeight) {
+        implementation(buffer + pixelOffset * 4, srcWidth, bandHeight, data + dataOffset);
+    });
 
     return true;
 }
@@ -239,15 +556,54 @@ bool CtrImageConvert::fromRGBA32(
 ) {
     ToImplementation implementation;
     switch (format) {
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGBA8888:
+        implementation = IMPLEMENTATION_TO_TILED<32, PACK_RGBA8888>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGB888:
+        implementation = IMPLEMENTATION_TO_TILED<24, PACK_RGB888>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGBA5551:
+        implementation = IMPLEMENTATION_TO_TILED<16, PACK_RGBA5551>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGB565:
+        implementation = IMPLEMENTATION_TO_TILED<16, PACK_RGB565>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_RGBA4444:
+        implementation = IMPLEMENTATION_TO_TILED<16, PACK_RGBA4444>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_LA88:
+        implementation = IMPLEMENTATION_TO_TILED<16, PACK_LA88>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_L8:
+        implementation = IMPLEMENTATION_TO_TILED<8, PACK_L8>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_A8:
+        implementation = IMPLEMENTATION_TO_TILED<8, PACK_A8>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_LA44:
+        implementation = IMPLEMENTATION_TO_TILED<8, PACK_LA44>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_L4:
+        implementation = IMPLEMENTATION_TO_TILED<4, PACK_L4>;
+        break;
+    case ImageFormat::CTPK_IMAGE_FORMAT_A4:
+        implementation = IMPLEMENTATION_TO_TILED<4, PACK_A4>;
+        break;
+
+    case ImageFormat::CTPK_IMAGE_FORMAT_ETC1:
+        implementation = IMPLEMENTATION_TO_ETC1<false>;
+        break;
     case ImageFormat::CTPK_IMAGE_FORMAT_ETC1A4:
-        implementation = IMPLEMENTATION_TO_ETC1A4;
+        implementation = IMPLEMENTATION_TO_ETC1<true>;
         break;
 
     default:
         return false;
     }
 
-    implementation(buffer, srcWidth, srcHeight, data);
+    ForEachTileRowBand(format, srcWidth, srcHeight, [&](size_t pixelOffset, size_t dataOffset, unsigned bandHeight) {
+        implementation(buffer + dataOffset, srcWidth, bandHeight, data + pixelOffset * 4);
+    });
 
     return true;
 }
@@ -279,30 +635,38 @@ static unsigned ImageByteSize_ETC1(unsigned width, unsigned height) {
    	return tilesX * tilesY * 8;
 }
 
+static unsigned ImageByteSize_Tiled(unsigned width, unsigned height, unsigned bitsPerPixel) {
+    unsigned tilesX = (width + 7) / 8;
+    unsigned tilesY = (height + 7) / 8;
+
+    return tilesX * tilesY * (8 * 8 * bitsPerPixel / 8);
+}
+
 unsigned CtrImageConvert::getImageByteSize(const ImageFormat type, unsigned width, unsigned height, unsigned mipCount) {
+    const unsigned bitsPerPixel = getBitsPerPixel(type);
+    if (bitsPerPixel == 0) {
+        Logging::error("[CtrImageConvert::getImageByteSize] Invalid format passed ({})", static_cast<int>(type));
+        return 0;
+    }
+
     unsigned sum = 0;
 
-    switch (type) {
-    case ImageFormat::CTPK_IMAGE_FORMAT_ETC1A4: {
-        for (unsigned i = 0; i < mipCount; i++) {
+    for (unsigned i = 0; i < mipCount; i++) {
+        switch (type) {
+        case ImageFormat::CTPK_IMAGE_FORMAT_ETC1A4:
             sum += ImageByteSize_ETC1A4(width, height);
-
-            width = (width > 1) ? width / 2 : 1;
-            height = (height > 1) ? height / 2 : 1;
-        }
-    } break;
-    case ImageFormat::CTPK_IMAGE_FORMAT_ETC1: {
-        for (unsigned i = 0; i < mipCount; i++) {
+            break;
+        case ImageFormat::CTPK_IMAGE_FORMAT_ETC1:
             sum += ImageByteSize_ETC1(width, height);
+            break;
 
-            width = (width > 1) ? width / 2 : 1;
-            height = (height > 1) ? height / 2 : 1;
+        default:
+            sum += ImageByteSize_Tiled(width, height, bitsPerPixel);
+            break;
         }
-    } break;
 
-    default:
-        Logging::error("[CtrImageConvert::getImageByteSize] Invalid format passed ({})", static_cast<int>(type));
-        break;
+        width = (width > 1) ? width / 2 : 1;
+        height = (height > 1) ? height / 2 : 1;
     }
 
     return sum;
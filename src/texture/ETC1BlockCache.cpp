@@ -0,0 +1,321 @@
+#include "ETC1BlockCache.hpp"
+
+#include <cstring>
+
+#include <array>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+
+#include <mutex>
+
+#include <fstream>
+#include <filesystem>
+
+#include <chrono>
+#include <random>
+#include <string>
+#include <thread>
+
+#include <cstdio>
+
+#include "Logging.hpp"
+
+#include "util/FileUtil.hpp"
+
+#include "Macro.hpp"
+
+static constexpr const char* CACHE_PATH = "toast.etc1cache.bin";
+// Held by the process that is merging into the cache file.
+static constexpr const char* CACHE_LOCK_PATH = "toast.etc1cache.lock";
+
+// A lock older than this was left behind by a process that died.
+static constexpr auto STALE_LOCK_AGE = std::chrono::seconds(30);
+// How long to wait for another process to finish flushing.
+static constexpr auto LOCK_TIMEOUT = std::chrono::seconds(5);
+
+static constexpr uint32_t CACHE_MAGIC = IDENTIFIER_TO_U32('T','E','T','C');
+static constexpr uint32_t CACHE_VERSION = 3;
+
+// Blocks kept in memory & in the cache file (24 bytes each); the oldest ones
+// are dropped first.
+static constexpr size_t MAX_ENTRIES = 1 << 20;
+
+// Lookups from the bands of an image that are packed in parallel are spread
+// over a few maps, so that they rarely wait on each other.
+static constexpr unsigned SHARD_COUNT = 16;
+
+static constexpr size_t MAX_SHARD_ENTRIES = MAX_ENTRIES / SHARD_COUNT;
+
+namespace {
+
+struct CacheFileHeader {
+    uint32_t magic;
+    uint32_t version;
+};
+
+struct CacheFileEntry {
+    uint64_t hash;
+    uint64_t check;
+    uint64_t block;
+};
+
+struct CacheBlock {
+    uint64_t check;
+    uint64_t block;
+};
+
+struct CacheShard {
+    std::mutex mtx;
+    std::unordered_map<uint64_t, CacheBlock> blocks;
+
+    // Hashes in the order they were added, to drop the oldest.
+    std::deque<uint64_t> order;
+
+    // Returns: false if there already is a block with this hash.
+    bool add(const CacheFileEntry& entry) {
+        if (!blocks.emplace(entry.hash, CacheBlock { entry.check, entry.block }).second)
+            return false;
+
+        order.push_back(entry.hash);
+
+        if (order.size() > MAX_SHARD_ENTRIES) {
+            blocks.erase(order.front());
+            order.pop_front();
+        }
+
+        return true;
+    }
+};
+
+struct Cache {
+    std::array<CacheShard, SHARD_COUNT> shards;
+
+    // Blocks that aren't in the cache file yet.
+    std::deque<CacheFileEntry> pendingEntries;
+    std::mutex pendingMtx;
+
+    CacheShard& getShard(uint64_t hash) {
+        return shards[(hash >> 60) & (SHARD_COUNT - 1)];
+    }
+};
+
+} // namespace
+
+// Read the entries of the cache file, oldest first.
+//
+// Returns: false if the file doesn't exist or is invalid.
+static bool ReadCacheFile(std::vector<CacheFileEntry>& entries) {
+    auto data = FileUtil::openFileData(CACHE_PATH);
+    if (!data.has_value())
+        return false;
+
+    CacheFileHeader header {};
+    if (data->size() >= sizeof(CacheFileHeader))
+        memcpy(&header, data->data(), sizeof(CacheFileHeader));
+
+    if (header.magic != CACHE_MAGIC || header.version != CACHE_VERSION)
+        return false;
+
+    // A partially written entry at the end is ignored.
+    const size_t entryCount = (data->size() - sizeof(CacheFileHeader)) / sizeof(CacheFileEntry);
+
+    entries.resize(entryCount);
+    memcpy(entries.data(), data->data() + sizeof(CacheFileHeader), entryCount * sizeof(CacheFileEntry));
+
+    return true;
+}
+
+// Replace the cache file. It is written under a name of its own & renamed over
+// the cache file, so readers never see it half-written.
+static bool WriteCacheFile(const std::vector<CacheFileEntry>& entries) {
+    std::random_device randomDevice;
+    const std::string tempPath = std::string(CACHE_PATH) + ".tmp" +
+        std::to_string(randomDevice()) +
+        std::to_string(std::chrono::steady_clock::now().time_since_epoch().count());
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+
+        const CacheFileHeader header { .magic = CACHE_MAGIC, .version = CACHE_VERSION };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+        file.write(
+            reinterpret_cast<const char*>(entries.data()),
+            entries.size() * sizeof(CacheFileEntry)
+        );
+
+        if (!file.good())
+            return false;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, CACHE_PATH, error);
+    if (error) {
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    return true;
+}
+
+// Lock the cache file against other processes by creating the lock file
+// (exclusive create fails if it exists).
+//
+// Returns: false if the lock couldn't be taken in time.
+static bool LockCacheFile() {
+    const auto startTime = std::chrono::steady_clock::now();
+
+    while (true) {
+        if (FILE* file = std::fopen(CACHE_LOCK_PATH, "wx")) {
+            std::fclose(file);
+            return true;
+        }
+
+        std::error_code error;
+        const auto writeTime = std::filesystem::last_write_time(CACHE_LOCK_PATH, error);
+        if (!error && std::filesystem::file_time_type::clock::now() - writeTime > STALE_LOCK_AGE) {
+            std::filesystem::remove(CACHE_LOCK_PATH, error);
+            continue;
+        }
+
+        if (std::chrono::steady_clock::now() - startTime > LOCK_TIMEOUT)
+            return false;
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+static void UnlockCacheFile() {
+    std::error_code error;
+    std::filesystem::remove(CACHE_LOCK_PATH, error);
+}
+
+static Cache sCache;
+static std::once_flag sLoadFlag;
+
+// The cache, loaded from the cache file on first use.
+static Cache& GetCache() {
+    Cache& cache = sCache;
+
+    std::call_once(sLoadFlag, [&cache]() {
+        std::vector<CacheFileEntry> entries;
+        if (!ReadCacheFile(entries)) {
+            if (FileUtil::doesFileExist(CACHE_PATH))
+                Logging::warn("[ETC1BlockCache] Cache file is invalid or outdated; starting over.");
+            return;
+        }
+
+        for (const auto& entry : entries)
+            cache.getShard(entry.hash).add(entry);
+
+        Logging::info("[ETC1BlockCache] Loaded {} cached blocks.", entries.size());
+    });
+
+    return cache;
+}
+
+static inline uint64_t MixBits(uint64_t value) {
+    value ^= value >> 33;
+    value *= 0xFF51AFD7ED558CCDull;
+    value ^= value >> 33;
+    value *= 0xC4CEB9FE1A85EC53ull;
+    value ^= value >> 33;
+    return value;
+}
+
+ETC1BlockCache::Key ETC1BlockCache::getKey(const uint32_t* pixels, unsigned quality) {
+    uint64_t hash = MixBits(0x45544331ull + quality);
+
+    // FNV-1a over the bytes; unrelated to the hash above.
+    uint64_t check = 0xCBF29CE484222325ull ^ quality;
+
+    for (unsigned i = 0; i < 16; i += 2) {
+        const uint64_t pair =
+            static_cast<uint64_t>(pixels[i] & 0x00FFFFFF) |
+            (static_cast<uint64_t>(pixels[i + 1] & 0x00FFFFFF) << 32);
+
+        hash = MixBits(hash ^ pair) + i;
+
+        for (unsigned j = 0; j < 8; j++) {
+            check ^= (pair >> (j * 8)) & 0xFF;
+            check *= 0x100000001B3ull;
+        }
+    }
+
+    return Key { hash, check };
+}
+
+bool ETC1BlockCache::find(const Key& key, uint64_t& blockOut) {
+    CacheShard& shard = GetCache().getShard(key.hash);
+
+    std::lock_guard<std::mutex> lock(shard.mtx);
+
+    auto it = shard.blocks.find(key.hash);
+    if (it == shard.blocks.end() || it->second.check != key.check)
+        return false;
+
+    blockOut = it->second.block;
+    return true;
+}
+
+void ETC1BlockCache::insert(const Key& key, uint64_t block) {
+    Cache& cache = GetCache();
+
+    const CacheFileEntry entry { key.hash, key.check, block };
+
+    {
+        CacheShard& shard = cache.getShard(key.hash);
+
+        // On a collision, the block that is there is kept.
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        if (!shard.add(entry))
+            return;
+    }
+
+    std::lock_guard<std::mutex> lock(cache.pendingMtx);
+    cache.pendingEntries.push_back(entry);
+
+    // If flushing keeps failing, only the newest blocks are kept around.
+    if (cache.pendingEntries.size() > MAX_ENTRIES)
+        cache.pendingEntries.pop_front();
+}
+
+void ETC1BlockCache::flush() {
+    // Only the pending blocks are needed; if the cache was never used, it
+    // isn't loaded just to find there's nothing to write.
+    Cache& cache = sCache;
+
+    std::lock_guard<std::mutex> lock(cache.pendingMtx);
+    if (cache.pendingEntries.empty())
+        return;
+
+    if (!LockCacheFile()) {
+        Logging::warn("[ETC1BlockCache::flush] The cache file is locked by another process; trying again next time.");
+        return;
+    }
+
+    // Merge with the file as it is now; another process may have added to it
+    // since it was loaded.
+    std::vector<CacheFileEntry> entries;
+    ReadCacheFile(entries);
+
+    entries.insert(entries.end(), cache.pendingEntries.begin(), cache.pendingEntries.end());
+    if (entries.size() > MAX_ENTRIES)
+        entries.erase(entries.begin(), entries.end() - MAX_ENTRIES);
+
+    const bool written = WriteCacheFile(entries);
+
+    UnlockCacheFile();
+
+    if (!written) {
+        Logging::error("[ETC1BlockCache::flush] Unable to write to the cache file ({}).", CACHE_PATH);
+        return;
+    }
+
+    Logging::info("[ETC1BlockCache::flush] Cached {} new blocks.", cache.pendingEntries.size());
+
+    cache.pendingEntries.clear();
+}
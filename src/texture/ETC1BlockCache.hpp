@@ -0,0 +1,44 @@
+#ifndef ETC1_BLOCK_CACHE_HPP
+#define ETC1_BLOCK_CACHE_HPP
+
+#include <cstdint>
+
+/*
+    Persistent cache of packed ETC1 blocks.
+
+    Packing ETC1 is extremely slow & isn't deterministic, so every packed 4x4
+    block is remembered by the hash of its pixels & the quality it was packed
+    with. Blocks that didn't change since they were last packed (in this run or
+    a previous one) are taken from the cache, which makes re-saving a sheet
+    fast & its output stable.
+
+    The cache is loaded on first use & holds a bounded amount of blocks, the
+    oldest ones being dropped first. On flush(), new blocks are merged with
+    the cache file as it is then, under a lock file, & the result replaces it
+    (written to a temporary file that is renamed over it), so several
+    processes can share the file.
+*/
+
+namespace ETC1BlockCache {
+
+// Key of a block of 4x4 RGBA32 pixels; the alpha channel is ignored. It is two
+// independent hashes: one finds the entry & the other is checked on a hit, so
+// a collision of the first doesn't return the block of other pixels.
+struct Key {
+    uint64_t hash;
+    uint64_t check;
+};
+
+Key getKey(const uint32_t* pixels, unsigned quality);
+
+bool find(const Key& key, uint64_t& blockOut);
+void insert(const Key& key, uint64_t block);
+
+// Write the blocks inserted since the last flush to the cache file. This
+// rewrites the whole file, so it's done once per exported archive (& on exit),
+// not per texture.
+void flush();
+
+} // namespace ETC1BlockCache
+
+#endif // ETC1_BLOCK_CACHE_HPP
@@ -0,0 +1,473 @@
+#include "ETC1FastPacker.hpp"
+
+#include <cstring>
+
+#include <algorithm>
+#include <iterator>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// The kernels are compiled for their instruction set per function, so the
+// rest of the program doesn't require it; they are only called if the CPU
+// supports it.
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+#define HAS_X86_KERNELS
+#endif
+
+namespace {
+
+// Modifiers of each table, in the order of the pixel index values.
+constexpr int MODIFIER_TABLE[8][4] = {
+    {  2,   8,  -2,   -8 },
+    {  5,  17,  -5,  -17 },
+    {  9,  29,  -9,  -29 },
+    { 13,  42, -13,  -42 },
+    { 18,  60, -18,  -60 },
+    { 24,  80, -24,  -80 },
+    { 33, 106, -33, -106 },
+    { 47, 183, -47, -183 }
+};
+
+// The pixels of each subblock for both flips: the index of the pixel in the
+// (row-major) source block & the bit of the pixel in the index words.
+struct SubblockLayout {
+    unsigned char pixelIndex[8];
+    unsigned char bitIndex[8];
+};
+
+constexpr SubblockLayout SUBBLOCK_LAYOUTS[2][2] = {
+    // Flip 0: left & right halves.
+    {
+        { { 0, 4, 8, 12, 1, 5, 9, 13 }, { 0, 1, 2, 3, 4, 5, 6, 7 } },
+        { { 2, 6, 10, 14, 3, 7, 11, 15 }, { 8, 9, 10, 11, 12, 13, 14, 15 } }
+    },
+    // Flip 1: top & bottom halves.
+    {
+        { { 0, 1, 2, 3, 4, 5, 6, 7 }, { 0, 4, 8, 12, 1, 5, 9, 13 } },
+        { { 8, 9, 10, 11, 12, 13, 14, 15 }, { 2, 6, 10, 14, 3, 7, 11, 15 } }
+    }
+};
+
+// The eight pixels of a subblock as 16-bit lanes: (R | G << 16) & B.
+struct SubblockPixels {
+    alignas(32) uint32_t rg[8];
+    alignas(32) uint32_t b[8];
+};
+
+struct SubblockFit {
+    uint32_t error;
+    unsigned table;
+    unsigned char selectors[8];
+};
+
+// The colors a subblock with a given base color can hold, per table &
+// modifier, as (R | G << 16) & B.
+struct SubblockColors {
+    uint32_t rg[8][4];
+    uint32_t b[8][4];
+};
+
+// Find the table with the least error for a subblock. On equal errors the
+// lower table & pixel index value is taken.
+typedef void (*FitSubblockFunc)(const SubblockPixels& pixels, const SubblockColors& colors, SubblockFit& fit);
+
+inline int Clamp255(int value) {
+    return std::clamp(value, 0, 255);
+}
+
+void GetSubblockColors(const int base[3], SubblockColors& colors) {
+    for (unsigned table = 0; table < 8; table++) {
+        for (unsigned selector = 0; selector < 4; selector++) {
+            const int modifier = MODIFIER_TABLE[table][selector];
+
+            colors.rg[table][selector] =
+                Clamp255(base[0] + modifier) | (Clamp255(base[1] + modifier) << 16);
+            colors.b[table][selector] = Clamp255(base[2] + modifier);
+        }
+    }
+}
+
+void FitSubblock_Scalar(const SubblockPixels& pixels, const SubblockColors& colors, SubblockFit& fit) {
+    fit.error = UINT32_MAX;
+
+    for (unsigned table = 0; table < 8; table++) {
+        uint32_t keys[8];
+        std::fill(std::begin(keys), std::end(keys), UINT32_MAX);
+
+        for (unsigned selector = 0; selector < 4; selector++) {
+            const uint32_t candidateRG = colors.rg[table][selector];
+            const uint32_t candidateB = colors.b[table][selector];
+
+            for (unsigned i = 0; i < 8; i++) {
+                const int dr = static_cast<int>(pixels.rg[i] & 0xFFFF) - static_cast<int>(candidateRG & 0xFFFF);
+                const int dg = static_cast<int>(pixels.rg[i] >> 16) - static_cast<int>(candidateRG >> 16);
+                const int db = static_cast<int>(pixels.b[i]) - static_cast<int>(candidateB);
+
+                const uint32_t key = (static_cast<uint32_t>(dr * dr + dg * dg + db * db) << 2) | selector;
+                keys[i] = std::min(keys[i], key);
+            }
+        }
+
+        uint32_t error = 0;
+        for (unsigned i = 0; i < 8; i++)
+            error += keys[i] >> 2;
+
+        if (error < fit.error) {
+            fit.error = error;
+            fit.table = table;
+            for (unsigned i = 0; i < 8; i++)
+                fit.selectors[i] = keys[i] & 3;
+        }
+    }
+}
+
+#ifdef HAS_X86_KERNELS
+
+TARGET_SSE41 void FitSubblock_SSE41(const SubblockPixels& pixels, const SubblockColors& colors, SubblockFit& fit) {
+    const __m128i rg0 = _mm_load_si128(reinterpret_cast<const __m128i*>(pixels.rg));
+    const __m128i rg1 = _mm_load_si128(reinterpret_cast<const __m128i*>(pixels.rg + 4));
+    const __m128i b0 = _mm_load_si128(reinterpret_cast<const __m128i*>(pixels.b));
+    const __m128i b1 = _mm_load_si128(reinterpret_cast<const __m128i*>(pixels.b + 4));
+
+    fit.error = UINT32_MAX;
+
+    for (unsigned table = 0; table < 8; table++) {
+        __m128i keys0 = _mm_set1_epi32(-1);
+        __m128i keys1 = _mm_set1_epi32(-1);
+
+        for (unsigned selector = 0; selector < 4; selector++) {
+            const __m128i crg = _mm_set1_epi32(static_cast<int>(colors.rg[table][selector]));
+            const __m128i cb = _mm_set1_epi32(static_cast<int>(colors.b[table][selector]));
+            const __m128i sel = _mm_set1_epi32(static_cast<int>(selector));
+
+            const __m128i drg0 = _mm_sub_epi16(rg0, crg);
+            const __m128i drg1 = _mm_sub_epi16(rg1, crg);
+            const __m128i db0 = _mm_sub_epi16(b0, cb);
+            const __m128i db1 = _mm_sub_epi16(b1, cb);
+
+            const __m128i err0 = _mm_add_epi32(_mm_madd_epi16(drg0, drg0), _mm_madd_epi16(db0, db0));
+            const __m128i err1 = _mm_add_epi32(_mm_madd_epi16(drg1, drg1), _mm_madd_epi16(db1, db1));
+
+            keys0 = _mm_min_epu32(keys0, _mm_or_si128(_mm_slli_epi32(err0, 2), sel));
+            keys1 = _mm_min_epu32(keys1, _mm_or_si128(_mm_slli_epi32(err1, 2), sel));
+        }
+
+        __m128i sum = _mm_add_epi32(_mm_srli_epi32(keys0, 2), _mm_srli_epi32(keys1, 2));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        const uint32_t error = static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+        if (error < fit.error) {
+            fit.error = error;
+            fit.table = table;
+
+            const __m128i selectors = _mm_packus_epi32(
+                _mm_and_si128(keys0, _mm_set1_epi32(3)),
+                _mm_and_si128(keys1, _mm_set1_epi32(3))
+            );
+            _mm_storel_epi64(
+                reinterpret_cast<__m128i*>(fit.selectors),
+                _mm_packus_epi16(selectors, selectors)
+            );
+        }
+    }
+}
+
+TARGET_AVX2 void FitSubblock_AVX2(const SubblockPixels& pixels, const SubblockColors& colors, SubblockFit& fit) {
+    const __m256i rg = _mm256_load_si256(reinterpret_cast<const __m256i*>(pixels.rg));
+    const __m256i b = _mm256_load_si256(reinterpret_cast<const __m256i*>(pixels.b));
+
+    fit.error = UINT32_MAX;
+
+    for (unsigned table = 0; table < 8; table++) {
+        __m256i keys = _mm256_set1_epi32(-1);
+
+        for (unsigned selector = 0; selector < 4; selector++) {
+            const __m256i crg = _mm256_set1_epi32(static_cast<int>(colors.rg[table][selector]));
+            const __m256i cb = _mm256_set1_epi32(static_cast<int>(colors.b[table][selector]));
+
+            const __m256i drg = _mm256_sub_epi16(rg, crg);
+            const __m256i db = _mm256_sub_epi16(b, cb);
+
+            const __m256i err = _mm256_add_epi32(_mm256_madd_epi16(drg, drg), _mm256_madd_epi16(db, db));
+
+            keys = _mm256_min_epu32(
+                keys,
+                _mm256_or_si256(_mm256_slli_epi32(err, 2), _mm256_set1_epi32(static_cast<int>(selector)))
+            );
+        }
+
+        const __m256i errors = _mm256_srli_epi32(keys, 2);
+
+        __m128i sum = _mm_add_epi32(_mm256_castsi256_si128(errors), _mm256_extracti128_si256(errors, 1));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+
+        const uint32_t error = static_cast<uint32_t>(_mm_cvtsi128_si32(sum));
+        if (error < fit.error) {
+            fit.error = error;
+            fit.table = table;
+
+            const __m256i selectors32 = _mm256_and_si256(keys, _mm256_set1_epi32(3));
+            const __m128i selectors16 = _mm_packus_epi32(
+                _mm256_castsi256_si128(selectors32), _mm256_extracti128_si256(selectors32, 1)
+            );
+            _mm_storel_epi64(
+                reinterpret_cast<__m128i*>(fit.selectors),
+                _mm_packus_epi16(selectors16, selectors16)
+            );
+        }
+    }
+}
+
+#endif // HAS_X86_KERNELS
+
+FitSubblockFunc GetFitSubblock(ETC1FastPacker::PackISA isa) {
+    switch (isa) {
+#ifdef HAS_X86_KERNELS
+    case ETC1FastPacker::PackISA::SSE41:
+        return FitSubblock_SSE41;
+    case ETC1FastPacker::PackISA::AVX2:
+        return FitSubblock_AVX2;
+#endif
+    default:
+        return FitSubblock_Scalar;
+    }
+}
+
+// Quantize the sum of the eight values of a subblock to an average of the
+// given amount of bits (rounded to nearest).
+template <unsigned Bits>
+inline int QuantizeSum(int sum) {
+    constexpr int MAX = (1 << Bits) - 1;
+    return (std::clamp(sum, 0, 8 * 255) * MAX + 8 * 255 / 2) / (8 * 255);
+}
+
+inline int Expand4(int value) {
+    return (value << 4) | value;
+}
+inline int Expand5(int value) {
+    return (value << 3) | (value >> 2);
+}
+
+// Refinement passes over the best candidate; most blocks stop improving
+// after one or two.
+constexpr unsigned REFINE_PASSES = 3;
+
+struct BlockCandidate {
+    uint32_t error { UINT32_MAX };
+
+    bool flip;
+    bool differential;
+
+    // 4-bit (individual) or 5-bit (differential) base colors.
+    int colors[2][3];
+
+    SubblockFit fits[2];
+};
+
+// Set the base colors of a candidate to the averages of its subblocks, given
+// as sums of eight values.
+void SetBaseColors(BlockCandidate& candidate, const int sums[2][3]) {
+    for (unsigned c = 0; c < 3; c++) {
+        if (candidate.differential) {
+            // The second color is moved as close as the delta allows.
+            const int color0 = QuantizeSum<5>(sums[0][c]);
+            const int color1 = color0 + std::clamp(QuantizeSum<5>(sums[1][c]) - color0, -4, 3);
+
+            candidate.colors[0][c] = color0;
+            candidate.colors[1][c] = color1;
+        }
+        else {
+            candidate.colors[0][c] = QuantizeSum<4>(sums[0][c]);
+            candidate.colors[1][c] = QuantizeSum<4>(sums[1][c]);
+        }
+    }
+}
+
+void FitCandidate(FitSubblockFunc fitSubblock, const SubblockPixels subblocks[2], BlockCandidate& candidate) {
+    candidate.error = 0;
+
+    for (unsigned s = 0; s < 2; s++) {
+        int base[3];
+        for (unsigned c = 0; c < 3; c++) {
+            base[c] = candidate.differential ?
+                Expand5(candidate.colors[s][c]) : Expand4(candidate.colors[s][c]);
+        }
+
+        SubblockColors colors;
+        GetSubblockColors(base, colors);
+
+        fitSubblock(subblocks[s], colors, candidate.fits[s]);
+        candidate.error += candidate.fits[s].error;
+    }
+}
+
+// Sums of the base colors that suit the chosen modifiers best (ignoring
+// clamping): the pixels minus their modifiers.
+void GetRefinedSums(const SubblockPixels subblocks[2], const BlockCandidate& candidate, int sums[2][3]) {
+    for (unsigned s = 0; s < 2; s++) {
+        const SubblockFit& fit = candidate.fits[s];
+
+        sums[s][0] = sums[s][1] = sums[s][2] = 0;
+
+        for (unsigned i = 0; i < 8; i++) {
+            const int modifier = MODIFIER_TABLE[fit.table][fit.selectors[i]];
+
+            sums[s][0] += static_cast<int>(subblocks[s].rg[i] & 0xFFFF) - modifier;
+            sums[s][1] += static_cast<int>(subblocks[s].rg[i] >> 16) - modifier;
+            sums[s][2] += static_cast<int>(subblocks[s].b[i]) - modifier;
+        }
+    }
+}
+
+void WriteBlock(unsigned char* out, const BlockCandidate& candidate) {
+    for (unsigned c = 0; c < 3; c++) {
+        if (candidate.differential) {
+            const int delta = candidate.colors[1][c] - candidate.colors[0][c];
+            out[c] = static_cast<unsigned char>((candidate.colors[0][c] << 3) | (delta & 7));
+        }
+        else
+            out[c] = static_cast<unsigned char>((candidate.colors[0][c] << 4) | candidate.colors[1][c]);
+    }
+
+    out[3] = static_cast<unsigned char>(
+        (candidate.fits[0].table << 5) | (candidate.fits[1].table << 2) |
+        (candidate.differential << 1) | candidate.flip
+    );
+
+    unsigned msb = 0, lsb = 0;
+
+    for (unsigned s = 0; s < 2; s++) {
+        const SubblockLayout& layout = SUBBLOCK_LAYOUTS[candidate.flip][s];
+
+        for (unsigned i = 0; i < 8; i++) {
+            const unsigned selector = candidate.fits[s].selectors[i];
+
+            msb |= (selector >> 1) << layout.bitIndex[i];
+            lsb |= (selector & 1) << layout.bitIndex[i];
+        }
+    }
+
+    out[4] = static_cast<unsigned char>(msb >> 8);
+    out[5] = static_cast<unsigned char>(msb);
+    out[6] = static_cast<unsigned char>(lsb >> 8);
+    out[7] = static_cast<unsigned char>(lsb);
+}
+
+} // namespace
+
+const char* ETC1FastPacker::getPackISAName(PackISA isa) {
+    switch (isa) {
+    case PackISA::Scalar:
+        return "Scalar";
+    case PackISA::SSE41:
+        return "SSE4.1";
+    case PackISA::AVX2:
+        return "AVX2";
+
+    default:
+        return "Unknown";
+    }
+}
+
+bool ETC1FastPacker::isPackISASupported(PackISA isa) {
+    switch (isa) {
+    case PackISA::Scalar:
+        return true;
+
+#ifdef HAS_X86_KERNELS
+    case PackISA::SSE41:
+        return __builtin_cpu_supports("sse4.1");
+    case PackISA::AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+
+    default:
+        return false;
+    }
+}
+
+ETC1FastPacker::PackISA ETC1FastPacker::getBestPackISA() {
+    static const PackISA bestISA = []() {
+        for (PackISA isa : { PackISA::AVX2, PackISA::SSE41 }) {
+            if (isPackISASupported(isa))
+                return isa;
+        }
+        return PackISA::Scalar;
+    }();
+    return bestISA;
+}
+
+unsigned ETC1FastPacker::packBlock(void* block, const uint32_t* pixels) {
+    return packBlock(getBestPackISA(), block, pixels);
+}
+
+unsigned ETC1FastPacker::packBlock(PackISA isa, void* block, const uint32_t* pixels) {
+    const FitSubblockFunc fitSubblock = GetFitSubblock(isa);
+
+    BlockCandidate best;
+    SubblockPixels bestSubblocks[2];
+
+    for (unsigned flip = 0; flip < 2; flip++) {
+        SubblockPixels subblocks[2];
+        int sums[2][3] {};
+
+        for (unsigned s = 0; s < 2; s++) {
+            const SubblockLayout& layout = SUBBLOCK_LAYOUTS[flip][s];
+
+            for (unsigned i = 0; i < 8; i++) {
+                const uint32_t pixel = pixels[layout.pixelIndex[i]];
+
+                const unsigned r = (pixel >> 0) & 0xFF;
+                const unsigned g = (pixel >> 8) & 0xFF;
+                const unsigned b = (pixel >> 16) & 0xFF;
+
+                subblocks[s].rg[i] = r | (g << 16);
+                subblocks[s].b[i] = b;
+
+                sums[s][0] += r;
+                sums[s][1] += g;
+                sums[s][2] += b;
+            }
+        }
+
+        for (unsigned mode = 0; mode < 2; mode++) {
+            BlockCandidate candidate;
+            candidate.flip = flip != 0;
+            candidate.differential = mode != 0;
+
+            SetBaseColors(candidate, sums);
+            FitCandidate(fitSubblock, subblocks, candidate);
+
+            if (candidate.error < best.error) {
+                best = candidate;
+                bestSubblocks[0] = subblocks[0];
+                bestSubblocks[1] = subblocks[1];
+            }
+        }
+    }
+
+    // Move the base colors of the best candidate to suit the chosen modifiers.
+    for (unsigned pass = 0; pass < REFINE_PASSES && best.error != 0; pass++) {
+        BlockCandidate refined = best;
+
+        int refinedSums[2][3];
+        GetRefinedSums(bestSubblocks, best, refinedSums);
+
+        SetBaseColors(refined, refinedSums);
+        FitCandidate(fitSubblock, bestSubblocks, refined);
+
+        if (refined.error >= best.error)
+            break;
+
+        best = refined;
+    }
+
+    WriteBlock(static_cast<unsigned char*>(block), best);
+
+    return best.error;
+}
@@ -0,0 +1,48 @@
+#ifndef ETC1_FAST_PACKER_HPP
+#define ETC1_FAST_PACKER_HPP
+
+#include <cstdint>
+
+/*
+    Fast ETC1 block packer (ETC1Quality::Fast).
+
+    Unlike rg_etc1, the base colors aren't searched for: both flips are tried
+    in individual & differential mode with the averages of the subblocks as
+    base colors, and every table is tried for each subblock. The error of all
+    table & modifier pairs is computed for the eight pixels of a subblock at
+    once. The best candidate is then refined by moving its base colors to
+    suit the chosen modifiers.
+
+    The target is to stay within 1.5 dB PSNR of rg_etc1 Medium on sprite
+    sheets; toast-bench-etc1-pack measures both.
+*/
+
+namespace ETC1FastPacker {
+
+enum class PackISA {
+    Scalar,
+    SSE41,
+    AVX2,
+
+    Count
+};
+
+const char* getPackISAName(PackISA isa);
+
+bool isPackISASupported(PackISA isa);
+
+// The best instruction set supported by the running CPU.
+PackISA getBestPackISA();
+
+// Pack 4x4 RGBA32 pixels (row-major, R in the lowest byte) to an ETC1 block,
+// in the byte order rg_etc1::pack_etc1_block writes. The alpha channel is
+// ignored. Returns the squared RGB error of the block.
+//
+// Every instruction set produces the same block.
+unsigned packBlock(void* block, const uint32_t* pixels);
+// The instruction set must be supported.
+unsigned packBlock(PackISA isa, void* block, const uint32_t* pixels);
+
+} // namespace ETC1FastPacker
+
+#endif // ETC1_FAST_PACKER_HPP
@@ -0,0 +1,296 @@
+#include "MipChain.hpp"
+
+#include <cstdint>
+
+#include <cstring>
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "util/ParallelUtil.hpp"
+
+// Minimum amount of output pixels filtered by one thread.
+constexpr unsigned PARALLEL_MIN_PIXELS = 0x4000;
+
+namespace {
+
+// A premultiplied RGBA pixel as four floats; RGB range from 0 to alpha * 255,
+// alpha from 0 to 255.
+
+#if defined(__SSE2__)
+
+typedef __m128 Pixel;
+
+inline Pixel LoadPixel(const float* src) { return _mm_loadu_ps(src); }
+inline void StorePixel(float* dst, Pixel pixel) { _mm_storeu_ps(dst, pixel); }
+
+inline Pixel Add(Pixel a, Pixel b) { return _mm_add_ps(a, b); }
+inline Pixel Scale(Pixel pixel, float scale) { return _mm_mul_ps(pixel, _mm_set1_ps(scale)); }
+
+// Replace the alpha lane of a (broadcast) scale with 1.
+inline __m128 KeepAlpha(__m128 scale) {
+    const __m128 rgbMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+    const __m128 alphaOne = _mm_set_ps(1.f, 0.f, 0.f, 0.f);
+
+    return _mm_or_ps(_mm_and_ps(scale, rgbMask), alphaOne);
+}
+
+inline Pixel LoadRGBA32(const unsigned char* src) {
+    uint32_t value;
+    std::memcpy(&value, src, sizeof(uint32_t));
+
+    const __m128i zero = _mm_setzero_si128();
+
+    __m128i channels = _mm_cvtsi32_si128(static_cast<int>(value));
+    channels = _mm_unpacklo_epi16(_mm_unpacklo_epi8(channels, zero), zero);
+
+    const __m128 pixel = _mm_cvtepi32_ps(channels);
+    const __m128 alpha = _mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3));
+
+    return _mm_mul_ps(pixel, KeepAlpha(_mm_mul_ps(alpha, _mm_set1_ps(1.f / 255.f))));
+}
+
+inline void StoreRGBA32(unsigned char* dst, Pixel pixel) {
+    const __m128 zero = _mm_setzero_ps();
+
+    const __m128 alpha = _mm_shuffle_ps(pixel, pixel, _MM_SHUFFLE(3, 3, 3, 3));
+
+    // Fully transparent pixels become zero.
+    const __m128 scale = _mm_and_ps(
+        KeepAlpha(_mm_div_ps(_mm_set1_ps(255.f), alpha)),
+        _mm_cmpgt_ps(alpha, zero)
+    );
+
+    __m128 channels = _mm_min_ps(_mm_max_ps(_mm_mul_ps(pixel, scale), zero), _mm_set1_ps(255.f));
+    channels = _mm_add_ps(channels, _mm_set1_ps(.5f));
+
+    __m128i packed = _mm_cvttps_epi32(channels);
+    packed = _mm_packs_epi32(packed, packed);
+    packed = _mm_packus_epi16(packed, packed);
+
+    const uint32_t value = static_cast<uint32_t>(_mm_cvtsi128_si32(packed));
+    std::memcpy(dst, &value, sizeof(uint32_t));
+}
+
+#else // defined(__SSE2__)
+
+struct Pixel {
+    float c[4];
+};
+
+inline Pixel LoadPixel(const float* src) {
+    return Pixel {{ src[0], src[1], src[2], src[3] }};
+}
+inline void StorePixel(float* dst, Pixel pixel) {
+    std::memcpy(dst, pixel.c, sizeof(pixel.c));
+}
+
+inline Pixel Add(Pixel a, Pixel b) {
+    return Pixel {{ a.c[0] + b.c[0], a.c[1] + b.c[1], a.c[2] + b.c[2], a.c[3] + b.c[3] }};
+}
+inline Pixel Scale(Pixel pixel, float scale) {
+    return Pixel {{ pixel.c[0] * scale, pixel.c[1] * scale, pixel.c[2] * scale, pixel.c[3] * scale }};
+}
+
+inline Pixel LoadRGBA32(const unsigned char* src) {
+    const float alpha = static_cast<float>(src[3]);
+    const float scale = alpha * (1.f / 255.f);
+
+    return Pixel {{
+        static_cast<float>(src[0]) * scale,
+        static_cast<float>(src[1]) * scale,
+        static_cast<float>(src[2]) * scale,
+        alpha
+    }};
+}
+
+inline void StoreRGBA32(unsigned char* dst, Pixel pixel) {
+    const float alpha = pixel.c[3];
+
+    // Fully transparent pixels become zero.
+    const float scale = alpha > 0.f ? 255.f / alpha : 0.f;
+
+    for (unsigned i = 0; i < 4; i++) {
+        const float value = i == 3 ? std::max(alpha, 0.f) : pixel.c[i] * scale;
+        dst[i] = static_cast<unsigned char>(std::min(std::max(value, 0.f), 255.f) + .5f);
+    }
+}
+
+#endif // defined(__SSE2__)
+
+inline Pixel LoadSource(const unsigned char* row, unsigned x) {
+    return LoadRGBA32(row + x * 4);
+}
+inline Pixel LoadSource(const float* row, unsigned x) {
+    return LoadPixel(row + x * 4);
+}
+
+// The weights of the source pixels along one axis. Output pixel i covers the
+// source pixels from 2i onward.
+struct AxisFilter {
+    // 1 if the source is a single pixel, 2 if its size is even, 3 if it's odd.
+    unsigned tapCount;
+    // tapCount weights per output pixel.
+    std::vector<float> weights;
+};
+
+AxisFilter MakeAxisFilter(unsigned srcSize) {
+    const unsigned dstSize = MipChain::getLevelSize(srcSize, 1);
+
+    AxisFilter filter;
+
+    if (srcSize == 1) {
+        filter.tapCount = 1;
+        filter.weights = { 1.f };
+    }
+    else if ((srcSize % 2) == 0) {
+        filter.tapCount = 2;
+        filter.weights.assign(dstSize * 2, .5f);
+    }
+    else {
+        // The output pixels are 2 + 1/dstSize source pixels wide.
+        filter.tapCount = 3;
+        filter.weights.resize(dstSize * 3);
+
+        const float invSrcSize = 1.f / static_cast<float>(srcSize);
+
+        for (unsigned i = 0; i < dstSize; i++) {
+            filter.weights[i * 3 + 0] = static_cast<float>(dstSize - i) * invSrcSize;
+            filter.weights[i * 3 + 1] = static_cast<float>(dstSize) * invSrcSize;
+            filter.weights[i * 3 + 2] = static_cast<float>(i + 1) * invSrcSize;
+        }
+    }
+
+    return filter;
+}
+
+template <typename Src>
+void FilterRow(float* dst, const Src* srcRow, const AxisFilter& filter, unsigned dstWidth) {
+    switch (filter.tapCount) {
+    case 1:
+        StorePixel(dst, LoadSource(srcRow, 0));
+        break;
+
+    case 2:
+        for (unsigned x = 0; x < dstWidth; x++) {
+            const Pixel sum = Add(LoadSource(srcRow, x * 2), LoadSource(srcRow, x * 2 + 1));
+            StorePixel(dst + x * 4, Scale(sum, .5f));
+        }
+        break;
+
+    case 3:
+        for (unsigned x = 0; x < dstWidth; x++) {
+            const float* weights = filter.weights.data() + x * 3;
+
+            const Pixel sum = Add(
+                Add(
+                    Scale(LoadSource(srcRow, x * 2 + 0), weights[0]),
+                    Scale(LoadSource(srcRow, x * 2 + 1), weights[1])
+                ),
+                Scale(LoadSource(srcRow, x * 2 + 2), weights[2])
+            );
+            StorePixel(dst + x * 4, sum);
+        }
+        break;
+
+    default:
+        break;
+    }
+}
+
+// Filter a level down to the next one, as both floats (for the level after)
+// & RGBA32.
+template <typename Src>
+void FilterLevel(
+    const Src* src, unsigned srcWidth, unsigned srcHeight,
+    float* dst, unsigned char* dstRGBA32
+) {
+    const unsigned dstWidth = MipChain::getLevelSize(srcWidth, 1);
+    const unsigned dstHeight = MipChain::getLevelSize(srcHeight, 1);
+
+    const AxisFilter filterX = MakeAxisFilter(srcWidth);
+    const AxisFilter filterY = MakeAxisFilter(srcHeight);
+
+    const size_t srcStride = static_cast<size_t>(srcWidth) * 4;
+    const size_t dstStride = static_cast<size_t>(dstWidth) * 4;
+
+    ParallelUtil::parallelFor(dstHeight, std::max(PARALLEL_MIN_PIXELS / dstWidth, 1u), [&](size_t begin, size_t end) {
+        // The source rows of an output row, filtered horizontally.
+        std::vector<float> rows(dstStride * filterY.tapCount);
+
+        for (size_t y = begin; y < end; y++) {
+            for (unsigned t = 0; t < filterY.tapCount; t++) {
+                FilterRow(
+                    rows.data() + dstStride * t, src + srcStride * (y * 2 + t),
+                    filterX, dstWidth
+                );
+            }
+
+            const float* weightsY = filterY.weights.data() + y * filterY.tapCount;
+
+            float* dstRow = dst + dstStride * y;
+            unsigned char* dstRowRGBA32 = dstRGBA32 + dstStride * y;
+
+            for (unsigned x = 0; x < dstWidth; x++) {
+                Pixel sum = Scale(LoadPixel(rows.data() + x * 4), weightsY[0]);
+                for (unsigned t = 1; t < filterY.tapCount; t++)
+                    sum = Add(sum, Scale(LoadPixel(rows.data() + dstStride * t + x * 4), weightsY[t]));
+
+                StorePixel(dstRow + x * 4, sum);
+                StoreRGBA32(dstRowRGBA32 + x * 4, sum);
+            }
+        }
+    });
+}
+
+} // namespace
+
+namespace MipChain {
+
+unsigned getMaxLevelCount(unsigned width, unsigned height) {
+    unsigned levelCount = 1;
+    while (width > 1 || height > 1) {
+        width = getLevelSize(width, 1);
+        height = getLevelSize(height, 1);
+
+        levelCount++;
+    }
+    return levelCount;
+}
+
+std::vector<std::vector<unsigned char>> build(
+    const unsigned char* data, unsigned width, unsigned height, unsigned levelCount
+) {
+    std::vector<std::vector<unsigned char>> levels;
+    if (data == nullptr || width == 0 || height == 0 || levelCount <= 1)
+        return levels;
+
+    levels.resize(levelCount - 1);
+
+    // The previous & current level.
+    std::vector<float> srcLevel, dstLevel;
+
+    for (unsigned level = 1; level < levelCount; level++) {
+        const unsigned srcWidth = getLevelSize(width, level - 1);
+        const unsigned srcHeight = getLevelSize(height, level - 1);
+
+        const size_t dstSize = size_t(getLevelSize(width, level)) * getLevelSize(height, level) * 4;
+
+        dstLevel.resize(dstSize);
+        levels[level - 1].resize(dstSize);
+
+        if (level == 1)
+            FilterLevel(data, srcWidth, srcHeight, dstLevel.data(), levels[0].data());
+        else
+            FilterLevel(srcLevel.data(), srcWidth, srcHeight, dstLevel.data(), levels[level - 1].data());
+
+        std::swap(srcLevel, dstLevel);
+    }
+
+    return levels;
+}
+
+} // namespace MipChain
@@ -0,0 +1,35 @@
+#ifndef MIP_CHAIN_HPP
+#define MIP_CHAIN_HPP
+
+#include <vector>
+
+/*
+    Mip chain builder, shared by the TPL & CTPK writers.
+
+    Every level is filtered from the one above it with a box filter on the
+    premultiplied colors, so transparent pixels don't bleed into their
+    neighbours. Levels of odd sizes use the exact area weights of the three
+    pixels each output pixel covers. The levels are kept as floats in between,
+    so rounding errors don't add up down the chain.
+*/
+
+namespace MipChain {
+
+// Size of a side of a mip level; halved every level, down to 1.
+constexpr unsigned getLevelSize(unsigned size, unsigned level) {
+    return (level < 32 && (size >> level) != 0) ? (size >> level) : 1;
+}
+
+// Amount of levels of a full chain, down to 1x1.
+unsigned getMaxLevelCount(unsigned width, unsigned height);
+
+// Build the mip levels below an RGBA32 image (width * height * 4 bytes).
+// Level 0 is the image itself, so the RGBA32 data of levels 1 up to
+// levelCount - 1 is returned, in order.
+[[nodiscard]] std::vector<std::vector<unsigned char>> build(
+    const unsigned char* data, unsigned width, unsigned height, unsigned levelCount
+);
+
+} // namespace MipChain
+
+#endif // MIP_CHAIN_HPP
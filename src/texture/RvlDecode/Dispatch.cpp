@@ -0,0 +1,116 @@
+#include "Kernels.hpp"
+
+#include <stdexcept>
+
+namespace RvlImageConvert {
+
+namespace detail {
+
+const char* getDecodeISAName(DecodeISA isa) {
+    switch (isa) {
+    case DecodeISA::Scalar:
+        return "Scalar";
+    case DecodeISA::SSE2:
+        return "SSE2";
+    case DecodeISA::AVX2:
+        return "AVX2";
+    case DecodeISA::NEON:
+        return "NEON";
+
+    default:
+        return "Unknown";
+    }
+}
+
+bool isDecodeISASupported(DecodeISA isa) {
+    switch (isa) {
+    case DecodeISA::Scalar:
+        return true;
+
+    case DecodeISA::SSE2:
+#if defined(__SSE2__)
+        return true;
+#else
+        return false;
+#endif
+
+    case DecodeISA::AVX2:
+#if defined(__x86_64__) || defined(__i386__)
+        return __builtin_cpu_supports("avx2");
+#else
+        return false;
+#endif
+
+    case DecodeISA::NEON:
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+        return true;
+#else
+        return false;
+#endif
+
+    default:
+        return false;
+    }
+}
+
+DecodeISA getBestDecodeISA() {
+    static const DecodeISA bestISA = []() {
+        for (DecodeISA isa : { DecodeISA::AVX2, DecodeISA::SSE2, DecodeISA::NEON }) {
+            if (isDecodeISASupported(isa))
+                return isa;
+        }
+        return DecodeISA::Scalar;
+    }();
+    return bestISA;
+}
+
+// Fill the gaps of a table with the kernels of a lower instruction set.
+static void FillTable(DecodeTable& table, const DecodeTable& fallback) {
+    for (unsigned i = 0; i < TPL::TPL_IMAGE_FORMAT_COUNT; i++) {
+        if (!table.implementations[i])
+            table.implementations[i] = fallback.implementations[i];
+    }
+}
+
+const DecodeTable& getDecodeTable(DecodeISA isa) {
+    static const DecodeTable scalarTable = getScalarKernels();
+
+    static const DecodeTable sse2Table = []() {
+        DecodeTable table = getSSE2Kernels();
+        FillTable(table, scalarTable);
+        return table;
+    }();
+    static const DecodeTable avx2Table = []() {
+        DecodeTable table = getAVX2Kernels();
+        FillTable(table, sse2Table);
+        return table;
+    }();
+    static const DecodeTable neonTable = []() {
+        DecodeTable table = getNEONKernels();
+        FillTable(table, scalarTable);
+        return table;
+    }();
+
+    switch (isa) {
+    case DecodeISA::Scalar:
+        return scalarTable;
+    case DecodeISA::SSE2:
+        return sse2Table;
+    case DecodeISA::AVX2:
+        return avx2Table;
+    case DecodeISA::NEON:
+        return neonTable;
+
+    default:
+        throw std::runtime_error("RvlImageConvert::detail::getDecodeTable: invalid ISA");
+    }
+}
+
+const DecodeTable& getDecodeTable() {
+    static const DecodeTable& table = getDecodeTable(getBestDecodeISA());
+    return table;
+}
+
+} // namespace detail
+
+} // namespace RvlImageConvert
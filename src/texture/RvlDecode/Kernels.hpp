@@ -0,0 +1,152 @@
+#ifndef RVL_DECODE_KERNELS_HPP
+#define RVL_DECODE_KERNELS_HPP
+
+#include <cstdint>
+
+#include <cstddef>
+
+#include "texture/TPL.hpp"
+
+namespace RvlImageConvert {
+
+namespace detail {
+
+// Decode a whole image to RGBA32 (srcWidth * srcHeight * 4 bytes).
+typedef void (*DecodeImplementation)(
+    unsigned char* result, unsigned srcWidth, unsigned srcHeight,
+    const unsigned char* data, const uint32_t* palette
+);
+
+enum class DecodeISA {
+    Scalar,
+    SSE2,
+    AVX2,
+    NEON,
+
+    Count
+};
+
+// Decode implementation per image format, indexed by TPL::TPLImageFormat;
+// nullptr if the format can't be decoded.
+struct DecodeTable {
+    DecodeImplementation implementations[TPL::TPL_IMAGE_FORMAT_COUNT] {};
+};
+
+const char* getDecodeISAName(DecodeISA isa);
+
+bool isDecodeISASupported(DecodeISA isa);
+
+// The best instruction set supported by the running CPU.
+DecodeISA getBestDecodeISA();
+
+// Get the table for an instruction set. Formats without a kernel for it use
+// the kernel of the next best instruction set (down to the scalar kernels).
+// The instruction set must be supported.
+const DecodeTable& getDecodeTable(DecodeISA isa);
+// The table for getBestDecodeISA().
+const DecodeTable& getDecodeTable();
+
+// Kernels of each instruction set; only the formats that have one are set.
+// The tables of instruction sets that aren't compiled in are empty.
+const DecodeTable& getScalarKernels();
+const DecodeTable& getSSE2Kernels();
+const DecodeTable& getAVX2Kernels();
+const DecodeTable& getNEONKernels();
+
+// Decode a tile that is cut off by the image edge: the tile is decoded with
+// the scalar kernel & the visible part is copied to the image.
+void decodeEdgeTile(
+    DecodeImplementation scalarImplementation,
+    unsigned tileWidth, unsigned tileHeight,
+    unsigned char* result, unsigned srcWidth, unsigned srcHeight,
+    unsigned tileX, unsigned tileY,
+    const unsigned char* tileData, const uint32_t* palette
+);
+
+// Decode the two colors of a CMPR subblock & derive the other two, as
+// RGBA32 pixels (R in the lowest byte).
+inline void decodeCMPRColors(const unsigned char* blockData, uint32_t colors[4]) {
+    const uint16_t color1 = (static_cast<uint16_t>(blockData[0]) << 8) | blockData[1];
+    const uint16_t color2 = (static_cast<uint16_t>(blockData[2]) << 8) | blockData[3];
+
+    unsigned c[4][3];
+
+    c[0][0] = (((color1 >> 11) & 0x1f) << 3) | (((color1 >> 11) & 0x1f) >> 2);
+    c[0][1] = (((color1 >>  5) & 0x3f) << 2) | (((color1 >>  5) & 0x3f) >> 4);
+    c[0][2] = (((color1 >>  0) & 0x1f) << 3) | (((color1 >>  0) & 0x1f) >> 2);
+
+    c[1][0] = (((color2 >> 11) & 0x1f) << 3) | (((color2 >> 11) & 0x1f) >> 2);
+    c[1][1] = (((color2 >>  5) & 0x3f) << 2) | (((color2 >>  5) & 0x3f) >> 4);
+    c[1][2] = (((color2 >>  0) & 0x1f) << 3) | (((color2 >>  0) & 0x1f) >> 2);
+
+    uint32_t alpha3;
+
+    if (color1 > color2) {
+        for (unsigned i = 0; i < 3; i++) {
+            c[2][i] = (c[1][i] * 3 + c[0][i] * 5) >> 3;
+            c[3][i] = (c[0][i] * 3 + c[1][i] * 5) >> 3;
+        }
+        alpha3 = 0xFFu;
+    }
+    else {
+        for (unsigned i = 0; i < 3; i++) {
+            c[2][i] = (c[0][i] + c[1][i]) / 2;
+            c[3][i] = (c[0][i] + c[1][i]) / 2;
+        }
+        alpha3 = 0x00;
+    }
+
+    for (unsigned i = 0; i < 4; i++)
+        colors[i] = c[i][0] | (c[i][1] << 8) | (c[i][2] << 16) | (0xFFu << 24);
+
+    colors[3] = (colors[3] & 0x00FFFFFFu) | (alpha3 << 24);
+}
+
+// Walk the tiles of an image. Full tiles are decoded with decodeFullTile,
+// which writes TileWidth * TileHeight pixels to the image at the given row
+// pitch (in bytes) without bounds checks; edge tiles use decodeEdgeTile.
+template <
+    unsigned TileWidth, unsigned TileHeight, unsigned TileByteSize,
+    void (*decodeFullTile)(unsigned char* out, size_t pitch, const unsigned char* tileData, const uint32_t* palette)
+>
+inline void decodeTiles(
+    DecodeImplementation scalarImplementation,
+    unsigned char* result, unsigned srcWidth, unsigned srcHeight,
+    const unsigned char* data, const uint32_t* palette
+) {
+    const size_t pitch = static_cast<size_t>(srcWidth) * 4;
+
+    const unsigned fullTilesX = srcWidth / TileWidth;
+
+    for (unsigned yy = 0; yy < srcHeight; yy += TileHeight) {
+        const bool fullRow = yy + TileHeight <= srcHeight;
+
+        unsigned xx = 0;
+
+        if (fullRow) {
+            unsigned char* out = result + yy * pitch;
+            for (unsigned i = 0; i < fullTilesX; i++) {
+                decodeFullTile(out, pitch, data, palette);
+
+                out += TileWidth * 4;
+                data += TileByteSize;
+            }
+            xx = fullTilesX * TileWidth;
+        }
+
+        for (; xx < srcWidth; xx += TileWidth) {
+            decodeEdgeTile(
+                scalarImplementation, TileWidth, TileHeight,
+                result, srcWidth, srcHeight, xx, yy,
+                data, palette
+            );
+            data += TileByteSize;
+        }
+    }
+}
+
+} // namespace detail
+
+} // namespace RvlImageConvert
+
+#endif // RVL_DECODE_KERNELS_HPP
@@ -0,0 +1,309 @@
+#include "Kernels.hpp"
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+namespace RvlImageConvert {
+
+namespace detail {
+
+namespace {
+
+// Expand 4-bit values (one per byte) to 8 bits.
+inline uint8x8_t expand4(uint8x8_t value) {
+    return vorr_u8(value, vshl_n_u8(value, 4));
+}
+
+inline void storeIntensityAlpha8(unsigned char* out, uint8x8_t intensity, uint8x8_t alpha) {
+    uint8x8x4_t pixels;
+    pixels.val[0] = intensity;
+    pixels.val[1] = intensity;
+    pixels.val[2] = intensity;
+    pixels.val[3] = alpha;
+
+    vst4_u8(out, pixels);
+}
+
+// Load 8 big-endian 16-bit values.
+inline uint16x8_t loadBE16(const unsigned char* src) {
+    return vreinterpretq_u16_u8(vrev16q_u8(vld1q_u8(src)));
+}
+
+// Write two rows of 4 pixels from 16-bit lanes of (R | G << 8) & (B | A << 8).
+inline void storeRows4x2(unsigned char* out, size_t pitch, uint16x8_t rg, uint16x8_t ba) {
+    const uint16x8x2_t rows = vzipq_u16(rg, ba);
+
+    vst1q_u8(out, vreinterpretq_u8_u16(rows.val[0]));
+    vst1q_u8(out + pitch, vreinterpretq_u8_u16(rows.val[1]));
+}
+
+inline void storeColors4(unsigned char* out, uint32_t c0, uint32_t c1, uint32_t c2, uint32_t c3) {
+    const uint32_t colors[4] { c0, c1, c2, c3 };
+    vst1q_u8(out, vreinterpretq_u8_u32(vld1q_u32(colors)));
+}
+
+/*
+    Full tile kernels
+*/
+
+void TILE_I4(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    const uint8x8_t opaque = vdup_n_u8(0xFF);
+
+    // 8x8, 4 bytes per row; two rows per iteration.
+    for (unsigned y = 0; y < 8; y += 2) {
+        const uint8x8_t v = vld1_u8(tile + y * 4);
+
+        // The high nibble is the left pixel.
+        const uint8x8x2_t rows = vzip_u8(vshr_n_u8(v, 4), vand_u8(v, vdup_n_u8(0x0F)));
+
+        storeIntensityAlpha8(out + y * pitch, expand4(rows.val[0]), opaque);
+        storeIntensityAlpha8(out + (y + 1) * pitch, expand4(rows.val[1]), opaque);
+    }
+}
+
+void TILE_I8(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    const uint8x8_t opaque = vdup_n_u8(0xFF);
+
+    // 8x4, 8 bytes per row.
+    for (unsigned y = 0; y < 4; y++)
+        storeIntensityAlpha8(out + y * pitch, vld1_u8(tile + y * 8), opaque);
+}
+
+void TILE_IA4(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    // 8x4, 8 bytes per row; alpha in the high nibble.
+    for (unsigned y = 0; y < 4; y++) {
+        const uint8x8_t v = vld1_u8(tile + y * 8);
+
+        storeIntensityAlpha8(
+            out + y * pitch,
+            expand4(vand_u8(v, vdup_n_u8(0x0F))), expand4(vshr_n_u8(v, 4))
+        );
+    }
+}
+
+void TILE_IA8(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    // 4x4, (alpha, intensity) byte pairs; two rows per iteration.
+    for (unsigned y = 0; y < 4; y += 2) {
+        const uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(tile + y * 8));
+
+        const uint16x8_t intensity = vshrq_n_u16(v, 8);
+        const uint16x8_t alpha = vandq_u16(v, vdupq_n_u16(0x00FF));
+
+        storeRows4x2(
+            out + y * pitch, pitch,
+            vorrq_u16(intensity, vshlq_n_u16(intensity, 8)),
+            vorrq_u16(intensity, vshlq_n_u16(alpha, 8))
+        );
+    }
+}
+
+void TILE_RGB565(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    const uint16x8_t maskRB = vdupq_n_u16(0x00F8);
+
+    for (unsigned y = 0; y < 4; y += 2) {
+        const uint16x8_t p = loadBE16(tile + y * 8);
+
+        const uint16x8_t r = vandq_u16(vshrq_n_u16(p, 8), maskRB);
+        const uint16x8_t g = vandq_u16(vshrq_n_u16(p, 3), vdupq_n_u16(0x00FC));
+        const uint16x8_t b = vandq_u16(vshlq_n_u16(p, 3), maskRB);
+
+        storeRows4x2(
+            out + y * pitch, pitch,
+            vorrq_u16(r, vshlq_n_u16(g, 8)),
+            vorrq_u16(b, vdupq_n_u16(0xFF00))
+        );
+    }
+}
+
+void TILE_RGB5A3(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    const uint16x8_t mask5 = vdupq_n_u16(0x1F);
+    const uint16x8_t mask4 = vdupq_n_u16(0x0F);
+
+    for (unsigned y = 0; y < 4; y += 2) {
+        const uint16x8_t p = loadBE16(tile + y * 8);
+
+        // RGB555 (top bit set)
+        const uint16x8_t r5 = vandq_u16(vshrq_n_u16(p, 10), mask5);
+        const uint16x8_t g5 = vandq_u16(vshrq_n_u16(p, 5), mask5);
+        const uint16x8_t b5 = vandq_u16(p, mask5);
+
+        const uint16x8_t r5x = vorrq_u16(vshlq_n_u16(r5, 3), vshrq_n_u16(r5, 2));
+        const uint16x8_t g5x = vorrq_u16(vshlq_n_u16(g5, 3), vshrq_n_u16(g5, 2));
+        const uint16x8_t b5x = vorrq_u16(vshlq_n_u16(b5, 3), vshrq_n_u16(b5, 2));
+
+        const uint16x8_t rgOpaque = vorrq_u16(r5x, vshlq_n_u16(g5x, 8));
+        const uint16x8_t baOpaque = vorrq_u16(b5x, vdupq_n_u16(0xFF00));
+
+        // RGBA4443
+        const uint16x8_t r4 = vandq_u16(vshrq_n_u16(p, 8), mask4);
+        const uint16x8_t g4 = vandq_u16(vshrq_n_u16(p, 4), mask4);
+        const uint16x8_t b4 = vandq_u16(p, mask4);
+
+        const uint16x8_t a3 = vandq_u16(vshrq_n_u16(p, 12), vdupq_n_u16(0x07));
+        const uint16x8_t a3x = vorrq_u16(
+            vorrq_u16(vshlq_n_u16(a3, 5), vshlq_n_u16(a3, 2)),
+            vshrq_n_u16(a3, 1)
+        );
+
+        const uint16x8_t rgAlpha = vorrq_u16(
+            vorrq_u16(r4, vshlq_n_u16(r4, 4)),
+            vshlq_n_u16(vorrq_u16(g4, vshlq_n_u16(g4, 4)), 8)
+        );
+        const uint16x8_t baAlpha = vorrq_u16(
+            vorrq_u16(b4, vshlq_n_u16(b4, 4)),
+            vshlq_n_u16(a3x, 8)
+        );
+
+        const uint16x8_t isOpaque = vreinterpretq_u16_s16(
+            vshrq_n_s16(vreinterpretq_s16_u16(p), 15)
+        );
+
+        storeRows4x2(
+            out + y * pitch, pitch,
+            vbslq_u16(isOpaque, rgOpaque, rgAlpha),
+            vbslq_u16(isOpaque, baOpaque, baAlpha)
+        );
+    }
+}
+
+void TILE_RGBA32(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    // The first 32 bytes hold (A, R) pairs, the next 32 (G, B) pairs.
+    for (unsigned y = 0; y < 4; y += 2) {
+        const uint16x8_t ar = vreinterpretq_u16_u8(vld1q_u8(tile + y * 8));
+        const uint16x8_t gb = vreinterpretq_u16_u8(vld1q_u8(tile + 32 + y * 8));
+
+        storeRows4x2(
+            out + y * pitch, pitch,
+            vorrq_u16(vshrq_n_u16(ar, 8), vshlq_n_u16(gb, 8)),
+            vorrq_u16(vshrq_n_u16(gb, 8), vshlq_n_u16(ar, 8))
+        );
+    }
+}
+
+void TILE_C8(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t* palette) {
+    // 8x4.
+    for (unsigned y = 0; y < 4; y++) {
+        const unsigned char* indices = tile + y * 8;
+
+        const uint32_t colors[8] {
+            palette[indices[0]], palette[indices[1]], palette[indices[2]], palette[indices[3]],
+            palette[indices[4]], palette[indices[5]], palette[indices[6]], palette[indices[7]]
+        };
+
+        vst1q_u8(out + y * pitch, vreinterpretq_u8_u32(vld1q_u32(colors + 0)));
+        vst1q_u8(out + y * pitch + 16, vreinterpretq_u8_u32(vld1q_u32(colors + 4)));
+    }
+}
+
+void TILE_C14X2(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t* palette) {
+    // 4x4, big-endian 16-bit indices.
+    for (unsigned y = 0; y < 4; y++) {
+        uint16_t indices[4];
+        vst1_u16(indices, vand_u16(
+            vreinterpret_u16_u8(vrev16_u8(vld1_u8(tile + y * 8))),
+            vdup_n_u16(0x3FFF)
+        ));
+
+        storeColors4(
+            out + y * pitch,
+            palette[indices[0]], palette[indices[1]],
+            palette[indices[2]], palette[indices[3]]
+        );
+    }
+}
+
+void TILE_CMPR(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    // 8x8 made of four 4x4 DXT1 subblocks (top-left, top-right, bottom-left,
+    // bottom-right).
+    for (unsigned i = 0; i < 4; i++) {
+        const unsigned char* blockData = tile + i * 8;
+
+        uint32_t colors[4];
+        decodeCMPRColors(blockData, colors);
+
+        unsigned char* blockOut = out + (i >> 1) * 4 * pitch + (i & 1) * 4 * 4;
+
+        for (unsigned y = 0; y < 4; y++) {
+            const unsigned bits = blockData[4 + y];
+
+            storeColors4(
+                blockOut + y * pitch,
+                colors[bits >> 6], colors[(bits >> 4) & 3],
+                colors[(bits >> 2) & 3], colors[bits & 3]
+            );
+        }
+    }
+}
+
+/*
+    Image kernels
+*/
+
+#define DEFINE_IMAGE_KERNEL(format, tileWidth, tileHeight, tileByteSize) \
+    void IMAGE_##format( \
+        unsigned char* result, unsigned srcWidth, unsigned srcHeight, \
+        const unsigned char* data, const uint32_t* palette \
+    ) { \
+        decodeTiles<tileWidth, tileHeight, tileByteSize, TILE_##format>( \
+            getScalarKernels().implementations[TPL::TPL_IMAGE_FORMAT_##format], \
+            result, srcWidth, srcHeight, data, palette \
+        ); \
+    }
+
+DEFINE_IMAGE_KERNEL(I4, 8, 8, 32)
+DEFINE_IMAGE_KERNEL(I8, 8, 4, 32)
+DEFINE_IMAGE_KERNEL(IA4, 8, 4, 32)
+DEFINE_IMAGE_KERNEL(IA8, 4, 4, 32)
+DEFINE_IMAGE_KERNEL(RGB565, 4, 4, 32)
+DEFINE_IMAGE_KERNEL(RGB5A3, 4, 4, 32)
+DEFINE_IMAGE_KERNEL(RGBA32, 4, 4, 64)
+DEFINE_IMAGE_KERNEL(C8, 8, 4, 32)
+DEFINE_IMAGE_KERNEL(C14X2, 4, 4, 32)
+DEFINE_IMAGE_KERNEL(CMPR, 8, 8, 32)
+
+#undef DEFINE_IMAGE_KERNEL
+
+} // namespace
+
+const DecodeTable& getNEONKernels() {
+    static const DecodeTable table = []() {
+        DecodeTable table;
+        auto& impl = table.implementations;
+
+        impl[TPL::TPL_IMAGE_FORMAT_I4] = IMAGE_I4;
+        impl[TPL::TPL_IMAGE_FORMAT_I8] = IMAGE_I8;
+        impl[TPL::TPL_IMAGE_FORMAT_IA4] = IMAGE_IA4;
+        impl[TPL::TPL_IMAGE_FORMAT_IA8] = IMAGE_IA8;
+        impl[TPL::TPL_IMAGE_FORMAT_RGB565] = IMAGE_RGB565;
+        impl[TPL::TPL_IMAGE_FORMAT_RGB5A3] = IMAGE_RGB5A3;
+        impl[TPL::TPL_IMAGE_FORMAT_RGBA32] = IMAGE_RGBA32;
+        impl[TPL::TPL_IMAGE_FORMAT_C8] = IMAGE_C8;
+        impl[TPL::TPL_IMAGE_FORMAT_C14X2] = IMAGE_C14X2;
+        impl[TPL::TPL_IMAGE_FORMAT_CMPR] = IMAGE_CMPR;
+
+        return table;
+    }();
+    return table;
+}
+
+} // namespace detail
+
+} // namespace RvlImageConvert
+
+#else // defined(__ARM_NEON) || defined(__ARM_NEON__)
+
+namespace RvlImageConvert {
+
+namespace detail {
+
+const DecodeTable& getNEONKernels() {
+    static const DecodeTable table {};
+    return table;
+}
+
+} // namespace detail
+
+} // namespace RvlImageConvert
+
+#endif // defined(__ARM_NEON) || defined(__ARM_NEON__)
@@ -0,0 +1,322 @@
+#include "Kernels.hpp"
+
+#if defined(__SSE2__)
+
+#include <emmintrin.h>
+
+#include "Macro.hpp"
+
+namespace RvlImageConvert {
+
+namespace detail {
+
+namespace {
+
+inline __m128i load64(const unsigned char* src) {
+    return _mm_loadl_epi64(reinterpret_cast<const __m128i*>(src));
+}
+inline __m128i load128(const unsigned char* src) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(src));
+}
+inline void store128(unsigned char* dst, __m128i value) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst), value);
+}
+
+// Byteswap every 16-bit lane (the image data is big-endian).
+inline __m128i byteswap16(__m128i value) {
+    return _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+}
+
+// Expand 4-bit values (one per byte) to 8 bits.
+inline __m128i expand4(__m128i value) {
+    return _mm_or_si128(value, _mm_slli_epi16(value, 4));
+}
+
+// Write 8 pixels from the low 8 bytes of intensity & alpha.
+inline void storeIntensityAlpha8(unsigned char* out, __m128i intensity, __m128i alpha) {
+    const __m128i ii = _mm_unpacklo_epi8(intensity, intensity);
+    const __m128i ia = _mm_unpacklo_epi8(intensity, alpha);
+
+    store128(out + 0, _mm_unpacklo_epi16(ii, ia));
+    store128(out + 16, _mm_unpackhi_epi16(ii, ia));
+}
+
+// Write two rows of 4 pixels from 16-bit lanes of (R | G << 8) & (B | A << 8).
+inline void storeRows4x2(unsigned char* out, size_t pitch, __m128i rg, __m128i ba) {
+    store128(out, _mm_unpacklo_epi16(rg, ba));
+    store128(out + pitch, _mm_unpackhi_epi16(rg, ba));
+}
+
+/*
+    Full tile kernels
+*/
+
+void TILE_I4(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    const __m128i lowMask = _mm_set1_epi8(0x0F);
+    const __m128i opaque = _mm_set1_epi8(static_cast<char>(0xFF));
+
+    // 8x8, 4 bytes per row; two rows per iteration.
+    for (unsigned y = 0; y < 8; y += 2) {
+        const __m128i v = load64(tile + y * 4);
+
+        const __m128i high = _mm_and_si128(_mm_srli_epi16(v, 4), lowMask);
+        const __m128i low = _mm_and_si128(v, lowMask);
+
+        // The high nibble is the left pixel.
+        const __m128i intensity = expand4(_mm_unpacklo_epi8(high, low));
+
+        storeIntensityAlpha8(out + y * pitch, intensity, opaque);
+        storeIntensityAlpha8(out + (y + 1) * pitch, _mm_srli_si128(intensity, 8), opaque);
+    }
+}
+
+void TILE_I8(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    const __m128i opaque = _mm_set1_epi8(static_cast<char>(0xFF));
+
+    // 8x4, 8 bytes per row.
+    for (unsigned y = 0; y < 4; y++)
+        storeIntensityAlpha8(out + y * pitch, load64(tile + y * 8), opaque);
+}
+
+void TILE_IA4(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    const __m128i lowMask = _mm_set1_epi8(0x0F);
+
+    // 8x4, 8 bytes per row.
+    for (unsigned y = 0; y < 4; y++) {
+        const __m128i v = load64(tile + y * 8);
+
+        const __m128i alpha = expand4(_mm_and_si128(_mm_srli_epi16(v, 4), lowMask));
+        const __m128i intensity = expand4(_mm_and_si128(v, lowMask));
+
+        storeIntensityAlpha8(out + y * pitch, intensity, alpha);
+    }
+}
+
+void TILE_IA8(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    const __m128i lowMask = _mm_set1_epi16(0x00FF);
+
+    // 4x4, 8 bytes per row; two rows per iteration. Each pixel is (A, I).
+    for (unsigned y = 0; y < 4; y += 2) {
+        const __m128i v = load128(tile + y * 8);
+
+        const __m128i intensity = _mm_srli_epi16(v, 8);
+        const __m128i alpha = _mm_and_si128(v, lowMask);
+
+        const __m128i rg = _mm_or_si128(intensity, _mm_slli_epi16(intensity, 8));
+        const __m128i ba = _mm_or_si128(intensity, _mm_slli_epi16(alpha, 8));
+
+        storeRows4x2(out + y * pitch, pitch, rg, ba);
+    }
+}
+
+void TILE_RGB565(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    const __m128i maskRB = _mm_set1_epi16(0x00F8);
+    const __m128i maskG = _mm_set1_epi16(0x00FC);
+    const __m128i opaque = _mm_set1_epi16(static_cast<short>(0xFF00));
+
+    for (unsigned y = 0; y < 4; y += 2) {
+        const __m128i p = byteswap16(load128(tile + y * 8));
+
+        const __m128i r = _mm_and_si128(_mm_srli_epi16(p, 8), maskRB);
+        const __m128i g = _mm_and_si128(_mm_srli_epi16(p, 3), maskG);
+        const __m128i b = _mm_and_si128(_mm_slli_epi16(p, 3), maskRB);
+
+        const __m128i rg = _mm_or_si128(r, _mm_slli_epi16(g, 8));
+        const __m128i ba = _mm_or_si128(b, opaque);
+
+        storeRows4x2(out + y * pitch, pitch, rg, ba);
+    }
+}
+
+void TILE_RGB5A3(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    const __m128i mask5 = _mm_set1_epi16(0x1F);
+    const __m128i mask4 = _mm_set1_epi16(0x0F);
+    const __m128i mask3 = _mm_set1_epi16(0x07);
+    const __m128i opaque = _mm_set1_epi16(static_cast<short>(0xFF00));
+
+    for (unsigned y = 0; y < 4; y += 2) {
+        const __m128i p = byteswap16(load128(tile + y * 8));
+
+        // RGB555 (top bit set)
+        const __m128i r5 = _mm_and_si128(_mm_srli_epi16(p, 10), mask5);
+        const __m128i g5 = _mm_and_si128(_mm_srli_epi16(p, 5), mask5);
+        const __m128i b5 = _mm_and_si128(p, mask5);
+
+        const __m128i r5x = _mm_or_si128(_mm_slli_epi16(r5, 3), _mm_srli_epi16(r5, 2));
+        const __m128i g5x = _mm_or_si128(_mm_slli_epi16(g5, 3), _mm_srli_epi16(g5, 2));
+        const __m128i b5x = _mm_or_si128(_mm_slli_epi16(b5, 3), _mm_srli_epi16(b5, 2));
+
+        const __m128i rgOpaque = _mm_or_si128(r5x, _mm_slli_epi16(g5x, 8));
+        const __m128i baOpaque = _mm_or_si128(b5x, opaque);
+
+        // RGBA4443
+        const __m128i r4 = expand4(_mm_and_si128(_mm_srli_epi16(p, 8), mask4));
+        const __m128i g4 = expand4(_mm_and_si128(_mm_srli_epi16(p, 4), mask4));
+        const __m128i b4 = expand4(_mm_and_si128(p, mask4));
+
+        const __m128i a3 = _mm_and_si128(_mm_srli_epi16(p, 12), mask3);
+        const __m128i a3x = _mm_or_si128(
+            _mm_or_si128(_mm_slli_epi16(a3, 5), _mm_slli_epi16(a3, 2)),
+            _mm_srli_epi16(a3, 1)
+        );
+
+        const __m128i rgAlpha = _mm_or_si128(r4, _mm_slli_epi16(g4, 8));
+        const __m128i baAlpha = _mm_or_si128(b4, _mm_slli_epi16(a3x, 8));
+
+        const __m128i isOpaque = _mm_srai_epi16(p, 15);
+
+        const __m128i rg = _mm_or_si128(_mm_and_si128(isOpaque, rgOpaque), _mm_andnot_si128(isOpaque, rgAlpha));
+        const __m128i ba = _mm_or_si128(_mm_and_si128(isOpaque, baOpaque), _mm_andnot_si128(isOpaque, baAlpha));
+
+        storeRows4x2(out + y * pitch, pitch, rg, ba);
+    }
+}
+
+void TILE_RGBA32(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    // 4x4; the first 32 bytes hold (A, R) pairs, the next 32 (G, B) pairs.
+    for (unsigned y = 0; y < 4; y += 2) {
+        const __m128i ar = load128(tile + y * 8);
+        const __m128i gb = load128(tile + 32 + y * 8);
+
+        const __m128i rg = _mm_or_si128(_mm_srli_epi16(ar, 8), _mm_slli_epi16(gb, 8));
+        const __m128i ba = _mm_or_si128(_mm_srli_epi16(gb, 8), _mm_slli_epi16(ar, 8));
+
+        storeRows4x2(out + y * pitch, pitch, rg, ba);
+    }
+}
+
+void TILE_C8(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t* palette) {
+    // 8x4.
+    for (unsigned y = 0; y < 4; y++) {
+        const unsigned char* indices = tile + y * 8;
+        unsigned char* row = out + y * pitch;
+
+        store128(row, _mm_set_epi32(
+            static_cast<int>(palette[indices[3]]), static_cast<int>(palette[indices[2]]),
+            static_cast<int>(palette[indices[1]]), static_cast<int>(palette[indices[0]])
+        ));
+        store128(row + 16, _mm_set_epi32(
+            static_cast<int>(palette[indices[7]]), static_cast<int>(palette[indices[6]]),
+            static_cast<int>(palette[indices[5]]), static_cast<int>(palette[indices[4]])
+        ));
+    }
+}
+
+void TILE_C14X2(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t* palette) {
+    const __m128i indexMask = _mm_set1_epi16(0x3FFF);
+
+    // 4x4, big-endian 16-bit indices (top 2 bits ignored); two rows per
+    // iteration. The colors go straight into registers: storing them to
+    // memory & loading them back as a vector stalls store forwarding.
+    for (unsigned y = 0; y < 4; y += 2) {
+        const __m128i indices = _mm_and_si128(byteswap16(load128(tile + y * 8)), indexMask);
+
+        store128(out + y * pitch, _mm_set_epi32(
+            static_cast<int>(palette[_mm_extract_epi16(indices, 3)]),
+            static_cast<int>(palette[_mm_extract_epi16(indices, 2)]),
+            static_cast<int>(palette[_mm_extract_epi16(indices, 1)]),
+            static_cast<int>(palette[_mm_extract_epi16(indices, 0)])
+        ));
+        store128(out + (y + 1) * pitch, _mm_set_epi32(
+            static_cast<int>(palette[_mm_extract_epi16(indices, 7)]),
+            static_cast<int>(palette[_mm_extract_epi16(indices, 6)]),
+            static_cast<int>(palette[_mm_extract_epi16(indices, 5)]),
+            static_cast<int>(palette[_mm_extract_epi16(indices, 4)])
+        ));
+    }
+}
+
+void TILE_CMPR(unsigned char* out, size_t pitch, const unsigned char* tile, const uint32_t*) {
+    // 8x8 made of four 4x4 DXT1 subblocks (top-left, top-right, bottom-left,
+    // bottom-right). Each row of a subblock is one byte of 2-bit indices, the
+    // leftmost pixel in the top bits.
+    for (unsigned i = 0; i < 4; i++) {
+        const unsigned char* blockData = tile + i * 8;
+
+        uint32_t colors[4];
+        decodeCMPRColors(blockData, colors);
+
+        unsigned char* blockOut = out + (i >> 1) * 4 * pitch + (i & 1) * 4 * 4;
+
+        for (unsigned y = 0; y < 4; y++) {
+            const unsigned bits = blockData[4 + y];
+
+            store128(blockOut + y * pitch, _mm_set_epi32(
+                colors[bits & 3], colors[(bits >> 2) & 3],
+                colors[(bits >> 4) & 3], colors[bits >> 6]
+            ));
+        }
+    }
+}
+
+/*
+    Image kernels
+*/
+
+#define DEFINE_IMAGE_KERNEL(format, tileWidth, tileHeight, tileByteSize) \
+    void IMAGE_##format( \
+        unsigned char* result, unsigned srcWidth, unsigned srcHeight, \
+        const unsigned char* data, const uint32_t* palette \
+    ) { \
+        decodeTiles<tileWidth, tileHeight, tileByteSize, TILE_##format>( \
+            getScalarKernels().implementations[TPL::TPL_IMAGE_FORMAT_##format], \
+            result, srcWidth, srcHeight, data, palette \
+        ); \
+    }
+
+DEFINE_IMAGE_KERNEL(I4, 8, 8, 32)
+DEFINE_IMAGE_KERNEL(I8, 8, 4, 32)
+DEFINE_IMAGE_KERNEL(IA4, 8, 4, 32)
+DEFINE_IMAGE_KERNEL(IA8, 4, 4, 32)
+DEFINE_IMAGE_KERNEL(RGB565, 4, 4, 32)
+DEFINE_IMAGE_KERNEL(RGB5A3, 4, 4, 32)
+DEFINE_IMAGE_KERNEL(RGBA32, 4, 4, 64)
+DEFINE_IMAGE_KERNEL(C8, 8, 4, 32)
+DEFINE_IMAGE_KERNEL(C14X2, 4, 4, 32)
+DEFINE_IMAGE_KERNEL(CMPR, 8, 8, 32)
+
+#undef DEFINE_IMAGE_KERNEL
+
+} // namespace
+
+const DecodeTable& getSSE2Kernels() {
+    static const DecodeTable table = []() {
+        DecodeTable table;
+        auto& impl = table.implementations;
+
+        impl[TPL::TPL_IMAGE_FORMAT_I4] = IMAGE_I4;
+        impl[TPL::TPL_IMAGE_FORMAT_I8] = IMAGE_I8;
+        impl[TPL::TPL_IMAGE_FORMAT_IA4] = IMAGE_IA4;
+        impl[TPL::TPL_IMAGE_FORMAT_IA8] = IMAGE_IA8;
+        impl[TPL::TPL_IMAGE_FORMAT_RGB565] = IMAGE_RGB565;
+        impl[TPL::TPL_IMAGE_FORMAT_RGB5A3] = IMAGE_RGB5A3;
+        impl[TPL::TPL_IMAGE_FORMAT_RGBA32] = IMAGE_RGBA32;
+        impl[TPL::TPL_IMAGE_FORMAT_C8] = IMAGE_C8;
+        impl[TPL::TPL_IMAGE_FORMAT_C14X2] = IMAGE_C14X2;
+        impl[TPL::TPL_IMAGE_FORMAT_CMPR] = IMAGE_CMPR;
+
+        return table;
+    }();
+    return table;
+}
+
+} // namespace detail
+
+} // namespace RvlImageConvert
+
+#else // defined(__SSE2__)
+
+namespace RvlImageConvert {
+
+namespace detail {
+
+const DecodeTable& getSSE2Kernels() {
+    static const DecodeTable table {};
+    return table;
+}
+
+} // namespace detail
+
+} // namespace RvlImageConvert
+
+#endif // defined(__SSE2__)
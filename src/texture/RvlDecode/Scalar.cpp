@@ -0,0 +1,501 @@
+#include "Kernels.hpp"
+
+#include <cstring>
+
+#include <algorithm>
+
+#include "Macro.hpp"
+
+namespace RvlImageConvert {
+
+namespace detail {
+
+/*
+    Scalar kernels; these are the reference the other kernels are checked
+    against, and decode the tiles on the image edges for them.
+*/
+
+static void IMPLEMENTATION_FROM_I4(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 8) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
+
+            for (unsigned y = 0; y < 8; y++) {
+                if (yy + y >= srcHeight) break;
+
+                const unsigned rowBase = srcWidth * (yy + y);
+
+                for (unsigned x = 0; x < 8; x += 2) {
+                    if (xx + x >= srcWidth) break;
+
+                    const uint8_t intensityA = ((data[readOffset + (y * 4) + (x / 2)] & 0xF0) >> 4) * 0x11;
+                    const uint8_t intensityB = (data[readOffset + (y * 4) + (x / 2)] & 0x0F) * 0x11;
+
+                    const unsigned destIndex = (rowBase + xx + x) * 4;
+
+                    result[destIndex + 0] = intensityA;
+                    result[destIndex + 1] = intensityA;
+                    result[destIndex + 2] = intensityA;
+                    result[destIndex + 3] = 0xFFu;
+
+                    result[destIndex + 4] = intensityB;
+                    result[destIndex + 5] = intensityB;
+                    result[destIndex + 6] = intensityB;
+                    result[destIndex + 7] = 0xFFu;
+                }
+            }
+            readOffset += 4 * 8;
+        }
+    }
+}
+
+static void IMPLEMENTATION_FROM_I8(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
+
+            for (unsigned y = 0; y < 4; y++) {
+                if (yy + y >= srcHeight) break;
+
+                for (unsigned x = 0; x < 8; x++) {
+                    if (xx + x >= srcWidth) break;
+
+                    const uint8_t intensity = data[readOffset + (y * 8) + x];
+
+                    const uint32_t destIndex = 4 * (srcWidth * (yy + y) + xx + x);
+
+                    result[destIndex + 0] = intensity;
+                    result[destIndex + 1] = intensity;
+                    result[destIndex + 2] = intensity;
+                    result[destIndex + 3] = 0xFFu;
+                }
+            }
+            readOffset += 1 * 8 * 4;
+        }
+    }
+}
+
+static void IMPLEMENTATION_FROM_IA4(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
+
+            for (unsigned y = 0; y < 4; y++) {
+                if (yy + y >= srcHeight) break;
+
+                const unsigned rowBase = srcWidth * (yy + y);
+
+                for (unsigned x = 0; x < 8; x++) {
+                    if (xx + x >= srcWidth) break;
+
+                    const unsigned destIndex = (rowBase + xx + x) * 4;
+
+                    const uint8_t alpha = ((data[readOffset + (y * 8) + x] & 0xF0) >> 4) * 0x11;
+                    const uint8_t intensity = (data[readOffset + (y * 8) + x] & 0x0F) * 0x11;
+
+                    result[destIndex + 0] = intensity;
+                    result[destIndex + 1] = intensity;
+                    result[destIndex + 2] = intensity;
+                    result[destIndex + 3] = alpha;
+                }
+            }
+            readOffset += 1 * 8 * 4;
+        }
+    }
+}
+
+static void IMPLEMENTATION_FROM_IA8(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 4) {
+
+            for (unsigned y = 0; y < 4; y++) {
+                if (yy + y >= srcHeight) break;
+
+                const unsigned rowBase = srcWidth * (yy + y);
+
+                for (unsigned x = 0; x < 4; x++) {
+                    if (xx + x >= srcWidth) break;
+
+                    const unsigned destIndex = (rowBase + xx + x) * 4;
+
+                    const uint8_t alpha = data[readOffset + (y * 2 * 4) + (x * 2) + 0];
+                    const uint8_t intensity = data[readOffset + (y * 2 * 4) + (x * 2) + 1];
+
+                    result[destIndex + 0] = intensity;
+                    result[destIndex + 1] = intensity;
+                    result[destIndex + 2] = intensity;
+                    result[destIndex + 3] = alpha;
+                }
+            }
+            readOffset += 2 * 4 * 4;
+        }
+    }
+}
+
+
+static void IMPLEMENTATION_FROM_RGB565(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 4) {
+
+            for (unsigned y = 0; y < 4; y++) {
+                if (yy + y >= srcHeight) break;
+
+                const unsigned rowBase = srcWidth * (yy + y);
+
+                for (unsigned x = 0; x < 4; x++) {
+                    if (xx + x >= srcWidth) break;
+
+                    const unsigned writeOffset = (rowBase + xx + x) * 4;
+
+                    const uint16_t sourcePixel = BYTESWAP_16(*reinterpret_cast<const uint16_t*>(
+                        data + readOffset + (y * 2 * 4) + (x * 2)
+                    ));
+
+                    result[writeOffset + 0] = ((sourcePixel >> 11) & 0x1f) << 3;
+                    result[writeOffset + 1] = ((sourcePixel >>  5) & 0x3f) << 2;
+                    result[writeOffset + 2] = ((sourcePixel >>  0) & 0x1f) << 3;
+                    result[writeOffset + 3] = 0xFFu;
+                }
+            }
+            readOffset += 2 * 4 * 4;
+        }
+    }
+}
+
+static void IMPLEMENTATION_FROM_RGB5A3(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 4) {
+
+            for (unsigned y = 0; y < 4; y++) {
+                if (yy + y >= srcHeight) break;
+
+                const unsigned rowBase = srcWidth * (yy + y);
+
+                for (unsigned x = 0; x < 4; x++) {
+                    if (xx + x >= srcWidth) break;
+
+                    const unsigned writeOffset = (rowBase + xx + x) * 4;
+
+                    const uint16_t sourcePixel = BYTESWAP_16(*reinterpret_cast<const uint16_t*>(
+                        data + readOffset + (y * 2 * 4) + (x * 2)
+                    ));
+
+                    if ((sourcePixel & (1 << 15)) != 0) { // RGB555
+                        result[writeOffset + 0] = (((sourcePixel >> 10) & 0x1f) << 3) | (((sourcePixel >> 10) & 0x1f) >> 2);
+                        result[writeOffset + 1] = (((sourcePixel >> 5) & 0x1f) << 3) | (((sourcePixel >> 5) & 0x1f) >> 2);
+                        result[writeOffset + 2] = (((sourcePixel) & 0x1f) << 3) | (((sourcePixel) & 0x1f) >> 2);
+
+                        result[writeOffset + 3] = 0xFFu;
+                    }
+                    else { // RGBA4443
+                        result[writeOffset + 0] = (((sourcePixel >> 8) & 0x0f) << 4) | ((sourcePixel >> 8) & 0x0f);
+                        result[writeOffset + 1] = (((sourcePixel >> 4) & 0x0f) << 4) | ((sourcePixel >> 4) & 0x0f);
+                        result[writeOffset + 2] = (((sourcePixel) & 0x0f) << 4) | ((sourcePixel) & 0x0f);
+
+                        result[writeOffset + 3] =
+                            (((sourcePixel >> 12) & 0x07) << 5) | (((sourcePixel >> 12) & 0x07) << 2) |
+                            (((sourcePixel >> 12) & 0x07) >> 1);
+                    }
+                }
+            }
+            readOffset += 2 * 4 * 4;
+
+        }
+    }
+}
+
+static void IMPLEMENTATION_FROM_RGBA32(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 4) {
+            // The block data is split down into two subblocks:
+            //    Subblock A: Alpha and Red channel
+            //    Subblock B: Green and Blue channel
+
+            // Subblock A
+            for (unsigned y = 0; y < 4; y++) {
+                if (yy + y >= srcHeight) break;
+
+                const unsigned rowBase = srcWidth * (yy + y);
+
+                for (unsigned x = 0; x < 4; x++) {
+                    if (xx + x >= srcWidth) break;
+
+                    const unsigned destIndex = (rowBase + xx + x) * 4;
+
+                    result[destIndex + 3] = data[readOffset + (y * 2 * 4) + (x * 2) + 0]; // Alpha channel
+                    result[destIndex + 0] = data[readOffset + (y * 2 * 4) + (x * 2) + 1]; // Red channel
+                }
+            }
+            readOffset += 2 * 4 * 4;
+
+            // Subblock B
+            for (unsigned y = 0; y < 4; y++) {
+                if (yy + y >= srcHeight) break;
+
+                const unsigned rowBase = srcWidth * (yy + y);
+
+                for (unsigned x = 0; x < 4; x++) {
+                    if (xx + x >= srcWidth) break;
+
+                    const unsigned destIndex = (rowBase + xx + x) * 4;
+
+                    result[destIndex + 1] = data[readOffset + (y * 2 * 4) + (x * 2) + 0]; // Green channel
+                    result[destIndex + 2] = data[readOffset + (y * 2 * 4) + (x * 2) + 1]; // Blue channel
+                }
+            }
+            readOffset += 2 * 4 * 4;
+        }
+    }
+}
+
+static void IMPLEMENTATION_FROM_CMPR(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 8) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
+            // 4 4x4 RGBA blocks. Makes up one whole CMPR block
+            uint8_t blocks[4][4][4][4];
+
+            // Decode each CMPR-subblock
+            for (unsigned i = 0; i < 4; i++) {
+                const unsigned char *blockData = data + readOffset + (i * 8);
+                uint8_t (*block)[4][4] = blocks[i];
+
+                const uint16_t color1    = BYTESWAP_16(*reinterpret_cast<const uint16_t *>(blockData + 0));
+                const uint16_t color2    = BYTESWAP_16(*reinterpret_cast<const uint16_t *>(blockData + 2));
+                const uint32_t indexBits = BYTESWAP_32(*reinterpret_cast<const uint32_t *>(blockData + 4));
+
+                uint8_t colors[4][4];
+
+                colors[0][0] = (((color1 >> 11) & 0x1f) << 3) | (((color1 >> 11) & 0x1f) >> 2);
+                colors[0][1] = (((color1 >>  5) & 0x3f) << 2) | (((color1 >>  5) & 0x3f) >> 4);
+                colors[0][2] = (((color1 >>  0) & 0x1f) << 3) | (((color1 >>  0) & 0x1f) >> 2);
+                colors[0][3] = 0xFFu;
+
+                colors[1][0] = (((color2 >> 11) & 0x1f) << 3) | (((color2 >> 11) & 0x1f) >> 2);
+                colors[1][1] = (((color2 >>  5) & 0x3f) << 2) | (((color2 >>  5) & 0x3f) >> 4);
+                colors[1][2] = (((color2 >>  0) & 0x1f) << 3) | (((color2 >>  0) & 0x1f) >> 2);
+                colors[1][3] = 0xFFu;
+
+                if (color1 > color2) {
+                    colors[2][0] = ((static_cast<int>(colors[1][0]) * 3 + colors[0][0] * 5) >> 3);
+                    colors[2][1] = ((static_cast<int>(colors[1][1]) * 3 + colors[0][1] * 5) >> 3);
+                    colors[2][2] = ((static_cast<int>(colors[1][2]) * 3 + colors[0][2] * 5) >> 3);
+                    colors[2][3] = 0xFFu;
+
+                    colors[3][0] = ((static_cast<int>(colors[0][0]) * 3 + colors[1][0] * 5) >> 3);
+                    colors[3][1] = ((static_cast<int>(colors[0][1]) * 3 + colors[1][1] * 5) >> 3);
+                    colors[3][2] = ((static_cast<int>(colors[0][2]) * 3 + colors[1][2] * 5) >> 3);
+                    colors[3][3] = 0xFFu;
+                }
+                else {
+                    colors[2][0] = (static_cast<int>(colors[0][0]) + colors[1][0]) / 2;
+                    colors[2][1] = (static_cast<int>(colors[0][1]) + colors[1][1]) / 2;
+                    colors[2][2] = (static_cast<int>(colors[0][2]) + colors[1][2]) / 2;
+                    colors[2][3] = 0xFFu;
+
+                    colors[3][0] = (static_cast<int>(colors[0][0]) + colors[1][0]) / 2;
+                    colors[3][1] = (static_cast<int>(colors[0][1]) + colors[1][1]) / 2;
+                    colors[3][2] = (static_cast<int>(colors[0][2]) + colors[1][2]) / 2;
+                    colors[3][3] = 0x00;
+                }
+
+                uint8_t indices[16];
+                for (unsigned j = 0; j < 16; j++)
+                    indices[j] = (indexBits >> (j * 2)) & 0b11;
+
+                for (unsigned y = 0; y < 4; y++) {
+                    for (unsigned x = 0; x < 4; x++) {
+                        unsigned index = 15 - ((y * 4) + x);
+
+                        block[y][x][0] = colors[indices[index]][0];
+                        block[y][x][1] = colors[indices[index]][1];
+                        block[y][x][2] = colors[indices[index]][2];
+                        block[y][x][3] = colors[indices[index]][3];
+                    }
+                }
+            }
+
+            // Copy decoded pixels
+            for (unsigned y = 0; y < 8; y++) {
+                if (yy + y >= srcHeight) break;
+
+                const unsigned rowBase = srcWidth * (yy + y);
+
+                for (unsigned x = 0; x < 8; x++) {
+                    if (xx + x >= srcWidth) break;
+
+                    const unsigned writeOffset = (rowBase + xx + x) * 4;
+
+                    unsigned blockIdx = (y >= 4) * 2 + (x >= 4);
+
+                    const unsigned localY = y % 4;
+                    const unsigned localX = x % 4;
+
+                    result[writeOffset + 0] = blocks[blockIdx][localY][localX][0];
+                    result[writeOffset + 1] = blocks[blockIdx][localY][localX][1];
+                    result[writeOffset + 2] = blocks[blockIdx][localY][localX][2];
+                    result[writeOffset + 3] = blocks[blockIdx][localY][localX][3];
+                }
+            }
+
+            readOffset += 8 * 4; // Advance sizeof sub-block * sub-block count
+        }
+    }
+}
+
+
+static void IMPLEMENTATION_FROM_C4(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t* palette) {
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 8) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
+
+            for (unsigned y = 0; y < 8; y++) {
+                if (yy + y >= srcHeight) break;
+
+                const unsigned rowBase = srcWidth * (yy + y);
+
+                for (unsigned x = 0; x < 8; x++) {
+                    if (xx + x >= srcWidth) break;
+
+                    const uint32_t destIndex = (rowBase + xx + x) * 4;
+
+                    // The left pixel is in the high nibble.
+                    const uint8_t indexPair = data[readOffset + (y * 4) + (x / 2)];
+                    const uint8_t index = (x & 1) ? (indexPair & 0xF) : (indexPair >> 4);
+                    const uint32_t color = palette[index];
+
+                    result[destIndex + 0] = (color >> 0) & 0xFFu;
+                    result[destIndex + 1] = (color >> 8) & 0xFFu;
+                    result[destIndex + 2] = (color >> 16) & 0xFFu;
+                    result[destIndex + 3] = (color >> 24) & 0xFFu;
+                }
+            }
+            readOffset += 4 * 8;
+        }
+    }
+}
+
+static void IMPLEMENTATION_FROM_C8(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t* palette) {
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
+
+            for (unsigned y = 0; y < 4; y++) {
+                if (yy + y >= srcHeight) break;
+
+                const unsigned rowBase = srcWidth * (yy + y);
+
+                for (unsigned x = 0; x < 8; x++) {
+                    if (xx + x >= srcWidth) break;
+
+                    const uint32_t destIndex = (rowBase + xx + x) * 4;
+
+                    const uint8_t index = data[readOffset + (y * 8) + x];
+                    const uint32_t color = palette[index];
+
+                    result[destIndex + 0] = (color >> 0) & 0xFFu;
+                    result[destIndex + 1] = (color >> 8) & 0xFFu;
+                    result[destIndex + 2] = (color >> 16) & 0xFFu;
+                    result[destIndex + 3] = (color >> 24) & 0xFFu;
+                }
+            }
+            readOffset += 1 * 8 * 4;
+        }
+    }
+}
+
+static void IMPLEMENTATION_FROM_C14X2(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t* palette) {
+    unsigned readOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 4) {
+
+            for (unsigned y = 0; y < 4; y++) {
+                if (yy + y >= srcHeight) break;
+
+                const unsigned rowBase = srcWidth * (yy + y);
+
+                for (unsigned x = 0; x < 4; x++) {
+                    if (xx + x >= srcWidth) break;
+
+                    const unsigned destIndex = (rowBase + xx + x) * 4;
+
+                    const uint16_t index = BYTESWAP_16(*reinterpret_cast<const uint16_t*>(
+                        data + readOffset + (y * 2 * 4) + (x * 2)
+                    ));
+                    const uint32_t color = palette[index & 0x3FFF];
+
+                    result[destIndex + 0] = (color >> 0) & 0xFFu;
+                    result[destIndex + 1] = (color >> 8) & 0xFFu;
+                    result[destIndex + 2] = (color >> 16) & 0xFFu;
+                    result[destIndex + 3] = (color >> 24) & 0xFFu;
+                }
+            }
+            readOffset += 2 * 4 * 4;
+
+        }
+    }
+}
+
+void decodeEdgeTile(
+    DecodeImplementation scalarImplementation,
+    unsigned tileWidth, unsigned tileHeight,
+    unsigned char* result, unsigned srcWidth, unsigned srcHeight,
+    unsigned tileX, unsigned tileY,
+    const unsigned char* tileData, const uint32_t* palette
+) {
+    // The largest tile is 8x8.
+    unsigned char tile[8 * 8 * 4];
+    scalarImplementation(tile, tileWidth, tileHeight, tileData, palette);
+
+    const unsigned copyWidth = std::min(tileWidth, srcWidth - tileX);
+    const unsigned copyHeight = std::min(tileHeight, srcHeight - tileY);
+
+    for (unsigned y = 0; y < copyHeight; y++) {
+        memcpy(
+            result + ((static_cast<size_t>(tileY) + y) * srcWidth + tileX) * 4,
+            tile + (y * tileWidth) * 4,
+            copyWidth * 4
+        );
+    }
+}
+
+const DecodeTable& getScalarKernels() {
+    static const DecodeTable table = []() {
+        DecodeTable table;
+        auto& impl = table.implementations;
+
+        impl[TPL::TPL_IMAGE_FORMAT_I4] = IMPLEMENTATION_FROM_I4;
+        impl[TPL::TPL_IMAGE_FORMAT_I8] = IMPLEMENTATION_FROM_I8;
+        impl[TPL::TPL_IMAGE_FORMAT_IA4] = IMPLEMENTATION_FROM_IA4;
+        impl[TPL::TPL_IMAGE_FORMAT_IA8] = IMPLEMENTATION_FROM_IA8;
+        impl[TPL::TPL_IMAGE_FORMAT_RGB565] = IMPLEMENTATION_FROM_RGB565;
+        impl[TPL::TPL_IMAGE_FORMAT_RGB5A3] = IMPLEMENTATION_FROM_RGB5A3;
+        impl[TPL::TPL_IMAGE_FORMAT_RGBA32] = IMPLEMENTATION_FROM_RGBA32;
+        impl[TPL::TPL_IMAGE_FORMAT_C4] = IMPLEMENTATION_FROM_C4;
+        impl[TPL::TPL_IMAGE_FORMAT_C8] = IMPLEMENTATION_FROM_C8;
+        impl[TPL::TPL_IMAGE_FORMAT_C14X2] = IMPLEMENTATION_FROM_C14X2;
+        impl[TPL::TPL_IMAGE_FORMAT_CMPR] = IMPLEMENTATION_FROM_CMPR;
+
+        return table;
+    }();
+    return table;
+}
+
+} // namespace detail
+
+} // namespace RvlImageConvert
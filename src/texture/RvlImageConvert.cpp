@@ -1,430 +1,128 @@
 #include "RvlImageConvert.hpp"
 
-#include <unordered_map>
+#include "RvlDecode/Kernels.hpp"
 
-#include "Logging.hpp"
+#include <cstring>
 
-#include "stb/stb_dxt.h"
+#include <algorithm>
 
-#include "Macro.hpp"
+#include <vector>
 
-typedef TPL::TPLImageFormat ImageFormat;
+#include "RvlPalette.hpp"
+#include "CMPRPacker.hpp"
 
-typedef void (*FromImplementation)(unsigned char*, unsigned, unsigned, const unsigned char*, const uint32_t*);
-typedef void (*ToImplementation)(unsigned char*, uint32_t*, unsigned*, unsigned, unsigned, const unsigned char*);
+#include "Logging.hpp"
 
-/*
-    FROM implementations (x to RGBA32)
-*/
+#include "manager/ConfigManager.hpp"
 
-static void IMPLEMENTATION_FROM_I4(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
-    unsigned readOffset { 0 };
+#include "util/ParallelUtil.hpp"
 
-    for (unsigned yy = 0; yy < srcHeight; yy += 8) {
-        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
 
-            for (unsigned y = 0; y < 8; y++) {
-                if (yy + y >= srcHeight) break;
+#include "Macro.hpp"
 
-                const unsigned rowBase = srcWidth * (yy + y);
+typedef TPL::TPLImageFormat ImageFormat;
 
-                for (unsigned x = 0; x < 8; x += 2) {
-                    if (xx + x >= srcWidth) break;
+typedef RvlImageConvert::detail::DecodeImplementation FromImplementation;
+typedef void (*ToImplementation)(unsigned char*, uint32_t*, unsigned*, unsigned, unsigned, const unsigned char*);
 
-                    const uint8_t intensityA = ((data[readOffset + (y * 4) + (x / 2)] & 0xF0) >> 4) * 0x11;
-                    const uint8_t intensityB = (data[readOffset + (y * 4) + (x / 2)] & 0x0F) * 0x11;
+/*
+    TO implementations (RGBA32 to x)
+*/
 
-                    const unsigned destIndex = (rowBase + xx + x) * 4;
+/*
+    Tile packers: a tile is gathered into contiguous RGBA32 pixels (row by row)
+    and packed by a branchless loop over the whole tile that is vectorized by
+    the compiler.
+*/
 
-                    result[destIndex + 0] = intensityA;
-                    result[destIndex + 1] = intensityA;
-                    result[destIndex + 2] = intensityA;
-                    result[destIndex + 3] = 0xFFu;
+static inline uint32_t GetR(uint32_t pixel) { return (pixel >>  0) & 0xFFu; }
+static inline uint32_t GetG(uint32_t pixel) { return (pixel >>  8) & 0xFFu; }
+static inline uint32_t GetB(uint32_t pixel) { return (pixel >> 16) & 0xFFu; }
+static inline uint32_t GetA(uint32_t pixel) { return (pixel >> 24) & 0xFFu; }
 
-                    result[destIndex + 4] = intensityB;
-                    result[destIndex + 5] = intensityB;
-                    result[destIndex + 6] = intensityB;
-                    result[destIndex + 7] = 0xFFu;
-                }
-            }
-            readOffset += 4 * 8;
-        }
-    }
+// Rec. 601 luma.
+static inline uint32_t GetIntensity(uint32_t pixel) {
+    return (GetR(pixel) * 77 + GetG(pixel) * 150 + GetB(pixel) * 29 + 128) >> 8;
 }
 
-static void IMPLEMENTATION_FROM_I8(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
-    unsigned readOffset { 0 };
-
-    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
-        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
-
-            for (unsigned y = 0; y < 4; y++) {
-                if (yy + y >= srcHeight) break;
-
-                for (unsigned x = 0; x < 8; x++) {
-                    if (xx + x >= srcWidth) break;
-
-                    const uint8_t intensity = data[readOffset + (y * 8) + x];
-
-                    const uint32_t destIndex = 4 * (srcWidth * (yy + y) + xx + x);
-
-                    result[destIndex + 0] = intensity;
-                    result[destIndex + 1] = intensity;
-                    result[destIndex + 2] = intensity;
-                    result[destIndex + 3] = 0xFFu;
-                }
-            }
-            readOffset += 1 * 8 * 4;
-        }
-    }
+// 8-bit channel to the nearest n-bit value.
+template <unsigned Bits>
+static inline uint32_t Reduce(uint32_t value) {
+    return (value * ((1u << Bits) - 1) + 127) / 255;
 }
 
-static void IMPLEMENTATION_FROM_IA4(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
-    unsigned readOffset { 0 };
-
-    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
-        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
-
-            for (unsigned y = 0; y < 4; y++) {
-                if (yy + y >= srcHeight) break;
-
-                const unsigned rowBase = srcWidth * (yy + y);
-
-                for (unsigned x = 0; x < 8; x++) {
-                    if (xx + x >= srcWidth) break;
-
-                    const unsigned destIndex = (rowBase + xx + x) * 4;
-
-                    const uint8_t alpha = ((data[readOffset + (y * 8) + x] & 0xF0) >> 4) * 0x11;
-                    const uint8_t intensity = (data[readOffset + (y * 8) + x] & 0x0F) * 0x11;
-
-                    result[destIndex + 0] = intensity;
-                    result[destIndex + 1] = intensity;
-                    result[destIndex + 2] = intensity;
-                    result[destIndex + 3] = alpha;
-                }
-            }
-            readOffset += 1 * 8 * 4;
-        }
+static void PACK_I4(unsigned char* out, const uint32_t* pixels) {
+    // 8x8; the left pixel of a pair is in the high nibble.
+    for (unsigned i = 0; i < 8 * 8 / 2; i++) {
+        out[i] =
+            (Reduce<4>(GetIntensity(pixels[i * 2 + 0])) << 4) |
+            Reduce<4>(GetIntensity(pixels[i * 2 + 1]));
     }
 }
 
-static void IMPLEMENTATION_FROM_IA8(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
-    unsigned readOffset { 0 };
-
-    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
-        for (unsigned xx = 0; xx < srcWidth; xx += 4) {
-
-            for (unsigned y = 0; y < 4; y++) {
-                if (yy + y >= srcHeight) break;
-
-                const unsigned rowBase = srcWidth * (yy + y);
-
-                for (unsigned x = 0; x < 4; x++) {
-                    if (xx + x >= srcWidth) break;
-
-                    const unsigned destIndex = (rowBase + xx + x) * 4;
-
-                    const uint8_t alpha = data[readOffset + (y * 2 * 4) + (x * 2) + 0];
-                    const uint8_t intensity = data[readOffset + (y * 2 * 4) + (x * 2) + 1];
-
-                    result[destIndex + 0] = intensity;
-                    result[destIndex + 1] = intensity;
-                    result[destIndex + 2] = intensity;
-                    result[destIndex + 3] = alpha;
-                }
-            }
-            readOffset += 2 * 4 * 4;
-        }
-    }
+static void PACK_I8(unsigned char* out, const uint32_t* pixels) {
+    // 8x4
+    for (unsigned i = 0; i < 8 * 4; i++)
+        out[i] = GetIntensity(pixels[i]);
 }
 
-
-static void IMPLEMENTATION_FROM_RGB565(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
-    unsigned readOffset { 0 };
-
-    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
-        for (unsigned xx = 0; xx < srcWidth; xx += 4) {
-
-            for (unsigned y = 0; y < 4; y++) {
-                if (yy + y >= srcHeight) break;
-
-                const unsigned rowBase = srcWidth * (yy + y);
-
-                for (unsigned x = 0; x < 4; x++) {
-                    if (xx + x >= srcWidth) break;
-
-                    const unsigned writeOffset = (rowBase + xx + x) * 4;
-
-                    const uint16_t sourcePixel = BYTESWAP_16(*reinterpret_cast<const uint16_t*>(
-                        data + readOffset + (y * 2 * 4) + (x * 2)
-                    ));
-
-                    result[writeOffset + 0] = ((sourcePixel >> 11) & 0x1f) << 3;
-                    result[writeOffset + 1] = ((sourcePixel >>  5) & 0x3f) << 2;
-                    result[writeOffset + 2] = ((sourcePixel >>  0) & 0x1f) << 3;
-                    result[writeOffset + 3] = 0xFFu;
-                }
-            }
-            readOffset += 2 * 4 * 4;
-        }
-    }
-}
-
-static void IMPLEMENTATION_FROM_RGB5A3(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
-    unsigned readOffset { 0 };
-
-    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
-        for (unsigned xx = 0; xx < srcWidth; xx += 4) {
-
-            for (unsigned y = 0; y < 4; y++) {
-                if (yy + y >= srcHeight) break;
-
-                const unsigned rowBase = srcWidth * (yy + y);
-
-                for (unsigned x = 0; x < 4; x++) {
-                    if (xx + x >= srcWidth) break;
-
-                    const unsigned writeOffset = (rowBase + xx + x) * 4;
-
-                    const uint16_t sourcePixel = BYTESWAP_16(*reinterpret_cast<const uint16_t*>(
-                        data + readOffset + (y * 2 * 4) + (x * 2)
-                    ));
-
-                    if ((sourcePixel & (1 << 15)) != 0) { // RGB555
-                        result[writeOffset + 0] = (((sourcePixel >> 10) & 0x1f) << 3) | (((sourcePixel >> 10) & 0x1f) >> 2);
-                        result[writeOffset + 1] = (((sourcePixel >> 5) & 0x1f) << 3) | (((sourcePixel >> 5) & 0x1f) >> 2);
-                        result[writeOffset + 2] = (((sourcePixel) & 0x1f) << 3) | (((sourcePixel) & 0x1f) >> 2);
-
-                        result[writeOffset + 3] = 0xFFu;
-                    }
-                    else { // RGBA4443
-                        result[writeOffset + 0] = (((sourcePixel >> 8) & 0x0f) << 4) | ((sourcePixel >> 8) & 0x0f);
-                        result[writeOffset + 1] = (((sourcePixel >> 4) & 0x0f) << 4) | ((sourcePixel >> 4) & 0x0f);
-                        result[writeOffset + 2] = (((sourcePixel) & 0x0f) << 4) | ((sourcePixel) & 0x0f);
-
-                        result[writeOffset + 3] =
-                            (((sourcePixel >> 12) & 0x07) << 5) | (((sourcePixel >> 12) & 0x07) << 2) |
-                            (((sourcePixel >> 12) & 0x07) >> 1);
-                    }
-                }
-            }
-            readOffset += 2 * 4 * 4;
-
-        }
-    }
+static void PACK_IA4(unsigned char* out, const uint32_t* pixels) {
+    // 8x4
+    for (unsigned i = 0; i < 8 * 4; i++)
+        out[i] = (Reduce<4>(GetA(pixels[i])) << 4) | Reduce<4>(GetIntensity(pixels[i]));
 }
 
-static void IMPLEMENTATION_FROM_RGBA32(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
-    unsigned readOffset { 0 };
-
-    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
-        for (unsigned xx = 0; xx < srcWidth; xx += 4) {
-            // The block data is split down into two subblocks:
-            //    Subblock A: Alpha and Red channel
-            //    Subblock B: Green and Blue channel
-
-            // Subblock A
-            for (unsigned y = 0; y < 4; y++) {
-                if (yy + y >= srcHeight) break;
-
-                const unsigned rowBase = srcWidth * (yy + y);
-
-                for (unsigned x = 0; x < 4; x++) {
-                    if (xx + x >= srcWidth) break;
-
-                    const unsigned destIndex = (rowBase + xx + x) * 4;
-
-                    result[destIndex + 3] = data[readOffset + (y * 2 * 4) + (x * 2) + 0]; // Alpha channel
-                    result[destIndex + 0] = data[readOffset + (y * 2 * 4) + (x * 2) + 1]; // Red channel
-                }
-            }
-            readOffset += 2 * 4 * 4;
-
-            // Subblock B
-            for (unsigned y = 0; y < 4; y++) {
-                if (yy + y >= srcHeight) break;
-
-                const unsigned rowBase = srcWidth * (yy + y);
-
-                for (unsigned x = 0; x < 4; x++) {
-                    if (xx + x >= srcWidth) break;
-
-                    const unsigned destIndex = (rowBase + xx + x) * 4;
-
-                    result[destIndex + 1] = data[readOffset + (y * 2 * 4) + (x * 2) + 0]; // Green channel
-                    result[destIndex + 2] = data[readOffset + (y * 2 * 4) + (x * 2) + 1]; // Blue channel
-                }
-            }
-            readOffset += 2 * 4 * 4;
-        }
+static void PACK_IA8(unsigned char* out, const uint32_t* pixels) {
+    // 4x4
+    for (unsigned i = 0; i < 4 * 4; i++) {
+        out[i * 2 + 0] = GetA(pixels[i]);
+        out[i * 2 + 1] = GetIntensity(pixels[i]);
     }
 }
 
-static void IMPLEMENTATION_FROM_CMPR(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t*) {
-    unsigned readOffset { 0 };
-
-    for (unsigned yy = 0; yy < srcHeight; yy += 8) {
-        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
-            // 4 4x4 RGBA blocks. Makes up one whole CMPR block
-            uint8_t blocks[4][4][4][4];
-
-            // Decode each CMPR-subblock
-            for (unsigned i = 0; i < 4; i++) {
-                const unsigned char *blockData = data + readOffset + (i * 8);
-                uint8_t (*block)[4][4] = blocks[i];
-
-                const uint16_t color1    = BYTESWAP_16(*reinterpret_cast<const uint16_t *>(blockData + 0));
-                const uint16_t color2    = BYTESWAP_16(*reinterpret_cast<const uint16_t *>(blockData + 2));
-                const uint32_t indexBits = BYTESWAP_32(*reinterpret_cast<const uint32_t *>(blockData + 4));
-
-                uint8_t colors[4][4];
-
-                colors[0][0] = (((color1 >> 11) & 0x1f) << 3) | (((color1 >> 11) & 0x1f) >> 2);
-                colors[0][1] = (((color1 >>  5) & 0x3f) << 2) | (((color1 >>  5) & 0x3f) >> 4);
-                colors[0][2] = (((color1 >>  0) & 0x1f) << 3) | (((color1 >>  0) & 0x1f) >> 2);
-                colors[0][3] = 0xFFu;
-
-                colors[1][0] = (((color2 >> 11) & 0x1f) << 3) | (((color2 >> 11) & 0x1f) >> 2);
-                colors[1][1] = (((color2 >>  5) & 0x3f) << 2) | (((color2 >>  5) & 0x3f) >> 4);
-                colors[1][2] = (((color2 >>  0) & 0x1f) << 3) | (((color2 >>  0) & 0x1f) >> 2);
-                colors[1][3] = 0xFFu;
-
-                if (color1 > color2) {
-                    colors[2][0] = ((static_cast<int>(colors[1][0]) * 3 + colors[0][0] * 5) >> 3);
-                    colors[2][1] = ((static_cast<int>(colors[1][1]) * 3 + colors[0][1] * 5) >> 3);
-                    colors[2][2] = ((static_cast<int>(colors[1][2]) * 3 + colors[0][2] * 5) >> 3);
-                    colors[2][3] = 0xFFu;
-
-                    colors[3][0] = ((static_cast<int>(colors[0][0]) * 3 + colors[1][0] * 5) >> 3);
-                    colors[3][1] = ((static_cast<int>(colors[0][1]) * 3 + colors[1][1] * 5) >> 3);
-                    colors[3][2] = ((static_cast<int>(colors[0][2]) * 3 + colors[1][2] * 5) >> 3);
-                    colors[3][3] = 0xFFu;
-                }
-                else {
-                    colors[2][0] = (static_cast<int>(colors[0][0]) + colors[1][0]) / 2;
-                    colors[2][1] = (static_cast<int>(colors[0][1]) + colors[1][1]) / 2;
-                    colors[2][2] = (static_cast<int>(colors[0][2]) + colors[1][2]) / 2;
-                    colors[2][3] = 0xFFu;
-
-                    colors[3][0] = (static_cast<int>(colors[0][0]) + colors[1][0]) / 2;
-                    colors[3][1] = (static_cast<int>(colors[0][1]) + colors[1][1]) / 2;
-                    colors[3][2] = (static_cast<int>(colors[0][2]) + colors[1][2]) / 2;
-                    colors[3][3] = 0x00;
-                }
-
-                uint8_t indices[16];
-                for (unsigned j = 0; j < 16; j++)
-                    indices[j] = (indexBits >> (j * 2)) & 0b11;
-
-                for (unsigned y = 0; y < 4; y++) {
-                    for (unsigned x = 0; x < 4; x++) {
-                        unsigned index = 15 - ((y * 4) + x);
-
-                        block[y][x][0] = colors[indices[index]][0];
-                        block[y][x][1] = colors[indices[index]][1];
-                        block[y][x][2] = colors[indices[index]][2];
-                        block[y][x][3] = colors[indices[index]][3];
-                    }
-                }
-            }
-
-            // Copy decoded pixels
-            for (unsigned y = 0; y < 8; y++) {
-                if (yy + y >= srcHeight) break;
-
-                const unsigned rowBase = srcWidth * (yy + y);
-
-                for (unsigned x = 0; x < 8; x++) {
-                    if (xx + x >= srcWidth) break;
-
-                    const unsigned writeOffset = (rowBase + xx + x) * 4;
-
-                    unsigned blockIdx = (y >= 4) * 2 + (x >= 4);
-
-                    const unsigned localY = y % 4;
-                    const unsigned localX = x % 4;
-
-                    result[writeOffset + 0] = blocks[blockIdx][localY][localX][0];
-                    result[writeOffset + 1] = blocks[blockIdx][localY][localX][1];
-                    result[writeOffset + 2] = blocks[blockIdx][localY][localX][2];
-                    result[writeOffset + 3] = blocks[blockIdx][localY][localX][3];
-                }
-            }
-
-            readOffset += 8 * 4; // Advance sizeof sub-block * sub-block count
-        }
+static void PACK_RGB565(unsigned char* out, const uint32_t* pixels) {
+    // 4x4, big-endian. The channels are rounded to what the decoder expands
+    // them to (shifted up without replicating the high bits).
+    for (unsigned i = 0; i < 4 * 4; i++) {
+        const uint32_t color =
+            (std::min((GetR(pixels[i]) + 4) >> 3, 0x1Fu) << 11) |
+            (std::min((GetG(pixels[i]) + 2) >> 2, 0x3Fu) << 5) |
+            std::min((GetB(pixels[i]) + 4) >> 3, 0x1Fu);
+
+        out[i * 2 + 0] = color >> 8;
+        out[i * 2 + 1] = color & 0xFFu;
     }
 }
 
+template <unsigned TileWidth, unsigned TileHeight, unsigned TileByteSize, void (*PackTile)(unsigned char*, const uint32_t*)>
+static void IMPLEMENTATION_TO_TILED(unsigned char* result, uint32_t*, unsigned*, unsigned srcWidth, unsigned srcHeight, const unsigned char* data) {
+    uint32_t pixels[TileWidth * TileHeight];
 
-static void IMPLEMENTATION_FROM_C8(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t* palette) {
-    unsigned readOffset { 0 };
-
-    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
-        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
-
-            for (unsigned y = 0; y < 4; y++) {
-                if (yy + y >= srcHeight) break;
-
-                const unsigned rowBase = srcWidth * (yy + y);
-
-                for (unsigned x = 0; x < 8; x++) {
-                    if (xx + x >= srcWidth) break;
-
-                    const uint32_t destIndex = (rowBase + xx + x) * 4;
-
-                    const uint8_t index = data[readOffset + (y * 8) + x];
-                    const uint32_t color = palette[index];
-
-                    result[destIndex + 0] = (color >> 24) & 0xFFu;
-                    result[destIndex + 1] = (color >> 16) & 0xFFu;
-                    result[destIndex + 2] = (color >>  8) & 0xFFu;
-                    result[destIndex + 3] = (color >>  0) & 0xFFu;
-                }
-            }
-            readOffset += 1 * 8 * 4;
-        }
-    }
-}
-
-static void IMPLEMENTATION_FROM_C14X2(unsigned char* result, unsigned srcWidth, unsigned srcHeight, const unsigned char* data, const uint32_t* palette) {
-    unsigned readOffset { 0 };
-
-    for (unsigned yy = 0; yy < srcHeight; yy += 4) {
-        for (unsigned xx = 0; xx < srcWidth; xx += 4) {
-
-            for (unsigned y = 0; y < 4; y++) {
-                if (yy + y >= srcHeight) break;
-
-                const unsigned rowBase = srcWidth * (yy + y);
-
-                for (unsigned x = 0; x < 4; x++) {
-                    if (xx + x >= srcWidth) break;
-
-                    const unsigned destIndex = (rowBase + xx + x) * 4;
-
-                    const uint16_t index = BYTESWAP_16(*reinterpret_cast<const uint16_t*>(
-                        data + readOffset + (y * 2 * 4) + (x * 2)
-                    ));
-                    const uint32_t color = palette[index & 0x3FFF];
+    unsigned writeOffset { 0 };
 
-                    result[destIndex + 0] = (color >> 0) & 0xFFu;
-                    result[destIndex + 1] = (color >> 8) & 0xFFu;
-                    result[destIndex + 2] = (color >> 16) & 0xFFu;
-                    result[destIndex + 3] = (color >> 24) & 0xFFu;
-                }
+    for (unsigned yy = 0; yy < srcHeight; yy += TileHeight) {
+        for (unsigned xx = 0; xx < srcWidth; xx += TileWidth) {
+            const unsigned copyWidth = std::min(TileWidth, srcWidth - xx);
+            const unsigned copyHeight = std::min(TileHeight, srcHeight - yy);
+
+            // Pixels outside of the image are transparent black.
+            if (copyWidth != TileWidth || copyHeight != TileHeight)
+                memset(pixels, 0x00, sizeof(pixels));
+
+            for (unsigned y = 0; y < copyHeight; y++) {
+                memcpy(
+                    pixels + y * TileWidth,
+                    data + ((static_cast<size_t>(yy) + y) * srcWidth + xx) * 4,
+                    copyWidth * 4
+                );
             }
-            readOffset += 2 * 4 * 4;
 
+            PackTile(result + writeOffset, pixels);
+            writeOffset += TileByteSize;
         }
     }
 }
 
-/*
-    TO implementations (RGBA32 to x)
-*/
-
 static void IMPLEMENTATION_TO_RGB5A3(unsigned char* result, uint32_t*, unsigned*, unsigned srcWidth, unsigned srcHeight, const unsigned char* data) {
     unsigned writeOffset { 0 };
 
@@ -515,14 +213,95 @@ static void IMPLEMENTATION_TO_RGBA32(unsigned char* result, uint32_t*, unsigned*
     }
 }
 
-static void IMPLEMENTATION_TO_CMPR(unsigned char* result, uint32_t*, unsigned*, unsigned srcWidth, unsigned srcHeight, const unsigned char* data) {
+static CMPRPacker::PackMode GetCMPRPackMode() {
+    switch (ConfigManager::getInstance().getConfig().cmprQuality) {
+    case CMPRQuality::Fast:
+        return CMPRPacker::PackMode::Fast;
+
+    default:
+        return CMPRPacker::PackMode::High;
+    }
+}
+
+static void IMPLEMENTATION_TO_CMPR(unsigned char* result, uint32_t*, unsigned*, unsigned srcWidth, unsigned srcHeight, const unsigned char* _data) {
+    const uint32_t* data = reinterpret_cast<const uint32_t*>(_data);
+
+    const CMPRPacker::PackMode packMode = GetCMPRPackMode();
+
+    unsigned writeOffset { 0 };
+
+    for (unsigned yy = 0; yy < srcHeight; yy += 8) {
+        for (unsigned xx = 0; xx < srcWidth; xx += 8) {
+            // A tile holds 2x2 blocks in row order.
+            for (unsigned i = 0; i < 4; i++) {
+                const unsigned blockX = xx + (i % 2) * 4;
+                const unsigned blockY = yy + (i / 2) * 4;
+
+                uint32_t pixels[4 * 4];
+
+                if (blockX + 4 <= srcWidth && blockY + 4 <= srcHeight) {
+                    for (unsigned y = 0; y < 4; y++)
+                        memcpy(pixels + y * 4, data + (blockY + y) * srcWidth + blockX, 4 * sizeof(uint32_t));
+                }
+                else {
+                    // Pixels outside of the image repeat the edge, so that
+                    // they don't take up colors of the block.
+                    for (unsigned y = 0; y < 4; y++) {
+                        for (unsigned x = 0; x < 4; x++) {
+                            const unsigned srcX = std::min(blockX + x, srcWidth - 1);
+                            const unsigned srcY = std::min(blockY + y, srcHeight - 1);
+
+                            pixels[y * 4 + x] = data[srcY * srcWidth + srcX];
+                        }
+                    }
+                }
+
+                CMPRPacker::packBlock(packMode, result + writeOffset, pixels);
+                writeOffset += 8;
+            }
+        }
+    }
+}
+
+static RvlPalette::Dithering GetPaletteDithering() {
+    switch (ConfigManager::getInstance().getConfig().paletteDithering) {
+    case PaletteDithering::Ordered:
+        return RvlPalette::Dithering::Ordered;
+    case PaletteDithering::ErrorDiffusion:
+        return RvlPalette::Dithering::ErrorDiffusion;
+
+    default:
+        return RvlPalette::Dithering::None;
+    }
+}
+
+// Reduce the image to the palette & return the palette index of every pixel.
+static std::vector<uint16_t> QuantizeImage(
+    uint32_t* paletteOut, unsigned* paletteSizeOut, unsigned maxColors,
+    unsigned srcWidth, unsigned srcHeight, const unsigned char* data
+) {
+    RvlPalette::IndexedImage image = RvlPalette::quantize(
+        data, srcWidth, srcHeight, maxColors, GetPaletteDithering()
+    );
+
+    std::copy(image.palette.begin(), image.palette.end(), paletteOut);
+    if (paletteSizeOut)
+        *paletteSizeOut = static_cast<unsigned>(image.palette.size());
+
+    return std::move(image.indices);
+}
+
+static void IMPLEMENTATION_TO_C4(unsigned char* result, uint32_t* paletteOut, unsigned* paletteSizeOut, unsigned srcWidth, unsigned srcHeight, const unsigned char* data) {
+    const std::vector<uint16_t> indices = QuantizeImage(paletteOut, paletteSizeOut, 16, srcWidth, srcHeight, data);
+
     unsigned writeOffset { 0 };
 
     for (unsigned yy = 0; yy < srcHeight; yy += 8) {
         for (unsigned xx = 0; xx < srcWidth; xx += 8) {
-            uint8_t blocks[4][4][4][4];
 
-            // Fill blocks
+            // Pixels outside of the image are index 0.
+            memset(result + writeOffset, 0x00, 4 * 8);
+
             for (unsigned y = 0; y < 8; y++) {
                 if (yy + y >= srcHeight) break;
 
@@ -531,52 +310,20 @@ static void IMPLEMENTATION_TO_CMPR(unsigned char* result, uint32_t*, unsigned*,
                 for (unsigned x = 0; x < 8; x++) {
                     if (xx + x >= srcWidth) break;
 
-                    unsigned blockIdx = (y >= 4) * 2 + (x >= 4);
-                    unsigned localY = y % 4;
-                    unsigned localX = x % 4;
-                    const unsigned readOffset = (rowBase + xx + x) * 4;
-
-                    blocks[blockIdx][localY][localX][0] = data[readOffset + 0];
-                    blocks[blockIdx][localY][localX][1] = data[readOffset + 1];
-                    blocks[blockIdx][localY][localX][2] = data[readOffset + 2];
-                    blocks[blockIdx][localY][localX][3] = data[readOffset + 3];
-                }
-            }
+                    uint8_t* pixelPair = result + writeOffset + (y * 4) + (x / 2);
 
-            // Encode
-            for (unsigned i = 0; i < 4; i++) {
-                uint8_t (*block)[4][4] = blocks[i];
-                unsigned char* blockData = result + writeOffset + (i * 8);
-
-                // This uses a modified version of stb_dxt that encodes to CMPR.
-                stb_compress_dxt_block(blockData, block[0][0], 0, STB_DXT_HIGHQUAL);
-
-                uint16_t* color1 = reinterpret_cast<uint16_t*>(blockData + 0);
-                uint16_t* color2 = reinterpret_cast<uint16_t*>(blockData + 2);
-                uint32_t* indexBits = reinterpret_cast<uint32_t*>(blockData + 4);
-
-                *color1 = BYTESWAP_16(*color1);
-                *color2 = BYTESWAP_16(*color2);
-
-                // The indices are read in reverse. Since it's already in LE the bytes are
-                // fine but we still need to reverse the individual bits.
-                for (unsigned i = 0; i < 4; i++) {
-                    unsigned shift = i * 8;
-                    unsigned row = (*indexBits >> shift) & 0xFF;
-                    row = ((row & 0x03) << 6) | ((row & 0x0C) << 2) | ((row & 0x30) >> 2) | ((row & 0xC0) >> 6);
-                    *indexBits = (*indexBits & ~(0xFF << shift)) | (row << shift);
+                    // The left pixel is in the high nibble.
+                    const uint8_t index = static_cast<uint8_t>(indices[rowBase + xx + x]);
+                    *pixelPair |= (x & 1) ? index : (index << 4);
                 }
             }
-
-            writeOffset += 8 * 4;
+            writeOffset += 4 * 8;
         }
     }
 }
 
-
 static void IMPLEMENTATION_TO_C8(unsigned char* result, uint32_t* paletteOut, unsigned* paletteSizeOut, unsigned srcWidth, unsigned srcHeight, const unsigned char* data) {
-    std::unordered_map<uint32_t, unsigned> colorToIndex;
-    unsigned nextColorIndex { 0 };
+    const std::vector<uint16_t> indices = QuantizeImage(paletteOut, paletteSizeOut, 256, srcWidth, srcHeight, data);
 
     unsigned writeOffset { 0 };
 
@@ -591,35 +338,19 @@ static void IMPLEMENTATION_TO_C8(unsigned char* result, uint32_t* paletteOut, un
                 for (unsigned x = 0; x < 8; x++) {
                     if (xx + x >= srcWidth) break;
 
-                    const uint32_t readPixel = *reinterpret_cast<const uint32_t*>(
-                        data + (rowBase + xx + x) * 4
-                    );
                     uint8_t* pixel = reinterpret_cast<uint8_t*>(
                         result + writeOffset + (y * 8) + x
                     );
-
-                    if (colorToIndex.find(readPixel) == colorToIndex.end()) {
-                        if (nextColorIndex >= 256) {
-                            Logging::error("[IMPLEMENTATION_TO_C8] Palette index limit reached (256), processing cannot continue.");
-                            return;
-                        }
-
-                        paletteOut[nextColorIndex] = readPixel;
-                        colorToIndex[readPixel] = nextColorIndex++;
-                    }
-                    *pixel = colorToIndex[readPixel];
+                    *pixel = static_cast<uint8_t>(indices[rowBase + xx + x]);
                 }
             }
             writeOffset += 1 * 8 * 4;
         }
     }
-
-    *paletteSizeOut = nextColorIndex;
 }
 
 static void IMPLEMENTATION_TO_C14X2(unsigned char* result, uint32_t* paletteOut, unsigned* paletteSizeOut, unsigned srcWidth, unsigned srcHeight, const unsigned char* data) {
-    std::unordered_map<uint32_t, unsigned> colorToIndex;
-    unsigned nextColorIndex { 0 };
+    const std::vector<uint16_t> indices = QuantizeImage(paletteOut, paletteSizeOut, 16384, srcWidth, srcHeight, data);
 
     unsigned writeOffset { 0 };
 
@@ -634,95 +365,76 @@ static void IMPLEMENTATION_TO_C14X2(unsigned char* result, uint32_t* paletteOut,
                 for (unsigned x = 0; x < 4; x++) {
                     if (xx + x >= srcWidth) break;
 
-                    const uint32_t readPixel = *reinterpret_cast<const uint32_t*>(
-                        data + (rowBase + xx + x) * 4
-                    );
                     uint16_t* pixel = reinterpret_cast<uint16_t*>(
                         result + writeOffset + (y * 2 * 4) + (x * 2)
                     );
-
-                    if (colorToIndex.find(readPixel) == colorToIndex.end()) {
-                        if (nextColorIndex >= 16384) {
-                            Logging::error("[IMPLEMENTATION_TO_C14X2] Palette index limit reached (16384), processing cannot continue.");
-                            return;
-                        }
-
-                        paletteOut[nextColorIndex] = readPixel;
-                        colorToIndex[readPixel] = nextColorIndex++;
-                    }
-                    *pixel = BYTESWAP_16(static_cast<uint16_t>(colorToIndex[readPixel]));
+                    *pixel = BYTESWAP_16(indices[rowBase + xx + x]);
                 }
             }
             writeOffset += 2 * 4 * 4;
         }
     }
-
-    if (paletteSizeOut)
-        *paletteSizeOut = nextColorIndex;
 }
 
 
 
-bool RvlImageConvert::toRGBA32(
-    unsigned char* buffer,
-    const ImageFormat format,
-    const unsigned srcWidth,
-    const unsigned srcHeight,
-    const unsigned char* data,
-    const uint32_t* palette
-) {
-    FromImplementation implementation;
+// Minimum amount of pixels converted by one thread.
+constexpr unsigned PARALLEL_MIN_PIXELS = 0x8000;
+
+static unsigned getTileHeight(const ImageFormat format) {
     switch (format) {
     case ImageFormat::TPL_IMAGE_FORMAT_I4:
-        implementation = IMPLEMENTATION_FROM_I4;
-        break;
-
-    case ImageFormat::TPL_IMAGE_FORMAT_I8:
-        implementation = IMPLEMENTATION_FROM_I8;
-        break;
-
-    case ImageFormat::TPL_IMAGE_FORMAT_IA4:
-        implementation = IMPLEMENTATION_FROM_IA4;
-        break;
-
-    case ImageFormat::TPL_IMAGE_FORMAT_IA8:
-        implementation = IMPLEMENTATION_FROM_IA8;
-        break;
+    case ImageFormat::TPL_IMAGE_FORMAT_C4:
+    case ImageFormat::TPL_IMAGE_FORMAT_CMPR:
+        return 8;
 
-    case ImageFormat::TPL_IMAGE_FORMAT_RGB565:
-        implementation = IMPLEMENTATION_FROM_RGB565;
-        break;
+    default:
+        return 4;
+    }
+}
 
-    case ImageFormat::TPL_IMAGE_FORMAT_RGB5A3:
-        implementation = IMPLEMENTATION_FROM_RGB5A3;
-        break;
+// Run a conversion on bands of whole tile rows in parallel. The image data of
+// a band is contiguous, so every band is converted like a separate image.
+static void ForEachTileRowBand(
+    const ImageFormat format, const unsigned srcWidth, const unsigned srcHeight, const unsigned minPixels,
+    const std::function<void(size_t pixelOffset, size_t dataOffset, unsigned bandHeight)>& func
+) {
+    const unsigned tileHeight = getTileHeight(format);
+    const unsigned tileRowCount = (srcHeight + tileHeight - 1) / tileHeight;
 
-    case ImageFormat::TPL_IMAGE_FORMAT_RGBA32:
-        implementation = IMPLEMENTATION_FROM_RGBA32;
-        break;
+    const size_t tileRowByteSize = RvlImageConvert::getImageByteSize(format, srcWidth, tileHeight);
+    const size_t tileRowPixelCount = static_cast<size_t>(srcWidth) * tileHeight;
 
-    case ImageFormat::TPL_IMAGE_FORMAT_C8:
-        if (!palette) {
-            Logging::error("[RvlImageConvert::toRGBA32] Cannot convert C8 texture: palette is NULL");
-            return false;
-        }
+    ParallelUtil::parallelFor(
+        tileRowCount, minPixels / std::max<size_t>(tileRowPixelCount, 1),
+        [&](size_t begin, size_t end) {
+            const unsigned y = static_cast<unsigned>(begin) * tileHeight;
+            const unsigned bandHeight = std::min(static_cast<unsigned>(end) * tileHeight, srcHeight) - y;
 
-        implementation = IMPLEMENTATION_FROM_C8;
-        break;
-    case ImageFormat::TPL_IMAGE_FORMAT_C14X2:
-        if (!palette) {
-            Logging::error("[RvlImageConvert::toRGBA32] Cannot convert C14X2 texture: palette is NULL");
-            return false;
+            func(begin * tileRowPixelCount, begin * tileRowByteSize, bandHeight);
         }
+    );
+}
 
-        implementation = IMPLEMENTATION_FROM_C14X2;
-        break;
-
-    case ImageFormat::TPL_IMAGE_FORMAT_CMPR:
-        implementation = IMPLEMENTATION_FROM_CMPR;
-        break;
+bool RvlImageConvert::toRGBA32(
+    unsigned char* buffer,
+    const ImageFormat format,
+    const unsigned srcWidth,
+    const unsigned srcHeight,
+    const unsigned char* data,
+    const uint32_t* palette
+) {
+    if (format >= ImageFormat::TPL_IMAGE_FORMAT_COUNT) {
+        Logging::error(
+            "[RvlImageConvert::toRGBA32] Cannot convert texture: invalid format ({})",
+            static_cast<uint32_t>(format)
+        );
+        return false;
+    }
 
-    default:
+    // The kernels for the best instruction set of the CPU.
+    const FromImplementation implementation = detail::getDecodeTable().implementations[format];
+    if (!implementation) {
         Logging::error(
             "[RvlImageConvert::toRGBA32] Cannot convert texture: invalid format ({})",
             static_cast<uint32_t>(format)
@@ -730,7 +442,17 @@ bool RvlImageConvert::toRGBA32(
         return false;
     }
 
-    implementation(buffer, srcWidth, srcHeight, data, palette);
+    if (TPL::getImageFormatPaletted(format) && !palette) {
+        Logging::error(
+            "[RvlImageConvert::toRGBA32] Cannot convert {} texture: palette is NULL",
+            TPL::getImageFormatName(format)
+        );
+        return false;
+    }
+
+    ForEachTileRowBand(format, srcWidth, srcHeight, PARALLEL_MIN_PIXELS, [&](size_t pixelOffset, size_t dataOffset, unsigned bandHeight) {
+        implementation(buffer + pixelOffset * 4, srcWidth, bandHeight, data + dataOffset, palette);
+    });
 
     return true;
 }
@@ -759,6 +481,22 @@ bool RvlImageConvert::fromRGBA32(
 ) {
     ToImplementation implementation;
     switch (format) {
+    case ImageFormat::TPL_IMAGE_FORMAT_I4:
+        implementation = IMPLEMENTATION_TO_TILED<8, 8, 32, PACK_I4>;
+        break;
+    case ImageFormat::TPL_IMAGE_FORMAT_I8:
+        implementation = IMPLEMENTATION_TO_TILED<8, 4, 32, PACK_I8>;
+        break;
+    case ImageFormat::TPL_IMAGE_FORMAT_IA4:
+        implementation = IMPLEMENTATION_TO_TILED<8, 4, 32, PACK_IA4>;
+        break;
+    case ImageFormat::TPL_IMAGE_FORMAT_IA8:
+        implementation = IMPLEMENTATION_TO_TILED<4, 4, 32, PACK_IA8>;
+        break;
+    case ImageFormat::TPL_IMAGE_FORMAT_RGB565:
+        implementation = IMPLEMENTATION_TO_TILED<4, 4, 32, PACK_RGB565>;
+        break;
+
     case ImageFormat::TPL_IMAGE_FORMAT_RGB5A3:
         implementation = IMPLEMENTATION_TO_RGB5A3;
         break;
@@ -771,13 +509,20 @@ bool RvlImageConvert::fromRGBA32(
         implementation = IMPLEMENTATION_TO_CMPR;
         break;
 
+    case ImageFormat::TPL_IMAGE_FORMAT_C4:
+        if (!paletteOut) {
+            Logging::error("[RvlImageConvert::fromRGBA32] Couldn't convert to C4 format: no color palette passed.");
+            return false;
+        }
+
+        implementation = IMPLEMENTATION_TO_C4;
+        break;
     case ImageFormat::TPL_IMAGE_FORMAT_C8:
         if (!paletteOut) {
             Logging::error("[RvlImageConvert::fromRGBA32] Couldn't convert to C8 format: no color palette passed.");
             return false;
         }
 
-        //IMPLEMENTATION_TO_C8(buffer, paletteOut, paletteSizeOut, srcWidth, srcHeight, data);
         implementation = IMPLEMENTATION_TO_C8;
         break;
     case ImageFormat::TPL_IMAGE_FORMAT_C14X2:
@@ -793,7 +538,18 @@ bool RvlImageConvert::fromRGBA32(
         return false;
     }
 
-    implementation(buffer, paletteOut, paletteSizeOut, srcWidth, srcHeight, data);
+    // The palette is built over the whole image.
+    if (TPL::getImageFormatPaletted(format)) {
+        implementation(buffer, paletteOut, paletteSizeOut, srcWidth, srcHeight, data);
+        return true;
+    }
+
+    // CMPR packing is slow, so it's split as fine as possible.
+    const unsigned minPixels = format == ImageFormat::TPL_IMAGE_FORMAT_CMPR ? 0 : PARALLEL_MIN_PIXELS;
+
+    ForEachTileRowBand(format, srcWidth, srcHeight, minPixels, [&](size_t pixelOffset, size_t dataOffset, unsigned bandHeight) {
+        implementation(buffer + dataOffset, nullptr, nullptr, srcWidth, bandHeight, data + pixelOffset * 4);
+    });
 
     return true;
 }
@@ -801,12 +557,7 @@ bool RvlImageConvert::fromRGBA32(
     TPL::TPLTexture& texture,
     unsigned char* buffer
 ) {
-    if (texture.format == ImageFormat::TPL_IMAGE_FORMAT_C14X2)
-        texture.palette.resize(16384);
-    if (texture.format == ImageFormat::TPL_IMAGE_FORMAT_C8)
-        texture.palette.resize(256);
-    if (texture.format == ImageFormat::TPL_IMAGE_FORMAT_C4)
-        texture.palette.resize(16);
+    texture.palette.resize(RvlPalette::getMaxColorCount(texture.format));
 
     unsigned paletteSize { 0 };
 
@@ -901,3 +652,16 @@ unsigned RvlImageConvert::getImageByteSize(const ImageFormat type, const unsigne
 unsigned RvlImageConvert::getImageByteSize(const TPL::TPLTexture& texture) {
     return getImageByteSize(texture.format, texture.width, texture.height);
 }
+
+unsigned RvlImageConvert::getImageByteSize(const ImageFormat type, unsigned width, unsigned height, unsigned mipCount) {
+    unsigned sum = 0;
+
+    for (unsigned i = 0; i < mipCount; i++) {
+        sum += getImageByteSize(type, width, height);
+
+        width = (width > 1) ? width / 2 : 1;
+        height = (height > 1) ? height / 2 : 1;
+    }
+
+    return sum;
+}
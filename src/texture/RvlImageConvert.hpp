@@ -38,6 +38,9 @@ bool fromRGBA32(
 unsigned getImageByteSize(const TPL::TPLImageFormat type, const unsigned width, const unsigned height);
 // Note: for paletted image types this does not include the lookup table.
 unsigned getImageByteSize(const TPL::TPLTexture& texture);
+// Size of mipCount levels, each half the size of the previous one.
+// Note: for paletted image types this does not include the lookup table.
+unsigned getImageByteSize(const TPL::TPLImageFormat type, unsigned width, unsigned height, unsigned mipCount);
 
 } // namespace RvlImageConvert
 
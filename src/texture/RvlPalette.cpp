@@ -1,17 +1,439 @@
 #include "RvlPalette.hpp"
 
+#include <array>
+
+#include <queue>
+
+#include <algorithm>
+
+#include <limits>
+
+#include <cmath>
+
+#include <chrono>
+
 #include "Logging.hpp"
 
+#include "util/ParallelUtil.hpp"
+
 #include "Macro.hpp"
 
-std::set<uint32_t> RvlPalette::generate(const unsigned char* _rgbaImage, unsigned pixelCount) {
-    const uint32_t* rgbaImage = reinterpret_cast<const uint32_t*>(_rgbaImage);
+// Colors are bucketed by their RGB5A3 CLUT entry; colors with the same entry
+// end up the same anyway.
+constexpr unsigned KEY_COUNT = 0x10000;
+
+constexpr uint16_t NO_INDEX = 0xFFFF;
+
+constexpr unsigned KMEANS_MAX_COLORS = 256;
+constexpr unsigned KMEANS_ITERATIONS = 4;
+
+typedef std::array<int, 4> Color; // R, G, B, A
+
+static uint16_t ColorToKey(const Color& color) {
+    const unsigned r = color[0], g = color[1], b = color[2], a = color[3];
+
+    if (a == 0xFF) // RGB555
+        return 0x8000 | ((r >> 3) << 10) | ((g >> 3) << 5) | (b >> 3);
+    else // RGBA4443
+        return ((a >> 5) << 12) | ((r >> 4) << 8) | ((g >> 4) << 4) | (b >> 4);
+}
+
+static Color KeyToColor(uint16_t key) {
+    if ((key & 0x8000) != 0) { // RGB555
+        const int r = (key >> 10) & 0x1F, g = (key >> 5) & 0x1F, b = key & 0x1F;
+        return { (r << 3) | (r >> 2), (g << 3) | (g >> 2), (b << 3) | (b >> 2), 0xFF };
+    }
+    else { // RGBA4443
+        const int a = (key >> 12) & 0x7;
+        const int r = (key >> 8) & 0xF, g = (key >> 4) & 0xF, b = key & 0xF;
+        return { (r << 4) | r, (g << 4) | g, (b << 4) | b, (a << 5) | (a << 2) | (a >> 1) };
+    }
+}
+
+static Color PixelToColor(const unsigned char* pixel) {
+    return { pixel[0], pixel[1], pixel[2], pixel[3] };
+}
+
+static unsigned ColorDistance(const Color& a, const Color& b) {
+    unsigned distance = 0;
+    for (unsigned i = 0; i < 4; i++)
+        distance += (a[i] - b[i]) * (a[i] - b[i]);
+    return distance;
+}
+
+static uint16_t FindNearest(const Color& color, const std::vector<Color>& palette) {
+    unsigned bestDistance = std::numeric_limits<unsigned>::max();
+    uint16_t bestIndex = 0;
+
+    for (size_t i = 0; i < palette.size(); i++) {
+        const unsigned distance = ColorDistance(color, palette[i]);
+        if (distance < bestDistance) {
+            bestDistance = distance;
+            bestIndex = static_cast<uint16_t>(i);
+        }
+    }
+
+    return bestIndex;
+}
+
+namespace {
+
+// A distinct color (by key) & the amount of pixels with it.
+struct ColorPoint {
+    Color color;
+    uint32_t weight;
+    uint16_t key;
+};
+
+struct ColorBox {
+    unsigned begin, end; // Range of points.
+    double error; // Weighted sum of squared distances to the mean.
+};
+
+} // namespace
+
+static double BoxError(const std::vector<ColorPoint>& points, unsigned begin, unsigned end) {
+    double weightSum = 0.0;
+    double sum[4] {}, squareSum[4] {};
+
+    for (unsigned i = begin; i < end; i++) {
+        const double weight = points[i].weight;
+        weightSum += weight;
+
+        for (unsigned c = 0; c < 4; c++) {
+            sum[c] += weight * points[i].color[c];
+            squareSum[c] += weight * points[i].color[c] * points[i].color[c];
+        }
+    }
+
+    double error = 0.0;
+    for (unsigned c = 0; c < 4; c++)
+        error += squareSum[c] - (sum[c] * sum[c]) / weightSum;
+
+    return error;
+}
+
+static Color BoxMean(const std::vector<ColorPoint>& points, unsigned begin, unsigned end) {
+    double weightSum = 0.0;
+    double sum[4] {};
+
+    for (unsigned i = begin; i < end; i++) {
+        weightSum += points[i].weight;
+        for (unsigned c = 0; c < 4; c++)
+            sum[c] += static_cast<double>(points[i].weight) * points[i].color[c];
+    }
+
+    Color mean;
+    for (unsigned c = 0; c < 4; c++)
+        mean[c] = std::clamp(static_cast<int>(sum[c] / weightSum + .5), 0, 255);
+
+    return mean;
+}
+
+// Split the points into at most boxCount boxes, always splitting the box with
+// the largest error at the weighted median of its widest channel.
+static std::vector<ColorBox> MedianCut(std::vector<ColorPoint>& points, unsigned boxCount) {
+    auto compareBoxes = [](const ColorBox& a, const ColorBox& b) { return a.error < b.error; };
+    std::priority_queue<ColorBox, std::vector<ColorBox>, decltype(compareBoxes)> queue(compareBoxes);
+
+    std::vector<ColorBox> finishedBoxes;
+
+    const unsigned pointCount = static_cast<unsigned>(points.size());
+    queue.push({ 0, pointCount, BoxError(points, 0, pointCount) });
+
+    while (!queue.empty() && (queue.size() + finishedBoxes.size()) < boxCount) {
+        const ColorBox box = queue.top();
+        queue.pop();
+
+        if ((box.end - box.begin) < 2 || box.error <= 0.0) {
+            finishedBoxes.push_back(box);
+            continue;
+        }
+
+        Color minColor { 255, 255, 255, 255 }, maxColor { 0, 0, 0, 0 };
+        uint64_t weightSum = 0;
+
+        for (unsigned i = box.begin; i < box.end; i++) {
+            for (unsigned c = 0; c < 4; c++) {
+                minColor[c] = std::min(minColor[c], points[i].color[c]);
+                maxColor[c] = std::max(maxColor[c], points[i].color[c]);
+            }
+            weightSum += points[i].weight;
+        }
+
+        unsigned channel = 0;
+        for (unsigned c = 1; c < 4; c++) {
+            if ((maxColor[c] - minColor[c]) > (maxColor[channel] - minColor[channel]))
+                channel = c;
+        }
+
+        std::sort(
+            points.begin() + box.begin, points.begin() + box.end,
+            [channel](const ColorPoint& a, const ColorPoint& b) {
+                return a.color[channel] < b.color[channel];
+            }
+        );
+
+        unsigned split = box.begin + 1;
+        uint64_t weightAccum = 0;
+        for (unsigned i = box.begin; i < box.end; i++) {
+            weightAccum += points[i].weight;
+            if (weightAccum * 2 >= weightSum) {
+                split = i + 1;
+                break;
+            }
+        }
+        split = std::clamp(split, box.begin + 1, box.end - 1);
+
+        queue.push({ box.begin, split, BoxError(points, box.begin, split) });
+        queue.push({ split, box.end, BoxError(points, split, box.end) });
+    }
+
+    while (!queue.empty()) {
+        finishedBoxes.push_back(queue.top());
+        queue.pop();
+    }
+
+    return finishedBoxes;
+}
+
+// Move every palette color to the mean of the points closest to it.
+static void RefineKMeans(const std::vector<ColorPoint>& points, std::vector<Color>& palette) {
+    std::vector<uint16_t> assignments(points.size());
+
+    for (unsigned iteration = 0; iteration < KMEANS_ITERATIONS; iteration++) {
+        ParallelUtil::parallelFor(points.size(), 1024, [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++)
+                assignments[i] = FindNearest(points[i].color, palette);
+        });
+
+        std::vector<std::array<double, 5>> sums(palette.size()); // RGBA & weight
+        for (size_t i = 0; i < points.size(); i++) {
+            auto& sum = sums[assignments[i]];
+            for (unsigned c = 0; c < 4; c++)
+                sum[c] += static_cast<double>(points[i].weight) * points[i].color[c];
+            sum[4] += points[i].weight;
+        }
+
+        for (size_t i = 0; i < palette.size(); i++) {
+            if (sums[i][4] <= 0.0)
+                continue;
+
+            for (unsigned c = 0; c < 4; c++)
+                palette[i][c] = std::clamp(static_cast<int>(sums[i][c] / sums[i][4] + .5), 0, 255);
+        }
+    }
+}
+
+unsigned RvlPalette::getMaxColorCount(TPL::TPLImageFormat format) {
+    switch (format) {
+    case TPL::TPL_IMAGE_FORMAT_C4:
+        return 16;
+    case TPL::TPL_IMAGE_FORMAT_C8:
+        return 256;
+    case TPL::TPL_IMAGE_FORMAT_C14X2:
+        return 16384;
+
+    default:
+        return 0;
+    }
+}
+
+RvlPalette::IndexedImage RvlPalette::quantize(
+    const unsigned char* rgbaImage, unsigned width, unsigned height,
+    unsigned maxColors, Dithering dithering
+) {
+    const auto startTime = std::chrono::steady_clock::now();
+
+    IndexedImage result;
+
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+    if (pixelCount == 0 || maxColors == 0)
+        return result;
+
+    maxColors = std::min(maxColors, 16384u);
+
+    result.indices.resize(pixelCount);
+
+    std::vector<uint32_t> keyCounts(KEY_COUNT, 0);
+    for (size_t i = 0; i < pixelCount; i++)
+        keyCounts[ColorToKey(PixelToColor(rgbaImage + i * 4))]++;
+
+    unsigned distinctCount = 0;
+    for (uint32_t count : keyCounts)
+        distinctCount += count != 0;
+
+    const bool lossy = distinctCount > maxColors;
+
+    // When colors have to be merged, the color of invisible pixels doesn't
+    // matter; they're all bucketed together.
+    auto getKey = [lossy](const Color& color) -> uint16_t {
+        const uint16_t key = ColorToKey(color);
+        if (lossy && (key & 0xF000) == 0)
+            return 0x0000;
+        return key;
+    };
+
+    if (lossy) {
+        for (unsigned key = 1; key < 0x1000; key++) {
+            keyCounts[0] += keyCounts[key];
+            keyCounts[key] = 0;
+        }
+    }
+
+    std::vector<ColorPoint> points;
+    points.reserve(distinctCount);
+
+    for (unsigned key = 0; key < KEY_COUNT; key++) {
+        if (keyCounts[key] != 0)
+            points.push_back({ KeyToColor(key), keyCounts[key], static_cast<uint16_t>(key) });
+    }
+
+    // Palette index per key.
+    std::vector<uint16_t> keyToIndex(KEY_COUNT, NO_INDEX);
+
+    std::vector<Color> palette;
+
+    if (!lossy) {
+        palette.reserve(points.size());
+        for (const auto& point : points) {
+            keyToIndex[point.key] = static_cast<uint16_t>(palette.size());
+            palette.push_back(point.color);
+        }
+    }
+    else {
+        std::vector<ColorBox> boxes = MedianCut(points, maxColors);
+
+        palette.reserve(boxes.size());
+        for (const auto& box : boxes)
+            palette.push_back(BoxMean(points, box.begin, box.end));
+
+        if (maxColors <= KMEANS_MAX_COLORS)
+            RefineKMeans(points, palette);
+
+        // Snap the colors to what the CLUT can store.
+        for (auto& color : palette)
+            color = KeyToColor(ColorToKey(color));
+
+        if (maxColors <= KMEANS_MAX_COLORS) {
+            ParallelUtil::parallelFor(points.size(), 1024, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++)
+                    keyToIndex[points[i].key] = FindNearest(points[i].color, palette);
+            });
+        }
+        else {
+            // Too many colors to search; every point keeps its box.
+            for (size_t i = 0; i < boxes.size(); i++) {
+                for (unsigned j = boxes[i].begin; j < boxes[i].end; j++)
+                    keyToIndex[points[j].key] = static_cast<uint16_t>(i);
+            }
+        }
+    }
+
+    // Index of the nearest palette color; keys that aren't in the image
+    // (dithered colors) are looked up as they come up.
+    auto lookup = [&](const Color& color) -> uint16_t {
+        const uint16_t key = getKey(color);
+        if (keyToIndex[key] == NO_INDEX)
+            keyToIndex[key] = FindNearest(KeyToColor(key), palette);
+        return keyToIndex[key];
+    };
+
+    if (!lossy || dithering == Dithering::None || maxColors > KMEANS_MAX_COLORS) {
+        ParallelUtil::parallelFor(height, 16, [&](size_t begin, size_t end) {
+            for (size_t i = begin * width; i < end * width; i++)
+                result.indices[i] = keyToIndex[getKey(PixelToColor(rgbaImage + i * 4))];
+        });
+    }
+    else if (dithering == Dithering::Ordered) {
+        static constexpr int BAYER_MATRIX[4][4] = {
+            {  0,  8,  2, 10 },
+            { 12,  4, 14,  6 },
+            {  3, 11,  1,  9 },
+            { 15,  7, 13,  5 }
+        };
+
+        // Spread of the dither offsets; roughly half of the distance between
+        // palette colors.
+        const int spread = static_cast<int>(128.f / std::cbrt(static_cast<float>(palette.size())));
+
+        for (unsigned y = 0; y < height; y++) {
+            for (unsigned x = 0; x < width; x++) {
+                const size_t i = static_cast<size_t>(y) * width + x;
+                Color color = PixelToColor(rgbaImage + i * 4);
+
+                // The alpha channel is kept as-is, so that edges stay clean.
+                const int offset = ((BAYER_MATRIX[y & 3][x & 3] * 2 + 1) * spread) / 32 - spread / 2;
+                for (unsigned c = 0; c < 3; c++)
+                    color[c] = std::clamp(color[c] + offset, 0, 255);
+
+                result.indices[i] = lookup(color);
+            }
+        }
+    }
+    else { // Dithering::ErrorDiffusion
+        // Error (RGB, in 16ths) of the current & the next row, with a pixel of
+        // padding on both sides.
+        std::vector<std::array<int, 3>> currentErrors(width + 2), nextErrors(width + 2);
+
+        for (unsigned y = 0; y < height; y++) {
+            std::fill(nextErrors.begin(), nextErrors.end(), std::array<int, 3> {});
+
+            // Serpentine; every other row goes right to left.
+            const bool reverse = (y & 1) != 0;
+            const int direction = reverse ? -1 : 1;
+
+            for (unsigned n = 0; n < width; n++) {
+                const unsigned x = reverse ? (width - 1 - n) : n;
+                const size_t i = static_cast<size_t>(y) * width + x;
+
+                Color color = PixelToColor(rgbaImage + i * 4);
+
+                // Invisible pixels don't take or pass on any error.
+                if ((ColorToKey(color) & 0xF000) == 0) {
+                    result.indices[i] = lookup(color);
+                    continue;
+                }
+
+                for (unsigned c = 0; c < 3; c++)
+                    color[c] = std::clamp(color[c] + currentErrors[x + 1][c] / 16, 0, 255);
+
+                const uint16_t index = lookup(color);
+                result.indices[i] = index;
+
+                for (unsigned c = 0; c < 3; c++) {
+                    const int error = color[c] - palette[index][c];
+
+                    currentErrors[x + 1 + direction][c] += error * 7;
+                    nextErrors[x + 1 - direction][c] += error * 3;
+                    nextErrors[x + 1][c] += error * 5;
+                    nextErrors[x + 1 + direction][c] += error * 1;
+                }
+            }
+
+            std::swap(currentErrors, nextErrors);
+        }
+    }
+
+    result.palette.resize(palette.size());
+    for (size_t i = 0; i < palette.size(); i++) {
+        const Color& color = palette[i];
+        result.palette[i] =
+            static_cast<uint32_t>(color[0]) | (static_cast<uint32_t>(color[1]) << 8) |
+            (static_cast<uint32_t>(color[2]) << 16) | (static_cast<uint32_t>(color[3]) << 24);
+    }
+
+    const double elapsedMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - startTime
+    ).count();
 
-    std::set<uint32_t> uniqueColors;
-    for (unsigned i = 0; i < pixelCount; ++i)
-        uniqueColors.insert(rgbaImage[i]);
+    Logging::info(
+        "[RvlPalette::quantize] Reduced {}x{} image with {} colors to {} colors in {:.2f}ms ({:.2f}ms per megapixel)",
+        width, height, distinctCount, result.palette.size(),
+        elapsedMs, elapsedMs / (static_cast<double>(pixelCount) / 1000000.0)
+    );
 
-    return uniqueColors;
+    return result;
 }
 
 void RvlPalette::readCLUT(
@@ -32,7 +454,7 @@ void RvlPalette::readCLUT(
             const uint32_t alpha = table[(i * 2) + 0];
             const uint32_t intensity = table[(i * 2) + 1];
 
-            colorsOut[i] = (intensity << 24) | (intensity << 16) | (intensity << 8) | alpha;
+            colorsOut[i] = intensity | (intensity << 8) | (intensity << 16) | (alpha << 24);
         }
     } break;
     case TPL::TPL_CLUT_FORMAT_RGB565: {
@@ -45,7 +467,7 @@ void RvlPalette::readCLUT(
             const uint32_t g = ((sourcePixel >>  5) & 0x3f) << 2;
             const uint32_t b = ((sourcePixel >>  0) & 0x1f) << 3;
 
-            colorsOut[i] = (r << 24) | (g << 16) | (b << 8) | 0xFFu;
+            colorsOut[i] = r | (g << 8) | (b << 16) | (0xFFu << 24);
         }
     } break;
     case TPL::TPL_CLUT_FORMAT_RGB5A3: {
@@ -73,7 +495,7 @@ void RvlPalette::readCLUT(
                 b = (((sourcePixel) & 0xf) << 4) | ((sourcePixel) & 0xf);
             }
 
-            colorsOut[i] = (r << 24) | (g << 16) | (b << 8) | a;
+            colorsOut[i] = r | (g << 8) | (b << 16) | (a << 24);
         }
     } break;
 
@@ -6,11 +6,36 @@
 #include <cstdint>
 
 #include <vector>
-#include <set>
 
 namespace RvlPalette {
 
-[[nodiscard]] std::set<uint32_t> generate(const unsigned char* rgbaImage, unsigned pixelCount);
+// Note: palette colors are RGBA32 in memory order (R in the lowest byte).
+
+enum class Dithering {
+    None,
+    Ordered, // 4x4 Bayer matrix.
+    ErrorDiffusion // Floyd-Steinberg.
+};
+
+struct IndexedImage {
+    std::vector<uint32_t> palette;
+    std::vector<uint16_t> indices; // One per pixel, row-major.
+};
+
+// Maximum amount of colors in the palette of a paletted format; 0 for other
+// formats.
+unsigned getMaxColorCount(TPL::TPLImageFormat format);
+
+// Reduce an image to a palette of at most maxColors colors. Colors are
+// compared at the precision of the RGB5A3 CLUT, so if the image doesn't have
+// more distinct colors than that the result is lossless. Otherwise the
+// palette is generated by median cut (refined with k-means for up to 256
+// colors) & the pixels are optionally dithered; dithering is skipped for
+// larger palettes.
+[[nodiscard]] IndexedImage quantize(
+    const unsigned char* rgbaImage, unsigned width, unsigned height,
+    unsigned maxColors, Dithering dithering
+);
 
 void readCLUT(
     std::vector<uint32_t>& colorsOut,
@@ -0,0 +1,287 @@
+#include "SheetFormatPreview.hpp"
+
+#include <cstdint>
+
+#include <vector>
+
+#include <optional>
+
+#include <algorithm>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "RvlImageConvert.hpp"
+#include "CtrImageConvert.hpp"
+
+#include "Logging.hpp"
+
+typedef SheetFormatPreview::Key Key;
+typedef SheetFormatPreview::Result Result;
+
+struct SheetFormatPreview::State {
+    std::mutex mtx;
+    std::condition_variable condition;
+
+    std::shared_ptr<TextureEx> sheet;
+
+    // Results of the latest revision of the sheet.
+    std::vector<std::pair<Key, std::shared_ptr<const Result>>> results;
+
+    // Requested, waiting for the worker.
+    std::optional<Key> pendingKey;
+    // Being worked on, unless the generation changed since it was started.
+    std::optional<Key> workingKey;
+    unsigned workingGeneration { 0 };
+
+    // Bumped to cancel the preview being worked on.
+    std::atomic<unsigned> generation { 0 };
+
+    bool stop { false };
+};
+
+static unsigned GetPaletteCapacity(TPL::TPLImageFormat format) {
+    switch (format) {
+    case TPL::TPL_IMAGE_FORMAT_C14X2:
+        return 16384;
+    case TPL::TPL_IMAGE_FORMAT_C8:
+        return 256;
+    case TPL::TPL_IMAGE_FORMAT_C4:
+        return 16;
+
+    default:
+        return 0;
+    }
+}
+
+static unsigned GetDataSize(const Key& key, unsigned width, unsigned height, unsigned paletteCount) {
+    if (key.isRVL) {
+        const auto format = static_cast<TPL::TPLImageFormat>(key.format);
+        const unsigned mipCount = TPL::getImageFormatMipmappable(format) ? key.mipCount : 1;
+
+        // paletteCount * sizeof CLUT entry
+        return RvlImageConvert::getImageByteSize(format, width, height, mipCount) + paletteCount * 2;
+    }
+    else {
+        return CtrImageConvert::getImageByteSize(
+            static_cast<CTPK::CTPKImageFormat>(key.format), width, height, key.mipCount
+        );
+    }
+}
+
+// Encode & decode the sheet. Returns nullptr if cancelled or if the sheet
+// changed since the preview was requested.
+static std::shared_ptr<Result> MakePreview(
+    const Key& key, const TextureEx& sheet,
+    const std::atomic<unsigned>& generation, unsigned startGeneration
+) {
+    auto isCancelled = [&]() {
+        return generation.load() != startGeneration;
+    };
+
+    unsigned width, height, revision;
+    std::vector<unsigned char> pixels = sheet.getPixels(width, height, revision);
+
+    if (revision != key.revision || isCancelled())
+        return nullptr;
+
+    auto result = std::make_shared<Result>();
+    result->ok = false;
+    result->dataSize = 0;
+    result->paletteCount = 0;
+
+    if (pixels.empty()) {
+        Logging::error("[SheetFormatPreview::MakePreview] The sheet has no image data");
+        return result;
+    }
+
+    if (key.isRVL) {
+        const auto format = static_cast<TPL::TPLImageFormat>(key.format);
+
+        std::vector<unsigned char> imageData(RvlImageConvert::getImageByteSize(format, width, height));
+        std::vector<uint32_t> palette(GetPaletteCapacity(format));
+
+        result->ok = RvlImageConvert::fromRGBA32(
+            imageData.data(), palette.data(), &result->paletteCount,
+            format, width, height, pixels.data()
+        );
+        if (!result->ok || isCancelled())
+            return result->ok ? nullptr : result;
+
+        result->ok = RvlImageConvert::toRGBA32(
+            pixels.data(), format, width, height, imageData.data(), palette.data()
+        );
+    }
+    else {
+        const auto format = static_cast<CTPK::CTPKImageFormat>(key.format);
+
+        std::vector<unsigned char> imageData(CtrImageConvert::getImageByteSize(format, width, height, 1));
+
+        result->ok = CtrImageConvert::fromRGBA32(
+            imageData.data(), format, width, height, pixels.data()
+        );
+        if (!result->ok || isCancelled())
+            return result->ok ? nullptr : result;
+
+        result->ok = CtrImageConvert::toRGBA32(
+            pixels.data(), format, width, height, imageData.data()
+        );
+    }
+
+    result->dataSize = GetDataSize(key, width, height, result->paletteCount);
+
+    if (result->ok)
+        result->texture = std::make_shared<TextureEx>(width, height, std::move(pixels));
+
+    return result;
+}
+
+void SheetFormatPreview::WorkerMain(std::shared_ptr<State> state) {
+    std::unique_lock<std::mutex> lock(state->mtx);
+
+    while (true) {
+        state->condition.wait(lock, [&state]() {
+            return state->stop || state->pendingKey.has_value();
+        });
+        if (state->stop)
+            return;
+
+        const Key key = *state->pendingKey;
+        state->pendingKey.reset();
+        state->workingKey = key;
+        state->workingGeneration = state->generation;
+
+        const std::shared_ptr<TextureEx> sheet = state->sheet;
+        const unsigned startGeneration = state->workingGeneration;
+
+        lock.unlock();
+
+        std::shared_ptr<const Result> result =
+            MakePreview(key, *sheet, state->generation, startGeneration);
+
+        lock.lock();
+
+        state->workingKey.reset();
+
+        if (!result || state->generation != startGeneration)
+            continue;
+
+        // Results of older revisions can't be asked for anymore.
+        state->results.erase(
+            std::remove_if(state->results.begin(), state->results.end(),
+            [&key](const auto& entry) {
+                return entry.first.revision != key.revision;
+            }),
+
+            state->results.end()
+        );
+
+        state->results.emplace_back(key, std::move(result));
+    }
+}
+
+SheetFormatPreview::SheetFormatPreview() :
+    mState(std::make_shared<State>()),
+    mWorker(WorkerMain, mState)
+{}
+
+SheetFormatPreview::~SheetFormatPreview() {
+    {
+        std::lock_guard<std::mutex> lock(mState->mtx);
+
+        mState->stop = true;
+        mState->generation++;
+    }
+    mState->condition.notify_one();
+
+    mWorker.join();
+}
+
+void SheetFormatPreview::setSheet(std::shared_ptr<TextureEx> sheet) {
+    std::lock_guard<std::mutex> lock(mState->mtx);
+
+    if (mState->sheet == sheet)
+        return;
+
+    mState->sheet = std::move(sheet);
+
+    mState->results.clear();
+    mState->pendingKey.reset();
+    mState->generation++;
+}
+
+std::shared_ptr<const SheetFormatPreview::Result> SheetFormatPreview::getTPL(TPL::TPLImageFormat format, unsigned mipCount) {
+    return get(true, static_cast<int>(format), mipCount);
+}
+
+std::shared_ptr<const SheetFormatPreview::Result> SheetFormatPreview::getCTPK(CTPK::CTPKImageFormat format, unsigned mipCount) {
+    return get(false, static_cast<int>(format), mipCount);
+}
+
+std::shared_ptr<const SheetFormatPreview::Result> SheetFormatPreview::get(bool isRVL, int format, unsigned mipCount) {
+    std::lock_guard<std::mutex> lock(mState->mtx);
+
+    if (!mState->sheet)
+        return nullptr;
+
+    const Key key { mState->sheet->getRevision(), isRVL, format, mipCount };
+
+    for (const auto& [resultKey, result] : mState->results) {
+        if (resultKey == key)
+            return result;
+    }
+
+    // Only the size depends on the mip count, so the preview of another mip
+    // count can be used.
+    for (const auto& [resultKey, result] : mState->results) {
+        if (
+            resultKey.revision != key.revision ||
+            resultKey.isRVL != key.isRVL || resultKey.format != key.format
+        )
+            continue;
+
+        auto newResult = std::make_shared<Result>(*result);
+        if (newResult->texture) {
+            newResult->dataSize = GetDataSize(
+                key,
+                newResult->texture->getWidth(), newResult->texture->getHeight(),
+                newResult->paletteCount
+            );
+        }
+
+        mState->results.emplace_back(key, newResult);
+        return newResult;
+    }
+
+    if (mState->workingKey == key && mState->generation == mState->workingGeneration) {
+        mState->pendingKey.reset();
+        return nullptr;
+    }
+    if (mState->pendingKey == key)
+        return nullptr;
+
+    if (mState->workingKey.has_value())
+        mState->generation++;
+
+    mState->pendingKey = key;
+    mState->condition.notify_one();
+
+    return nullptr;
+}
+
+bool SheetFormatPreview::isBusy() const {
+    std::lock_guard<std::mutex> lock(mState->mtx);
+    return mState->pendingKey.has_value() || mState->workingKey.has_value();
+}
+
+void SheetFormatPreview::clear() {
+    std::lock_guard<std::mutex> lock(mState->mtx);
+
+    mState->sheet.reset();
+
+    mState->results.clear();
+    mState->pendingKey.reset();
+    mState->generation++;
+}
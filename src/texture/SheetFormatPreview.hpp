@@ -0,0 +1,89 @@
+#ifndef SHEET_FORMAT_PREVIEW_HPP
+#define SHEET_FORMAT_PREVIEW_HPP
+
+#include <memory>
+
+#include <thread>
+
+#include "TextureEx.hpp"
+
+#include "TPL.hpp"
+#include "CTPK.hpp"
+
+/*
+    Preview of a spritesheet in another image format, used by the format
+    picker.
+
+    The sheet is encoded & decoded again on a worker thread. Asking for another
+    format while one is being worked on cancels it. Results are kept per sheet
+    revision, format & mip count, so switching back to a format is instant.
+*/
+
+class SheetFormatPreview {
+public:
+    struct Result {
+        // Whether encoding succeeded; if not, texture is nullptr.
+        bool ok;
+
+        // Size of the image data, including the palette.
+        unsigned dataSize;
+        // Amount of colors in the palette (paletted formats only).
+        unsigned paletteCount;
+
+        // The sheet after being encoded & decoded.
+        std::shared_ptr<TextureEx> texture;
+    };
+
+public:
+    SheetFormatPreview();
+    ~SheetFormatPreview();
+
+    SheetFormatPreview(const SheetFormatPreview&) = delete;
+    SheetFormatPreview& operator=(const SheetFormatPreview&) = delete;
+
+    // Preview this sheet from now on. The results of another sheet are dropped.
+    void setSheet(std::shared_ptr<TextureEx> sheet);
+
+    // Get the preview of the sheet in a format. If it isn't ready it's started
+    // on the worker (cancelling the one being worked on, if any) & nullptr is
+    // returned; call again to check on it.
+    std::shared_ptr<const Result> getTPL(TPL::TPLImageFormat format, unsigned mipCount);
+    std::shared_ptr<const Result> getCTPK(CTPK::CTPKImageFormat format, unsigned mipCount);
+
+    // Whether a preview is being worked on or waiting for the worker.
+    bool isBusy() const;
+
+    // Drop the sheet & all results, and cancel the preview being worked on.
+    void clear();
+
+public:
+    struct Key {
+        unsigned revision;
+
+        bool isRVL;
+        int format;
+        unsigned mipCount;
+
+        bool operator==(const Key& other) const {
+            return revision == other.revision &&
+                isRVL == other.isRVL &&
+                format == other.format &&
+                mipCount == other.mipCount;
+        }
+    };
+
+private:
+    std::shared_ptr<const Result> get(bool isRVL, int format, unsigned mipCount);
+
+    // Shared with the worker thread.
+    struct State;
+    std::shared_ptr<State> mState;
+
+    // Joined on destruction (after cancelling its preview), so nothing is
+    // left running when the app exits.
+    std::thread mWorker;
+
+    static void WorkerMain(std::shared_ptr<State> state);
+};
+
+#endif // SHEET_FORMAT_PREVIEW_HPP
@@ -1,13 +1,16 @@
 #include "TPL.hpp"
 
+#include <cstring>
+
 #include <algorithm>
 
 #include "Logging.hpp"
 
-#include "manager/MainThreadTaskManager.hpp"
-
 #include "RvlImageConvert.hpp"
 #include "RvlPalette.hpp"
+#include "MipChain.hpp"
+
+#include "util/ParallelUtil.hpp"
 
 #include "Macro.hpp"
 
@@ -77,66 +80,11 @@ constexpr TPL::TPLClutFormat DEFAULT_CLUT_FORMAT = TPL::TPL_CLUT_FORMAT_RGB5A3;
 
 namespace TPL {
 
-GLuint TPLTexture::createGPUTexture() const {
-    GLuint textureId { 0 };
-
-    GLint minFilter, magFilter;
-
-    switch (this->minFilter) {
-    case TPL::TPL_TEX_FILTER_NEAR:
-        minFilter = GL_NEAREST;
-        break;
-    case TPL::TPL_TEX_FILTER_NEAR_MIP_NEAR:
-        minFilter = GL_NEAREST_MIPMAP_NEAREST;
-        break;
-    case TPL::TPL_TEX_FILTER_LIN_MIP_NEAR:
-        minFilter = GL_LINEAR_MIPMAP_NEAREST;
-        break;
-    case TPL::TPL_TEX_FILTER_NEAR_MIP_LIN:
-        minFilter = GL_NEAREST_MIPMAP_LINEAR;
-        break;
-    case TPL::TPL_TEX_FILTER_LIN_MIP_LIN:
-        minFilter = GL_LINEAR_MIPMAP_LINEAR;
-        break;
-    case TPL::TPL_TEX_FILTER_LINEAR:
-    default:
-        minFilter = GL_LINEAR;
-        break;
-    }
-
-    switch (this->magFilter) {
-    case TPL::TPL_TEX_FILTER_NEAR:
-        magFilter = GL_NEAREST;
-        break;
-    case TPL::TPL_TEX_FILTER_LINEAR:
-    default:
-        magFilter = GL_LINEAR;
-        break;
-    }
-
-    MainThreadTaskManager::getInstance().queueTask([this, &textureId, &minFilter, &magFilter]() {
-        glGenTextures(1, &textureId);
-        glBindTexture(GL_TEXTURE_2D, textureId);
-
-        glTexParameteri(
-            GL_TEXTURE_2D, GL_TEXTURE_WRAP_S,
-            this->wrapS == TPL::TPL_WRAP_MODE_REPEAT ? GL_REPEAT : GL_CLAMP_TO_EDGE
-        );
-        glTexParameteri(
-            GL_TEXTURE_2D, GL_TEXTURE_WRAP_T,
-            this->wrapT == TPL::TPL_WRAP_MODE_REPEAT ? GL_REPEAT : GL_CLAMP_TO_EDGE
-        );
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
-
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, this->width, this->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, this->data.data());
-
-        glGenerateMipmap(GL_TEXTURE_2D);
-
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }).get();
+unsigned getWrittenMipCount(TPLImageFormat format, unsigned width, unsigned height, unsigned mipCount) {
+    if (!getImageFormatMipmappable(format))
+        return 1;
 
-    return textureId;
+    return std::clamp(mipCount, 1u, MipChain::getMaxLevelCount(width, height));
 }
 
 TPLObject::TPLObject(const unsigned char* tplData, const size_t dataSize) {
@@ -158,6 +106,10 @@ TPLObject::TPLObject(const unsigned char* tplData, const size_t dataSize) {
 
     mTextures.resize(descriptorCount);
 
+    // The image data of every texture; the textures are decoded in parallel
+    // once all headers are read.
+    std::vector<const unsigned char*> imageDatas(descriptorCount, nullptr);
+
     for (uint32_t i = 0; i < descriptorCount; i++) {
         const TPLDescriptor* descriptor = descriptors + i;
 
@@ -200,12 +152,21 @@ TPLObject::TPLObject(const unsigned char* tplData, const size_t dataSize) {
         textureData.minFilter = static_cast<TPLTexFilter>(BYTESWAP_32(header->minFilter));
         textureData.magFilter = static_cast<TPLTexFilter>(BYTESWAP_32(header->magFilter));
 
-        const unsigned char* imageData = tplData + BYTESWAP_32(header->dataOffset);
-
-        textureData.data.resize(textureData.width * textureData.height * 4);
-        RvlImageConvert::toRGBA32(textureData, imageData);
+        imageDatas[i] = tplData + BYTESWAP_32(header->dataOffset);
     }
 
+    ParallelUtil::parallelFor(descriptorCount, 1, [this, &imageDatas](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (!imageDatas[i])
+                continue;
+
+            TPLTexture& textureData = mTextures[i];
+
+            textureData.data.resize(textureData.width * textureData.height * 4);
+            RvlImageConvert::toRGBA32(textureData, imageDatas[i]);
+        }
+    });
+
     mInitialized = true;
 }
 
@@ -219,12 +180,32 @@ std::vector<unsigned char> TPLObject::serialize() {
 
     const size_t textureCount = mTextures.size();
 
+    // The amount of mip levels written for every texture.
+    std::vector<unsigned> mipCounts(textureCount);
+
+    for (size_t i = 0; i < textureCount; i++) {
+        const auto& texture = mTextures[i];
+
+        mipCounts[i] = getWrittenMipCount(
+            texture.format, texture.width, texture.height, texture.mipCount
+        );
+
+        if (texture.mipCount > 1 && !getImageFormatMipmappable(texture.format)) {
+            Logging::warn(
+                "[TPLObject::serialize] Texture no. {} is paletted ({}), so its mip levels won't be written",
+                i + 1, getImageFormatName(texture.format)
+            );
+        }
+    }
+
     // Precompute required size & texture indexes for color palettes.
     size_t paletteEntriesSize { 0 };
 
+    // Paletted textures are encoded up front, since the size of their palette
+    // is only known after quantizing them.
     struct PaletteTexEntry {
         size_t texIndex;
-        std::set<uint32_t> palette;
+        std::vector<unsigned char> imageData;
     };
     std::vector<PaletteTexEntry> paletteTextures;
     paletteTextures.reserve(textureCount);
@@ -232,23 +213,23 @@ std::vector<unsigned char> TPLObject::serialize() {
     for (size_t i = 0; i < textureCount; i++) {
         const auto& texture = mTextures[i];
 
-        if (
-            texture.format == TPL_IMAGE_FORMAT_C4 ||
-            texture.format == TPL_IMAGE_FORMAT_C8 ||
-            texture.format == TPL_IMAGE_FORMAT_C14X2
-        ) {
-            paletteTextures.push_back(PaletteTexEntry {
-                .texIndex = i,
-                .palette = RvlPalette::generate(
-                    texture.data.data(), texture.width * texture.height
-                )
-            });
-
-            // Conveniently, every palette format's pixel is 16-bit
-            paletteEntriesSize += ALIGN_UP_16(paletteTextures.back().palette.size()) * 2;
-        }
+        if (getImageFormatPaletted(texture.format))
+            paletteTextures.push_back(PaletteTexEntry { .texIndex = i });
     }
 
+    ParallelUtil::parallelFor(paletteTextures.size(), 1, [this, &paletteTextures](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            TPL::TPLTexture& texture = mTextures[paletteTextures[i].texIndex];
+
+            paletteTextures[i].imageData.resize(RvlImageConvert::getImageByteSize(texture));
+            RvlImageConvert::fromRGBA32(texture, paletteTextures[i].imageData.data());
+        }
+    });
+
+    // Conveniently, every palette format's pixel is 16-bit
+    for (const auto& entry : paletteTextures)
+        paletteEntriesSize += ALIGN_UP_16(mTextures[entry.texIndex].palette.size()) * 2;
+
     const size_t headerSectionStart = (
         (
             sizeof(TPLPalette) +
@@ -263,7 +244,9 @@ std::vector<unsigned char> TPLObject::serialize() {
 
     // Precompute size of data section.
     for (size_t i = 0; i < textureCount; i++) {
-        const size_t imageSize = RvlImageConvert::getImageByteSize(mTextures[i]);
+        const size_t imageSize = RvlImageConvert::getImageByteSize(
+            mTextures[i].format, mTextures[i].width, mTextures[i].height, mipCounts[i]
+        );
 
         fullSize = ALIGN_UP_32(fullSize) + imageSize;
     }
@@ -329,7 +312,7 @@ std::vector<unsigned char> TPLObject::serialize() {
         clutHeader->dataFormat = BYTESWAP_32(DEFAULT_CLUT_FORMAT);
         clutHeader->dataOffset = BYTESWAP_32(nextClutOffset);
 
-        const size_t colorCount = ALIGN_UP_16(paletteTextures[clutIndex].palette.size());
+        const size_t colorCount = ALIGN_UP_16(mTextures[paletteTextures[clutIndex].texIndex].palette.size());
         clutHeader->numEntries = BYTESWAP_16(colorCount);
 
         // Convieniently, every palette format's pixel is 16-bit
@@ -382,48 +365,77 @@ std::vector<unsigned char> TPLObject::serialize() {
         header->edgeLODEnable = 0;
 
         header->minMipmap = 0;
-        header->maxMipmap = 0;
+        header->maxMipmap = static_cast<uint8_t>(mipCounts[i] - 1);
     }
 
     // Image Data
 
+    std::vector<size_t> dataOffsets(textureCount);
+
     size_t writeOffset = dataSectionStart;
     for (size_t i = 0; i < textureCount; i++) {
-        TPL::TPLTexture& texture = mTextures[i];
-
         writeOffset = ALIGN_UP_32(writeOffset);
+
+        dataOffsets[i] = writeOffset;
         headers[i].dataOffset = BYTESWAP_32(writeOffset);
 
-        Logging::info(
-            "[TPLObject::serialize] Writing data for texture no. {} ({}x{}, {})..",
-            (i+1),
-            texture.width,
-            texture.height,
-            getImageFormatName(texture.format)
+        writeOffset += RvlImageConvert::getImageByteSize(
+            mTextures[i].format, mTextures[i].width, mTextures[i].height, mipCounts[i]
         );
+    }
 
-        const size_t imageSize = RvlImageConvert::getImageByteSize(texture);
+    // Every texture writes to its own part of the result, so they're all
+    // converted in parallel.
+    ParallelUtil::parallelFor(textureCount, 1, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            TPL::TPLTexture& texture = mTextures[i];
+
+            Logging::info(
+                "[TPLObject::serialize] Writing data for texture no. {} ({}x{}, {}, {} mip-level(s))..",
+                (i+1),
+                texture.width,
+                texture.height,
+                getImageFormatName(texture.format),
+                mipCounts[i]
+            );
 
-        unsigned char* imageData = result.data() + writeOffset;
-        RvlImageConvert::fromRGBA32(texture, imageData);
+            unsigned char* imageData = result.data() + dataOffsets[i];
 
-        auto it = std::find_if(
-            paletteTextures.begin(), paletteTextures.end(),
-            [i](const PaletteTexEntry& entry) {
-                return entry.texIndex == i;
+            auto it = std::find_if(
+                paletteTextures.begin(), paletteTextures.end(),
+                [i](const PaletteTexEntry& entry) {
+                    return entry.texIndex == i;
+                }
+            );
+            if (it == paletteTextures.end()) {
+                // Every level is filtered from the one above it.
+                const std::vector<std::vector<unsigned char>> mipLevels = MipChain::build(
+                    texture.data.data(), texture.width, texture.height, mipCounts[i]
+                );
+
+                for (unsigned j = 0; j < mipCounts[i]; j++) {
+                    const unsigned levelWidth = MipChain::getLevelSize(texture.width, j);
+                    const unsigned levelHeight = MipChain::getLevelSize(texture.height, j);
+
+                    RvlImageConvert::fromRGBA32(
+                        imageData, nullptr, nullptr, texture.format, levelWidth, levelHeight,
+                        j == 0 ? texture.data.data() : mipLevels[j - 1].data()
+                    );
+                    imageData += RvlImageConvert::getImageByteSize(texture.format, levelWidth, levelHeight);
+                }
             }
-        );
-        if (it != paletteTextures.end()) {
-            TPLClutHeader* clutHeader = clutHeaders + std::distance(paletteTextures.begin(), it);
+            else {
+                memcpy(imageData, it->imageData.data(), it->imageData.size());
 
-            RvlPalette::writeCLUT(
-                result.data() + BYTESWAP_32(clutHeader->dataOffset),
-                texture.palette, DEFAULT_CLUT_FORMAT
-            );
-        }
+                TPLClutHeader* clutHeader = clutHeaders + std::distance(paletteTextures.begin(), it);
 
-        writeOffset += imageSize;
-    }
+                RvlPalette::writeCLUT(
+                    result.data() + BYTESWAP_32(clutHeader->dataOffset),
+                    texture.palette, DEFAULT_CLUT_FORMAT
+                );
+            }
+        }
+    });
 
     return result;
 }
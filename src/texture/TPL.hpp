@@ -9,8 +9,6 @@
 
 #include <algorithm>
 
-#include "glInclude.hpp"
-
 namespace TPL {
 
 enum TPLWrapMode {
@@ -120,6 +118,16 @@ constexpr bool getImageFormatPaletted(TPLImageFormat format) {
         format == TPL_IMAGE_FORMAT_C14X2;
 }
 
+// Paletted textures are written without mip levels, since every level would
+// have to share the palette of the base level.
+constexpr bool getImageFormatMipmappable(TPLImageFormat format) {
+    return !getImageFormatPaletted(format);
+}
+
+// The amount of mip levels that is written for a texture: its mip count,
+// clamped to what the size allows, or one if the format isn't mipmappable.
+unsigned getWrittenMipCount(TPLImageFormat format, unsigned width, unsigned height, unsigned mipCount);
+
 struct TPLTexture {
 public:
     unsigned width;
@@ -138,8 +146,6 @@ public:
     std::vector<unsigned char> data; // In RGBA32 format.
     std::vector<uint32_t> palette; // In RGBA32 format.
 
-public:
-    [[nodiscard]] GLuint createGPUTexture() const;
 };
 
 class TPLObject {
@@ -143,7 +143,7 @@ bool Texture::getRGBA32(unsigned char* buffer) {
 unsigned char* Texture::getRGBA32() {
     unsigned char *imageData = new unsigned char[mWidth * mHeight * 4];
 
-    if (Texture::getRGBA32(imageData)) {
+    if (getRGBA32(imageData)) {
         return imageData;
     }
     else {
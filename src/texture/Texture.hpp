@@ -54,7 +54,7 @@ public:
 
     // Generate a texture & upload the RGBA32 data to it.
     // Note: if a GPU texture already exists, this will overwrite its data.
-    void loadRGBA32(const unsigned char *data, unsigned width, unsigned height);
+    virtual void loadRGBA32(const unsigned char *data, unsigned width, unsigned height);
 
     // Generate a texture & use stb_image to load the image data from memory.
     //     - Note: if a GPU texture already exists, this will overwrite its data.
@@ -72,7 +72,7 @@ public:
     //     - Note: the size of the buffer must be getPixelCount() * 4
     // 
     // Returns: true if succeeded, false if failed
-    bool getRGBA32(unsigned char *buffer);
+    virtual bool getRGBA32(unsigned char *buffer);
 
     // Download the texture from the GPU as RGBA32 image data.
     //     - Note A: the resulting pointer is dynamically allocated and must be freed by the caller.
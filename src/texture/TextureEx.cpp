@@ -1,12 +1,259 @@
 #include "TextureEx.hpp"
 
+#include <cstring>
+
+#include <algorithm>
+
 #include "manager/MainThreadTaskManager.hpp"
 
 #include "Logging.hpp"
 
+TextureEx::TextureEx(unsigned width, unsigned height, std::vector<unsigned char> pixels) {
+    loadRGBA32(std::move(pixels), width, height);
+}
+
+void TextureEx::setSampling(GLint wrapS, GLint wrapT, GLint minFilter, GLint magFilter) {
+    std::lock_guard<std::mutex> lock(mPixelsMtx);
+
+    mWrapS = wrapS;
+    mWrapT = wrapT;
+    mMinFilter = minFilter;
+    mMagFilter = magFilter;
+
+    mSamplingDirty = true;
+    mUploadPending = true;
+}
+
+static GLint getGLWrapMode(TPL::TPLWrapMode wrapMode) {
+    return wrapMode == TPL::TPL_WRAP_MODE_REPEAT ? GL_REPEAT : GL_CLAMP_TO_EDGE;
+}
+
+static GLint getGLFilter(TPL::TPLTexFilter filter) {
+    switch (filter) {
+    case TPL::TPL_TEX_FILTER_NEAR:
+        return GL_NEAREST;
+    case TPL::TPL_TEX_FILTER_NEAR_MIP_NEAR:
+        return GL_NEAREST_MIPMAP_NEAREST;
+    case TPL::TPL_TEX_FILTER_LIN_MIP_NEAR:
+        return GL_LINEAR_MIPMAP_NEAREST;
+    case TPL::TPL_TEX_FILTER_NEAR_MIP_LIN:
+        return GL_NEAREST_MIPMAP_LINEAR;
+    case TPL::TPL_TEX_FILTER_LIN_MIP_LIN:
+        return GL_LINEAR_MIPMAP_LINEAR;
+    case TPL::TPL_TEX_FILTER_LINEAR:
+    default:
+        return GL_LINEAR;
+    }
+}
+
+// The mip levels are only sampled with a mipmapped filter, so one is used if
+// the texture has mip levels; without them, a mipmapped filter is dropped for
+// the plain one.
+static TPL::TPLTexFilter getTPLMinFilter(GLint filter, bool hasMipLevels) {
+    switch (filter) {
+    case GL_NEAREST:
+        return hasMipLevels ? TPL::TPL_TEX_FILTER_NEAR_MIP_NEAR : TPL::TPL_TEX_FILTER_NEAR;
+    case GL_NEAREST_MIPMAP_NEAREST:
+        return hasMipLevels ? TPL::TPL_TEX_FILTER_NEAR_MIP_NEAR : TPL::TPL_TEX_FILTER_NEAR;
+    case GL_LINEAR_MIPMAP_NEAREST:
+        return hasMipLevels ? TPL::TPL_TEX_FILTER_LIN_MIP_NEAR : TPL::TPL_TEX_FILTER_LINEAR;
+    case GL_NEAREST_MIPMAP_LINEAR:
+        return hasMipLevels ? TPL::TPL_TEX_FILTER_NEAR_MIP_LIN : TPL::TPL_TEX_FILTER_NEAR;
+    case GL_LINEAR_MIPMAP_LINEAR:
+        return hasMipLevels ? TPL::TPL_TEX_FILTER_LIN_MIP_LIN : TPL::TPL_TEX_FILTER_LINEAR;
+    case GL_LINEAR:
+    default:
+        return hasMipLevels ? TPL::TPL_TEX_FILTER_LIN_MIP_LIN : TPL::TPL_TEX_FILTER_LINEAR;
+    }
+}
+
+void TextureEx::setSampling(const TPL::TPLTexture& texture) {
+    // Mipmapped filters don't apply to magnification.
+    const GLint magFilter = texture.magFilter == TPL::TPL_TEX_FILTER_NEAR ?
+        GL_NEAREST : GL_LINEAR;
+
+    setSampling(
+        getGLWrapMode(texture.wrapS), getGLWrapMode(texture.wrapT),
+        getGLFilter(texture.minFilter), magFilter
+    );
+}
+
+void TextureEx::loadRGBA32(const unsigned char* data, unsigned width, unsigned height) {
+    if (data == nullptr) {
+        Logging::error("[TextureEx::loadRGBA32] Failed to load image data: data is NULL");
+        return;
+    }
+
+    loadRGBA32(std::vector<unsigned char>(data, data + (size_t(width) * height * 4)), width, height);
+}
+
+void TextureEx::loadRGBA32(std::vector<unsigned char>&& pixels, unsigned width, unsigned height) {
+    if (pixels.size() != size_t(width) * height * 4) {
+        Logging::error(
+            "[TextureEx::loadRGBA32] Failed to load image data: expected {} bytes, got {}",
+            size_t(width) * height * 4, pixels.size()
+        );
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mPixelsMtx);
+
+    mPixels = std::move(pixels);
+
+    mWidth = width;
+    mHeight = height;
+
+    mDirtyRect = DirtyRect { 0, 0, width, height };
+    mUploadPending = true;
+
+    mRevision++;
+}
+
+bool TextureEx::getRGBA32(unsigned char* buffer) {
+    if (buffer == nullptr) {
+        Logging::error("[TextureEx::getRGBA32] Failed to copy image data: buffer is NULL");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mPixelsMtx);
+
+    if (mPixels.empty()) {
+        Logging::error("[TextureEx::getRGBA32] Failed to copy image data: no image is loaded");
+        return false;
+    }
+
+    std::memcpy(buffer, mPixels.data(), mPixels.size());
+
+    return true;
+}
+
+std::vector<unsigned char> TextureEx::getPixels() const {
+    std::lock_guard<std::mutex> lock(mPixelsMtx);
+    return mPixels;
+}
+
+std::vector<unsigned char> TextureEx::getPixels(unsigned& width, unsigned& height, unsigned& revision) const {
+    std::lock_guard<std::mutex> lock(mPixelsMtx);
+
+    width = mWidth;
+    height = mHeight;
+    revision = mRevision;
+
+    return mPixels;
+}
+
+unsigned TextureEx::getRevision() const {
+    std::lock_guard<std::mutex> lock(mPixelsMtx);
+    return mRevision;
+}
+
+bool TextureEx::updateRegion(unsigned x, unsigned y, unsigned width, unsigned height, const unsigned char* data) {
+    if (data == nullptr) {
+        Logging::error("[TextureEx::updateRegion] Failed to update image data: data is NULL");
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mPixelsMtx);
+
+    if (x > mWidth || y > mHeight || width > (mWidth - x) || height > (mHeight - y)) {
+        Logging::error(
+            "[TextureEx::updateRegion] Failed to update image data: rectangle ({}, {}, {}x{}) is out of bounds",
+            x, y, width, height
+        );
+        return false;
+    }
+
+    for (unsigned row = 0; row < height; row++) {
+        std::memcpy(
+            mPixels.data() + ((size_t(y + row) * mWidth) + x) * 4,
+            data + (size_t(row) * width * 4),
+            width * 4
+        );
+    }
+
+    if (mDirtyRect.empty())
+        mDirtyRect = DirtyRect { x, y, x + width, y + height };
+    else {
+        mDirtyRect.x0 = std::min(mDirtyRect.x0, x);
+        mDirtyRect.y0 = std::min(mDirtyRect.y0, y);
+        mDirtyRect.x1 = std::max(mDirtyRect.x1, x + width);
+        mDirtyRect.y1 = std::max(mDirtyRect.y1, y + height);
+    }
+    mUploadPending = true;
+
+    mRevision++;
+
+    return true;
+}
+
+void TextureEx::syncGPUTexture() {
+    if (!mUploadPending)
+        return;
+
+    MainThreadTaskManager::getInstance().queueTask([this]() {
+        std::lock_guard<std::mutex> lock(mPixelsMtx);
+
+        mUploadPending = false;
+
+        if (mPixels.empty())
+            return;
+
+        const bool recreate =
+            mTextureId == INVALID_TEXTURE_ID ||
+            mGPUWidth != mWidth || mGPUHeight != mHeight;
+
+        if (mTextureId == INVALID_TEXTURE_ID)
+            glGenTextures(1, &mTextureId);
+
+        glBindTexture(GL_TEXTURE_2D, mTextureId);
+
+        if (recreate || mSamplingDirty) {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, mWrapS);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, mWrapT);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, mMinFilter);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, mMagFilter);
+
+            mSamplingDirty = false;
+        }
+
+        if (recreate) {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, mWidth, mHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, mPixels.data());
+
+            mGPUWidth = mWidth;
+            mGPUHeight = mHeight;
+        }
+        else if (!mDirtyRect.empty()) {
+            // Upload only the dirty rectangle, reading it straight out of the
+            // full-width image.
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, mWidth);
+
+            glTexSubImage2D(
+                GL_TEXTURE_2D, 0,
+                mDirtyRect.x0, mDirtyRect.y0,
+                mDirtyRect.x1 - mDirtyRect.x0, mDirtyRect.y1 - mDirtyRect.y0,
+                GL_RGBA, GL_UNSIGNED_BYTE,
+                mPixels.data() + ((size_t(mDirtyRect.y0) * mWidth) + mDirtyRect.x0) * 4
+            );
+
+            glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+        }
+
+        if (recreate || !mDirtyRect.empty())
+            glGenerateMipmap(GL_TEXTURE_2D);
+
+        glBindTexture(GL_TEXTURE_2D, 0);
+
+        mDirtyRect = DirtyRect { 0, 0, 0, 0 };
+    }).get();
+}
+
 std::optional<TPL::TPLTexture> TextureEx::TPLTexture() {
-    if (mTextureId == INVALID_TEXTURE_ID) {
-        Logging::error("[TextureEx::TPLTexture] Failed to construct TPLTexture: textureId is invalid");
+    // Called off the main thread when exporting; the image & the settings are
+    // read at the same time.
+    std::lock_guard<std::mutex> lock(mPixelsMtx);
+
+    if (mPixels.empty()) {
+        Logging::error("[TextureEx::TPLTexture] Failed to construct TPLTexture: no image is loaded");
         return std::nullopt; // return nothing (std::optional)
     }
 
@@ -14,16 +261,18 @@ std::optional<TPL::TPLTexture> TextureEx::TPLTexture() {
         .width = mWidth,
         .height = mHeight,
 
-        .mipCount = 1, // TODO use true mip count
+        .mipCount = mOutputMipCount,
 
         .format = mTPLOutputFormat,
 
-        .data = std::vector<unsigned char>(mWidth * mHeight * 4)
+        .data = mPixels
     };
 
-    tplTexture.minFilter = mMinFilter == GL_NEAREST ?
-        TPL::TPL_TEX_FILTER_NEAR :
-        TPL::TPL_TEX_FILTER_LINEAR;
+    // Decided by the levels that are written; paletted formats get none.
+    const unsigned writtenMipCount = TPL::getWrittenMipCount(
+        mTPLOutputFormat, mWidth, mHeight, mOutputMipCount
+    );
+    tplTexture.minFilter = getTPLMinFilter(mMinFilter, writtenMipCount > 1);
     tplTexture.magFilter = mMagFilter == GL_NEAREST ?
         TPL::TPL_TEX_FILTER_NEAR :
         TPL::TPL_TEX_FILTER_LINEAR;
@@ -35,18 +284,14 @@ std::optional<TPL::TPLTexture> TextureEx::TPLTexture() {
         TPL::TPL_WRAP_MODE_REPEAT :
         TPL::TPL_WRAP_MODE_CLAMP;
 
-    MainThreadTaskManager::getInstance().queueTask([this, &tplTexture]() {
-        glBindTexture(GL_TEXTURE_2D, mTextureId);
-        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, tplTexture.data.data());
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }).get();
-
     return tplTexture;
 }
 
 std::optional<CTPK::CTPKTexture> TextureEx::CTPKTexture() {
-    if (mTextureId == INVALID_TEXTURE_ID) {
-        Logging::error("[TextureEx::CTPKTexture] Failed to construct CTPKTexture: textureId is invalid");
+    std::lock_guard<std::mutex> lock(mPixelsMtx);
+
+    if (mPixels.empty()) {
+        Logging::error("[TextureEx::CTPKTexture] Failed to construct CTPKTexture: no image is loaded");
         return std::nullopt; // return nothing (std::optional)
     }
 
@@ -61,20 +306,9 @@ std::optional<CTPK::CTPKTexture> TextureEx::CTPKTexture() {
         .sourceTimestamp = mOutputSrcTimestamp,
         .sourcePath = mOutputSrcPath,
 
-        // .cachedTargetData = mCachedETC1,
-        .data = std::vector<unsigned char>(mWidth * mHeight * 4)
+        // Packed ETC1 blocks are cached by ETC1BlockCache.
+        .data = mPixels
     };
 
-    if (CTPK::getImageFormatCompressed(mCTPKOutputFormat))
-        ctpkTexture.cachedTargetData = mCachedETC1;
-    else
-        ctpkTexture.cachedTargetData = std::vector<unsigned char>();
-
-    MainThreadTaskManager::getInstance().queueTask([this, &ctpkTexture]() {
-        glBindTexture(GL_TEXTURE_2D, mTextureId);
-        glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, ctpkTexture.data.data());
-        glBindTexture(GL_TEXTURE_2D, 0);
-    }).get();
-
     return ctpkTexture;
 }
@@ -8,8 +8,19 @@
 
 #include <optional>
 
+#include <vector>
+
+#include <mutex>
+
+#include <atomic>
+
 /*
     Extended Texture class, used for spritesheets.
+
+    The image is kept on the CPU as RGBA32 and is the source of truth; the GPU
+    texture is a cache of it that is (re)uploaded when it is next used for
+    drawing. Reading or modifying the image never touches the GL context, so
+    it can be done from any thread.
 */
 
 class TextureEx : public Texture {
@@ -23,36 +34,129 @@ private:
     uint32_t mOutputSrcTimestamp;
     std::string mOutputSrcPath;
 
-    // Cached ETC1(A4) data.
-    //     - Packing ETC1(A4) textures is extremely slow and undeterministic, so to reduce
-    //       save time & have deterministic saves we cache the (original) ETC1(A4) data.
-    //     - Only used if this texture targets ETC1(A4), otherwise empty.
-    std::vector<unsigned char> mCachedETC1;
-
     std::string mName;
 
+    // Linear RGBA32 image data, mWidth * mHeight * 4 bytes.
+    std::vector<unsigned char> mPixels;
+    mutable std::mutex mPixelsMtx;
+
+    // Bumped every time the image changes.
+    unsigned mRevision { 0 };
+
+    // Area of the image that changed since the last upload.
+    struct DirtyRect {
+        unsigned x0, y0;
+        unsigned x1, y1; // Exclusive.
+
+        bool empty() const { return x0 >= x1 || y0 >= y1; }
+    };
+    DirtyRect mDirtyRect { 0, 0, 0, 0 };
+
+    // The size of the GPU texture; if it differs from the image size, the next
+    // upload recreates the texture storage.
+    unsigned mGPUWidth { 0 };
+    unsigned mGPUHeight { 0 };
+
+    // Sampler state changed since the last upload.
+    bool mSamplingDirty { false };
+
+    // Set when the image or sampler state changed; checked before taking the
+    // lock so drawing an unchanged texture stays cheap.
+    std::atomic<bool> mUploadPending { false };
+
 public:
-    using Texture::Texture;
+    TextureEx() = default;
+    // Create a texture from RGBA32 pixels (width * height * 4 bytes). The GPU
+    // texture is created once the texture is first used for drawing.
+    TextureEx(unsigned width, unsigned height, std::vector<unsigned char> pixels);
+
+    // The output settings are read by TPLTexture & CTPKTexture, which can run
+    // on another thread (exporting); they are set under the image lock.
 
     unsigned getOutputMipCount() const { return mOutputMipCount; }
-    void setOutputMipCount(unsigned mipCount) { mOutputMipCount = mipCount; }
+    void setOutputMipCount(unsigned mipCount) {
+        std::lock_guard<std::mutex> lock(mPixelsMtx);
+        mOutputMipCount = mipCount;
+    }
 
     TPL::TPLImageFormat getTPLOutputFormat() const { return mTPLOutputFormat; }
-    void setTPLOutputFormat(TPL::TPLImageFormat format) { mTPLOutputFormat = format; }
+    void setTPLOutputFormat(TPL::TPLImageFormat format) {
+        std::lock_guard<std::mutex> lock(mPixelsMtx);
+        mTPLOutputFormat = format;
+    }
 
     CTPK::CTPKImageFormat getCTPKOutputFormat() const { return mCTPKOutputFormat; }
-    void setCTPKOutputFormat(CTPK::CTPKImageFormat format) { mCTPKOutputFormat = format; }
+    void setCTPKOutputFormat(CTPK::CTPKImageFormat format) {
+        std::lock_guard<std::mutex> lock(mPixelsMtx);
+        mCTPKOutputFormat = format;
+    }
 
     uint32_t getOutputSrcTimestamp() const { return mOutputSrcTimestamp; }
-    void setOutputSrcTimestamp(uint32_t timestamp) { mOutputSrcTimestamp = timestamp; }
+    void setOutputSrcTimestamp(uint32_t timestamp) {
+        std::lock_guard<std::mutex> lock(mPixelsMtx);
+        mOutputSrcTimestamp = timestamp;
+    }
 
     const std::string& getOutputSrcPath() const { return mOutputSrcPath; }
-    void setOutputSrcPath(std::string path) { mOutputSrcPath = path; }
+    void setOutputSrcPath(std::string path) {
+        std::lock_guard<std::mutex> lock(mPixelsMtx);
+        mOutputSrcPath = std::move(path);
+    }
 
     const std::string& getName() const { return mName; }
     void setName(const std::string& name) { mName = name; }
     void setName(std::string&& name) { mName = std::move(name); }
 
+    // Set the wrap modes and filters; they are applied to the GPU texture on
+    // the next upload.
+    void setSampling(GLint wrapS, GLint wrapT, GLint minFilter, GLint magFilter);
+    // Use the wrap modes & filters of a TPL texture.
+    void setSampling(const TPL::TPLTexture& texture);
+
+    // Replace the image with RGBA32 data. No GL calls are made.
+    void loadRGBA32(const unsigned char* data, unsigned width, unsigned height) override;
+    void loadRGBA32(std::vector<unsigned char>&& pixels, unsigned width, unsigned height);
+
+    // Copy the image into a RGBA32 image buffer.
+    //     - Note: the size of the buffer must be getPixelCount() * 4
+    //
+    // Returns: true if succeeded, false if failed
+    bool getRGBA32(unsigned char* buffer) override;
+    using Texture::getRGBA32;
+
+    // Get a copy of the image as RGBA32 data.
+    [[nodiscard]] std::vector<unsigned char> getPixels() const;
+    // Get a copy of the image as RGBA32 data along with its size & revision,
+    // all taken at the same time.
+    [[nodiscard]] std::vector<unsigned char> getPixels(
+        unsigned& width, unsigned& height, unsigned& revision
+    ) const;
+
+    // Revision of the image; changes whenever the image is loaded or modified.
+    unsigned getRevision() const;
+
+    // Overwrite a rectangle of the image with RGBA32 data (width * height * 4
+    // bytes). Only the changed rectangle is uploaded to the GPU.
+    //
+    // Returns: true if succeeded, false if the rectangle is out of bounds.
+    bool updateRegion(unsigned x, unsigned y, unsigned width, unsigned height, const unsigned char* data);
+
+    // Upload pending changes to the GPU texture, creating it if needed.
+    //     - Note: this is done on the main thread; when called from another
+    //       thread it blocks until the main thread has done it.
+    void syncGPUTexture();
+
+    // Get the GPU texture with all changes to the image uploaded. Only call
+    // these on the main thread. (Texture::getTextureId gives the texture as
+    // it is, without uploading.)
+    GLuint syncAndGetTextureId() {
+        syncGPUTexture();
+        return mTextureId;
+    }
+    ImTextureID syncAndGetImTextureId() {
+        return static_cast<ImTextureID>(syncAndGetTextureId());
+    }
+
     // Construct a TPLTexture from this texture.
     //
     // Returns: TPL::TPLTexture wrapped in std::optional
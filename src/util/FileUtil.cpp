@@ -25,6 +25,32 @@ std::optional<std::vector<unsigned char>> FileUtil::openFileData(std::string_vie
     return data;
 }
 
+bool FileUtil::readFileChunked(
+    std::string_view filePath, size_t chunkSize,
+    const std::function<bool(const unsigned char* chunk, size_t chunkSize)>& callback
+) {
+    std::ifstream file(filePath.data(), std::ios::binary);
+    if (!file.is_open()) {
+        Logging::error("[FileUtil::readFileChunked] Error opening file at path: {}", filePath);
+        return false;
+    }
+
+    std::vector<unsigned char> chunk(chunkSize);
+
+    while (file) {
+        file.read(reinterpret_cast<char*>(chunk.data()), chunk.size());
+
+        const size_t readSize = file.gcount();
+        if (readSize == 0)
+            break;
+
+        if (!callback(chunk.data(), readSize))
+            return false;
+    }
+
+    return true;
+}
+
 bool FileUtil::doesFileExist(std::string_view filePath) {
     if (filePath.empty())
         return false;
@@ -7,6 +7,8 @@
 
 #include <vector>
 
+#include <functional>
+
 namespace FileUtil {
 
 // Open a binary from the filesystem and read it's data.
@@ -14,6 +16,16 @@ namespace FileUtil {
 // Returns: std::vector<unsigned char> wrapped in std::optional
 std::optional<std::vector<unsigned char>> openFileData(std::string_view filePath);
 
+// Read a binary from the filesystem in chunks of up to chunkSize bytes, handing
+// every chunk to the callback as soon as it is read. Reading stops early if the
+// callback returns false.
+//
+// Returns: true if the whole file was read, false if it couldn't be opened or reading was stopped
+bool readFileChunked(
+    std::string_view filePath, size_t chunkSize,
+    const std::function<bool(const unsigned char* chunk, size_t chunkSize)>& callback
+);
+
 bool doesFileExist(std::string_view filePath);
 
 // Copy one file to another by their paths. If overwrite is set, 
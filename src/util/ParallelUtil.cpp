@@ -0,0 +1,268 @@
+#include "ParallelUtil.hpp"
+
+#include <vector>
+#include <deque>
+
+#include <memory>
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include <algorithm>
+
+namespace {
+
+struct Job {
+    const std::function<void(size_t begin, size_t end)>* func;
+
+    size_t remainingTasks; // Guarded by mtx.
+
+    std::mutex mtx;
+    std::condition_variable cv;
+};
+
+struct Task {
+    Job* job;
+    size_t begin, end;
+};
+
+// Index of the queue of the current thread; -1 if the thread isn't a worker.
+thread_local int tWorkerIndex = -1;
+
+class WorkerPool {
+public:
+    static WorkerPool& getInstance() {
+        static WorkerPool instance;
+        return instance;
+    }
+
+    unsigned getWorkerCount() const { return static_cast<unsigned>(mThreads.size()); }
+
+    // Queue the tasks of a job & help out until all of them are done.
+    void runJob(Job& job, const std::vector<Task>& tasks);
+
+private:
+    WorkerPool();
+    ~WorkerPool();
+
+    // Each worker pops from the back of its own queue; other threads steal
+    // from the front.
+    struct TaskQueue {
+        std::mutex mtx;
+        std::deque<Task> tasks;
+    };
+
+    bool popTask(unsigned queueIndex, Task& task);
+    bool stealTask(unsigned startIndex, Task& task);
+
+    bool takeTask(Task& task);
+
+    void runTask(const Task& task);
+
+    void workerMain(unsigned index);
+
+private:
+    std::vector<std::unique_ptr<TaskQueue>> mQueues;
+    std::vector<std::thread> mThreads;
+
+    std::atomic<unsigned> mNextQueue { 0 };
+
+    std::atomic<size_t> mPendingTasks { 0 };
+
+    std::mutex mSleepMtx;
+    std::condition_variable mSleepCv;
+    bool mStopping { false }; // Guarded by mSleepMtx.
+};
+
+WorkerPool::WorkerPool() {
+    const unsigned numThreads = ParallelUtil::getHardwareThreadCount();
+
+    // The calling thread always works along.
+    const unsigned workerCount = numThreads - 1;
+
+    mQueues.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; i++)
+        mQueues.push_back(std::make_unique<TaskQueue>());
+
+    mThreads.reserve(workerCount);
+    for (unsigned i = 0; i < workerCount; i++)
+        mThreads.emplace_back(&WorkerPool::workerMain, this, i);
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mSleepMtx);
+        mStopping = true;
+    }
+    mSleepCv.notify_all();
+
+    for (auto& thread : mThreads)
+        thread.join();
+}
+
+bool WorkerPool::popTask(unsigned queueIndex, Task& task) {
+    TaskQueue& queue = *mQueues[queueIndex];
+
+    std::lock_guard<std::mutex> lock(queue.mtx);
+    if (queue.tasks.empty())
+        return false;
+
+    task = queue.tasks.back();
+    queue.tasks.pop_back();
+
+    mPendingTasks--;
+    return true;
+}
+
+bool WorkerPool::stealTask(unsigned startIndex, Task& task) {
+    const unsigned queueCount = static_cast<unsigned>(mQueues.size());
+
+    for (unsigned i = 0; i < queueCount; i++) {
+        TaskQueue& queue = *mQueues[(startIndex + i) % queueCount];
+
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        if (queue.tasks.empty())
+            continue;
+
+        task = queue.tasks.front();
+        queue.tasks.pop_front();
+
+        mPendingTasks--;
+        return true;
+    }
+
+    return false;
+}
+
+bool WorkerPool::takeTask(Task& task) {
+    if (tWorkerIndex >= 0) {
+        const unsigned index = static_cast<unsigned>(tWorkerIndex);
+        return popTask(index, task) || stealTask(index + 1, task);
+    }
+    return stealTask(0, task);
+}
+
+void WorkerPool::runTask(const Task& task) {
+    Job& job = *task.job;
+
+    (*job.func)(task.begin, task.end);
+
+    std::lock_guard<std::mutex> lock(job.mtx);
+    if (--job.remainingTasks == 0)
+        job.cv.notify_all();
+}
+
+void WorkerPool::runJob(Job& job, const std::vector<Task>& tasks) {
+    job.remainingTasks = tasks.size();
+
+    // Counted before they're queued, so that the count doesn't underflow when
+    // a task is taken right away.
+    mPendingTasks += tasks.size();
+
+    // Tasks queued by a worker go to its own queue (nested jobs); otherwise
+    // they're dealt out over all queues.
+    if (tWorkerIndex >= 0) {
+        TaskQueue& queue = *mQueues[tWorkerIndex];
+
+        std::lock_guard<std::mutex> lock(queue.mtx);
+        queue.tasks.insert(queue.tasks.end(), tasks.begin(), tasks.end());
+    }
+    else {
+        const unsigned queueCount = static_cast<unsigned>(mQueues.size());
+        const unsigned firstQueue = mNextQueue++;
+
+        for (size_t i = 0; i < tasks.size(); i++) {
+            TaskQueue& queue = *mQueues[(firstQueue + i) % queueCount];
+
+            std::lock_guard<std::mutex> lock(queue.mtx);
+            queue.tasks.push_back(tasks[i]);
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mSleepMtx);
+    }
+    mSleepCv.notify_all();
+
+    // Help out until there's nothing left to take; the remaining tasks of the
+    // job are then running on other threads.
+    Task task;
+    while (takeTask(task))
+        runTask(task);
+
+    std::unique_lock<std::mutex> lock(job.mtx);
+    job.cv.wait(lock, [&job]() { return job.remainingTasks == 0; });
+}
+
+void WorkerPool::workerMain(unsigned index) {
+    tWorkerIndex = static_cast<int>(index);
+
+    while (true) {
+        Task task;
+        if (takeTask(task)) {
+            runTask(task);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mSleepMtx);
+        mSleepCv.wait(lock, [this]() { return mStopping || mPendingTasks > 0; });
+
+        if (mStopping)
+            return;
+    }
+}
+
+} // namespace
+
+unsigned ParallelUtil::getHardwareThreadCount() {
+    // Used if the amount can't be determined.
+    constexpr unsigned DEFAULT_THREAD_COUNT = 4;
+    // Keeps a bogus value from spawning thousands of threads.
+    constexpr unsigned MAX_THREAD_COUNT = 1024;
+
+    const unsigned numThreads = std::thread::hardware_concurrency();
+    if (numThreads == 0)
+        return DEFAULT_THREAD_COUNT;
+
+    return std::min(numThreads, MAX_THREAD_COUNT);
+}
+
+unsigned ParallelUtil::getThreadCount() {
+    return WorkerPool::getInstance().getWorkerCount() + 1;
+}
+
+void ParallelUtil::parallelFor(
+    size_t count, size_t grainSize,
+    const std::function<void(size_t begin, size_t end)>& func
+) {
+    if (count == 0)
+        return;
+
+    WorkerPool& pool = WorkerPool::getInstance();
+
+    grainSize = std::max<size_t>(grainSize, 1);
+
+    // A few ranges per thread, so that the stealing can even out the load.
+    const size_t maxRanges = static_cast<size_t>(pool.getWorkerCount() + 1) * 4;
+    const size_t rangeCount = std::min((count + grainSize - 1) / grainSize, maxRanges);
+
+    if (rangeCount <= 1 || pool.getWorkerCount() == 0) {
+        func(0, count);
+        return;
+    }
+
+    const size_t rangeSize = (count + rangeCount - 1) / rangeCount;
+
+    Job job;
+    job.func = &func;
+
+    std::vector<Task> tasks;
+    tasks.reserve(rangeCount);
+
+    for (size_t begin = 0; begin < count; begin += rangeSize)
+        tasks.push_back({ &job, begin, std::min(begin + rangeSize, count) });
+
+    pool.runJob(job, tasks);
+}
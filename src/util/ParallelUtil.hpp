@@ -0,0 +1,31 @@
+#ifndef PARALLEL_UTIL_HPP
+#define PARALLEL_UTIL_HPP
+
+#include <cstddef>
+
+#include <functional>
+
+namespace ParallelUtil {
+
+// Amount of hardware threads (falls back to a small default if it can't be
+// determined).
+unsigned getHardwareThreadCount();
+
+// Amount of threads that run work at once (the workers of the shared pool and
+// the calling thread).
+unsigned getThreadCount();
+
+// Split [0, count) into ranges of at least grainSize & run func on each range
+// on the shared worker pool. Idle workers steal ranges from busy ones. The
+// calling thread works on the ranges too & returns once all of them are done.
+//
+// Calls can be nested (e.g. every texture of an archive in parallel, and the
+// tile rows of every texture in parallel).
+void parallelFor(
+    size_t count, size_t grainSize,
+    const std::function<void(size_t begin, size_t end)>& func
+);
+
+} // namespace ParallelUtil
+
+#endif // PARALLEL_UTIL_HPP
@@ -39,7 +39,7 @@ bool SpritesheetFixUtil::FixRepack(Session& session, int sheetIndex) {
     std::shared_ptr cellanimObject = session.getCurrentCellAnim().object;
 
     // Copy
-    std::vector<CellAnim::Arrangement> arrangements = cellanimObject->getArrangements();
+    CellAnim::PersistentVector<CellAnim::Arrangement> arrangements = cellanimObject->getArrangements();
 
     std::set<stbrp_rect, decltype(&RectLess)> uniqueRects(RectLess);
 
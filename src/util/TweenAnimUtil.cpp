@@ -3,7 +3,7 @@
 #include "ArrangePartMatchUtil.hpp"
 
 CellAnim::AnimationKey TweenAnimUtil::tweenAnimKeys(
-    std::vector<CellAnim::Arrangement>& arrangements, bool dontTweenArrangement,
+    CellAnim::PersistentVector<CellAnim::Arrangement>& arrangements, bool dontTweenArrangement,
     const CellAnim::AnimationKey& k0, const CellAnim::AnimationKey& k1, float t
 ) {
     CellAnim::AnimationKey newKey = k0;
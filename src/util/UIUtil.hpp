@@ -9,9 +9,11 @@
 
 namespace UIUtil::Widget {
 
+// The value is only written (through setCurrent) when the widget changes it.
 template <typename T>
 void ValueEditor(
-    const char* label, T& currentValue,
+    const char* label, const T& currentValue,
+    std::function<void(const T& value)> setCurrent,
     std::function<T()> getOriginal,
     std::function<void(const T& oldValue, const T& newValue)> setFinal,
     std::function<bool(const char* label, T* value)> widgetCall
@@ -20,7 +22,7 @@ void ValueEditor(
     T tempValue = currentValue;
 
     if (widgetCall(label, &tempValue))
-        currentValue = tempValue;
+        setCurrent(tempValue);
 
     if (ImGui::IsItemActivated())
         oldValue = getOriginal();
@@ -11,6 +11,8 @@
 
 #include "BIN/image/toastIcon_title.png.h"
 
+#include "Toast.hpp"
+
 #include "manager/ThemeManager.hpp"
 
 #include "BuildDate.hpp"
@@ -234,6 +236,9 @@ void WindowAbout::update() {
 
     const ImVec2 imageSize { 350.f, 350.f };
 
+    // The image bobs continuously.
+    Toast::getInstance()->requestUpdates();
+
     const ImVec2 imageTopLeft {
         canvasTopLeft.x - 20.f,
 
@@ -445,7 +445,7 @@ void WindowCanvas::update() {
 
     auto& selectionState = SessionManager::getInstance().getCurrentSession()->getPartSelectState();
 
-    CellAnim::Arrangement& arrangement = playerManager.getArrangement();
+    const CellAnim::Arrangement& arrangement = playerManager.getArrangement();
 
     // Select all parts with CTRL+A
     if (ImGui::Shortcut(ImGuiKey_A | ImGuiMod_Ctrl)) {
@@ -785,9 +785,13 @@ void WindowCanvas::update() {
             break;
         }
 
+        // Taken for writing only here; this can copy the arrangement, so the
+        // bounding below is taken from the edited one.
+        CellAnim::Arrangement& editedArrangement = playerManager.editArrangement();
+
         // Apply transformation
         for (const auto& [index, _] : selectionState.mSelected) {
-            auto& part = arrangement.parts.at(index);
+            auto& part = editedArrangement.parts.at(index);
 
             if (part.editorLocked)
                 continue;
@@ -845,7 +849,7 @@ void WindowCanvas::update() {
             part.transform.angle += partsTransformation.rotation;
         }
 
-        partsBounding = calculatePartsBounding(mCellAnimRenderer, arrangement, quadRotation);
+        partsBounding = calculatePartsBounding(mCellAnimRenderer, editedArrangement, quadRotation);
         partsBoundingCenter = AVERAGE_IMVEC2(partsBounding[0], partsBounding[2]);
         partsAnmSpaceCenter = ImVec2(
             (partsBoundingCenter.x - origin.x) / mState.zoomFactor,
@@ -900,7 +904,7 @@ void WindowCanvas::update() {
             SessionManager& sessionManager = SessionManager::getInstance();
 
             // Reverse the role of arrangementBeforeMutation for the command submit
-            std::swap(arrangementBeforeMutation, arrangement);
+            std::swap(arrangementBeforeMutation, playerManager.editArrangement());
 
             sessionManager.getCurrentSession()->addCommand(
             std::make_shared<CommandModifyArrangement>(
@@ -1146,7 +1150,7 @@ void WindowCanvas::update() {
     }
 
     if (partsTransformation.active)
-        arrangement = arrangementBeforeMutation;
+        playerManager.editArrangement() = arrangementBeforeMutation;
 
     ImGui::End();
 }
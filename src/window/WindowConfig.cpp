@@ -8,6 +8,7 @@
 #include <tinyfiledialogs.h>
 
 #include "manager/ThemeManager.hpp"
+#include "manager/SessionManager.hpp"
 
 #include "util/UIUtil.hpp"
 
@@ -103,6 +104,25 @@ void WindowConfig::update() {
                     mMyConfig.updateRate = std::max<unsigned>(updateRate, min);
                 }
 
+                ImGui::Checkbox("Idle when inactive", &mMyConfig.idleWhenInactive);
+                ImGui::SetItemTooltip("Only update when there's input, playback or work going on.");
+
+                ImGui::Separator();
+
+                static const unsigned minUndoBudget = 1;
+
+                ImGui::DragScalar(
+                    "Undo history budget", ImGuiDataType_U32, &mMyConfig.undoHistoryBudget,
+                    1.f, &minUndoBudget, nullptr, "%u MiB", ImGuiSliderFlags_AlwaysClamp
+                );
+
+                if (const Session* session = SessionManager::getInstance().getCurrentSession()) {
+                    ImGui::TextDisabled(
+                        "Undo history of the current session: %.2f MiB",
+                        static_cast<double>(session->getUndoMemoryUsage()) / (1024. * 1024.)
+                    );
+                }
+
                 ImGui::Separator();
 
                 static const char* backupOptions[] {
@@ -155,7 +175,7 @@ void WindowConfig::update() {
                 }
 
                 if (ImGui::SliderInt(
-                    "Zlib compression level",
+                    "Compression level",
                     &selectedCompLevelIndex,
                     0,
                     static_cast<int>(AbstrCompressionLevel::Count) - 1,
@@ -166,7 +186,7 @@ void WindowConfig::update() {
                 }
 
                 static constexpr std::array<std::string_view, static_cast<int>(ETC1Quality::Count)> ETC1QualityNames = {
-                    "Low", "Medium", "High"
+                    "Fast", "Low", "Medium", "High"
                 };
 
                 int qualityIndex = static_cast<int>(mMyConfig.etc1Quality);
@@ -188,6 +208,54 @@ void WindowConfig::update() {
                 )) {
                     mMyConfig.etc1Quality = static_cast<ETC1Quality>(qualityIndex);
                 }
+
+                static constexpr std::array<std::string_view, static_cast<int>(CMPRQuality::Count)> CMPRQualityNames = {
+                    "Fast", "High"
+                };
+
+                int cmprQualityIndex = static_cast<int>(mMyConfig.cmprQuality);
+
+                if (cmprQualityIndex >= 0 && cmprQualityIndex < static_cast<int>(CMPRQuality::Count)) {
+                    std::snprintf(buffer, sizeof(buffer), "%s", CMPRQualityNames[cmprQualityIndex].data());
+                }
+                else {
+                    std::snprintf(buffer, sizeof(buffer), "Invalid");
+                }
+
+                if (ImGui::SliderInt(
+                    "CMPR compression quality",
+                    &cmprQualityIndex,
+                    0,
+                    static_cast<int>(CMPRQuality::Count) - 1,
+                    buffer,
+                    ImGuiSliderFlags_NoInput | ImGuiSliderFlags_AlwaysClamp
+                )) {
+                    mMyConfig.cmprQuality = static_cast<CMPRQuality>(cmprQualityIndex);
+                }
+
+                static constexpr std::array<std::string_view, static_cast<int>(PaletteDithering::Count)> PaletteDitheringNames = {
+                    "None", "Ordered", "Error diffusion"
+                };
+
+                int ditheringIndex = static_cast<int>(mMyConfig.paletteDithering);
+
+                if (ditheringIndex >= 0 && ditheringIndex < static_cast<int>(PaletteDithering::Count)) {
+                    std::snprintf(buffer, sizeof(buffer), "%s", PaletteDitheringNames[ditheringIndex].data());
+                }
+                else {
+                    std::snprintf(buffer, sizeof(buffer), "Invalid");
+                }
+
+                if (ImGui::SliderInt(
+                    "Palette (C4, C8) dithering",
+                    &ditheringIndex,
+                    0,
+                    static_cast<int>(PaletteDithering::Count) - 1,
+                    buffer,
+                    ImGuiSliderFlags_NoInput | ImGuiSliderFlags_AlwaysClamp
+                )) {
+                    mMyConfig.paletteDithering = static_cast<PaletteDithering>(ditheringIndex);
+                }
             } break;
 
             case Category_Theming: {
@@ -9,11 +9,15 @@
 
 #include <set>
 
+#include <utility>
+
 #include <cmath>
 
 #include <imgui.h>
 #include <imgui_internal.h>
 
+#include "Toast.hpp"
+
 #include "manager/AppState.hpp"
 #include "manager/SessionManager.hpp"
 #include "manager/PlayerManager.hpp"
@@ -36,6 +40,8 @@ constexpr float WINDOW_FLASH_TIME = .3f; // seconds
 void WindowHybridList::flashWindow() {
     mFlashWindow = true;
     mFlashTimer = static_cast<float>(ImGui::GetTime());
+
+    Toast::getInstance()->requestUpdates(WINDOW_FLASH_TIME);
 }
 void WindowHybridList::resetFlash() {
     mFlashWindow = false;
@@ -46,8 +52,8 @@ static CellAnim::Animation createNewAnimation() {
     constexpr std::string_view namePrefix = "CellAnim";
 
     SessionManager& sessionManager = SessionManager::getInstance();
-    const auto& animations = sessionManager.getCurrentSession()
-        ->getCurrentCellAnim().object->getAnimations();
+    const auto& animations = std::as_const(*sessionManager.getCurrentSession()
+        ->getCurrentCellAnim().object).getAnimations();
 
     std::set<unsigned> usedNumbers;
     for (const auto& animation : animations) {
@@ -133,8 +139,8 @@ void WindowHybridList::update() {
 
         const auto& config = ConfigManager::getInstance().getConfig();
 
-        const auto& animations = currentSession->getCurrentCellAnim().object->getAnimations();
-        const auto& arrangements = currentSession->getCurrentCellAnim().object->getArrangements();
+        const auto& animations = std::as_const(*currentSession->getCurrentCellAnim().object).getAnimations();
+        const auto& arrangements = std::as_const(*currentSession->getCurrentCellAnim().object).getArrangements();
 
         if (!currentSession->arrangementMode) {
             for (unsigned n = 0; n < animations.size(); n++) {
@@ -210,7 +216,7 @@ void WindowHybridList::update() {
 
                             auto& cellAnim = *currentSession->getCurrentCellAnim().object;
 
-                            std::vector<CellAnim::Arrangement> newArrangements = cellAnim.getArrangements();
+                            CellAnim::PersistentVector<CellAnim::Arrangement> newArrangements = cellAnim.getArrangements();
 
                             auto baseIndex = newArrangements.size(); // BEFORE insertion
                             newArrangements.insert(newArrangements.end(), copyAnimationArrangements.begin(), copyAnimationArrangements.end());
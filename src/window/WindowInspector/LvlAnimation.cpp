@@ -54,7 +54,7 @@ void WindowInspector::Level_Animation() {
 
     ImGui::SameLine();
 
-    CellAnim::Animation& animation = playerManager.getAnimation();
+    const CellAnim::Animation& animation = playerManager.getAnimation();
     unsigned animationIndex = playerManager.getAnimationIndex();
 
     CellAnim::Animation newAnimation = playerManager.getAnimation();
@@ -79,6 +79,7 @@ void WindowInspector::Level_Animation() {
     ImGui::SeparatorText((const char*)ICON_FA_PENCIL " Properties");
 
     UIUtil::Widget::ValueEditor<std::string>("Name", animation.name,
+        [&](const std::string& value) { playerManager.editAnimation().name = value; },
         [&]() { return originalAnimation.name; },
         [&](const std::string& oldValue, const std::string& newValue) {
             originalAnimation.name = oldValue;
@@ -90,6 +91,7 @@ void WindowInspector::Level_Animation() {
     );
 
     UIUtil::Widget::ValueEditor<std::string>("Comment", animation.comment,
+        [&](const std::string& value) { playerManager.editAnimation().comment = value; },
         [&]() { return originalAnimation.comment; },
         [&](const std::string& oldValue, const std::string& newValue) {
             originalAnimation.comment = oldValue;
@@ -148,7 +150,7 @@ void WindowInspector::Level_Animation() {
     ImGui::Unindent(); 
 
     if (newAnimation != originalAnimation) {
-        animation = originalAnimation;
+        playerManager.editAnimation() = originalAnimation;
 
         sessionManager.getCurrentSession()->addCommand(
         std::make_shared<CommandModifyAnimation>(
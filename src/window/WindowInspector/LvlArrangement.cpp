@@ -2,6 +2,8 @@
 
 #include <cstdint>
 
+#include <utility>
+
 #include "manager/SessionManager.hpp"
 #include "manager/ThemeManager.hpp"
 
@@ -74,8 +76,8 @@ void WindowInspector::Level_Arrangement() {
 
     static std::vector<CellAnim::ArrangementPart> copyParts;
 
-    const auto& arrangements = sessionManager.getCurrentSession()
-        ->getCurrentCellAnim().object->getArrangements();
+    const auto& arrangements = std::as_const(*sessionManager.getCurrentSession()
+        ->getCurrentCellAnim().object).getArrangements();
 
     ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, { 0.f, 0.f });
 
@@ -107,7 +109,7 @@ void WindowInspector::Level_Arrangement() {
                 if (ImGui::InputInt("##ArrangementInput", &newArrangement)) {
                     if (newArrangement < 1) newArrangement = 1;
 
-                    playerManager.getKey().arrangementIndex = std::min<unsigned>(
+                    playerManager.editKey().arrangementIndex = std::min<unsigned>(
                         newArrangement - 1, arrangements.size() - 1
                     );
                     playerManager.validateState();
@@ -126,7 +128,7 @@ void WindowInspector::Level_Arrangement() {
                 duplicateArrangementButton(newKey, originalKey);
 
                 if (newKey != originalKey) {
-                    playerManager.getKey() = originalKey;
+                    playerManager.editKey() = originalKey;
 
                     sessionManager.getCurrentSession()->addCommand(
                     std::make_shared<CommandModifyAnimationKey>(
@@ -143,9 +145,12 @@ void WindowInspector::Level_Arrangement() {
         ImGui::EndChild();
 
         if (selectionState.singleSelected()) {
-            CellAnim::ArrangementPart& part = playerManager.getArrangement().parts.at(
+            const CellAnim::ArrangementPart& part = playerManager.getArrangement().parts.at(
                 selectionState.mSelected[0].index
             );
+            auto editPart = [&]() -> CellAnim::ArrangementPart& {
+                return playerManager.editArrangement().parts.at(selectionState.mSelected[0].index);
+            };
 
             CellAnim::ArrangementPart newPart = part;
             CellAnim::ArrangementPart originalPart = part;
@@ -155,6 +160,7 @@ void WindowInspector::Level_Arrangement() {
             ImGui::SeparatorText((const char*)ICON_FA_PENCIL " Name (editor)");
 
             UIUtil::Widget::ValueEditor<std::string>("Name", part.editorName,
+                [&](const std::string& value) { editPart().editorName = value; },
                 [&]() { return originalPart.editorName; },
                 [&](const std::string& oldValue, const std::string& newValue) {
                     originalPart.editorName = oldValue;
@@ -168,6 +174,7 @@ void WindowInspector::Level_Arrangement() {
             ImGui::SeparatorText((const char*)ICON_FA_ARROWS_UP_DOWN_LEFT_RIGHT " Transform");
 
             UIUtil::Widget::ValueEditor<CellAnim::IntVec2>("Position XY", part.transform.position,
+                [&](const CellAnim::IntVec2& value) { editPart().transform.position = value; },
                 [&]() { return originalPart.transform.position; },
                 [&](const CellAnim::IntVec2& oldValue, const CellAnim::IntVec2& newValue) {
                     originalPart.transform.position = oldValue;
@@ -183,6 +190,7 @@ void WindowInspector::Level_Arrangement() {
             );
 
             UIUtil::Widget::ValueEditor<CellAnim::FltVec2>("Scale XY", part.transform.scale,
+                [&](const CellAnim::FltVec2& value) { editPart().transform.scale = value; },
                 [&]() { return originalPart.transform.scale; },
                 [&](const CellAnim::FltVec2& oldValue, const CellAnim::FltVec2& newValue) {
                     originalPart.transform.scale = oldValue;
@@ -194,6 +202,7 @@ void WindowInspector::Level_Arrangement() {
             );
 
             UIUtil::Widget::ValueEditor<float>("Angle Z", part.transform.angle,
+                [&](const float& value) { editPart().transform.angle = value; },
                 [&]() { return originalPart.transform.angle; },
                 [&](const float& oldValue, const float& newValue) {
                     originalPart.transform.angle = oldValue;
@@ -217,6 +226,7 @@ void WindowInspector::Level_Arrangement() {
             ImGui::SeparatorText((const char*)ICON_FA_IMAGE " Rendering");
 
             UIUtil::Widget::ValueEditor<uint8_t>("Opacity", part.opacity,
+                [&](const uint8_t& value) { editPart().opacity = value; },
                 [&]() { return originalPart.opacity; },
                 [&](const uint8_t& oldValue, const uint8_t& newValue) {
                     originalPart.opacity = oldValue;
@@ -233,6 +243,7 @@ void WindowInspector::Level_Arrangement() {
             // Fore & Back Color
             if (isCtr) {
                 UIUtil::Widget::ValueEditor<CellAnim::CTRColor>("Fore Color", part.foreColor,
+                    [&](const CellAnim::CTRColor& value) { editPart().foreColor = value; },
                     [&]() { return originalPart.foreColor; },
                     [&](const CellAnim::CTRColor& oldValue, const CellAnim::CTRColor& newValue) {
                         originalPart.foreColor = oldValue;
@@ -244,6 +255,7 @@ void WindowInspector::Level_Arrangement() {
                 );
 
                 UIUtil::Widget::ValueEditor<CellAnim::CTRColor>("Back Color", part.backColor,
+                    [&](const CellAnim::CTRColor& value) { editPart().backColor = value; },
                     [&]() { return originalPart.backColor; },
                     [&](const CellAnim::CTRColor& oldValue, const CellAnim::CTRColor& newValue) {
                         originalPart.backColor = oldValue;
@@ -258,6 +270,7 @@ void WindowInspector::Level_Arrangement() {
             ImGui::SeparatorText((const char*)ICON_FA_BORDER_TOP_LEFT " Cell");
 
             UIUtil::Widget::ValueEditor<CellAnim::UintVec2>("Origin XY##Cell", part.cellOrigin,
+                [&](const CellAnim::UintVec2& value) { editPart().cellOrigin = value; },
                 [&]() { return originalPart.cellOrigin; },
                 [&](const CellAnim::UintVec2& oldValue, const CellAnim::UintVec2& newValue) {
                     originalPart.cellOrigin = oldValue;
@@ -276,6 +289,7 @@ void WindowInspector::Level_Arrangement() {
             );
 
             UIUtil::Widget::ValueEditor<CellAnim::UintVec2>("Size WH##Cell", part.cellSize,
+                [&](const CellAnim::UintVec2& value) { editPart().cellSize = value; },
                 [&]() { return originalPart.cellSize; },
                 [&](const CellAnim::UintVec2& oldValue, const CellAnim::UintVec2& newValue) {
                     originalPart.cellSize = oldValue;
@@ -298,6 +312,7 @@ void WindowInspector::Level_Arrangement() {
                 ImGui::SeparatorText((const char*)ICON_FA_PENCIL " ID");
 
                 UIUtil::Widget::ValueEditor<unsigned>("ID", part.id,
+                    [&](const unsigned& value) { editPart().id = value; },
                     [&]() { return originalPart.id; },
                     [&](const unsigned& oldValue, const unsigned& newValue) {
                         originalPart.id = oldValue;
@@ -314,6 +329,7 @@ void WindowInspector::Level_Arrangement() {
                 ImGui::SeparatorText((const char*)ICON_FA_WAND_MAGIC_SPARKLES " 3D Depth");
 
                 UIUtil::Widget::ValueEditor<CellAnim::CTRQuadDepth>("Quad Depth", part.quadDepth,
+                    [&](const CellAnim::CTRQuadDepth& value) { editPart().quadDepth = value; },
                     [&]() { return originalPart.quadDepth; },
                     [&](const CellAnim::CTRQuadDepth& oldValue, const CellAnim::CTRQuadDepth& newValue) {
                         originalPart.quadDepth = oldValue;
@@ -351,6 +367,7 @@ void WindowInspector::Level_Arrangement() {
                 ImGui::SeparatorText((const char*)ICON_FA_WAND_MAGIC_SPARKLES " Effects");
 
                 UIUtil::Widget::ValueEditor<std::string>("Emitter Name", part.emitterName,
+                    [&](const std::string& value) { editPart().emitterName = value; },
                     [&]() { return originalPart.emitterName; },
                     [&](const std::string& oldValue, const std::string& newValue) {
                         originalPart.emitterName = oldValue;
@@ -363,7 +380,7 @@ void WindowInspector::Level_Arrangement() {
             }
 
             if (newPart != originalPart) {
-                part = originalPart;
+                editPart() = originalPart;
 
                 sessionManager.getCurrentSession()->addCommand(
                 std::make_shared<CommandModifyArrangementPart>(
@@ -396,7 +413,7 @@ void WindowInspector::Level_Arrangement() {
     {
         ImGui::SeparatorText((const char*)ICON_FA_IMAGE " Parts");
 
-        auto& arrangement = playerManager.getArrangement();
+        const auto& arrangement = playerManager.getArrangement();
 
         int selDeleteSingle = -1; // Index of part to delete or <0.
         int insertNewPart = -1; // Index of part to insert or <0.
@@ -1,5 +1,7 @@
 #include "../WindowInspector.hpp"
 
+#include <utility>
+
 #include "manager/SessionManager.hpp"
 #include "manager/ThemeManager.hpp"
 #include "manager/PlayerManager.hpp"
@@ -23,8 +25,8 @@ void WindowInspector::Level_Key() {
 
     ImGui::SameLine();
 
-    const auto& arrangements = sessionManager.getCurrentSession()
-        ->getCurrentCellAnim().object->getArrangements();
+    const auto& arrangements = std::as_const(*sessionManager.getCurrentSession()
+        ->getCurrentCellAnim().object).getArrangements();
 
     unsigned animationIndex = playerManager.getAnimationIndex();
     const char* animationName = playerManager.getAnimation().name.c_str();
@@ -45,7 +47,7 @@ void WindowInspector::Level_Key() {
     }
     ImGui::EndChild();
 
-    CellAnim::AnimationKey& key = playerManager.getKey();
+    const CellAnim::AnimationKey& key = playerManager.getKey();
 
     CellAnim::AnimationKey newKey = playerManager.getKey();
     CellAnim::AnimationKey originalKey = playerManager.getKey();
@@ -65,7 +67,7 @@ void WindowInspector::Level_Key() {
         if (ImGui::InputInt("##Arrangement No.", &newArrangement)) {
             if (newArrangement < 1) newArrangement = 1;
 
-            playerManager.getKey().arrangementIndex = std::min<unsigned>(
+            playerManager.editKey().arrangementIndex = std::min<unsigned>(
                 newArrangement - 1, arrangements.size() - 1
             );
             playerManager.validateState();
@@ -90,6 +92,7 @@ void WindowInspector::Level_Key() {
     ImGui::SeparatorText((const char*)ICON_FA_HOURGLASS " Frames");
 
     UIUtil::Widget::ValueEditor<unsigned>("Frames", key.holdFrames,
+        [&](const unsigned& value) { playerManager.editKey().holdFrames = value; },
         [&]() { return originalKey.holdFrames; },
         [&](const unsigned& oldValue, const unsigned& newValue) {
             originalKey.holdFrames = oldValue;
@@ -114,6 +117,7 @@ void WindowInspector::Level_Key() {
     ImGui::SeparatorText((const char*)ICON_FA_ARROWS_UP_DOWN_LEFT_RIGHT " Transform");
 
     UIUtil::Widget::ValueEditor<CellAnim::IntVec2>("Position XY", key.transform.position,
+        [&](const CellAnim::IntVec2& value) { playerManager.editKey().transform.position = value; },
         [&]() { return originalKey.transform.position; },
         [&](const CellAnim::IntVec2& oldValue, const CellAnim::IntVec2& newValue) {
             originalKey.transform.position = oldValue;
@@ -129,6 +133,7 @@ void WindowInspector::Level_Key() {
     );
 
     UIUtil::Widget::ValueEditor<CellAnim::FltVec2>("Scale XY", key.transform.scale,
+        [&](const CellAnim::FltVec2& value) { playerManager.editKey().transform.scale = value; },
         [&]() { return originalKey.transform.scale; },
         [&](const CellAnim::FltVec2& oldValue, const CellAnim::FltVec2& newValue) {
             originalKey.transform.scale = oldValue;
@@ -142,6 +147,7 @@ void WindowInspector::Level_Key() {
     );
 
     UIUtil::Widget::ValueEditor<float>("Angle Z", key.transform.angle,
+        [&](const float& value) { playerManager.editKey().transform.angle = value; },
         [&]() { return originalKey.transform.angle; },
         [&](const float& oldValue, const float& newValue) {
             originalKey.transform.angle = oldValue;
@@ -164,6 +170,7 @@ void WindowInspector::Level_Key() {
         ImGui::Dummy({ 0.f, 3.f });
 
         UIUtil::Widget::ValueEditor<float>("Position Z", key.translateZ,
+            [&](const float& value) { playerManager.editKey().translateZ = value; },
             [&]() { return originalKey.translateZ; },
             [&](const float& oldValue, const float& newValue) {
                 originalKey.translateZ = oldValue;
@@ -178,6 +185,7 @@ void WindowInspector::Level_Key() {
     ImGui::SeparatorText((const char*)ICON_FA_IMAGE " Rendering");
 
     UIUtil::Widget::ValueEditor<uint8_t>("Opacity", key.opacity,
+        [&](const uint8_t& value) { playerManager.editKey().opacity = value; },
         [&]() { return originalKey.opacity; },
         [&](const uint8_t& oldValue, const uint8_t& newValue) {
             originalKey.opacity = oldValue;
@@ -194,6 +202,7 @@ void WindowInspector::Level_Key() {
     // Fore & Back Color
     if (isCtr) {
         UIUtil::Widget::ValueEditor<CellAnim::CTRColor>("Fore Color", key.foreColor,
+            [&](const CellAnim::CTRColor& value) { playerManager.editKey().foreColor = value; },
             [&]() { return originalKey.foreColor; },
             [&](const CellAnim::CTRColor& oldValue, const CellAnim::CTRColor& newValue) {
                 originalKey.foreColor = oldValue;
@@ -205,6 +214,7 @@ void WindowInspector::Level_Key() {
         );
 
         UIUtil::Widget::ValueEditor<CellAnim::CTRColor>("Back Color", key.backColor,
+            [&](const CellAnim::CTRColor& value) { playerManager.editKey().backColor = value; },
             [&]() { return originalKey.backColor; },
             [&](const CellAnim::CTRColor& oldValue, const CellAnim::CTRColor& newValue) {
                 originalKey.backColor = oldValue;
@@ -217,7 +227,7 @@ void WindowInspector::Level_Key() {
     }
 
     if (newKey != originalKey) {
-        key = originalKey;
+        playerManager.editKey() = originalKey;
 
         sessionManager.getCurrentSession()->addCommand(
         std::make_shared<CommandModifyAnimationKey>(
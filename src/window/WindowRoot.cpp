@@ -1,5 +1,7 @@
 #include "WindowRoot.hpp"
 
+#include <utility>
+
 #include "manager/SessionManager.hpp"
 #include "manager/PlayerManager.hpp"
 #include "manager/ConfigManager.hpp"
@@ -375,6 +377,11 @@ void WindowRoot::doMenubar() {
             if (ImGui::MenuItem("Transform .."))
                 Popups::MTransformAnimation::getInstance().open();
 
+            ImGui::Separator();
+
+            if (ImGui::MenuItem("Export as APNG .."))
+                Actions::ExportAnimationPromptPath();
+
             ImGui::EndMenu();
         }
 
@@ -494,7 +501,7 @@ void WindowRoot::doMenubar() {
             if (ImGui::MenuItem("Make arrangement unique (duplicate)")) {
                 auto& cellAnim = *sessionManager.getCurrentSession()->getCurrentCellAnim().object;
 
-                auto& key = playerManager.getKey();
+                const auto& key = playerManager.getKey();
 
                 unsigned index = cellAnim.duplicateArrangement(key.arrangementIndex);
 
@@ -511,7 +518,7 @@ void WindowRoot::doMenubar() {
                     ));
                 }
                 else
-                    key.arrangementIndex = index;
+                    playerManager.editKey().arrangementIndex = index;
             }
 
             ImGui::Separator();
@@ -545,7 +552,7 @@ void WindowRoot::doMenubar() {
         )) {
             const auto& selectionState = sessionManager.getCurrentSession()->getPartSelectState();
 
-            auto& part = playerManager.getArrangement().parts.at(selectionState.mSelected[0].index);
+            const auto& part = playerManager.getArrangement().parts.at(selectionState.mSelected[0].index);
 
             ImGui::Text(
                 "Selected part (no. %u)",
@@ -554,8 +561,10 @@ void WindowRoot::doMenubar() {
 
             ImGui::Separator();
 
-            ImGui::MenuItem("Visible", nullptr, &part.editorVisible);
-            ImGui::MenuItem("Locked", nullptr, &part.editorLocked);
+            if (ImGui::MenuItem("Visible", nullptr, part.editorVisible))
+                playerManager.editArrangement().parts.at(selectionState.mSelected[0].index).editorVisible ^= true;
+            if (ImGui::MenuItem("Locked", nullptr, part.editorLocked))
+                playerManager.editArrangement().parts.at(selectionState.mSelected[0].index).editorLocked ^= true;
 
             ImGui::Separator();
 
@@ -587,7 +596,7 @@ void WindowRoot::doMenubar() {
                         (auto res, const std::string* newName) {
                             auto session = SessionManager::getInstance().getCurrentSession();
                             auto& anim = session->getCurrentCellAnim();
-                            auto newPart = anim.object->getArrangement(arrangementIndex).parts.at(partIndex);
+                            auto newPart = std::as_const(*anim.object).getArrangement(arrangementIndex).parts.at(partIndex);
 
                             newPart.editorName = *newName;
 
@@ -24,6 +24,8 @@
 
 #include "font/FontAwesome.h"
 
+#include "Toast.hpp"
+
 #include "manager/AppState.hpp"
 
 #include "manager/SessionManager.hpp"
@@ -32,6 +34,7 @@
 #include "manager/PromptPopupManager.hpp"
 
 #include "texture/TextureEx.hpp"
+#include "texture/SheetFormatPreview.hpp"
 
 #include "texture/RvlImageConvert.hpp"
 #include "texture/CtrImageConvert.hpp"
@@ -121,18 +124,35 @@ void WindowSpritesheet::FormatPopup() {
 
         const bool isRVL = sessionManager.getCurrentSession()->type == CellAnim::CELLANIM_TYPE_RVL;
 
-        constexpr std::array<TPL::TPLImageFormat, 4> rvlFormats = {
+        constexpr std::array<TPL::TPLImageFormat, 11> rvlFormats = {
             TPL::TPL_IMAGE_FORMAT_RGBA32,
             TPL::TPL_IMAGE_FORMAT_RGB5A3,
             TPL::TPL_IMAGE_FORMAT_CMPR,
-            TPL::TPL_IMAGE_FORMAT_C14X2
+            TPL::TPL_IMAGE_FORMAT_C14X2,
+            TPL::TPL_IMAGE_FORMAT_C8,
+            TPL::TPL_IMAGE_FORMAT_C4,
+            TPL::TPL_IMAGE_FORMAT_RGB565,
+            TPL::TPL_IMAGE_FORMAT_IA8,
+            TPL::TPL_IMAGE_FORMAT_IA4,
+            TPL::TPL_IMAGE_FORMAT_I8,
+            TPL::TPL_IMAGE_FORMAT_I4
         };
         constexpr unsigned defaultRvlFormatIdx = 1;
 
-        constexpr std::array<CTPK::CTPKImageFormat, 3> ctrFormats = {
+        constexpr std::array<CTPK::CTPKImageFormat, 13> ctrFormats = {
             CTPK::CTPK_IMAGE_FORMAT_RGBA8888,
             CTPK::CTPK_IMAGE_FORMAT_RGBA4444,
-            CTPK::CTPK_IMAGE_FORMAT_ETC1A4
+            CTPK::CTPK_IMAGE_FORMAT_ETC1A4,
+            CTPK::CTPK_IMAGE_FORMAT_ETC1,
+            CTPK::CTPK_IMAGE_FORMAT_RGB888,
+            CTPK::CTPK_IMAGE_FORMAT_RGBA5551,
+            CTPK::CTPK_IMAGE_FORMAT_RGB565,
+            CTPK::CTPK_IMAGE_FORMAT_LA88,
+            CTPK::CTPK_IMAGE_FORMAT_LA44,
+            CTPK::CTPK_IMAGE_FORMAT_L8,
+            CTPK::CTPK_IMAGE_FORMAT_L4,
+            CTPK::CTPK_IMAGE_FORMAT_A8,
+            CTPK::CTPK_IMAGE_FORMAT_A4
         };
         constexpr unsigned defaultCtrFormatIdx = 2;
 
@@ -152,139 +172,53 @@ void WindowSpritesheet::FormatPopup() {
         static int selectedFormatIndex { 0 };
         static int mipCount { 1 };
 
-        static unsigned colorPaletteCount { 0 };
-        static unsigned colorPaletteSize { 0 };
-
-        auto updateTextureData = [&]() {
-            unsigned selectedMax = isRVL ? rvlFormats.size() - 1 : ctrFormats.size() - 1;
-            if (selectedFormatIndex > selectedMax)
-                selectedFormatIndex = selectedMax;
+        static bool formatChanged { false };
 
-            unsigned char* imageData = cellanimSheet->getRGBA32();
-            if (!imageData)
-                return;
+        if (!lateOpen) {
+            mipCount = cellanimSheet->getOutputMipCount();
+            formatChanged = false;
 
             if (isRVL) {
-                unsigned bufferSize = RvlImageConvert::getImageByteSize(
-                    rvlFormats[selectedFormatIndex],
-                    cellanimSheet->getWidth(), cellanimSheet->getHeight()
-                );
-
-                unsigned char* imageBuffer = new unsigned char[bufferSize];
-
-                std::vector<uint32_t> colorPalette;
-                colorPaletteCount = 0;
-
-                // Only actually initialize color palette buffer if needed.
-                switch (rvlFormats[selectedFormatIndex]) {
-                case TPL::TPL_IMAGE_FORMAT_C14X2:
-                    colorPalette = std::vector<uint32_t>(16384);
-                    break;
-                case TPL::TPL_IMAGE_FORMAT_C8:
-                    colorPalette = std::vector<uint32_t>(256);
-                    break;
-                case TPL::TPL_IMAGE_FORMAT_C4:
-                    colorPalette = std::vector<uint32_t>(16);
-                    break;
-
-                default:
-                    break;
-                }
-
-                RvlImageConvert::fromRGBA32(
-                    imageBuffer, colorPalette.data(), &colorPaletteCount,
-                    rvlFormats[selectedFormatIndex],
-                    cellanimSheet->getWidth(), cellanimSheet->getHeight(),
-                    imageData
-                );
-
-                // colorPaletteCount * sizeof CLUT entry
-                colorPaletteSize = colorPaletteCount * 2;
-
-                // Swap buffers.
-                RvlImageConvert::toRGBA32(
-                    imageData, rvlFormats[selectedFormatIndex],
-                    cellanimSheet->getWidth(), cellanimSheet->getHeight(),
-                    imageBuffer, colorPalette.data()
+                auto it = std::find(
+                    rvlFormats.begin(), rvlFormats.end(), cellanimSheet->getTPLOutputFormat()
                 );
 
-                delete[] imageBuffer;
+                if (it != rvlFormats.end())
+                    selectedFormatIndex = std::distance(rvlFormats.begin(), it);
+                else
+                    selectedFormatIndex = defaultRvlFormatIdx;
             }
             else {
-                unsigned bufferSize = CtrImageConvert::getImageByteSize(
-                    ctrFormats[selectedFormatIndex],
-                    cellanimSheet->getWidth(), cellanimSheet->getHeight(), 1
+                auto it = std::find(
+                    ctrFormats.begin(), ctrFormats.end(), cellanimSheet->getCTPKOutputFormat()
                 );
 
-                unsigned char* imageBuffer = new unsigned char[bufferSize];
-
-                CtrImageConvert::fromRGBA32(
-                    imageBuffer, ctrFormats[selectedFormatIndex],
-                    cellanimSheet->getWidth(), cellanimSheet->getHeight(),
-                    imageData
-                );
-
-                // Swap buffers.
-                CtrImageConvert::toRGBA32(
-                    imageData, ctrFormats[selectedFormatIndex],
-                    cellanimSheet->getWidth(), cellanimSheet->getHeight(),
-                    imageBuffer
-                );
-
-                delete[] imageBuffer;
+                if (it != ctrFormats.end())
+                    selectedFormatIndex = std::distance(ctrFormats.begin(), it);
+                else
+                    selectedFormatIndex = defaultCtrFormatIdx;
             }
+        }
+        lateOpen = true;
 
-            mFormattingNewTex->loadRGBA32(
-                imageData,
-                cellanimSheet->getWidth(), cellanimSheet->getHeight()
-            );
-
-            if (isRVL)
-                mFormattingNewTex->setTPLOutputFormat(rvlFormats[selectedFormatIndex]);
-            else
-                mFormattingNewTex->setCTPKOutputFormat(ctrFormats[selectedFormatIndex]);
-
-            delete[] imageData;
-        };
-
-        if (!lateOpen) {
-            mipCount = cellanimSheet->getOutputMipCount();
-
-            mFormattingNewTex = std::make_shared<TextureEx>();
-
-            unsigned char* imageData = cellanimSheet->getRGBA32();
-            if (imageData) {
-                mFormattingNewTex->loadRGBA32(
-                    imageData,
-                    cellanimSheet->getWidth(), cellanimSheet->getHeight()
-                );
-                delete[] imageData;
-
-                mFormattingNewTex->setOutputMipCount(mipCount);
+        if (!mFormatPreview)
+            mFormatPreview = std::make_unique<SheetFormatPreview>();
+        mFormatPreview->setSheet(cellanimSheet);
 
-                if (isRVL) {
-                    auto it = std::find(
-                        rvlFormats.begin(), rvlFormats.end(), cellanimSheet->getTPLOutputFormat()
-                    );
+        // Encoded on a worker; nullptr until it's done.
+        std::shared_ptr<const SheetFormatPreview::Result> preview = isRVL ?
+            mFormatPreview->getTPL(rvlFormats[selectedFormatIndex], mipCount) :
+            mFormatPreview->getCTPK(ctrFormats[selectedFormatIndex], mipCount);
 
-                    if (it != rvlFormats.end())
-                        selectedFormatIndex = std::distance(rvlFormats.begin(), it);
-                    else
-                        selectedFormatIndex = defaultRvlFormatIdx;
-                }
-                else {
-                    auto it = std::find(
-                        ctrFormats.begin(), ctrFormats.end(), cellanimSheet->getCTPKOutputFormat()
-                    );
+        // Keep updating so the preview shows up when it's done.
+        if (mFormatPreview->isBusy())
+            Toast::getInstance()->requestUpdates();
 
-                    if (it != ctrFormats.end())
-                        selectedFormatIndex = std::distance(ctrFormats.begin(), it);
-                    else
-                        selectedFormatIndex = defaultCtrFormatIdx;
-                }
-            }
-        }
-        lateOpen = true;
+        // Keep showing the last preview until the new one is done.
+        if (preview && preview->texture)
+            mFormatPreviewTex = preview->texture;
+        else if (!mFormatPreviewTex)
+            mFormatPreviewTex = cellanimSheet;
 
         // Left
         {
@@ -320,10 +254,16 @@ void WindowSpritesheet::FormatPopup() {
 
                     uint32_t dataSize;
 
-                    if (isRVL) {
+                    // The size of the palette is only known once encoded.
+                    if (preview && preview->ok)
+                        dataSize = preview->dataSize;
+                    else if (isRVL) {
+                        const TPL::TPLImageFormat format = rvlFormats[selectedFormatIndex];
+
                         dataSize = RvlImageConvert::getImageByteSize(
-                            rvlFormats[selectedFormatIndex], imageWidth, imageHeight
-                        ) + colorPaletteSize;
+                            format, imageWidth, imageHeight,
+                            TPL::getImageFormatMipmappable(format) ? mipCount : 1
+                        );
                     }
                     else {
                         dataSize = CtrImageConvert::getImageByteSize(
@@ -331,7 +271,6 @@ void WindowSpritesheet::FormatPopup() {
                         );
                     }
 
-
                     char formattedStr[32];
                     {
                         char numberStr[32];
@@ -382,6 +321,8 @@ void WindowSpritesheet::FormatPopup() {
                             colorDesc = "Colors: 24-bit, millions of colors";
                             alphaDesc = "Alpha: 8-bit, ranged 0 to 255";
                             break;
+                        case TPL::TPL_IMAGE_FORMAT_C4:
+                        case TPL::TPL_IMAGE_FORMAT_C8:
                         case TPL::TPL_IMAGE_FORMAT_C14X2: // Uses RGB5A3 for the CLUT.
                             showPaletteCount = true;
                         case TPL::TPL_IMAGE_FORMAT_RGB5A3:
@@ -402,6 +343,26 @@ void WindowSpritesheet::FormatPopup() {
                                 "      12-bit, 4096 colors";
                             alphaDesc = "Alpha: 3-bit, ranged 0 to 7";
                             break;
+                        case TPL::TPL_IMAGE_FORMAT_RGB565:
+                            colorDesc = "Colors: 16-bit, 65536 colors";
+                            alphaDesc = "Alpha: none";
+                            break;
+                        case TPL::TPL_IMAGE_FORMAT_IA8:
+                            colorDesc = "Colors: 8-bit grayscale";
+                            alphaDesc = "Alpha: 8-bit, ranged 0 to 255";
+                            break;
+                        case TPL::TPL_IMAGE_FORMAT_IA4:
+                            colorDesc = "Colors: 4-bit grayscale";
+                            alphaDesc = "Alpha: 4-bit, ranged 0 to 15";
+                            break;
+                        case TPL::TPL_IMAGE_FORMAT_I8:
+                            colorDesc = "Colors: 8-bit grayscale";
+                            alphaDesc = "Alpha: none";
+                            break;
+                        case TPL::TPL_IMAGE_FORMAT_I4:
+                            colorDesc = "Colors: 4-bit grayscale";
+                            alphaDesc = "Alpha: none";
+                            break;
                         default:
                             break;
                         }
@@ -420,6 +381,46 @@ void WindowSpritesheet::FormatPopup() {
                             colorDesc = "Colors (per block): 24-bit, millions of colors";
                             alphaDesc = "Alpha: 4-bit, ranged 0 to 15";
                             break;
+                        case CTPK::CTPK_IMAGE_FORMAT_ETC1:
+                            colorDesc = "Colors (per block): 24-bit, millions of colors";
+                            alphaDesc = "Alpha: none";
+                            break;
+                        case CTPK::CTPK_IMAGE_FORMAT_RGB888:
+                            colorDesc = "Colors: 24-bit, millions of colors";
+                            alphaDesc = "Alpha: none";
+                            break;
+                        case CTPK::CTPK_IMAGE_FORMAT_RGBA5551:
+                            colorDesc = "Colors: 15-bit, 32768 colors";
+                            alphaDesc = "Alpha: 1-bit, opaque or transparent";
+                            break;
+                        case CTPK::CTPK_IMAGE_FORMAT_RGB565:
+                            colorDesc = "Colors: 16-bit, 65536 colors";
+                            alphaDesc = "Alpha: none";
+                            break;
+                        case CTPK::CTPK_IMAGE_FORMAT_LA88:
+                            colorDesc = "Colors: 8-bit grayscale";
+                            alphaDesc = "Alpha: 8-bit, ranged 0 to 255";
+                            break;
+                        case CTPK::CTPK_IMAGE_FORMAT_LA44:
+                            colorDesc = "Colors: 4-bit grayscale";
+                            alphaDesc = "Alpha: 4-bit, ranged 0 to 15";
+                            break;
+                        case CTPK::CTPK_IMAGE_FORMAT_L8:
+                            colorDesc = "Colors: 8-bit grayscale";
+                            alphaDesc = "Alpha: none";
+                            break;
+                        case CTPK::CTPK_IMAGE_FORMAT_L4:
+                            colorDesc = "Colors: 4-bit grayscale";
+                            alphaDesc = "Alpha: none";
+                            break;
+                        case CTPK::CTPK_IMAGE_FORMAT_A8:
+                            colorDesc = "Colors: none (black)";
+                            alphaDesc = "Alpha: 8-bit, ranged 0 to 255";
+                            break;
+                        case CTPK::CTPK_IMAGE_FORMAT_A4:
+                            colorDesc = "Colors: none (black)";
+                            alphaDesc = "Alpha: 4-bit, ranged 0 to 15";
+                            break;
                         default:
                             break;
                         }
@@ -429,8 +430,12 @@ void WindowSpritesheet::FormatPopup() {
                         ImGui::BulletText("%s", colorDesc);
                     if (alphaDesc)
                         ImGui::BulletText("%s", alphaDesc);
-                    if (showPaletteCount)
-                        ImGui::BulletText("Paletted (%u colors)", colorPaletteCount);
+                    if (showPaletteCount) {
+                        if (preview)
+                            ImGui::BulletText("Paletted (%u colors)", preview->paletteCount);
+                        else
+                            ImGui::BulletText("Paletted (counting colors..)");
+                    }
                 }
                 ImGui::EndChild();
             }
@@ -447,14 +452,12 @@ void WindowSpritesheet::FormatPopup() {
                 if (selectedFormatIndex > selectedMax)
                     selectedFormatIndex = selectedMax;
 
-                updateTextureData();
+                formatChanged = true;
             }
 
             if (ImGui::InputInt("Mip-levels", &mipCount, 1, 2)) {
                 if (mipCount < 1) mipCount = 1;
                 if (mipCount > 8) mipCount = 8;
-
-                mFormattingNewTex->setOutputMipCount(mipCount);
             }
 
             ImGui::EndChild();
@@ -463,21 +466,37 @@ void WindowSpritesheet::FormatPopup() {
                 ImGui::CloseCurrentPopup();
             ImGui::SameLine();
 
+            // A new format is applied as it's previewed, so wait for it.
+            ImGui::BeginDisabled(formatChanged && !(preview && preview->ok));
+
             if (ImGui::Button("Apply")) {
-                mFormattingNewTex->setName(cellanimSheet->getName());
+                std::shared_ptr<TextureEx> srcTex = formatChanged ? preview->texture : cellanimSheet;
+
+                unsigned width, height, revision;
+                std::vector<unsigned char> pixels = srcTex->getPixels(width, height, revision);
+
+                auto newTex = std::make_shared<TextureEx>(width, height, std::move(pixels));
+
+                newTex->setName(cellanimSheet->getName());
+                newTex->setOutputMipCount(mipCount);
+
+                if (isRVL)
+                    newTex->setTPLOutputFormat(rvlFormats[selectedFormatIndex]);
+                else
+                    newTex->setCTPKOutputFormat(ctrFormats[selectedFormatIndex]);
 
                 sessionManager.getCurrentSession()->addCommand(
                 std::make_shared<CommandModifySpritesheet>(
                     sessionManager.getCurrentSession()
                         ->getCurrentCellAnim().object->getSheetIndex(),
-                    mFormattingNewTex
+                    newTex
                 ));
 
-                mFormattingNewTex.reset();
-
                 ImGui::CloseCurrentPopup();
             }
 
+            ImGui::EndDisabled();
+
             ImGui::EndGroup();
         }
 
@@ -517,21 +536,31 @@ void WindowSpritesheet::FormatPopup() {
                 ImGui::ColorConvertFloat4ToU32({ bgScale, bgScale, bgScale, 1.f })
             );
 
-            if (mFormattingNewTex)
+            if (mFormatPreviewTex)
                 ImGui::GetWindowDrawList()->AddImage(
-                    mFormattingNewTex->getImTextureId(),
+                    mFormatPreviewTex->syncAndGetImTextureId(),
                     imagePosition,
                     { imagePosition.x + imageRect.x, imagePosition.y + imageRect.y, }
                 );
 
+            if (!preview)
+                ImGui::TextUnformatted("Encoding..");
+            else if (!preview->ok)
+                ImGui::TextUnformatted("Encoding failed; check the log for details.");
+
             ImGui::EndChild();
         }
 
         ImGui::EndPopup();
     }
-    else
+    else {
         lateOpen = false;
 
+        // Cancels the preview being worked on & drops the cached ones.
+        mFormatPreview.reset();
+        mFormatPreviewTex.reset();
+    }
+
         ImGui::PopID();
 }
 
@@ -773,6 +802,8 @@ void WindowSpritesheet::update() {
     if (ImGui::IsMouseDoubleClicked(ImGuiMouseButton_Left) && interactionHovered) {
         mSheetZoomTriggered = true;
         mSheetZoomTimer = static_cast<float>(ImGui::GetTime());
+
+        Toast::getInstance()->requestUpdates(SHEET_ZOOM_TIME);
     }
 
     if (
@@ -841,7 +872,7 @@ void WindowSpritesheet::update() {
     };
 
     drawList->AddImage(
-        cellanimSheet->getImTextureId(),
+        cellanimSheet->syncAndGetImTextureId(),
         imagePosition,
         { imagePosition.x + imageRect.x, imagePosition.y + imageRect.y, }
     );
@@ -8,6 +8,7 @@
 #include <imgui.h>
 
 #include "texture/TextureEx.hpp"
+#include "texture/SheetFormatPreview.hpp"
 
 class WindowSpritesheet : public BaseWindow {
 public:
@@ -41,7 +42,10 @@ private:
 
     bool mShowPaletteWindow { false };
 
-    std::shared_ptr<TextureEx> mFormattingNewTex;
+    // Format previews of the re-encode popup.
+    std::unique_ptr<SheetFormatPreview> mFormatPreview;
+    // The preview being shown.
+    std::shared_ptr<TextureEx> mFormatPreviewTex;
 };
 
 #endif // WINDOW_SPRITESHEET_HPP
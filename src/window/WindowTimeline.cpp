@@ -513,7 +513,7 @@ void WindowTimeline::ChildKeys() {
                 {
                     auto& cellAnim = sessionManager.getCurrentSession()->getCurrentCellAnim().object;
 
-                    auto& animation = playerManager.getAnimation();
+                    const auto& animation = playerManager.getAnimation();
 
                     bool splitPossible = false;
                     if ((i + 1) < playerManager.getKeyCount() && (animation.keys.at(i).holdFrames > 1)) {